@@ -47,6 +47,7 @@ $CMAKE .. \
   -DCMAKE_POLICY_DEFAULT_CMP0091=NEW \
   -DBUILD_PROFILE=$BUILD_PROFILE \
   -DCMAKE_BUILD_TYPE="$BUILD_TYPE" \
+  -DPONG_CORE_ONLY="${PONG_CORE_ONLY:-OFF}" \
   "${CMAKE_EMULATOR_SETTINGS[@]}"
 
 # put dependencies' dll's on LD_LIBRARY_PATH etc
@@ -58,6 +59,11 @@ cmake --build . --parallel
 # run tests
 ctest .
 
+# a core only build has nothing to package
+if [ "${PONG_CORE_ONLY:-OFF}" == ON ]; then
+  exit 0
+fi
+
 # package
 cpack -G TGZ .
 
@@ -47,5 +47,6 @@ exec docker run \
   -e CONAN_HOME=/mnt/conan \
   -e "BUILD_ROOT=${BUILD_ROOT_IN_CONTAINER}" \
   -e BUILD_TYPE \
+  -e PONG_CORE_ONLY \
   "$BUILD_IMAGE" \
   "$@"
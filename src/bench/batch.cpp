@@ -0,0 +1,233 @@
+/**
+ * pong-batch-bench : plays many AI vs AI matches in fixed ticks, one match at
+ * a time (match_t::tick) and then with batch_t on one and on several worker
+ * threads, and reports the throughput of each.
+ *
+ *   pong-batch-bench [--matches N] [--seconds S] [--seed SEED] [--workers W]
+ *                    [--lhs PLUGIN] [--rhs PLUGIN] [--budget-us N]
+ *                    [--strikes N]
+ *
+ * seconds is simulated time per match; workers defaults to the number of
+ * hardware threads.
+ *
+ * With --lhs or --rhs a bot plugin (see pong_bot.h) plays that side of
+ * every match in place of the AI, each decision within a CPU time budget
+ * (see plugin_t); the bench then also reports each plugin's decision times
+ * and how the last run's matches stand.
+ */
+#include "batch.hpp"
+#include "bot.hpp"
+#include "concurrency.hpp"
+#include "match.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+
+// long matches, so that most are still in play at the end
+const p::rules_t rules{.ai_skill = 95, .winning_score = 100};
+
+struct options_t {
+  std::size_t matches = 1024;
+  std::size_t seconds = 30;
+  std::mt19937::result_type seed = 4242;
+  std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+  std::string lhs;
+  std::string rhs;
+  std::size_t budget_us = 100;
+  unsigned strikes = 8;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--matches")
+      ok = parse(value, options.matches);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    else if (arg == "--workers")
+      ok = parse(value, options.workers);
+    else if (arg == "--lhs") {
+      options.lhs = value;
+      ok = !value.empty();
+    } else if (arg == "--rhs") {
+      options.rhs = value;
+      ok = !value.empty();
+    } else if (arg == "--budget-us")
+      ok = parse(value, options.budget_us);
+    else if (arg == "--strikes")
+      ok = parse(value, options.strikes);
+    if (!ok)
+      return false;
+  }
+  return options.matches > 0 && options.workers > 0;
+}
+
+const char *build() {
+#if defined(__EMSCRIPTEN__)
+  return "wasm";
+#elif defined(__AVX__)
+  return "native avx";
+#elif defined(__SSE2__)
+  return "native sse2";
+#else
+  return "native";
+#endif
+}
+
+void report(const char *name, const p::batch_t::stats_t &stats,
+            std::chrono::steady_clock::duration elapsed, double baseline) {
+  const auto ns = double(std::chrono::nanoseconds{elapsed}.count());
+  const auto ticks = double(std::max<std::size_t>(stats.ticks, 1));
+  std::printf("%-12s %10.1f %14.3f %9.2fx %11.1f%%\n", name, ns / ticks,
+              ticks / ns * 1e3, baseline > 0 ? baseline / (ns / ticks) : 1.,
+              100. * double(stats.vectorised) / ticks);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--matches N] [--seconds S] [--seed SEED] "
+                 "[--workers W] [--lhs PLUGIN] [--rhs PLUGIN] "
+                 "[--budget-us N] [--strikes N]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  std::unique_ptr<p::plugin_t> lhs;
+  std::unique_ptr<p::plugin_t> rhs;
+  try {
+    const std::chrono::microseconds budget{options.budget_us};
+    if (!options.lhs.empty())
+      lhs = std::make_unique<p::plugin_t>(options.lhs, budget, options.strikes);
+    if (!options.rhs.empty())
+      rhs = std::make_unique<p::plugin_t>(options.rhs, budget, options.strikes);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  // the plugins' bots for match i, seeded as its AIs would be
+  auto bots = [&](std::size_t i) {
+    const auto seed = options.seed + 3 * std::mt19937::result_type(i);
+    return std::pair{lhs ? std::make_unique<p::bot_t>(*lhs, seed + 1) : nullptr,
+                     rhs ? std::make_unique<p::bot_t>(*rhs, seed + 2)
+                         : nullptr};
+  };
+
+  constexpr std::size_t ticks_per_second = 120;
+  constexpr p::scalar_t dt = 1.f / ticks_per_second;
+  const std::size_t ticks = options.seconds * ticks_per_second;
+  const auto workers = p::threads ? options.workers : 1;
+
+  std::printf("build        %s\n", build());
+  std::printf("matches      %zu\n", options.matches);
+  std::printf("ticks each   %zu\n", ticks);
+  std::printf("workers      %zu\n", workers);
+  if (lhs || rhs)
+    std::printf("bots         %s vs %s, %zu us budget\n",
+                lhs ? lhs->name().c_str() : "ai",
+                rhs ? rhs->name().c_str() : "ai", options.budget_us);
+  std::printf("\n");
+  std::printf("%-12s %10s %14s %10s %12s\n", "", "ns / tick", "M ticks / s",
+              "speedup", "vectorised");
+
+  // one match at a time, as pong-bench
+  double baseline;
+  {
+    std::vector<std::unique_ptr<p::match_t>> matches;
+    for (std::size_t i = 0; i < options.matches; ++i) {
+      matches.emplace_back(std::make_unique<p::match_t>(
+          options.seed + 3 * std::mt19937::result_type(i), rules));
+      auto [l, r] = bots(i);
+      matches.back()->seat(std::move(l), std::move(r));
+    }
+
+    p::batch_t::stats_t stats;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < ticks; ++t) {
+      for (auto &m : matches) {
+        stats.ticks += m->in_play();
+        stats.actions += m->tick(dt);
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    report("match_t", stats, elapsed, 0);
+    baseline = double(std::chrono::nanoseconds{elapsed}.count()) /
+               double(std::max<std::size_t>(stats.ticks, 1));
+  }
+
+  // how the last run's matches stand: lhs ahead, rhs ahead, level
+  std::array<std::size_t, 3> standings{};
+  auto batch = [&](const char *name, std::size_t threads) {
+    p::batch_t batch{options.seed, options.matches, rules};
+    for (std::size_t i = 0; i < options.matches; ++i) {
+      auto [l, r] = bots(i);
+      batch.seat(i, std::move(l), std::move(r));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto stats = batch.run(ticks, dt, threads);
+    report(name, stats, std::chrono::steady_clock::now() - start, baseline);
+
+    standings = {};
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+      const auto &arena = batch[i].arena();
+      ++standings[arena.lhs_score() > arena.rhs_score()   ? 0
+                  : arena.lhs_score() < arena.rhs_score() ? 1
+                                                          : 2];
+    }
+  };
+
+  batch("batch_t", 1);
+  if (workers > 1)
+    batch("batch_t x W", workers);
+
+  if (!lhs && !rhs)
+    return 0;
+
+  std::printf("\n%-12s %10s %8s %8s %8s %8s %10s %9s\n", "decision us",
+              "decisions", "p50", "p90", "p99", "max", "over", "struck");
+  for (const auto *plugin : {lhs.get(), rhs.get()}) {
+    if (!plugin)
+      continue;
+    const auto stats = plugin->stats();
+    const auto us = [&](double q) {
+      return double(stats.cpu_ns.quantile(q)) / 1e3;
+    };
+    std::printf("%-12s %10lu %8.2f %8.2f %8.2f %8.2f %9.3f%% %9lu\n",
+                plugin->name().c_str(),
+                static_cast<unsigned long>(stats.cpu_ns.count()), us(.5),
+                us(.9), us(.99), us(1.),
+                100. * double(stats.over_budget) /
+                    double(std::max<std::uint64_t>(stats.cpu_ns.count(), 1)),
+                static_cast<unsigned long>(stats.suspended));
+  }
+  std::printf("\nstandings    %zu lhs ahead, %zu rhs ahead, %zu level\n",
+              standings[0], standings[1], standings[2]);
+  return 0;
+}
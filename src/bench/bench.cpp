@@ -0,0 +1,147 @@
+/**
+ * pong-bench : runs many arenas, each with an AI on both sides, in fixed
+ * ticks and reports the cost of a tick and the heap allocations made.
+ *
+ *   pong-bench [--arenas N] [--seconds S] [--seed SEED] [--hash on|off]
+ *
+ * seconds is simulated time per arena.  With --hash on each arena also keeps
+ * a hash_history_t, as a lockstep peer would, to show what that costs.
+ */
+#include "alloc.hpp"
+#include "hash.hpp"
+#include "model.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+namespace a = p::alloc;
+
+struct options_t {
+  std::size_t arenas = 64;
+  std::size_t seconds = 60;
+  std::mt19937::result_type seed = 4242;
+  bool hash = false;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--arenas")
+      ok = parse(value, options.arenas);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    else if (arg == "--hash") {
+      ok = value == "on" || value == "off";
+      options.hash = value == "on";
+    }
+    if (!ok)
+      return false;
+  }
+  return options.arenas > 0;
+}
+
+struct match_t {
+  explicit match_t(std::mt19937::result_type seed)
+      : arena{p::make_starter(seed)}, lhs{seed + 1, 10.f}, rhs{seed + 2, 10.f} {}
+
+  std::size_t tick(p::scalar_t dt) {
+    if (const auto s = lhs.paddle_speed(arena, arena.lhs_paddle()))
+      arena.lhs_paddle().velocity()(1) = *s;
+    if (const auto s = rhs.paddle_speed(arena, arena.rhs_paddle()))
+      arena.rhs_paddle().velocity()(1) = *s;
+    return arena.advance_time(dt);
+  }
+
+  std::size_t tick(p::scalar_t dt, p::hash_history_t &history) {
+    if (const auto s = lhs.paddle_speed(arena, arena.lhs_paddle())) {
+      arena.lhs_paddle().velocity()(1) = *s;
+      history.steer(arena.lhs_paddle());
+    }
+    if (const auto s = rhs.paddle_speed(arena, arena.rhs_paddle())) {
+      arena.rhs_paddle().velocity()(1) = *s;
+      history.steer(arena.rhs_paddle());
+    }
+    const auto actions =
+        arena.advance_time(dt, [&](p::scalar_t t, const p::action_t &action) {
+          history.action(arena, t, action);
+        });
+    history.end_tick();
+    return actions;
+  }
+
+  p::arena_t arena;
+  p::ai_t lhs;
+  p::ai_t rhs;
+  p::hash_history_t history{arena, 8, 8};
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--arenas N] [--seconds S] [--seed SEED] "
+                 "[--hash on|off]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  constexpr std::size_t ticks_per_second = 120;
+  constexpr p::scalar_t dt = 1.f / ticks_per_second;
+
+  std::vector<std::unique_ptr<match_t>> matches;
+  for (std::size_t i = 0; i < options.arenas; ++i) {
+    matches.emplace_back(std::make_unique<match_t>(options.seed + 3 * i));
+  }
+
+  const std::size_t ticks = options.seconds * ticks_per_second;
+  std::size_t actions = 0;
+
+  const a::scope_t scope;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < ticks; ++t) {
+    for (auto &m : matches) {
+      actions += options.hash ? m->tick(dt, m->history) : m->tick(dt);
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const auto counts = scope.counts();
+
+  const auto arena_ticks = double(ticks * options.arenas);
+  const auto ns = double(std::chrono::nanoseconds{elapsed}.count());
+
+  std::printf("arenas            %zu\n", options.arenas);
+  std::printf("hashed            %s\n", options.hash ? "yes" : "no");
+  std::printf("ticks per arena   %zu\n", ticks);
+  std::printf("ns per tick       %.1f\n", ns / arena_ticks);
+  std::printf("actions per tick  %.3f\n", double(actions) / arena_ticks);
+  std::printf("allocs per tick   %.3f\n",
+              double(counts.allocations) / arena_ticks);
+  std::printf("allocs per action %.3f\n",
+              actions ? double(counts.allocations) / double(actions) : 0.);
+  std::printf("bytes allocated   %llu\n",
+              static_cast<unsigned long long>(counts.bytes));
+
+  return 0;
+}
@@ -0,0 +1,317 @@
+/**
+ * pong-fanout-bench : a loopback load test of pong-server's spectators.
+ * Runs a server_t in process with a few players' matches and, on one thread
+ * of its own, a swarm of spectators watching them, each on a socket of its
+ * own.  Most read whatever arrives as it arrives; slow ones read a datagram
+ * now and then, so fall behind and are left to wait for keyframes.  Every
+ * spectator sends its watch again twice a second, with the latest tick it
+ * has read.
+ *
+ *   pong-fanout-bench [--matches N] [--spectators N] [--slow PERCENT]
+ *                     [--seconds S] [--loops N] [--seed SEED]
+ *
+ * Reports the server's tick times against the 2 ms budget a 60 Hz tick
+ * leaves room for, the datagrams it sent, how often spectators fell behind
+ * and how late what they read was, by when its tick was due.
+ */
+#include "host.hpp"
+#include "loopback.hpp"
+#include "net.hpp"
+#include "profile.hpp"
+#include "protocol.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace b = pong::bench;
+
+using clock_t = std::chrono::steady_clock;
+
+constexpr auto tick_budget = std::chrono::milliseconds{2};
+
+struct options_t {
+  std::size_t matches = 4;
+  std::size_t spectators = 4000;
+  std::size_t slow = 10;
+  std::size_t seconds = 5;
+  unsigned loops = std::max(1u, std::thread::hardware_concurrency());
+  std::mt19937::result_type seed = 4242;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--matches")
+      ok = parse(value, options.matches);
+    else if (arg == "--spectators")
+      ok = parse(value, options.spectators);
+    else if (arg == "--slow")
+      ok = parse(value, options.slow);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--loops")
+      ok = parse(value, options.loops);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    if (!ok)
+      return false;
+  }
+  return options.matches > 0 && options.spectators > 0 &&
+         options.slow <= 100 && options.loops > 0;
+}
+
+// how often players keep their matches alive and spectators say where they
+// are
+constexpr auto keepalive = std::chrono::milliseconds{500};
+
+// how often a slow spectator reads a datagram: more often than keyframes
+// come, less than a match's events and keyframes together do
+constexpr auto slow_read = std::chrono::milliseconds{700};
+
+template <typename Message>
+void send(const p::udp_socket_t &socket, const sockaddr_in &to,
+          const Message &message) {
+  p::datagrams_t out{1};
+  out.commit(pr::encode(message, out.prepare(to)));
+  out.send(socket);
+}
+
+struct spectator_t {
+  std::size_t match{};
+  bool slow{};
+  p::udp_socket_t socket{};
+  std::uint64_t tick{};
+  clock_t::time_point next_read{};
+};
+
+/**
+ * When each match's ticks are due, going by the earliest any arrived, and
+ * how late what spectators read was.
+ */
+class lateness_t {
+public:
+  lateness_t(std::size_t matches, clock_t::duration tick_period)
+      : tick_period_{tick_period},
+        origins_(matches, clock_t::time_point::max()) {}
+
+  void record(std::size_t match, std::uint64_t tick, bool slow,
+              clock_t::time_point now) {
+    const auto origin = now - tick_period_ * std::int64_t(tick);
+    origins_[match] = std::min(origins_[match], origin);
+    if (!measuring_)
+      return;
+    const auto late = std::chrono::nanoseconds{origin - origins_[match]};
+    (slow ? slow_ns_ : fast_ns_).record(std::uint64_t(late.count()));
+  }
+
+  void start() { measuring_ = true; }
+
+  [[nodiscard]] const p::histogram_t &fast_ns() const { return fast_ns_; }
+  [[nodiscard]] const p::histogram_t &slow_ns() const { return slow_ns_; }
+
+private:
+  clock_t::duration tick_period_;
+  std::vector<clock_t::time_point> origins_;
+  bool measuring_{};
+  p::histogram_t fast_ns_;
+  p::histogram_t slow_ns_;
+};
+
+double ms(std::uint64_t ns) { return double(ns) / 1e6; }
+double us(std::uint64_t ns) { return double(ns) / 1e3; }
+
+// room for a socket per spectator
+void raise_file_limit() {
+  rlimit limit{};
+  if (::getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--matches N] [--spectators N] [--slow PERCENT] "
+                 "[--seconds S] [--loops N] [--seed SEED]\n",
+                 argv[0]);
+    return 1;
+  }
+  raise_file_limit();
+
+  using clock_t = p::server_t::clock_t;
+
+  p::server_t server{{
+      .loops = options.loops,
+      .rules = b::long_matches,
+      .seed = options.seed,
+      .max_matches = options.matches,
+      .max_spectators = options.spectators,
+  }};
+  server.start();
+
+  // players who never move, but keep their matches alive
+  const p::udp_socket_t players;
+  std::vector<std::uint64_t> matches(options.matches);
+  clock_t::duration tick_period{};
+  {
+    p::datagrams_t in{64};
+    std::size_t welcomed = 0;
+    const auto joining = clock_t::now();
+    while (welcomed < matches.size()) {
+      if (clock_t::now() - joining > std::chrono::seconds{10}) {
+        std::fprintf(stderr, "players were not all welcomed\n");
+        return 1;
+      }
+      for (std::size_t i = 0; i < matches.size(); ++i)
+        if (!matches[i])
+          send(players, server.address(), pr::join_t{.nonce = i + 1});
+      std::this_thread::sleep_for(std::chrono::milliseconds{50});
+      in.receive(players);
+      for (std::size_t i = 0; i < in.size(); ++i) {
+        pr::welcome_t welcome;
+        if (!pr::decode(in.payload(i), welcome) || welcome.nonce == 0 ||
+            welcome.nonce > matches.size() || matches[welcome.nonce - 1])
+          continue;
+        matches[welcome.nonce - 1] = welcome.match;
+        tick_period = std::chrono::microseconds{welcome.tick_period_us};
+        ++welcomed;
+      }
+    }
+  }
+
+  const auto slow_every =
+      options.slow ? 100 / options.slow
+                   : std::numeric_limits<std::size_t>::max();
+  std::vector<std::unique_ptr<spectator_t>> spectators;
+  p::epoll_t epoll;
+  for (std::size_t i = 0; i < options.spectators; ++i) {
+    auto &s = *spectators.emplace_back(std::make_unique<spectator_t>());
+    s.match = i % matches.size();
+    s.slow = options.slow && i % slow_every == 0;
+    // the slow are read on a timer instead
+    if (!s.slow)
+      epoll.add(s.socket.fd(), EPOLLIN, i);
+  }
+
+  lateness_t lateness{matches.size(), tick_period};
+  p::datagrams_t in{16};
+  p::datagrams_t one{1};
+  auto read = [&](spectator_t &s, const p::datagrams_t &in,
+                  clock_t::time_point now) {
+    for (std::size_t i = 0; i < in.size(); ++i) {
+      pr::events_t events;
+      if (!pr::decode(in.payload(i), events))
+        continue;
+      s.tick = std::max(s.tick, events.tick);
+      lateness.record(s.match, events.tick, s.slow, now);
+    }
+  };
+
+  auto next_keepalive = clock_t::now();
+  auto run = [&](clock_t::time_point until) {
+    while (clock_t::now() < until) {
+      for (const auto &event : epoll.wait(std::chrono::milliseconds{1})) {
+        auto &s = *spectators[event.data.u64];
+        in.receive(s.socket);
+        read(s, in, clock_t::now());
+      }
+      const auto now = clock_t::now();
+      for (auto &s : spectators) {
+        if (!s->slow || now < s->next_read)
+          continue;
+        one.receive(s->socket);
+        read(*s, one, now);
+        s->next_read = now + slow_read;
+      }
+      if (now >= next_keepalive) {
+        for (const auto match : matches)
+          send(players, server.address(),
+               pr::command_t{.match = match, .sequence = 1});
+        for (const auto &s : spectators)
+          send(s->socket, server.address(),
+               pr::watch_t{.match = matches[s->match], .tick = s->tick});
+        next_keepalive = now + keepalive;
+      }
+    }
+  };
+
+  // until every spectator has heard something, and a little longer for the
+  // slow to fall behind
+  const auto watching = clock_t::now();
+  while (!std::ranges::all_of(spectators, [](auto &s) { return s->tick; })) {
+    if (clock_t::now() - watching > std::chrono::seconds{10}) {
+      std::fprintf(stderr, "spectators were not all sent their matches\n");
+      return 1;
+    }
+    run(clock_t::now() + std::chrono::milliseconds{100});
+  }
+  run(clock_t::now() + std::chrono::seconds{2});
+
+  // measure only the steady state
+  const auto before = server.stats();
+  lateness.start();
+  const auto start = clock_t::now();
+  run(start + std::chrono::seconds{options.seconds});
+  const auto seconds =
+      std::chrono::duration<double>(clock_t::now() - start).count();
+  const auto after = server.stats();
+
+  for (const auto &s : spectators)
+    send(s->socket, server.address(), pr::leave_t{.match = matches[s->match]});
+  server.stop();
+
+  auto ticks = after.tick_ns;
+  ticks -= before.tick_ns;
+
+  const auto slow =
+      std::ranges::count_if(spectators, [](auto &s) { return s->slow; });
+  const auto per_second = [&](std::uint64_t n) { return double(n) / seconds; };
+  std::printf("spectators   %lu of %zu matches (%ld slow) on %u loops\n",
+              static_cast<unsigned long>(after.spectators), matches.size(),
+              static_cast<long>(slow), options.loops);
+  std::printf("ticks        %lu, %lu overran\n",
+              static_cast<unsigned long>(after.ticks - before.ticks),
+              static_cast<unsigned long>(after.overruns - before.overruns));
+  std::printf("tick us      p50 %.1f  p99 %.1f  max %.1f  (budget %.0f)\n",
+              us(ticks.quantile(.5)), us(ticks.quantile(.99)),
+              us(ticks.max()),
+              us(std::chrono::nanoseconds{tick_budget}.count()));
+  std::printf("server       %.0f datagrams / s out, %lu dropped\n",
+              per_second(after.sent - before.sent),
+              static_cast<unsigned long>(after.dropped - before.dropped));
+  std::printf("skips        %.1f / s\n",
+              per_second(after.skips - before.skips));
+  std::printf("late ms      p50 %.1f  p99 %.1f  (slow: p50 %.1f  p99 %.1f)\n",
+              ms(lateness.fast_ns().quantile(.5)),
+              ms(lateness.fast_ns().quantile(.99)),
+              ms(lateness.slow_ns().quantile(.5)),
+              ms(lateness.slow_ns().quantile(.99)));
+
+  return after.spectators == options.spectators ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+/**
+ * pong-feed-bench : the round trip of a feed (see feed.hpp), from a state
+ * published to the command answering it.  Creates a feed and forks a bot
+ * that opens it by name, as pong-feed-bot would, and answers every state it
+ * sees at once.  Publishes a state to every arena each period, spinning on
+ * the commands in between, and times each from its state's publication.
+ *
+ *   pong-feed-bench [--arenas N] [--seconds S] [--period-us N]
+ *                   [--spins N]
+ *
+ * Reports the round trip and the states answered too late, after the next
+ * was published.  Both sides spin, yielding the CPU only after --spins
+ * spins, or at once with one CPU, where the round trip is then mostly the
+ * scheduler's two context switches rather than the feed's.
+ */
+#include "feed.hpp"
+#include "profile.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+
+struct options_t {
+  std::size_t arenas = 64;
+  std::size_t seconds = 5;
+  std::size_t period_us = 1000;
+  // spins before yielding the CPU, on both sides; with one CPU, spinning
+  // only keeps the other side from running
+  int spins = std::thread::hardware_concurrency() > 1 ? 1 << 12 : 0;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--arenas")
+      ok = parse(value, options.arenas);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--period-us")
+      ok = parse(value, options.period_us);
+    else if (arg == "--spins")
+      ok = parse(value, options.spins);
+    if (!ok)
+      return false;
+  }
+  return options.arenas > 0 && options.period_us > 0;
+}
+
+// answer every state published until killed
+[[noreturn]] void bot(const std::string &name, int spins) {
+  p::feed_t feed{name};
+  std::vector<std::uint64_t> seen(feed.arenas());
+  for (int idle = 0;;) {
+    bool any = false;
+    for (std::size_t i = 0; i < seen.size(); ++i) {
+      const auto published = feed.published(i);
+      if (published == seen[i])
+        continue;
+      seen[i] = published;
+      any = true;
+      if (const auto state = feed.latest(i))
+        feed.command(i, {.match = state->match, .tick = state->tick});
+    }
+    if (any)
+      idle = 0;
+    else if (++idle < spins)
+      p::spin();
+    else
+      std::this_thread::yield();
+  }
+}
+
+double us(std::uint64_t ns) { return double(ns) / 1e3; }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--arenas N] [--seconds S] [--period-us N] "
+                 "[--spins N]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  using clock_t = std::chrono::steady_clock;
+
+  const auto name = "/pong-feed-bench-" + std::to_string(::getpid());
+  const std::chrono::microseconds period{options.period_us};
+  p::feed_t feed{name, options.arenas, period};
+
+  const auto child = ::fork();
+  if (child < 0) {
+    std::perror("fork");
+    return 1;
+  }
+  if (child == 0)
+    bot(name, options.spins);
+
+  p::histogram_t round_trip_ns;
+  std::uint64_t published = 0;
+  std::uint64_t answered = 0;
+  std::uint64_t stale = 0;
+
+  std::uint64_t tick = 0;
+  auto sent = clock_t::now();
+  const auto start = sent;
+  const auto until = start + std::chrono::seconds{options.seconds};
+  // the first second, while the bot starts, is not measured
+  const auto measured = start + std::chrono::seconds{1};
+  for (auto next = start; next < until; next += period) {
+    ++tick;
+    sent = clock_t::now();
+    for (std::size_t i = 0; i < options.arenas; ++i)
+      feed.publish(i, {.match = i + 1, .tick = tick, .in_play = 1});
+    const bool measuring = sent >= measured;
+    published += measuring ? options.arenas : 0;
+
+    // take up the answers until the next period
+    next = std::max(next, sent);
+    for (int idle = 0; clock_t::now() < next + period;) {
+      bool any = false;
+      for (std::size_t i = 0; i < options.arenas; ++i)
+        while (const auto command = feed.command(i)) {
+          any = true;
+          if (!measuring)
+            continue;
+          if (command->tick != tick) {
+            ++stale;
+            continue;
+          }
+          ++answered;
+          round_trip_ns.record(std::uint64_t(
+              std::chrono::nanoseconds{clock_t::now() - sent}.count()));
+        }
+      if (any)
+        idle = 0;
+      else if (++idle < options.spins)
+        p::spin();
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  ::kill(child, SIGKILL);
+  ::waitpid(child, nullptr, 0);
+
+  std::printf("arenas       %zu, a state each every %zu us\n",
+              options.arenas, options.period_us);
+  std::printf("states       %lu published, %lu answered in time, "
+              "%lu late\n",
+              static_cast<unsigned long>(published),
+              static_cast<unsigned long>(answered),
+              static_cast<unsigned long>(stale));
+  std::printf("round trip   p50 %.1f us  p99 %.1f us  max %.1f us\n",
+              us(round_trip_ns.quantile(.5)), us(round_trip_ns.quantile(.99)),
+              us(round_trip_ns.max()));
+
+  // a short run only checks that the feed works
+  return answered > 0 ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/**
+ * pong-frame-bench : builds the game's ImGui frames headless (no window, no
+ * GPU), driven by a scripted sequence of mouse, wheel and key input, and
+ * reports the CPU time per frame (and the frame rate the slowest would
+ * allow), the size of the resulting draw lists and the heap allocations
+ * made.  With --raster it also renders each frame in software with that
+ * many threads and reports the time taken.  With --spectate it builds a
+ * 1920 x 1080 spectator wall of that many arenas instead of the game.
+ *
+ *   pong-frame-bench [--frames N] [--warmup N] [--seed SEED]
+ *                    [--raster THREADS] [--ppm FILE]
+ *                    [--spectate COLUMNSxROWS]
+ *
+ * The first warmup frames (at least one pass of the script) aren't measured.
+ * --ppm writes the last rendered frame as an image.
+ */
+#include "alloc.hpp"
+#include "headless.hpp"
+#include "profile.hpp"
+#include "raster.hpp"
+#include "simulation.hpp"
+#include "spectator.hpp"
+#include "ui.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace {
+
+namespace p = pong;
+namespace a = p::alloc;
+
+struct options_t {
+  std::size_t frames = 3000;
+  std::size_t warmup = 600;
+  std::mt19937::result_type seed = 4242;
+  unsigned raster = 0;
+  std::string_view ppm;
+  int columns = 0;
+  int rows = 0;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+// COLUMNSxROWS
+bool parse_grid(std::string_view s, options_t &options) {
+  const auto x = s.find('x');
+  return x != std::string_view::npos &&
+         parse(s.substr(0, x), options.columns) &&
+         parse(s.substr(x + 1), options.rows) && options.columns > 0 &&
+         options.rows > 0;
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--frames")
+      ok = parse(value, options.frames);
+    else if (arg == "--warmup")
+      ok = parse(value, options.warmup);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    else if (arg == "--raster")
+      ok = parse(value, options.raster);
+    else if (arg == "--ppm")
+      ok = !(options.ppm = value).empty();
+    else if (arg == "--spectate")
+      ok = parse_grid(value, options);
+    if (!ok)
+      return false;
+  }
+  return options.frames > 0 && (options.ppm.empty() || options.raster > 0);
+}
+
+/**
+ * The input a user might give over ten seconds at 60 fps, as a platform
+ * backend would report it.  Positions are roughly where the widgets are with
+ * the default style in a 660 x 660 window.
+ */
+class script_t {
+public:
+  static constexpr std::size_t length = 600;
+
+  void operator()(std::size_t frame, ImGuiIO &io, p::simulation_t &simulation,
+                  p::simulation_t::clock_t::time_point now) {
+    const auto f = frame % length;
+
+    if (f < 120) {
+      // wander over the arena, scrolling the paddle up and down
+      const float t = float(f) / 120.f;
+      io.AddMousePosEvent(330.f + 200.f * t, 200.f + 200.f * t);
+      if (f % 8 == 0) {
+        const float wheel = (f / 8) % 4 < 2 ? 1.f : -1.f;
+        io.AddMouseWheelEvent(0.f, wheel);
+        simulation.input({now, p::input_t::kind_t::wheel, wheel});
+      }
+    } else if (f < 180) {
+      // drag the paddle size slider from one end to the other
+      io.AddMousePosEvent(100.f + 300.f * float(f - 120) / 60.f, 40.f);
+      if (f == 121)
+        io.AddMouseButtonEvent(0, true);
+      if (f == 179)
+        io.AddMouseButtonEvent(0, false);
+    } else if (f < 240) {
+      // hold W
+      if (f == 180 || f == 239) {
+        io.AddKeyEvent(ImGuiKey_W, f == 180);
+        simulation.input({now, p::input_t::kind_t::up, f == 180 ? 1.f : 0.f});
+      }
+    } else if (f == 300 || f == 301 || f == 450 || f == 451) {
+      // show, then hide, the profile window
+      io.AddKeyEvent(ImGuiKey_F1, f % 2 == 0);
+    } else if (f >= 499 && f <= 501) {
+      // click reset scores
+      io.AddMousePosEvent(50.f, 109.f);
+      if (f != 499)
+        io.AddMouseButtonEvent(0, f == 500);
+    }
+  }
+};
+
+void print(const char *name, const p::histogram_t &h, double scale = 1.) {
+  std::printf("%-18s p50 %10.1f  p99 %10.1f  max %10.1f\n", name,
+              double(h.quantile(.5)) * scale, double(h.quantile(.99)) * scale,
+              double(h.max()) * scale);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--frames N] [--warmup N] [--seed SEED] "
+                 "[--raster THREADS] [--ppm FILE] [--spectate COLUMNSxROWS]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  p::headless_t headless{options.columns > 0 ? ImVec2{1920, 1080}
+                                             : ImVec2{660, 660}};
+  auto &io = headless.io();
+
+  const auto period =
+      std::chrono::duration_cast<p::simulation_t::clock_t::duration>(
+          std::chrono::duration<float>{io.DeltaTime});
+
+  const auto profile = std::make_unique<p::profile_t>();
+  p::simulation_t simulation{p::make_starter(options.seed), options.seed,
+                             p::rules(p::settings_t{})};
+  simulation.profile(profile.get());
+  p::ui_t ui{simulation, profile.get()};
+  std::optional<p::spectator_t> spectator;
+  if (options.columns > 0)
+    spectator.emplace(options.columns, options.rows, options.seed);
+  script_t script;
+
+  // the histograms are big, so on the heap
+  const auto time = std::make_unique<p::histogram_t>();
+  const auto vertices = std::make_unique<p::histogram_t>();
+  const auto indices = std::make_unique<p::histogram_t>();
+  const auto raster = std::make_unique<p::histogram_t>();
+  std::uint64_t allocations = 0;
+  std::uint64_t max_allocations = 0;
+
+  std::optional<p::rasterizer_t> rasterizer;
+  p::framebuffer_t framebuffer{int(io.DisplaySize.x), int(io.DisplaySize.y)};
+  if (options.raster > 0)
+    rasterizer.emplace(options.raster);
+
+  const p::simulation_t::clock_t::time_point start{std::chrono::seconds{1}};
+  const auto frames = options.warmup + options.frames;
+
+  for (std::size_t i = 0; i < frames; ++i) {
+    const auto now = start + period * i;
+    script(i, io, simulation, now);
+    simulation.advance_to(now);
+
+    const a::scope_t scope;
+    const auto t0 = std::chrono::steady_clock::now();
+    ImGui::NewFrame();
+    if (spectator)
+      spectator->frame(now);
+    else
+      ui.frame(now);
+    ImGui::Render();
+    const auto t1 = std::chrono::steady_clock::now();
+    const auto counts = scope.counts();
+
+    const auto *draw_data = ImGui::GetDrawData();
+    if (rasterizer) {
+      rasterizer->render(*draw_data, framebuffer, IM_COL32(115, 140, 153, 255));
+    }
+    const auto t2 = std::chrono::steady_clock::now();
+
+    if (i < options.warmup)
+      continue;
+
+    time->record(std::chrono::nanoseconds{t1 - t0}.count());
+    raster->record(std::chrono::nanoseconds{t2 - t1}.count());
+    vertices->record(draw_data->TotalVtxCount);
+    indices->record(draw_data->TotalIdxCount);
+    allocations += counts.allocations;
+    max_allocations = std::max(max_allocations, counts.allocations);
+  }
+
+  std::printf("frames             %zu\n", options.frames);
+  if (spectator) {
+    std::printf("arenas             %d\n",
+                spectator->columns() * spectator->rows());
+  }
+  print("frame time (us)", *time, 1e-3);
+  std::printf("frame fps (p99)    %.0f\n",
+              1e9 / double(std::max<std::uint64_t>(time->quantile(.99), 1)));
+  print("vertices", *vertices);
+  print("indices", *indices);
+  std::printf("allocs per frame   %.3f (max %llu)\n",
+              double(allocations) / double(options.frames),
+              static_cast<unsigned long long>(max_allocations));
+
+  if (rasterizer) {
+    std::printf("raster threads     %u\n", rasterizer->threads());
+    print("raster time (us)", *raster, 1e-3);
+    std::printf("raster fps (p50)   %.0f\n",
+                1e9 / double(std::max<std::uint64_t>(raster->quantile(.5), 1)));
+  }
+
+  if (!options.ppm.empty()) {
+    std::ofstream os{std::string{options.ppm}, std::ios::binary};
+    p::write_ppm(os, framebuffer);
+  }
+
+  return 0;
+}
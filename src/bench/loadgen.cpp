@@ -0,0 +1,467 @@
+/**
+ * pong-loadgen : a load generator for sizing pong-server.  Plays ever more
+ * simulated players over loopback, on one thread, and measures how the
+ * server copes with each count, as a capacity curve.
+ *
+ *   pong-loadgen [--clients N,N,...] [--seconds S] [--server HOST:PORT]
+ *                [--loops N] [--per-socket N] [--trace FILE]
+ *                [--ai-skill N] [--max-rtt-ms N] [--max-loss PERCENT]
+ *                [--seed SEED]
+ *
+ * Without --server it runs a server_t in process, with --loops loops.  The
+ * players are synced by states and share a few sockets, --per-socket each,
+ * whose datagrams are read and written in batches (recvmmsg / sendmmsg) off
+ * one epoll.  By default each plays their paddle with an ai_t of their own,
+ * of --ai-skill (5 to 95, as rules_t allows), taking the puck's velocity
+ * from the last two states; with --trace they replay a recorded input trace
+ * instead, each from their own point in it.
+ * A trace is lines of "MILLISECONDS SPEED", the paddle speed from then on,
+ * '#' starting a comment; it repeats from its last line's time.
+ *
+ * For each count of --clients, joined on top of the last, it lets the
+ * players settle for a second then measures for --seconds: the jitter of
+ * the states' arrival against the tick period, the states lost (ticks
+ * never heard of), the command round trip and the datagram rates both ways,
+ * with the server's own tick times when it's in process and the share of a
+ * core the generator took.  It reports a row of the curve per count, and
+ * the most players served with the round trip's p99 within --max-rtt-ms,
+ * the loss within --max-loss and the jitter's p99 within half a tick.
+ */
+#include "host.hpp"
+#include "loopback.hpp"
+#include "net.hpp"
+#include "protocol.hpp"
+
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace b = pong::bench;
+
+using clock_t = std::chrono::steady_clock;
+
+struct options_t {
+  std::vector<std::size_t> clients{1000, 2000, 5000, 10000, 20000};
+  std::size_t seconds = 3;
+  std::optional<sockaddr_in> server;
+  unsigned loops = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t per_socket = 128;
+  std::string trace;
+  int ai_skill = 70;
+  std::size_t max_rtt_ms = 50;
+  double max_loss = 1;
+  std::mt19937::result_type seed = 4242;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+// "N,N,..." in increasing order
+bool parse(std::string_view s, std::vector<std::size_t> &counts) {
+  counts.clear();
+  while (!s.empty()) {
+    const auto comma = std::min(s.find(','), s.size());
+    std::size_t n;
+    if (!parse(s.substr(0, comma), n) || n == 0 ||
+        (!counts.empty() && n <= counts.back()))
+      return false;
+    counts.push_back(n);
+    s.remove_prefix(std::min(comma + 1, s.size()));
+  }
+  return !counts.empty();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--clients")
+      ok = parse(value, options.clients);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--server")
+      ok = p::parse(value, options.server.emplace());
+    else if (arg == "--loops")
+      ok = parse(value, options.loops);
+    else if (arg == "--per-socket")
+      ok = parse(value, options.per_socket);
+    else if (arg == "--trace") {
+      options.trace = value;
+      ok = !value.empty();
+    } else if (arg == "--ai-skill")
+      ok = parse(value, options.ai_skill) &&
+           options.ai_skill >= p::rules_t::ai_skill_min &&
+           options.ai_skill <= p::rules_t::ai_skill_max;
+    else if (arg == "--max-rtt-ms")
+      ok = parse(value, options.max_rtt_ms);
+    else if (arg == "--max-loss") {
+      const std::string s{value};
+      char *end;
+      options.max_loss = std::strtod(s.c_str(), &end);
+      ok = end == s.c_str() + s.size() && options.max_loss >= 0;
+    } else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    if (!ok)
+      return false;
+  }
+  return options.loops > 0 && options.per_socket > 0 && options.seconds > 0;
+}
+
+/**
+ * A recorded input trace: the paddle's speed from each time on, repeating.
+ */
+class trace_t {
+public:
+  // throws std::runtime_error if it can't be read
+  explicit trace_t(const std::string &path) {
+    std::ifstream in{path};
+    if (!in)
+      throw std::runtime_error{"can't read " + path};
+    for (std::string line; std::getline(in, line);) {
+      line = line.substr(0, line.find('#'));
+      std::istringstream words{line};
+      double ms;
+      p::scalar_t speed;
+      if (!(words >> ms))
+        continue;
+      const clock_t::duration at =
+          std::chrono::microseconds{std::int64_t(ms * 1e3)};
+      if (!(words >> speed) || ms < 0 ||
+          (!steps_.empty() && at < steps_.back().first))
+        throw std::runtime_error{"bad line in " + path + ": " + line};
+      steps_.emplace_back(at, speed);
+    }
+    if (steps_.empty() || steps_.back().first.count() == 0)
+      throw std::runtime_error{path + " is too short to repeat"};
+  }
+
+  [[nodiscard]] clock_t::duration length() const {
+    return steps_.back().first;
+  }
+
+  // the speed at t into a repetition
+  [[nodiscard]] p::scalar_t speed(clock_t::duration t) const {
+    t %= length();
+    const auto i = std::ranges::upper_bound(
+        steps_, t, {}, [](const auto &step) { return step.first; });
+    return i == steps_.begin() ? 0.f : std::prev(i)->second;
+  }
+
+private:
+  std::vector<std::pair<clock_t::duration, p::scalar_t>> steps_;
+};
+
+struct player_t : b::loopback_player_t {
+  // the latest state, when it came and the puck's velocity by then
+  std::optional<p::snapshot_t> state{};
+  clock_t::time_point arrived{};
+  std::array<p::scalar_t, 2> puck_velocity{};
+  // a state has come since the player last looked
+  bool fresh{};
+  std::unique_ptr<p::ai_t> ai{};
+};
+
+/**
+ * What the players measure, from when it was last reset.
+ */
+struct measures_t {
+  p::histogram_t jitter_us;
+  p::histogram_t round_trip_us;
+  std::uint64_t states{};
+  std::uint64_t lost{};
+  std::uint64_t received{};
+  std::uint64_t sent{};
+};
+
+/**
+ * A socket's worth of players.
+ */
+class client_t : public b::loopback_client_t<player_t> {
+public:
+  using loopback_client_t::loopback_client_t;
+
+  void receive(measures_t &measures) {
+    loopback_client_t::receive(
+        [&](std::span<const std::byte> datagram, clock_t::time_point now) {
+          ++measures.received;
+          handle(datagram, now, measures);
+        });
+  }
+
+  // have every player look at their match and command a new speed if they
+  // want one, with the AI or from trace, each from their own point in it
+  void play(clock_t::time_point now, const trace_t *trace, int ai_skill,
+            measures_t &measures) {
+    for (auto &player : players()) {
+      if (!player.state || !player.state->in_play)
+        continue;
+      auto speed = player.speed;
+      if (trace)
+        speed = trace->speed(now.time_since_epoch() +
+                             std::chrono::milliseconds{player.seed % 60'000});
+      else if (player.fresh)
+        if (const auto s = decide(player, ai_skill))
+          speed = *s;
+      player.fresh = false;
+      if (command(player, speed, now))
+        ++measures.sent;
+    }
+    flush();
+  }
+
+private:
+  void handle(std::span<const std::byte> datagram, clock_t::time_point now,
+              measures_t &measures) {
+    pr::state_t state;
+    if (!pr::decode(datagram, state))
+      return;
+    auto *player = find(state.match);
+    if (!player)
+      return;
+    if (const auto rtt = acknowledged(*player, state.acknowledged, now))
+      measures.round_trip_us.record(std::uint64_t(
+          std::chrono::duration_cast<std::chrono::microseconds>(*rtt)
+              .count()));
+
+    const auto &s = state.snapshot;
+    if (player->state && s.tick <= player->state->tick)
+      return;
+    ++measures.states;
+    if (player->state) {
+      const auto ticks = std::int64_t(s.tick - player->state->tick);
+      measures.lost += std::uint64_t(ticks - 1);
+      // how far off the tick period the state came
+      const auto off = (now - player->arrived) - tick_period() * ticks;
+      measures.jitter_us.record(std::uint64_t(std::abs(
+          std::chrono::duration_cast<std::chrono::microseconds>(off)
+              .count())));
+      if (s.lhs_score == player->state->lhs_score &&
+          s.rhs_score == player->state->rhs_score) {
+        const auto dt =
+            std::chrono::duration<p::scalar_t>(tick_period() * ticks).count();
+        player->puck_velocity = {(s.puck[0] - player->state->puck[0]) / dt,
+                                 (s.puck[1] - player->state->puck[1]) / dt};
+      }
+    }
+    player->state = s;
+    player->arrived = now;
+    player->fresh = true;
+  }
+
+  // the player's AI's speed, on the arena as their latest state has it
+  static std::optional<p::scalar_t> decide(player_t &player, int ai_skill) {
+    const auto &s = *player.state;
+    // a puck standing still, as at a restart, is going nowhere to estimate
+    if (player.puck_velocity[0] == 0)
+      return {};
+    if (!player.ai)
+      player.ai = std::make_unique<p::ai_t>(
+          std::mt19937::result_type(player.nonce),
+          // as remote_match_t configures its AI
+          p::ai_stdev({.paddle_size = s.rhs_paddle[3] - s.rhs_paddle[1],
+                       .ai_skill = ai_skill},
+                      s.puck_radius));
+
+    // the AIs share an arena, put as each player's state has it
+    static p::arena_t arena{p::make_starter(0)};
+    arena.puck().centre() = p::vec_t{s.puck[0], s.puck[1]};
+    arena.puck().velocity() =
+        p::vec_t{player.puck_velocity[0], player.puck_velocity[1]};
+    arena.puck().radius() = s.puck_radius;
+    for (auto [paddle, box] : {std::pair{&arena.lhs_paddle(), s.lhs_paddle},
+                               std::pair{&arena.rhs_paddle(), s.rhs_paddle}})
+      paddle->box() =
+          p::box_t{p::vec_t{box[0], box[1]}, p::vec_t{box[2], box[3]}};
+    arena.rhs_paddle().velocity() = p::vec_t{0, player.speed};
+    return player.ai->paddle_speed(arena, arena.rhs_paddle());
+  }
+};
+
+// the calling thread's CPU time so far
+clock_t::duration cpu_time() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+double ms(std::uint64_t us) { return double(us) / 1e3; }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--clients N,N,...] [--seconds S] "
+                 "[--server HOST:PORT] [--loops N] [--per-socket N] "
+                 "[--trace FILE] [--ai-skill N] [--max-rtt-ms N] "
+                 "[--max-loss PERCENT] [--seed SEED]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  using clock_t = std::chrono::steady_clock;
+
+  std::optional<trace_t> trace;
+  try {
+    if (!options.trace.empty())
+      trace.emplace(options.trace);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  std::optional<p::server_t> server;
+  if (!options.server) {
+    server.emplace(p::server_options_t{
+        .loops = options.loops,
+        .rules = b::long_matches,
+        .seed = options.seed,
+        .max_matches = options.clients.back(),
+        .max_spectators = 0,
+    });
+    server->start();
+  }
+  const auto address = server ? server->address() : *options.server;
+
+  std::vector<std::unique_ptr<client_t>> clients;
+  p::epoll_t epoll;
+  measures_t measures;
+  clock_t::duration period = std::chrono::microseconds{16'666};
+
+  // handle what arrives, and play once a tick
+  auto next_play = clock_t::now();
+  auto run = [&](clock_t::time_point until) {
+    while (clock_t::now() < until) {
+      for (const auto &event : epoll.wait(std::chrono::milliseconds{1}))
+        clients[event.data.u64]->receive(measures);
+      if (const auto now = clock_t::now(); now >= next_play) {
+        for (auto &client : clients)
+          client->play(now, trace ? &*trace : nullptr, options.ai_skill,
+                       measures);
+        next_play += period;
+        if (next_play < now)
+          next_play = now;
+      }
+    }
+  };
+
+  std::printf("server       %s, players %s\n",
+              server ? "in process" : "remote",
+              trace ? options.trace.c_str() : "ai");
+  std::printf("\n%8s %15s %15s %8s %15s %10s %10s %8s\n", "clients",
+              "jitter ms", "rtt ms", "lost %", "server tick us", "in / s",
+              "out / s", "gen cpu");
+  std::printf("%8s %15s %15s %8s %15s %10s %10s %8s\n", "", "p50    p99",
+              "p50    p99", "", "p50    p99", "", "", "");
+
+  std::size_t capacity = 0;
+  bool coping = true;
+  std::size_t players = 0;
+  for (const auto count : options.clients) {
+    // top the players up to count, joined afresh
+    for (std::size_t first = players; first < count;) {
+      const auto n = std::min(options.per_socket, count - first);
+      clients.emplace_back(std::make_unique<client_t>(address, first + 1, n));
+      epoll.add(clients.back()->socket().fd(), EPOLLIN, clients.size() - 1);
+      first += n;
+    }
+    players = count;
+
+    const auto joining = clock_t::now();
+    while (!std::ranges::all_of(clients, &client_t::welcomed)) {
+      if (clock_t::now() - joining > std::chrono::seconds{10}) {
+        std::fprintf(stderr, "%zu players were not all welcomed\n", count);
+        return 1;
+      }
+      for (auto &client : clients)
+        if (!client->welcomed())
+          client->join();
+      run(clock_t::now() + std::chrono::milliseconds{100});
+    }
+    period = clients.front()->tick_period();
+    run(clock_t::now() + std::chrono::seconds{1});
+
+    // measure only the steady state
+    const auto before = server ? server->stats() : p::server_stats_t{};
+    measures = {};
+    const auto cpu = cpu_time();
+    const auto start = clock_t::now();
+    run(start + std::chrono::seconds{options.seconds});
+    const auto seconds =
+        std::chrono::duration<double>(clock_t::now() - start).count();
+    const auto busy =
+        std::chrono::duration<double>(cpu_time() - cpu).count() / seconds;
+    auto ticks = server ? server->stats().tick_ns : p::histogram_t{};
+    ticks -= before.tick_ns;
+
+    const auto heard = measures.states + measures.lost;
+    const auto lost = 100. * double(measures.lost) /
+                      double(std::max<std::uint64_t>(heard, 1));
+    std::printf("%8zu %7.2f %7.2f %7.2f %7.2f %8.2f ", count,
+                ms(measures.jitter_us.quantile(.5)),
+                ms(measures.jitter_us.quantile(.99)),
+                ms(measures.round_trip_us.quantile(.5)),
+                ms(measures.round_trip_us.quantile(.99)), lost);
+    if (server)
+      std::printf("%7.0f %7.0f ", double(ticks.quantile(.5)) / 1e3,
+                  double(ticks.quantile(.99)) / 1e3);
+    else
+      std::printf("%7s %7s ", "-", "-");
+    std::printf("%10.0f %10.0f %7.0f%%\n", double(measures.received) / seconds,
+                double(measures.sent) / seconds, 100. * busy);
+    std::fflush(stdout);
+
+    // the curve goes on past the first count the server didn't cope with,
+    // to show how it degrades
+    const auto half_tick = std::uint64_t(
+        std::chrono::duration_cast<std::chrono::microseconds>(period / 2)
+            .count());
+    coping = coping &&
+             measures.round_trip_us.quantile(.99) <=
+                 options.max_rtt_ms * 1000 &&
+             lost <= options.max_loss &&
+             measures.jitter_us.quantile(.99) <= half_tick;
+    if (coping)
+      capacity = count;
+  }
+
+  for (auto &client : clients)
+    client->leave();
+  if (server)
+    server->stop();
+
+  if (capacity)
+    std::printf("\ncapacity     %zu players\n", capacity);
+  else
+    std::printf("\ncapacity     under %zu players\n", options.clients.front());
+  return 0;
+}
@@ -0,0 +1,182 @@
+#ifndef PONG_BENCH_LOOPBACK_HPP
+#define PONG_BENCH_LOOPBACK_HPP
+
+#include "net.hpp"
+#include "protocol.hpp"
+#include "simulation.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace pong::bench {
+
+// how often a player commands the speed they already have, to keep their
+// match alive
+constexpr auto keepalive = std::chrono::seconds{1};
+
+// long matches, so that they are all still in play at the end of a run
+constexpr rules_t long_matches{.ai_skill = rules_t::ai_skill_max,
+                               .winning_score = 1000};
+
+/**
+ * What every loopback player keeps of their match: what they were welcomed
+ * to and the commands they have sent, with the one being timed.
+ */
+struct loopback_player_t {
+  using clock_t = std::chrono::steady_clock;
+
+  std::uint64_t nonce{};
+  std::uint64_t match{};
+  bool welcomed{};
+  // the welcome's, for anything the player wants to vary by match
+  std::uint32_t seed{};
+  std::uint32_t sequence{};
+  // the command being timed, if any
+  std::uint32_t timing{};
+  clock_t::time_point sent{};
+  scalar_t speed{};
+  clock_t::time_point commanded{};
+};
+
+/**
+ * A socket's worth of players, with consecutive nonces, playing a server as
+ * remote players would over loopback.  It joins, welcomes, commands and
+ * leaves for them; what they make of their matches is up to the benchmark,
+ * whose Player derives from loopback_player_t with whatever else it keeps.
+ */
+template <typename Player> class loopback_client_t {
+public:
+  using clock_t = loopback_player_t::clock_t;
+
+  loopback_client_t(const sockaddr_in &server, std::uint64_t first_nonce,
+                    std::size_t players,
+                    protocol::sync_t sync = protocol::sync_t::states)
+      : server_{server}, sync_{sync}, players_(players) {
+    socket_.buffers(1 << 22, 1 << 22);
+    for (std::size_t i = 0; i < players; ++i)
+      players_[i].nonce = first_nonce + i;
+  }
+
+  [[nodiscard]] const udp_socket_t &socket() const { return socket_; }
+
+  [[nodiscard]] bool welcomed() const { return welcomed_ == players_.size(); }
+
+  // the server's, once welcomed
+  [[nodiscard]] clock_t::duration tick_period() const { return tick_period_; }
+
+  // (re)send the joins of the players not yet welcomed
+  void join() {
+    for (const auto &player : players_)
+      if (!player.welcomed)
+        queue(protocol::join_t{.nonce = player.nonce, .sync = sync_});
+    flush();
+  }
+
+  void leave() {
+    for (const auto &player : players_)
+      if (player.welcomed)
+        queue(protocol::leave_t{.match = player.match});
+    flush();
+  }
+
+protected:
+  [[nodiscard]] std::span<Player> players() { return players_; }
+
+  // handle some of whatever has arrived and leave the rest for later, so
+  // that the other sockets get a turn: the welcomes here, everything else
+  // with handle(datagram, now)
+  template <typename F> void receive(F &&handle) {
+    for (int i = 0; i < 16 && in_.receive(socket_) > 0; ++i) {
+      const auto now = clock_t::now();
+      for (std::size_t i = 0; i < in_.size(); ++i)
+        if (!welcome(in_.payload(i), now))
+          handle(in_.payload(i), now);
+    }
+  }
+
+  // queue speed as the player's command if it changes theirs or it's time
+  // to keep their match alive, timing it if none is being; the bytes
+  // queued, if any
+  std::size_t command(Player &player, scalar_t speed,
+                      clock_t::time_point now) {
+    if (speed == player.speed && now - player.commanded < keepalive)
+      return 0;
+    player.speed = speed;
+    player.commanded = now;
+    const auto n = queue(protocol::command_t{.match = player.match,
+                                             .sequence = ++player.sequence,
+                                             .speed = speed});
+    if (player.timing == 0) {
+      player.timing = player.sequence;
+      player.sent = now;
+    }
+    return n;
+  }
+
+  // send what has been queued
+  void flush() { out_.send(socket_); }
+
+  // the player in match, if it's one of these
+  Player *find(std::uint64_t match) {
+    const auto i = matches_.find(match);
+    return i == matches_.end() ? nullptr : &players_[i->second];
+  }
+
+  // the round trip of the command being timed, if acknowledged (the latest
+  // command applied, which may be a later one) covers it
+  static std::optional<clock_t::duration>
+  acknowledged(Player &player, std::uint32_t acknowledged,
+               clock_t::time_point now) {
+    if (player.timing == 0 ||
+        std::int32_t(acknowledged - player.timing) < 0)
+      return {};
+    player.timing = 0;
+    return now - player.sent;
+  }
+
+private:
+  bool welcome(std::span<const std::byte> datagram, clock_t::time_point now) {
+    protocol::welcome_t welcome;
+    if (!protocol::decode(datagram, welcome))
+      return false;
+    const auto i = std::size_t(welcome.nonce - players_.front().nonce);
+    if (i < players_.size() && !players_[i].welcomed) {
+      auto &player = players_[i];
+      player.welcomed = true;
+      player.match = welcome.match;
+      player.seed = welcome.seed;
+      player.commanded = now;
+      tick_period_ = std::chrono::microseconds{welcome.tick_period_us};
+      matches_.emplace(welcome.match, i);
+      ++welcomed_;
+    }
+    return true;
+  }
+
+  template <typename Message> std::size_t queue(const Message &message) {
+    const auto n = protocol::encode(message, out_.prepare(server_));
+    out_.commit(n);
+    if (out_.full())
+      flush();
+    return n;
+  }
+
+  sockaddr_in server_;
+  protocol::sync_t sync_;
+  clock_t::duration tick_period_{std::chrono::microseconds{16'666}};
+  udp_socket_t socket_;
+  datagrams_t in_{64};
+  datagrams_t out_{64};
+  std::vector<Player> players_;
+  std::unordered_map<std::uint64_t, std::size_t> matches_;
+  std::size_t welcomed_{};
+};
+
+} // namespace pong::bench
+
+#endif // PONG_BENCH_LOOPBACK_HPP
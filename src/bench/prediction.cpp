@@ -0,0 +1,375 @@
+/**
+ * pong-prediction-bench : how often, and how far, remote players'
+ * predictions are corrected.  Runs a server_t in process and players synced
+ * by events over loopback, every datagram both ways held back by a
+ * simulated network: half the round trip, give or take the jitter (normally
+ * distributed), and dropped at the loss rate.  Each player predicts their
+ * match with a predictor_t and plays on what it shows, at the keyboard, as
+ * pong-server-bench's players do.
+ *
+ *   pong-prediction-bench [--players N] [--seconds S] [--rtt MS]
+ *                         [--jitter MS] [--loss PERCENT] [--seed SEED]
+ *
+ * Reports how far ahead of the server the predictions run and, after a
+ * second to settle, how often a reconciliation moves them noticeably (by
+ * half a pixel or more) and how far, for the player's own paddle, the puck
+ * and the AI's paddle.
+ */
+#include "host.hpp"
+#include "loopback.hpp"
+#include "net.hpp"
+#include "prediction.hpp"
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace b = pong::bench;
+
+using clock_t = std::chrono::steady_clock;
+
+// corrections smaller than this go unnoticed
+constexpr p::scalar_t noticeable = .5f;
+
+struct options_t {
+  std::size_t players = 8;
+  std::size_t seconds = 10;
+  double rtt = 100;
+  double jitter = 10;
+  double loss = 0;
+  std::mt19937::result_type seed = 4242;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--players")
+      ok = parse(value, options.players);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--rtt")
+      ok = parse(value, options.rtt);
+    else if (arg == "--jitter")
+      ok = parse(value, options.jitter);
+    else if (arg == "--loss")
+      ok = parse(value, options.loss);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    if (!ok)
+      return false;
+  }
+  return options.players > 0 && options.rtt >= 0 && options.jitter >= 0 &&
+         options.loss >= 0 && options.loss < 100;
+}
+
+/**
+ * One way of the simulated network: datagrams go in, and come out when
+ * they are due, if at all, perhaps in a different order.
+ */
+class network_t {
+public:
+  network_t(const options_t &options, std::mt19937::result_type seed)
+      : rng_{seed}, delay_ms_{options.rtt / 2, options.jitter},
+        lost_{options.loss / 100} {}
+
+  void send(std::span<const std::byte> datagram, clock_t::time_point now) {
+    if (lost_(rng_))
+      return;
+    const auto delay = std::chrono::duration<double, std::milli>{
+        std::max(0., delay_ms_(rng_))};
+    queue_.emplace(now + std::chrono::duration_cast<clock_t::duration>(delay),
+                   std::vector<std::byte>{datagram.begin(), datagram.end()});
+  }
+
+  // hand f the datagrams due by now
+  template <typename F> void deliver(clock_t::time_point now, F &&f) {
+    while (!queue_.empty() && queue_.begin()->first <= now) {
+      f(std::span<const std::byte>{queue_.begin()->second});
+      queue_.erase(queue_.begin());
+    }
+  }
+
+private:
+  std::mt19937 rng_;
+  std::normal_distribution<double> delay_ms_;
+  std::bernoulli_distribution lost_;
+  std::multimap<clock_t::time_point, std::vector<std::byte>> queue_;
+};
+
+struct player_t {
+  std::uint64_t nonce{};
+  std::uint64_t match{};
+  std::optional<p::predictor_t> predictor{};
+  p::scalar_t speed{};
+  clock_t::time_point commanded{};
+};
+
+struct stats_t {
+  std::uint64_t reconciled{};
+  std::uint64_t corrected{};
+  // in ticks
+  p::histogram_t ahead;
+  // in hundredths of a pixel
+  p::histogram_t own_paddle;
+  p::histogram_t puck;
+  p::histogram_t other_paddle;
+
+  void record(const p::correction_t &correction, std::uint64_t ahead) {
+    ++reconciled;
+    this->ahead.record(ahead);
+    if (correction.max() < noticeable)
+      return;
+    ++corrected;
+    auto record = [](p::histogram_t &h, p::scalar_t pixels) {
+      if (pixels >= noticeable)
+        h.record(std::uint64_t(std::lround(pixels * 100)));
+    };
+    record(own_paddle, correction.own_paddle);
+    record(puck, correction.puck);
+    record(other_paddle, correction.other_paddle);
+  }
+};
+
+/**
+ * The players, on one socket, and the network between them and the server.
+ */
+class client_t {
+public:
+  client_t(const options_t &options, const sockaddr_in &server)
+      : server_{server}, up_{options, options.seed + 1},
+        down_{options, options.seed + 2}, players_(options.players) {
+    socket_.buffers(1 << 20, 1 << 20);
+    for (std::size_t i = 0; i < players_.size(); ++i)
+      players_[i].nonce = i + 1;
+  }
+
+  [[nodiscard]] const p::udp_socket_t &socket() const { return socket_; }
+
+  [[nodiscard]] bool ready() const {
+    return std::ranges::all_of(players_, [](const player_t &player) {
+      return player.predictor && player.predictor->ready();
+    });
+  }
+
+  void join(clock_t::time_point now) {
+    for (const auto &player : players_)
+      if (!player.predictor)
+        send(pr::join_t{.nonce = player.nonce, .sync = pr::sync_t::events},
+             now);
+  }
+
+  // take in what has arrived and pass on whatever the network has let
+  // through by now
+  void receive(clock_t::time_point now, stats_t &stats) {
+    while (in_.receive(socket_) > 0)
+      for (std::size_t i = 0; i < in_.size(); ++i)
+        down_.send(in_.payload(i), now);
+    down_.deliver(now, [&](std::span<const std::byte> datagram) {
+      handle(datagram, now, stats);
+    });
+    forward(now);
+  }
+
+  // whether corrections count yet, once the predictions have settled
+  void measure(bool measuring) { measuring_ = measuring; }
+
+  // have every player look at their prediction, command a new speed if
+  // they want one, and predict the next tick
+  void play(clock_t::time_point now) {
+    for (auto &player : players_) {
+      if (!player.predictor || !player.predictor->ready())
+        continue;
+      auto &predictor = *player.predictor;
+      const auto s = predictor.snapshot();
+      const auto paddle = (s.rhs_paddle[1] + s.rhs_paddle[3]) / 2;
+      const auto gap = s.puck[1] - paddle;
+      auto speed = player.speed;
+      if (speed == 0 && std::abs(gap) > 20)
+        speed = gap > 0 ? p::simulation_t::key_paddle_speed
+                        : -p::simulation_t::key_paddle_speed;
+      else if (speed * gap <= 0)
+        speed = 0;
+      if (speed != player.speed || now - player.commanded >= b::keepalive) {
+        player.speed = speed;
+        player.commanded = now;
+        const auto command = predictor.command(speed);
+        send(pr::command_t{.match = player.match,
+                           .sequence = command.sequence,
+                           .speed = speed,
+                           .tick = command.tick},
+             now);
+      }
+      predictor.tick();
+    }
+  }
+
+  void leave(clock_t::time_point now) {
+    for (const auto &player : players_)
+      if (player.predictor)
+        send(pr::leave_t{.match = player.match}, now);
+    // straight away, rather than through the network
+    forward(clock_t::time_point::max());
+  }
+
+private:
+  void handle(std::span<const std::byte> datagram, clock_t::time_point now,
+              stats_t &stats) {
+    if (pr::welcome_t welcome; pr::decode(datagram, welcome)) {
+      const auto i = std::size_t(welcome.nonce - 1);
+      if (i < players_.size() && !players_[i].predictor) {
+        auto &player = players_[i];
+        player.match = welcome.match;
+        player.commanded = now;
+        player.predictor.emplace(p::scalar_t(welcome.tick_period_us) / 1e6f);
+        matches_.emplace(welcome.match, i);
+      }
+    } else if (pr::events_t events; pr::decode(datagram, events)) {
+      const auto i = matches_.find(events.match);
+      if (i == matches_.end())
+        return;
+      auto &predictor = *players_[i->second].predictor;
+      for (std::size_t j = 0; j < events.count; ++j)
+        predictor.apply(events.events[j]);
+      const bool ready = predictor.ready();
+      const auto correction =
+          predictor.reconcile(events.tick, events.acknowledged, events.early);
+      if (ready && measuring_)
+        stats.record(correction, predictor.ticks() - events.tick);
+    }
+  }
+
+  template <typename Message>
+  void send(const Message &message, clock_t::time_point now) {
+    std::array<std::byte, pr::max_size> buffer;
+    up_.send({buffer.data(), pr::encode(message, buffer)}, now);
+  }
+
+  // send the server what the network has let through by now
+  void forward(clock_t::time_point now) {
+    up_.deliver(now, [&](std::span<const std::byte> datagram) {
+      auto out = out_.prepare(server_);
+      std::ranges::copy(datagram, out.begin());
+      out_.commit(datagram.size());
+      if (out_.full())
+        out_.send(socket_);
+    });
+    out_.send(socket_);
+  }
+
+  sockaddr_in server_;
+  p::udp_socket_t socket_;
+  p::datagrams_t in_{64};
+  p::datagrams_t out_{64};
+  network_t up_;
+  network_t down_;
+  std::vector<player_t> players_;
+  std::unordered_map<std::uint64_t, std::size_t> matches_;
+  bool measuring_{};
+};
+
+double pixels(std::uint64_t hundredths) { return double(hundredths) / 100; }
+
+void print(const char *name, const p::histogram_t &h) {
+  std::printf("%-12s p50 %.2f px  p99 %.2f  max %.2f  (%lu corrections)\n",
+              name, pixels(h.quantile(.5)), pixels(h.quantile(.99)),
+              pixels(h.max()), static_cast<unsigned long>(h.count()));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--players N] [--seconds S] [--rtt MS] "
+                 "[--jitter MS] [--loss PERCENT] [--seed SEED]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  using clock_t = p::server_t::clock_t;
+
+  p::server_t server{{
+      .loops = 1,
+      .rules = b::long_matches,
+      .seed = options.seed,
+      .pin = false,
+  }};
+  server.start();
+
+  client_t client{options, server.address()};
+  p::epoll_t epoll;
+  epoll.add(client.socket().fd(), EPOLLIN, 0);
+  const auto tick_period = std::chrono::microseconds{1'000'000 / 60};
+
+  stats_t stats;
+  const auto start = clock_t::now();
+  const auto settled = start + std::chrono::seconds{1};
+  const auto end = start + std::chrono::seconds{options.seconds};
+  auto next_play = start;
+  auto next_join = start;
+  while (clock_t::now() < end) {
+    epoll.wait(std::chrono::milliseconds{1});
+    const auto now = clock_t::now();
+    client.receive(now, stats);
+    if (!client.ready() && now >= next_join) {
+      client.join(now);
+      next_join = now + std::chrono::milliseconds{100};
+    }
+    client.measure(now >= settled);
+    if (now >= next_play) {
+      client.play(now);
+      next_play += tick_period;
+      if (next_play < now)
+        next_play = now;
+    }
+  }
+  const auto seconds =
+      std::chrono::duration<double>(clock_t::now() - settled).count();
+  const bool ready = client.ready();
+  client.leave(clock_t::now());
+  server.stop();
+
+  std::printf("players      %zu, rtt %.0f ms, jitter %.0f ms, loss %.1f%%\n",
+              options.players, options.rtt, options.jitter, options.loss);
+  std::printf("ahead        p50 %lu ticks  p99 %lu  (of the server's "
+              "latest)\n",
+              static_cast<unsigned long>(stats.ahead.quantile(.5)),
+              static_cast<unsigned long>(stats.ahead.quantile(.99)));
+  std::printf("reconciled   %lu times, %.1f%% noticeably (%.2f / s a "
+              "player)\n",
+              static_cast<unsigned long>(stats.reconciled),
+              stats.reconciled
+                  ? 100. * double(stats.corrected) / double(stats.reconciled)
+                  : 0.,
+              double(stats.corrected) / seconds / double(options.players));
+  print("own paddle", stats.own_paddle);
+  print("puck", stats.puck);
+  print("ai paddle", stats.other_paddle);
+
+  // a short run only checks that the harness works
+  return ready && stats.reconciled > 0 ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+/**
+ * pong-server-bench : a loopback load test of pong-server.  Runs a server_t
+ * in process and, on one thread of its own, as many players as there are
+ * matches, spread over a few client sockets.  Each player plays as if at the
+ * keyboard, holding up or down until their paddle is level with the puck,
+ * looking at their match once a tick.  They command a speed only when it
+ * changes (and now and then to keep the match alive) and time how long each
+ * command takes to be acknowledged.  With --idle, that share of them never
+ * move, commanding only to keep their matches alive.
+ *
+ *   pong-server-bench [--matches N] [--seconds S] [--loops N]
+ *                     [--sockets N] [--seed SEED] [--sync states|events]
+ *                     [--idle PERCENT]
+ *
+ * With --sync states players are sent every state; with --sync events only
+ * the events, from which they reconstruct the states with a trajectory_t.
+ * Reports the server's tick times against the 2 ms budget a 60 Hz tick
+ * leaves room for, the datagram rates both ways, the bytes each match is
+ * sent and the command round trip.
+ */
+#include "host.hpp"
+#include "loopback.hpp"
+#include "net.hpp"
+#include "protocol.hpp"
+#include "trajectory.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace b = pong::bench;
+
+using clock_t = std::chrono::steady_clock;
+
+constexpr auto tick_budget = std::chrono::milliseconds{2};
+
+struct options_t {
+  std::size_t matches = 1000;
+  std::size_t seconds = 5;
+  unsigned loops = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t sockets = 16;
+  std::mt19937::result_type seed = 4242;
+  pr::sync_t sync = pr::sync_t::states;
+  std::size_t idle = 0;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--matches")
+      ok = parse(value, options.matches);
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    else if (arg == "--loops")
+      ok = parse(value, options.loops);
+    else if (arg == "--sockets")
+      ok = parse(value, options.sockets);
+    else if (arg == "--seed")
+      ok = parse(value, options.seed);
+    else if (arg == "--sync") {
+      ok = value == "states" || value == "events";
+      options.sync =
+          value == "events" ? pr::sync_t::events : pr::sync_t::states;
+    } else if (arg == "--idle")
+      ok = parse(value, options.idle);
+    if (!ok)
+      return false;
+  }
+  return options.matches > 0 && options.loops > 0 && options.sockets > 0 &&
+         options.idle <= 100;
+}
+
+// bytes of IPv4 and UDP header on every datagram
+constexpr std::size_t header_bytes = 28;
+
+struct player_t : b::loopback_player_t {
+  // never moves
+  bool idle{};
+  // the latest state, or the events so far
+  std::optional<p::snapshot_t> state{};
+  std::optional<p::trajectory_t> trajectory{};
+  // when the latest event's tick was heard of
+  clock_t::time_point heard{};
+};
+
+struct traffic_t {
+  std::uint64_t datagrams{};
+  std::uint64_t bytes{};
+
+  void add(std::size_t payload) {
+    ++datagrams;
+    bytes += payload;
+  }
+};
+
+/**
+ * A socket's worth of players.
+ */
+class client_t : public b::loopback_client_t<player_t> {
+public:
+  client_t(const sockaddr_in &server, std::uint64_t first_nonce,
+           std::size_t players, pr::sync_t sync, std::size_t idle)
+      : loopback_client_t{server, first_nonce, players, sync}, sync_{sync} {
+    // idle percent of them, spread evenly
+    for (auto &player : this->players())
+      player.idle =
+          player.nonce * idle / 100 != (player.nonce - 1) * idle / 100;
+  }
+
+  void receive(p::histogram_t &round_trip_ns, traffic_t &received) {
+    loopback_client_t::receive(
+        [&](std::span<const std::byte> datagram, clock_t::time_point now) {
+          received.add(datagram.size());
+          handle(datagram, now, round_trip_ns);
+        });
+  }
+
+  // have every player look at their match as it is now and command a new
+  // speed if they want one
+  void play(clock_t::time_point now, traffic_t &sent) {
+    for (auto &player : players()) {
+      const auto s = snapshot(player, now);
+      if (!s || (player.idle && now - player.commanded < b::keepalive))
+        continue;
+      const auto paddle = (s->rhs_paddle[1] + s->rhs_paddle[3]) / 2;
+      const auto gap = s->puck[1] - paddle;
+      auto speed = player.speed;
+      if (player.idle)
+        speed = 0;
+      else if (speed == 0 && std::abs(gap) > 20)
+        speed = gap > 0 ? p::simulation_t::key_paddle_speed
+                        : -p::simulation_t::key_paddle_speed;
+      else if (speed * gap <= 0)
+        speed = 0;
+      if (const auto n = command(player, speed, now))
+        sent.add(n);
+    }
+    flush();
+  }
+
+private:
+  void handle(std::span<const std::byte> datagram, clock_t::time_point now,
+              p::histogram_t &round_trip_ns) {
+    const auto record = [&](player_t &player, std::uint32_t acknowledged) {
+      if (const auto rtt = this->acknowledged(player, acknowledged, now))
+        round_trip_ns.record(
+            std::uint64_t(std::chrono::nanoseconds{*rtt}.count()));
+    };
+    if (pr::state_t state; pr::decode(datagram, state)) {
+      if (auto *player = find(state.match)) {
+        record(*player, state.acknowledged);
+        player->state = state.snapshot;
+      }
+    } else if (pr::events_t events; pr::decode(datagram, events)) {
+      if (auto *player = find(events.match);
+          player && sync_ == pr::sync_t::events) {
+        // from the first events on, which come only after the welcome
+        if (!player->trajectory)
+          player->trajectory.emplace(
+              std::chrono::duration<p::scalar_t>(tick_period()).count());
+        record(*player, events.acknowledged);
+        if (events.tick > player->trajectory->tick())
+          player->heard = now;
+        for (std::size_t i = 0; i < events.count; ++i)
+          player->trajectory->apply(events.events[i]);
+      }
+    }
+  }
+
+  // the match as the player last heard it or, from events, as it must be
+  // by now
+  std::optional<p::snapshot_t> snapshot(const player_t &player,
+                                        clock_t::time_point now) const {
+    if (!player.trajectory)
+      return player.state;
+    if (!player.trajectory->complete())
+      return {};
+    const auto ticks = std::uint64_t((now - player.heard) / tick_period());
+    return player.trajectory->snapshot(player.trajectory->tick() + ticks);
+  }
+
+  pr::sync_t sync_;
+};
+
+double us(std::uint64_t ns) { return double(ns) / 1e3; }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--matches N] [--seconds S] [--loops N] "
+                 "[--sockets N] [--seed SEED] [--sync states|events] "
+                 "[--idle PERCENT]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  using clock_t = p::server_t::clock_t;
+
+  p::server_t server{{
+      .loops = options.loops,
+      .rules = b::long_matches,
+      .seed = options.seed,
+      .max_matches = options.matches,
+  }};
+  server.start();
+
+  const auto sockets = std::min(options.sockets, options.matches);
+  std::vector<std::unique_ptr<client_t>> clients;
+  p::epoll_t epoll;
+  for (std::size_t i = 0; i < sockets; ++i) {
+    const auto first = i * options.matches / sockets;
+    const auto last = (i + 1) * options.matches / sockets;
+    clients.emplace_back(
+        std::make_unique<client_t>(server.address(), first + 1, last - first,
+                                   options.sync, options.idle));
+    epoll.add(clients.back()->socket().fd(), EPOLLIN, i);
+  }
+
+  p::histogram_t round_trip_ns;
+  traffic_t received;
+  traffic_t sent;
+
+  // handle what arrives, and play once a tick
+  auto next_play = clock_t::now();
+  auto run = [&](clock_t::time_point until) {
+    while (clock_t::now() < until) {
+      for (const auto &event : epoll.wait(std::chrono::milliseconds{1}))
+        clients[event.data.u64]->receive(round_trip_ns, received);
+      if (const auto now = clock_t::now(); now >= next_play) {
+        for (auto &client : clients)
+          client->play(now, sent);
+        next_play += std::chrono::microseconds{16'666};
+        if (next_play < now)
+          next_play = now;
+      }
+    }
+  };
+
+  // join, resending until every player is welcomed
+  const auto joining = clock_t::now();
+  while (!std::ranges::all_of(clients, &client_t::welcomed)) {
+    if (clock_t::now() - joining > std::chrono::seconds{10}) {
+      std::fprintf(stderr, "players were not all welcomed\n");
+      return 1;
+    }
+    for (auto &client : clients)
+      if (!client->welcomed())
+        client->join();
+    run(clock_t::now() + std::chrono::milliseconds{100});
+  }
+
+  // measure only the steady state
+  const auto before = server.stats();
+  round_trip_ns = {};
+  received = {};
+  sent = {};
+  const auto start = clock_t::now();
+  run(start + std::chrono::seconds{options.seconds});
+  const auto seconds =
+      std::chrono::duration<double>(clock_t::now() - start).count();
+  const auto after = server.stats();
+
+  for (auto &client : clients)
+    client->leave();
+  server.stop();
+
+  // the loops' histograms only grow, so the difference is the steady state
+  auto ticks = after.tick_ns;
+  ticks -= before.tick_ns;
+
+  const auto per_second = [&](std::uint64_t n) { return double(n) / seconds; };
+  std::printf("matches      %lu on %u loops\n",
+              static_cast<unsigned long>(after.matches), options.loops);
+  std::printf("ticks        %lu, %lu overran, %.1f matches woken per tick\n",
+              static_cast<unsigned long>(after.ticks - before.ticks),
+              static_cast<unsigned long>(after.overruns - before.overruns),
+              double(after.woken - before.woken) /
+                  double(std::max<std::uint64_t>(after.ticks - before.ticks,
+                                                 1)));
+  std::printf("tick us      p50 %.1f  p99 %.1f  max %.1f  (budget %.0f)\n",
+              us(ticks.quantile(.5)), us(ticks.quantile(.99)),
+              us(ticks.max()),
+              us(std::chrono::nanoseconds{tick_budget}.count()));
+  std::printf("server       %.0f datagrams / s in, %.0f out, %lu dropped\n",
+              per_second(after.received - before.received),
+              per_second(after.sent - before.sent),
+              static_cast<unsigned long>(after.dropped - before.dropped));
+  std::printf("clients      %.0f datagrams / s in, %.0f out\n",
+              per_second(received.datagrams), per_second(sent.datagrams));
+  // per match, as the payload and as it is on the wire
+  const auto per_match = [&](const traffic_t &traffic) {
+    return std::pair{
+        per_second(traffic.bytes) / double(options.matches),
+        per_second(traffic.bytes + header_bytes * traffic.datagrams) /
+            double(options.matches)};
+  };
+  const auto [in, in_wire] = per_match(received);
+  const auto [out, out_wire] = per_match(sent);
+  std::printf("per match    %.0f bytes / s in (%.0f with headers), "
+              "%.0f out (%.0f)\n",
+              in, in_wire, out, out_wire);
+  std::printf("round trip   p50 %.1f us  p99 %.1f us  (%lu commands)\n",
+              us(round_trip_ns.quantile(.5)), us(round_trip_ns.quantile(.99)),
+              static_cast<unsigned long>(round_trip_ns.count()));
+
+  // a short run only checks that the load test works; a full one says
+  // whether the server kept up
+  return after.matches == options.matches ? 0 : 1;
+}
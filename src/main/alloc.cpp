@@ -0,0 +1,147 @@
+#include "alloc.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local pong::alloc::counts_t thread_counts_;
+
+std::atomic<std::uint64_t> process_allocations{};
+std::atomic<std::uint64_t> process_deallocations{};
+std::atomic<std::uint64_t> process_bytes{};
+
+void count_allocation(std::size_t size) {
+  ++thread_counts_.allocations;
+  thread_counts_.bytes += size;
+  process_allocations.fetch_add(1, std::memory_order_relaxed);
+  process_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void count_deallocation(void *p) {
+  if (p) {
+    ++thread_counts_.deallocations;
+    process_deallocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void *allocate(std::size_t size, std::align_val_t align, bool nothrow) {
+  count_allocation(size);
+
+  void *result = nullptr;
+  if (size == 0)
+    size = 1;
+
+  for (;;) {
+    if (align <= std::align_val_t{__STDCPP_DEFAULT_NEW_ALIGNMENT__}) {
+      result = std::malloc(size);
+    } else {
+      const auto a = static_cast<std::size_t>(align);
+      result = std::aligned_alloc(a, (size + a - 1) / a * a);
+    }
+
+    if (result)
+      return result;
+
+    if (const auto handler = std::get_new_handler()) {
+      handler();
+    } else if (nothrow) {
+      return nullptr;
+    } else {
+      throw std::bad_alloc{};
+    }
+  }
+}
+
+void deallocate(void *p) {
+  count_deallocation(p);
+  std::free(p);
+}
+
+constexpr auto default_alignment =
+    std::align_val_t{__STDCPP_DEFAULT_NEW_ALIGNMENT__};
+
+} // namespace
+
+pong::alloc::counts_t pong::alloc::thread_counts() { return thread_counts_; }
+
+pong::alloc::counts_t pong::alloc::process_counts() {
+  return {process_allocations.load(std::memory_order_relaxed),
+          process_deallocations.load(std::memory_order_relaxed),
+          process_bytes.load(std::memory_order_relaxed)};
+}
+
+// replacements for every global allocation / deallocation function
+
+void *operator new(std::size_t n) {
+  return allocate(n, default_alignment, false);
+}
+
+void *operator new[](std::size_t n) {
+  return allocate(n, default_alignment, false);
+}
+
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept {
+  return allocate(n, default_alignment, true);
+}
+
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept {
+  return allocate(n, default_alignment, true);
+}
+
+void *operator new(std::size_t n, std::align_val_t a) {
+  return allocate(n, a, false);
+}
+
+void *operator new[](std::size_t n, std::align_val_t a) {
+  return allocate(n, a, false);
+}
+
+void *operator new(std::size_t n, std::align_val_t a,
+                   const std::nothrow_t &) noexcept {
+  return allocate(n, a, true);
+}
+
+void *operator new[](std::size_t n, std::align_val_t a,
+                     const std::nothrow_t &) noexcept {
+  return allocate(n, a, true);
+}
+
+void operator delete(void *p) noexcept { deallocate(p); }
+
+void operator delete[](void *p) noexcept { deallocate(p); }
+
+void operator delete(void *p, std::size_t) noexcept { deallocate(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { deallocate(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { deallocate(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { deallocate(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  deallocate(p);
+}
+
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  deallocate(p);
+}
+
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  deallocate(p);
+}
@@ -0,0 +1,53 @@
+#ifndef PONG_ALLOC_HPP
+#define PONG_ALLOC_HPP
+
+#include <cstdint>
+
+/**
+ * Heap allocation accounting.
+ *
+ * Linking the pong-alloc library replaces the global operator new / delete
+ * with versions that count every allocation, both process wide and per
+ * thread.  Only tests and benchmarks link it; the game doesn't.
+ */
+namespace pong::alloc {
+
+struct counts_t {
+  std::uint64_t allocations{};
+  std::uint64_t deallocations{};
+  std::uint64_t bytes{};
+
+  friend counts_t operator-(const counts_t &l, const counts_t &r) {
+    return {l.allocations - r.allocations, l.deallocations - r.deallocations,
+            l.bytes - r.bytes};
+  }
+
+  friend bool operator==(const counts_t &, const counts_t &) = default;
+};
+
+/**
+ * allocations made by the calling thread since it started
+ */
+counts_t thread_counts();
+
+/**
+ * allocations made by every thread since the process started
+ */
+counts_t process_counts();
+
+/**
+ * Counts the allocations made by the calling thread during its lifetime.
+ */
+class scope_t {
+public:
+  scope_t() : start_{thread_counts()} {}
+
+  [[nodiscard]] counts_t counts() const { return thread_counts() - start_; }
+
+private:
+  counts_t start_;
+};
+
+} // namespace pong::alloc
+
+#endif // PONG_ALLOC_HPP
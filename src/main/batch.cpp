@@ -0,0 +1,251 @@
+#include "batch.hpp"
+#include "concurrency.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+using pong::scalar_t;
+
+/*
+ * A lane per float of a 128 bit vector, the width of SSE and of WASM SIMD,
+ * with GCC / Clang vector extensions: Eigen 3.4 evaluates comparisons and
+ * select() a coefficient at a time, which drags whole expressions back to
+ * scalar code.  Comparisons give masks of all ones or all zeros per lane.
+ */
+using lane_t = scalar_t
+    __attribute__((vector_size(sizeof(scalar_t) * pong::batch_t::lanes)));
+using mask_t = std::int32_t
+    __attribute__((vector_size(sizeof(std::int32_t) * pong::batch_t::lanes)));
+
+static_assert(sizeof(lane_t) == sizeof(mask_t));
+
+// mask ? a : b, lane by lane
+lane_t select(mask_t mask, lane_t a, lane_t b) {
+  return lane_t((mask & mask_t(a)) | (~mask & mask_t(b)));
+}
+
+struct paddle_lanes_t {
+  lane_t min_x, min_y, max_x, max_y;
+  lane_t vy;
+};
+
+// the parts of an arena that move or that the collision tests read, a lane
+// per arena
+struct lanes_t {
+  lane_t arena_min_x, arena_min_y, arena_max_x, arena_max_y;
+  lane_t x, y, vx, vy, radius;
+  paddle_lanes_t lhs, rhs;
+};
+
+void gather(paddle_lanes_t &l, std::size_t i, const pong::paddle_t &paddle) {
+  l.min_x[i] = paddle.box().min()(0);
+  l.min_y[i] = paddle.box().min()(1);
+  l.max_x[i] = paddle.box().max()(0);
+  l.max_y[i] = paddle.box().max()(1);
+  l.vy[i] = paddle.velocity()(1);
+}
+
+void gather(lanes_t &l, std::size_t i, const pong::arena_t &arena) {
+  l.arena_min_x[i] = arena.box().min()(0);
+  l.arena_min_y[i] = arena.box().min()(1);
+  l.arena_max_x[i] = arena.box().max()(0);
+  l.arena_max_y[i] = arena.box().max()(1);
+  l.x[i] = arena.puck().centre()(0);
+  l.y[i] = arena.puck().centre()(1);
+  l.vx[i] = arena.puck().velocity()(0);
+  l.vy[i] = arena.puck().velocity()(1);
+  l.radius[i] = arena.puck().radius();
+  gather(l.lhs, i, arena.lhs_paddle());
+  gather(l.rhs, i, arena.rhs_paddle());
+}
+
+mask_t within(lane_t when, scalar_t dt) {
+  return (when >= -0.f) & (when <= dt);
+}
+
+/*
+ * The tests below are those of paddle_t::next_action and arena_t::next_action
+ * with the same arithmetic, so that a lane is quiet exactly when advance_time
+ * would find no action; where those skip a test (e.g. on a zero speed) the
+ * division here gives an infinity or a NaN, which fails it just the same.
+ */
+
+// paddle_t::next_action found something
+mask_t acts(const lanes_t &l, const paddle_lanes_t &p, scalar_t dt) {
+  // the paddle hits the top or bottom of the arena
+  const lane_t stop = select(p.vy > 0.f, l.arena_max_y - p.max_y - 1.f,
+                             l.arena_min_y - p.min_y + 1.f) /
+                      p.vy;
+  const mask_t stops = (p.vy != 0.f) & (stop > -0.f) & (stop <= dt);
+
+  const lane_t min_x = p.min_x - l.radius;
+  const lane_t min_y = p.min_y - l.radius;
+  const lane_t max_x = p.max_x + l.radius;
+  const lane_t max_y = p.max_y + l.radius;
+
+  // north / south surfaces
+  const lane_t ds = p.vy - l.vy;
+  const lane_t ns = (l.y - select(l.vy > -0.f, min_y, max_y)) / ds;
+  const lane_t ns_x = l.x + l.vx * ns;
+  const mask_t north_south = (ds == ds) & (ds != 0.f) & within(ns, dt) &
+                             (ns_x >= min_x) & (ns_x <= max_x);
+
+  // east / west surfaces
+  const lane_t ew = (select(l.vx > -0.f, min_x, max_x) - l.x) / l.vx;
+  const lane_t ew_y = l.y + l.vy * ew;
+  const mask_t east_west = within(ew, dt) & (ew_y >= min_y + ew * p.vy) &
+                           (ew_y <= max_y + ew * p.vy);
+
+  return stops | north_south | east_west;
+}
+
+// arena_t::next_action found something
+mask_t acts(const lanes_t &l, scalar_t dt) {
+  const lane_t min_x = l.arena_min_x + l.radius;
+  const lane_t min_y = l.arena_min_y + l.radius;
+  const lane_t max_x = l.arena_max_x - l.radius;
+  const lane_t max_y = l.arena_max_y - l.radius;
+
+  // north / south
+  const lane_t s = -l.vy;
+  const lane_t ns = (l.y - select(l.vy > -0.f, max_y, min_y)) / s;
+  const mask_t north_south = (s == s) & (s != 0.f) & within(ns, dt);
+
+  // east / west
+  const lane_t ew = (select(l.vx > -0.f, max_x, min_x) - l.x) / l.vx;
+
+  return north_south | within(ew, dt);
+}
+
+// paddle_t::advance_time; the result is the paddle's new box().min()(1)
+lane_t advance(const lanes_t &l, const paddle_lanes_t &p, scalar_t dt) {
+  const lane_t lower = l.arena_min_y + 1.f;
+  const lane_t upper = l.arena_max_y - (p.max_y - p.min_y) - 1.f;
+  const lane_t y = p.min_y + p.vy * dt;
+  // std::max(lower, std::min(upper, y))
+  const lane_t below = select(y < upper, y, upper);
+  return select(lower < below, below, lower);
+}
+
+} // namespace
+
+pong::batch_t::stats_t &
+pong::batch_t::stats_t::operator+=(const stats_t &other) {
+  ticks += other.ticks;
+  vectorised += other.vectorised;
+  actions += other.actions;
+  return *this;
+}
+
+pong::batch_t::batch_t(std::mt19937::result_type seed, std::size_t matches,
+                       const rules_t &rules) {
+  matches_.reserve(matches);
+  for (std::size_t i = 0; i < matches; ++i)
+    matches_.emplace_back(
+        std::make_unique<match_t>(seed + 3 * std::mt19937::result_type(i),
+                                  rules));
+}
+
+pong::batch_t::stats_t pong::batch_t::tick(scalar_t dt) {
+  PONG_TRACE_SCOPE("batch_t::tick");
+  return step(0, (size() + lanes - 1) / lanes, 1, dt);
+}
+
+pong::batch_t::stats_t pong::batch_t::run(std::size_t ticks, scalar_t dt,
+                                          std::size_t workers) {
+  PONG_TRACE_SCOPE("batch_t::run");
+
+  const auto groups = (size() + lanes - 1) / lanes;
+  workers = threads ? std::clamp<std::size_t>(workers, 1,
+                                              std::max<std::size_t>(groups, 1))
+                    : 1;
+
+  // a contiguous share of the groups each, the first on this thread
+  auto share = [&](std::size_t worker) { return groups * worker / workers; };
+
+  std::vector<stats_t> stats(workers);
+  {
+    std::vector<std::jthread> pool;
+    for (std::size_t w = 1; w < workers; ++w)
+      pool.emplace_back([&, w]() {
+        stats[w] = step(share(w), share(w + 1), ticks, dt);
+      });
+    stats[0] = step(share(0), share(1), ticks, dt);
+  }
+
+  stats_t result;
+  for (const auto &s : stats)
+    result += s;
+  return result;
+}
+
+std::size_t pong::batch_t::in_play() const {
+  return std::size_t(std::ranges::count_if(
+      matches_, [](const auto &match) { return match->in_play(); }));
+}
+
+pong::batch_t::stats_t pong::batch_t::step(std::size_t first, std::size_t last,
+                                           std::size_t ticks, scalar_t dt) {
+  stats_t stats;
+  for (std::size_t t = 0; t < ticks; ++t)
+    for (std::size_t g = first; g < last; ++g)
+      stats += step_lanes(g * lanes, std::min(lanes, size() - g * lanes), dt);
+  return stats;
+}
+
+pong::batch_t::stats_t pong::batch_t::step_lanes(std::size_t first,
+                                                 std::size_t n, scalar_t dt) {
+  stats_t stats;
+
+  // lanes past the end, or whose matches are over, stay at zero and inactive
+  lanes_t l{};
+  mask_t active{};
+
+  // as match_t::tick, steer whether or not the match is in play
+  for (std::size_t i = 0; i < n; ++i) {
+    auto &match = *matches_[first + i];
+    match.steer();
+    if (match.in_play()) {
+      active[i] = -1;
+      gather(l, i, match.arena());
+    }
+  }
+
+  const mask_t quiet =
+      active & ~(acts(l, l.lhs, dt) | acts(l, l.rhs, dt) | acts(l, dt));
+
+  // puck_t::advance_time
+  const lane_t x = l.x + l.vx * dt;
+  const lane_t y = l.y + l.vy * dt;
+  const lane_t lhs_y = advance(l, l.lhs, dt);
+  const lane_t rhs_y = advance(l, l.rhs, dt);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!active[i])
+      continue;
+
+    auto &match = *matches_[first + i];
+    ++stats.ticks;
+    if (!quiet[i]) {
+      stats.actions += match.advance(dt);
+      continue;
+    }
+
+    ++stats.vectorised;
+    auto &arena = match.arena_;
+    arena.puck().centre() = vec_t{x[i], y[i]};
+    // rectangle_t::box().translate
+    for (auto [paddle, to] : {std::pair{&arena.lhs_paddle(), lhs_y[i]},
+                              std::pair{&arena.rhs_paddle(), rhs_y[i]}}) {
+      const scalar_t by = to - paddle->box().min()(1);
+      paddle->box().min()(1) += by;
+      paddle->box().max()(1) += by;
+    }
+  }
+
+  return stats;
+}
@@ -0,0 +1,105 @@
+#ifndef PONG_BATCH_HPP
+#define PONG_BATCH_HPP
+
+#include "match.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace pong {
+
+/**
+ * Many AI vs AI matches stepped together in fixed ticks, for tournaments
+ * played faster than real time (natively or in the browser).
+ *
+ * Matches are stepped lanes at a time.  The collision tests of the arena and
+ * both paddles (paddle_t::next_action and arena_t::next_action) run for every
+ * lane at once in 128 bit vectors: SSE natively, while in the browser,
+ * without WASM SIMD, the compiler lowers them to scalar code.  A tick is
+ * quiet for most lanes, which then move on in the same vectors with the
+ * arithmetic of arena_t::advance_time; only lanes where something happens
+ * take the scalar path.  Either way each match steps exactly as
+ * match_t::tick would step it, bit for bit.
+ *
+ * run() shares the lanes out between worker threads, each of which steps its
+ * own matches for every tick without synchronising with the others.
+ */
+class batch_t {
+public:
+  static constexpr std::size_t lanes = 4;
+
+  struct stats_t {
+    // match ticks stepped while in play
+    std::size_t ticks{};
+    // of which were advanced by the vector path alone
+    std::size_t vectorised{};
+    // actions that happened, as returned by match_t::tick
+    std::size_t actions{};
+
+    stats_t &operator+=(const stats_t &);
+  };
+
+  /**
+   * matches are seeded from seed in steps of three, as a match uses its seed
+   * and the next two
+   */
+  batch_t(std::mt19937::result_type seed, std::size_t matches,
+          const rules_t &rules = {});
+
+  batch_t(const batch_t &) = delete;
+
+  batch_t &operator=(const batch_t &) = delete;
+
+  /**
+   * step every match by a tick of length dt on the calling thread
+   */
+  stats_t tick(scalar_t dt);
+
+  /**
+   * step every match by ticks ticks of length dt on up to workers threads,
+   * the calling thread included; without threads (see pong::threads) they
+   * all run on the calling thread
+   */
+  stats_t run(std::size_t ticks, scalar_t dt, std::size_t workers);
+
+  /**
+   * seat bots at match i in place of its AIs (see match_t::seat)
+   */
+  void seat(std::size_t i, std::unique_ptr<bot_t> lhs,
+            std::unique_ptr<bot_t> rhs) {
+    matches_[i]->seat(std::move(lhs), std::move(rhs));
+  }
+
+  [[nodiscard]] std::size_t size() const { return matches_.size(); }
+
+  [[nodiscard]] const match_t &operator[](std::size_t i) const {
+    return *matches_[i];
+  }
+
+  /**
+   * the number of matches still in play
+   */
+  [[nodiscard]] std::size_t in_play() const;
+
+private:
+  /**
+   * step the matches of groups [first, last), of lanes matches each, by ticks
+   * ticks
+   */
+  stats_t step(std::size_t first, std::size_t last, std::size_t ticks,
+               scalar_t dt);
+
+  /**
+   * step the n <= lanes matches from first by a tick
+   */
+  stats_t step_lanes(std::size_t first, std::size_t n, scalar_t dt);
+
+  std::vector<std::unique_ptr<match_t>> matches_;
+};
+
+} // namespace pong
+
+#endif // PONG_BATCH_HPP
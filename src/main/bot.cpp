@@ -0,0 +1,151 @@
+#include "bot.hpp"
+
+#include <dlfcn.h>
+#include <time.h>
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+static_assert(std::is_same_v<pong::scalar_t, float>,
+              "pong_bot.h speaks floats");
+
+// the calling thread's CPU time so far
+std::chrono::nanoseconds cpu_time() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+std::atomic<std::uint64_t> next_id{1};
+
+} // namespace
+
+pong_bot_state pong::bot_state(const arena_t &a, const paddle_t &paddle) {
+  auto corners = [](float(&to)[4], const box_t &b) {
+    to[0] = b.min()(0);
+    to[1] = b.min()(1);
+    to[2] = b.max()(0);
+    to[3] = b.max()(1);
+  };
+
+  pong_bot_state s{};
+  corners(s.arena, a.box());
+  s.puck[0] = a.puck().centre()(0);
+  s.puck[1] = a.puck().centre()(1);
+  s.puck_velocity[0] = a.puck().velocity()(0);
+  s.puck_velocity[1] = a.puck().velocity()(1);
+  s.puck_radius = a.puck().radius();
+  corners(s.lhs_paddle, a.lhs_paddle().box());
+  s.lhs_velocity = a.lhs_paddle().velocity()(1);
+  corners(s.rhs_paddle, a.rhs_paddle().box());
+  s.rhs_velocity = a.rhs_paddle().velocity()(1);
+  s.lhs_score = a.lhs_score();
+  s.rhs_score = a.rhs_score();
+  s.side = &paddle == &a.rhs_paddle();
+  return s;
+}
+
+pong::plugin_t::stats_t &
+pong::plugin_t::stats_t::operator+=(const stats_t &other) {
+  cpu_ns += other.cpu_ns;
+  over_budget += other.over_budget;
+  unplayable += other.unplayable;
+  suspended += other.suspended;
+  return *this;
+}
+
+pong::plugin_t::plugin_t(const std::string &path,
+                         std::chrono::nanoseconds budget, unsigned strikes)
+    : budget_{budget}, strikes_{strikes}, id_{next_id++} {
+  handle_ = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle_)
+    throw std::runtime_error{::dlerror()};
+
+  using entry_t = const pong_bot_api *(*)();
+  const auto entry =
+      reinterpret_cast<entry_t>(::dlsym(handle_, PONG_BOT_ENTRY));
+  api_ = entry ? entry() : nullptr;
+  if (!api_ || api_->abi_version != PONG_BOT_ABI_VERSION || !api_->name ||
+      !api_->create || !api_->destroy || !api_->paddle_speed) {
+    ::dlclose(handle_);
+    throw std::runtime_error{path + " is not a pong bot of ABI version " +
+                             std::to_string(PONG_BOT_ABI_VERSION)};
+  }
+}
+
+pong::plugin_t::plugin_t(const pong_bot_api &api,
+                         std::chrono::nanoseconds budget, unsigned strikes)
+    : api_{&api}, budget_{budget}, strikes_{strikes}, id_{next_id++} {}
+
+pong::plugin_t::~plugin_t() {
+  if (handle_)
+    ::dlclose(handle_);
+}
+
+pong::plugin_t::stats_t pong::plugin_t::stats() const {
+  const std::lock_guard lock{mutex_};
+  stats_t stats;
+  for (const auto &shard : shards_)
+    stats += *shard;
+  return stats;
+}
+
+pong::plugin_t::stats_t &pong::plugin_t::shard() {
+  // the shards this thread records into, by plugin; a thread plays few
+  thread_local std::vector<std::pair<std::uint64_t, stats_t *>> shards;
+  for (const auto &[id, shard] : shards)
+    if (id == id_)
+      return *shard;
+
+  const std::lock_guard lock{mutex_};
+  auto &shard = *shards_.emplace_back(std::make_unique<stats_t>());
+  shards.emplace_back(id_, &shard);
+  return shard;
+}
+
+pong::bot_t::bot_t(plugin_t &plugin, std::uint32_t seed)
+    : plugin_{plugin}, bot_{plugin.api_->create(seed)} {
+  if (!bot_)
+    throw std::runtime_error{plugin.name() + " could not create a bot"};
+}
+
+pong::bot_t::~bot_t() { plugin_.api_->destroy(bot_); }
+
+std::optional<pong::scalar_t>
+pong::bot_t::paddle_speed(const arena_t &arena, const paddle_t &paddle) {
+  if (plugin_.strikes_ && strikes_ == plugin_.strikes_)
+    return last_;
+
+  const auto state = bot_state(arena, paddle);
+  float speed{};
+  const auto start = cpu_time();
+  const bool decided = plugin_.api_->paddle_speed(bot_, &state, &speed);
+  const auto cpu = cpu_time() - start;
+
+  auto &stats = plugin_.shard();
+  stats.cpu_ns.record(std::uint64_t(cpu.count()));
+  if (cpu > plugin_.budget_) {
+    ++stats.over_budget;
+    if (++strikes_ == plugin_.strikes_)
+      ++stats.suspended;
+    return last_;
+  }
+  if (decided && !std::isfinite(speed)) {
+    // no paddle can go that fast, and the arena would never finish a tick
+    // that one did
+    ++stats.unplayable;
+    if (++strikes_ == plugin_.strikes_)
+      ++stats.suspended;
+    return last_;
+  }
+  strikes_ = 0;
+  if (!decided)
+    return {};
+  return last_ = clamp_speed(speed);
+}
@@ -0,0 +1,132 @@
+#ifndef PONG_BOT_HPP
+#define PONG_BOT_HPP
+
+#include "model.hpp"
+#include "pong_bot.h"
+#include "profile.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pong {
+
+/**
+ * the arena as the bot playing paddle sees it
+ */
+pong_bot_state bot_state(const arena_t &, const paddle_t &paddle);
+
+/**
+ * A bot plugin (see pong_bot.h), loaded from a shared object or linked in,
+ * and what its bots have cost.
+ *
+ * Every decision a bot makes is timed by the calling thread's CPU clock, so
+ * that a bot isn't charged for the time its thread was preempted, against
+ * the plugin's budget.  A decision over budget is dropped and the bot's
+ * previous one stands; a bot over budget strikes decisions running isn't
+ * asked again for the rest of its match, so that it holds up its worker no
+ * longer than that.  A call can't be cut short, though: a bot that never
+ * returns stalls its worker.
+ *
+ * A decided speed is clamped to max_paddle_speed, as a remote player's is,
+ * except that one that isn't finite is dropped and counted against the bot
+ * as a decision over budget is.
+ */
+class plugin_t {
+public:
+  struct stats_t {
+    // CPU time of each decision
+    histogram_t cpu_ns;
+    std::uint64_t over_budget{};
+    // decisions of speeds no paddle can move at (infinite, or NaN)
+    std::uint64_t unplayable{};
+    // bots that struck out
+    std::uint64_t suspended{};
+
+    stats_t &operator+=(const stats_t &);
+  };
+
+  /**
+   * load the plugin at path (as dlopen finds it), throwing
+   * std::runtime_error if it can't be or its ABI isn't this one's
+   */
+  plugin_t(const std::string &path, std::chrono::nanoseconds budget,
+           unsigned strikes = 8);
+
+  /**
+   * a plugin linked in
+   */
+  plugin_t(const pong_bot_api &, std::chrono::nanoseconds budget,
+           unsigned strikes = 8);
+
+  plugin_t(const plugin_t &) = delete;
+
+  plugin_t &operator=(const plugin_t &) = delete;
+
+  ~plugin_t();
+
+  [[nodiscard]] std::string name() const { return api_->name; }
+
+  [[nodiscard]] std::chrono::nanoseconds budget() const { return budget_; }
+
+  /**
+   * what its bots have cost so far, from every thread; only while none of
+   * them is deciding
+   */
+  [[nodiscard]] stats_t stats() const;
+
+private:
+  friend class bot_t;
+
+  // the stats of the calling thread's decisions
+  stats_t &shard();
+
+  void *handle_{};
+  const pong_bot_api *api_{};
+  std::chrono::nanoseconds budget_;
+  unsigned strikes_;
+  // tells this plugin's shards from those of plugins gone before it
+  std::uint64_t id_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<stats_t>> shards_;
+};
+
+/**
+ * A plugin's bot playing a paddle, as ai_t does.
+ */
+class bot_t {
+public:
+  /**
+   * throws std::runtime_error if the plugin can't create one
+   */
+  bot_t(plugin_t &, std::uint32_t seed);
+
+  bot_t(const bot_t &) = delete;
+
+  bot_t &operator=(const bot_t &) = delete;
+
+  ~bot_t();
+
+  /**
+   * as ai_t::paddle_speed, or the bot's previous speed if it was over
+   * budget or not finite
+   */
+  std::optional<scalar_t> paddle_speed(const arena_t &, const paddle_t &);
+
+  [[nodiscard]] const plugin_t &plugin() const { return plugin_; }
+
+private:
+  plugin_t &plugin_;
+  void *bot_;
+  std::optional<scalar_t> last_;
+  // decisions over budget running
+  unsigned strikes_{};
+};
+
+} // namespace pong
+
+#endif // PONG_BOT_HPP
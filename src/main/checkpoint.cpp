@@ -0,0 +1,196 @@
+#include "checkpoint.hpp"
+#include "net.hpp"
+#include "trace.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+namespace {
+
+[[noreturn]] void fail(const char *what) {
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+// "PONGCKPT", read as a little endian word
+constexpr std::uint64_t magic = 0x54504b43474e4f50;
+
+constexpr std::size_t header_size = 64;
+constexpr std::size_t loop_header_size = 64;
+constexpr std::size_t page_size = 4096;
+
+struct header_t {
+  std::atomic<std::uint64_t> magic;
+  std::uint32_t version;
+  std::uint32_t loops;
+  std::uint64_t slots;
+  std::uint64_t slot_size;
+  std::uint64_t tick_period_ns;
+};
+
+static_assert(sizeof(header_t) <= header_size);
+static_assert(sizeof(pong::checkpoint_t::loop_header_t) <= loop_header_size);
+static_assert(std::is_trivially_copyable_v<pong::checkpoint_t::slot_t>);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "a checkpoint's epochs are read by another process");
+
+std::size_t page_align(std::size_t n) {
+  return (n + page_size - 1) / page_size * page_size;
+}
+
+// msync the pages holding [p, p + size)
+bool sync(const void *p, std::size_t size) {
+  const auto from = reinterpret_cast<std::uintptr_t>(p) / page_size * page_size;
+  const auto to = reinterpret_cast<std::uintptr_t>(p) + size;
+  return ::msync(reinterpret_cast<void *>(from), to - from, MS_SYNC) == 0;
+}
+
+} // namespace
+
+pong::checkpoint_t::checkpoint_t(const std::string &path, unsigned loops,
+                                 std::size_t slots,
+                                 std::chrono::nanoseconds tick_period)
+    : loops_{loops}, slots_{slots},
+      size_{header_size + 2 * loops * half_size()}, pending_(loops) {
+  const fd_t fd{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)};
+  if (!fd)
+    fail("open");
+  struct stat st{};
+  if (::fstat(fd.get(), &st) < 0)
+    fail("fstat");
+  // a new file, or one the server that created it got no further with
+  const bool fresh = std::size_t(st.st_size) < header_size;
+  if (fresh && ::ftruncate(fd.get(), off_t(size_)) < 0)
+    fail("ftruncate");
+  if (!fresh && std::size_t(st.st_size) != size_)
+    throw std::runtime_error{path + " is not a checkpoint of these options"};
+
+  memory_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd.get(), 0);
+  if (memory_ == MAP_FAILED)
+    fail("mmap");
+
+  auto *header = static_cast<header_t *>(memory_);
+  if (fresh || header->magic.load(std::memory_order_acquire) == 0) {
+    header->version = version;
+    header->loops = loops;
+    header->slots = slots;
+    header->slot_size = sizeof(slot_t);
+    header->tick_period_ns = std::uint64_t(tick_period.count());
+    header->magic.store(magic, std::memory_order_release);
+    if (!sync(header, header_size))
+      fail("msync");
+  } else if (header->magic.load(std::memory_order_acquire) != magic ||
+             header->version != version || header->loops != loops ||
+             header->slots != slots || header->slot_size != sizeof(slot_t) ||
+             header->tick_period_ns != std::uint64_t(tick_period.count())) {
+    ::munmap(memory_, size_);
+    throw std::runtime_error{path + " is not a checkpoint of these options, "
+                                    "or of this build"};
+  }
+
+  writer_ = std::jthread{[this](std::stop_token stop) { write_out(stop); }};
+}
+
+pong::checkpoint_t::~checkpoint_t() {
+  flush();
+  writer_.request_stop();
+  writer_.join();
+  ::munmap(memory_, size_);
+}
+
+std::optional<pong::checkpoint_t::half_t>
+pong::checkpoint_t::latest(unsigned loop) const {
+  const auto a = half(loop, 0);
+  const auto b = half(loop, 1);
+  if (a.epoch == 0 && b.epoch == 0)
+    return {};
+  return a.epoch > b.epoch ? a : b;
+}
+
+std::optional<pong::checkpoint_t::half_t>
+pong::checkpoint_t::begin(unsigned loop) {
+  {
+    const std::lock_guard lock{mutex_};
+    if (pending_[loop])
+      return {};
+  }
+  const auto a = half(loop, 0);
+  const auto b = half(loop, 1);
+  // the newer stands until this one is written out
+  auto older = a.epoch > b.epoch ? b : a;
+  older.epoch = std::max(a.epoch, b.epoch) + 1;
+  return older;
+}
+
+void pong::checkpoint_t::commit(unsigned loop, const half_t &half) {
+  {
+    const std::lock_guard lock{mutex_};
+    pending_[loop] = true;
+    jobs_.push_back({.loop = loop, .half = half});
+  }
+  changed_.notify_all();
+}
+
+void pong::checkpoint_t::flush() {
+  std::unique_lock lock{mutex_};
+  changed_.wait(lock, [this] {
+    return std::ranges::none_of(pending_, [](bool p) { return p; });
+  });
+}
+
+pong::checkpoint_t::half_t pong::checkpoint_t::half(unsigned loop,
+                                                     unsigned index) const {
+  auto *p = static_cast<std::byte *>(memory_) + header_size +
+            (2 * loop + index) * half_size();
+  auto *header = reinterpret_cast<loop_header_t *>(p);
+  return {.header = header,
+          .slots = reinterpret_cast<slot_t *>(p + loop_header_size),
+          .index = index,
+          .epoch = header->epoch.load(std::memory_order_acquire)};
+}
+
+std::size_t pong::checkpoint_t::half_size() const {
+  return page_align(loop_header_size + slots_ * sizeof(slot_t));
+}
+
+void pong::checkpoint_t::write_out(std::stop_token stop) {
+  PONG_TRACE_THREAD_NAME("checkpoint writer");
+  std::vector<job_t> jobs;
+  while (true) {
+    {
+      std::unique_lock lock{mutex_};
+      changed_.wait(lock, stop, [this] { return !jobs_.empty(); });
+      if (jobs_.empty())
+        return;
+      std::swap(jobs, jobs_);
+    }
+
+    for (const auto &[loop, half] : jobs) {
+      PONG_TRACE_SCOPE("checkpoint_t::write_out");
+      // the slots first, so that a half is only ever marked the newer once
+      // it's all on disk; one that can't be is left the older, for the loop
+      // to try again
+      if (!sync(half.header,
+                loop_header_size + half.header->slots * sizeof(slot_t)))
+        continue;
+      half.header->epoch.store(half.epoch, std::memory_order_release);
+      sync(half.header, loop_header_size);
+    }
+
+    {
+      const std::lock_guard lock{mutex_};
+      for (const auto &job : jobs)
+        pending_[job.loop] = false;
+    }
+    jobs.clear();
+    changed_.notify_all();
+  }
+}
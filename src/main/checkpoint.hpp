@@ -0,0 +1,159 @@
+#ifndef PONG_CHECKPOINT_HPP
+#define PONG_CHECKPOINT_HPP
+
+#include "match.hpp"
+#include "protocol.hpp"
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pong {
+
+/**
+ * A server's matches, checkpointed to a file it maps (mmap), so that a
+ * server started in its place (e.g. a new build) takes them up where they
+ * left off rather than losing them.
+ *
+ * Each of the server's loops has two halves of the file, each a complete
+ * checkpoint of its sessions' slots, and writes the older while the newer
+ * is left alone: a copy on write, so that whatever becomes of a checkpoint
+ * being written, the one before stands.  A loop writes straight into the
+ * mapping, and only the slots that changed since it last wrote that half;
+ * it then hands the half to a thread of the checkpoint's own, which
+ * msyncs it and only then marks it the newer, by its epoch, and msyncs
+ * that too.  The loop never waits on the disk: until the half is marked it
+ * skips its checkpoints.
+ *
+ * A checkpoint is only taken up by a server of the same build, layout and
+ * options (loops, slots per loop and tick period), where its matches carry
+ * on exactly (see remote_match_t::state_t); players find theirs on the
+ * same loop as long as the kernel spreads them over as many sockets on the
+ * same host as it did.
+ *
+ * The file is laid out as a 64-byte header (a 64-bit magic, set last, then
+ * 32-bit version and loops and 64-bit slots, slot size and tick period in
+ * nanoseconds) followed by each loop's two halves, page aligned: a 64-byte
+ * loop_header_t then its slot_t's, in the host's byte order.
+ */
+class checkpoint_t {
+public:
+  static constexpr std::uint32_t version = 1;
+
+  struct loop_header_t {
+    // which half is the newer; 0 for one never written
+    std::atomic<std::uint64_t> epoch;
+    // the loop's tick
+    std::uint64_t tick;
+    // players it has welcomed so far, of which its matches' seeds follow
+    std::uint64_t joined;
+    // the slots it had
+    std::uint64_t slots;
+  };
+
+  /**
+   * a session's slot, as host.cpp's session_t but for its spectators, who
+   * watch again, and when its player was last heard from, which starts
+   * over
+   */
+  struct slot_t {
+    // whether a session holds it
+    bool used;
+    std::uint32_t generation;
+    sockaddr_in player;
+    std::uint64_t nonce;
+    protocol::sync_t sync;
+    bool keyframe;
+    std::uint32_t reported;
+    std::uint64_t start;
+    // the tick its session is to be woken
+    std::uint64_t wake;
+    remote_match_t::state_t match;
+  };
+
+  /**
+   * a loop's half of the file, with epoch, once written, the half's
+   */
+  struct half_t {
+    loop_header_t *header;
+    slot_t *slots;
+    unsigned index;
+    std::uint64_t epoch;
+  };
+
+  /**
+   * open the checkpoint at path, or create it if there isn't one, throwing
+   * std::system_error if it can't be and std::runtime_error if it's one of
+   * a server with other options, or of another build
+   */
+  checkpoint_t(const std::string &path, unsigned loops, std::size_t slots,
+               std::chrono::nanoseconds tick_period);
+
+  checkpoint_t(const checkpoint_t &) = delete;
+
+  checkpoint_t &operator=(const checkpoint_t &) = delete;
+
+  /**
+   * after the checkpoints begun have been written out
+   */
+  ~checkpoint_t();
+
+  /**
+   * a loop's newer half, if it has written one
+   */
+  [[nodiscard]] std::optional<half_t> latest(unsigned loop) const;
+
+  /**
+   * a loop's older half, to write its next checkpoint into; none while its
+   * last is still being written out
+   */
+  std::optional<half_t> begin(unsigned loop);
+
+  /**
+   * have a half begun written out in the background, then marked the newer
+   */
+  void commit(unsigned loop, const half_t &);
+
+  /**
+   * wait until every half committed has been written out
+   */
+  void flush();
+
+private:
+  struct job_t {
+    unsigned loop;
+    half_t half;
+  };
+
+  [[nodiscard]] half_t half(unsigned loop, unsigned index) const;
+
+  // how much of a half there is, page aligned
+  [[nodiscard]] std::size_t half_size() const;
+
+  void write_out(std::stop_token);
+
+  unsigned loops_;
+  std::size_t slots_;
+  std::size_t size_{};
+  void *memory_{};
+
+  std::mutex mutex_;
+  std::condition_variable_any changed_;
+  std::vector<job_t> jobs_;
+  // whether each loop has a half committed and not yet written out
+  std::vector<bool> pending_;
+  std::jthread writer_;
+};
+
+} // namespace pong
+
+#endif // PONG_CHECKPOINT_HPP
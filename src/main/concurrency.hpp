@@ -0,0 +1,193 @@
+#ifndef PONG_CONCURRENCY_HPP
+#define PONG_CONCURRENCY_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <semaphore>
+#include <type_traits>
+
+namespace pong {
+
+/**
+ * Whether there are threads to run things on: natively, and in the browser
+ * only when compiled with emscripten's -pthread, which no build here does
+ * yet.  Otherwise the browser's main thread is the only one.
+ */
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+inline constexpr bool threads = true;
+#else
+inline constexpr bool threads = false;
+#endif
+
+/**
+ * A single writer, multiple reader sequence lock.
+ *
+ * The writer never blocks; readers retry until they observe a value that
+ * wasn't being written at the time.  The value is held as relaxed atomic
+ * words so that torn reads are well defined (and discarded).
+ */
+template <typename T> class seqlock_t {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  using word_t = std::uint64_t;
+  static constexpr std::size_t words = (sizeof(T) + sizeof(word_t) - 1) / sizeof(word_t);
+
+public:
+  seqlock_t() : seqlock_t(T{}) {}
+
+  explicit seqlock_t(const T &value) { store(value); }
+
+  seqlock_t(const seqlock_t &) = delete;
+
+  seqlock_t &operator=(const seqlock_t &) = delete;
+
+  /**
+   * publish a new value; must only be called from one thread at a time
+   */
+  void store(const T &value) noexcept {
+    std::array<word_t, words> buffer{};
+    std::memcpy(buffer.data(), &value, sizeof(T));
+
+    const auto seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < words; ++i)
+      data_[i].store(buffer[i], std::memory_order_relaxed);
+
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * read the most recently published value
+   */
+  [[nodiscard]] T load() const noexcept {
+    std::array<word_t, words> buffer;
+    std::uint64_t before, after;
+
+    do {
+      before = seq_.load(std::memory_order_acquire);
+
+      for (std::size_t i = 0; i < words; ++i)
+        buffer[i] = data_[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1) != 0);
+
+    T result;
+    std::memcpy(static_cast<void *>(&result), buffer.data(), sizeof(T));
+    return result;
+  }
+
+  /**
+   * the number of values published so far
+   */
+  [[nodiscard]] std::uint64_t version() const noexcept {
+    return seq_.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  alignas(64) std::atomic<std::uint64_t> seq_{};
+  std::array<std::atomic<word_t>, words> data_{};
+};
+
+/**
+ * A bounded, lock free, single producer, single consumer queue.
+ */
+template <typename T, std::size_t Capacity> class spsc_queue_t {
+  static_assert(std::has_single_bit(Capacity));
+
+public:
+  spsc_queue_t() = default;
+
+  spsc_queue_t(const spsc_queue_t &) = delete;
+
+  spsc_queue_t &operator=(const spsc_queue_t &) = delete;
+
+  /**
+   * producer: enqueue value, returning false (and dropping it) if full
+   */
+  bool push(const T &value) noexcept {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) == Capacity)
+      return false;
+
+    buffer_[tail % Capacity] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * consumer: the oldest value in the queue, or nullptr if empty
+   */
+  [[nodiscard]] const T *front() const noexcept {
+    const auto head = head_.load(std::memory_order_relaxed);
+
+    if (head == tail_.load(std::memory_order_acquire))
+      return nullptr;
+
+    return &buffer_[head % Capacity];
+  }
+
+  /**
+   * consumer: discard the value returned by front
+   */
+  void pop() noexcept {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+private:
+  alignas(64) std::atomic<std::size_t> head_{};
+  alignas(64) std::atomic<std::size_t> tail_{};
+  std::array<T, Capacity> buffer_{};
+};
+
+/**
+ * A bounded single producer, single consumer queue whose ends block: push
+ * waits while the queue is full and pop waits while it is empty.  For
+ * connecting the stages of a pipeline, where a full queue is back pressure
+ * rather than a reason to drop values.
+ */
+template <typename T, std::size_t Capacity> class pipe_t {
+public:
+  pipe_t() = default;
+
+  pipe_t(const pipe_t &) = delete;
+
+  pipe_t &operator=(const pipe_t &) = delete;
+
+  /**
+   * producer: enqueue value, waiting for space if need be
+   */
+  void push(const T &value) {
+    free_.acquire();
+    queue_.push(value);
+    used_.release();
+  }
+
+  /**
+   * consumer: dequeue the oldest value, waiting for one if need be
+   */
+  [[nodiscard]] T pop() {
+    used_.acquire();
+    T value = *queue_.front();
+    queue_.pop();
+    free_.release();
+    return value;
+  }
+
+private:
+  spsc_queue_t<T, Capacity> queue_;
+  std::counting_semaphore<Capacity> free_{Capacity};
+  std::counting_semaphore<Capacity> used_{0};
+};
+
+} // namespace pong
+
+#endif // PONG_CONCURRENCY_HPP
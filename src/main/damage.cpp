@@ -0,0 +1,120 @@
+#include "damage.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+/**
+ * A 64 bit hash over draw list buffers, a word at a time since they are
+ * hashed every frame.
+ */
+class hasher_t {
+public:
+  void bytes(const void *data, std::size_t size) {
+    const auto *p = static_cast<const unsigned char *>(data);
+    for (; size >= 8; p += 8, size -= 8) {
+      std::uint64_t word;
+      std::memcpy(&word, p, 8);
+      mix(word);
+    }
+    if (size > 0) {
+      std::uint64_t word = 0;
+      std::memcpy(&word, p, size);
+      mix(word ^ (std::uint64_t{size} << 56));
+    }
+  }
+
+  template <typename T> void value(const T &t) { bytes(&t, sizeof t); }
+
+  [[nodiscard]] std::uint64_t finish() const {
+    auto h = h_;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+private:
+  void mix(std::uint64_t word) {
+    h_ = std::rotl(h_ ^ (word * 0x87c37b91114253d5ull), 31) *
+         0x4cf5ad432745937full;
+  }
+
+  std::uint64_t h_{0x9e3779b97f4a7c15ull};
+};
+
+ImVec4 merge(const ImVec4 &a, const ImVec4 &b) {
+  if (pong::empty(a))
+    return b;
+  if (pong::empty(b))
+    return a;
+  return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z),
+          std::max(a.w, b.w)};
+}
+
+} // namespace
+
+ImVec4 pong::damage_t::update(const ImDrawData &draw_data) {
+  PONG_TRACE_SCOPE("damage_t::update");
+
+  std::swap(lists_, previous_);
+  lists_.clear();
+  for (int i = 0; i < draw_data.CmdListsCount; ++i) {
+    const ImDrawList &list = *draw_data.CmdLists[i];
+    hasher_t hasher;
+    hasher.bytes(list.VtxBuffer.Data,
+                 std::size_t(list.VtxBuffer.size_in_bytes()));
+    hasher.bytes(list.IdxBuffer.Data,
+                 std::size_t(list.IdxBuffer.size_in_bytes()));
+    // field by field, as commands have padding
+    ImVec4 bounds{};
+    for (const ImDrawCmd &cmd : list.CmdBuffer) {
+      hasher.value(cmd.ClipRect);
+      hasher.value(cmd.GetTexID());
+      hasher.value(cmd.VtxOffset);
+      hasher.value(cmd.IdxOffset);
+      hasher.value(cmd.ElemCount);
+      hasher.value(reinterpret_cast<std::uintptr_t>(cmd.UserCallback));
+      hasher.value(cmd.UserCallbackData);
+      bounds = merge(bounds, cmd.ClipRect);
+    }
+    lists_.push_back({hasher.finish(), bounds});
+  }
+
+  const ImVec4 display{draw_data.DisplayPos.x, draw_data.DisplayPos.y,
+                       draw_data.DisplayPos.x + draw_data.DisplaySize.x,
+                       draw_data.DisplayPos.y + draw_data.DisplaySize.y};
+  if (!std::exchange(valid_, true) ||
+      draw_data.DisplayPos.x != display_pos_.x ||
+      draw_data.DisplayPos.y != display_pos_.y ||
+      draw_data.DisplaySize.x != display_size_.x ||
+      draw_data.DisplaySize.y != display_size_.y) {
+    display_pos_ = draw_data.DisplayPos;
+    display_size_ = draw_data.DisplaySize;
+    return display;
+  }
+
+  ImVec4 damage{};
+  const auto n = std::max(lists_.size(), previous_.size());
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto *now = i < lists_.size() ? &lists_[i] : nullptr;
+    const auto *before = i < previous_.size() ? &previous_[i] : nullptr;
+    if (now && before && now->hash == before->hash)
+      continue;
+    if (now)
+      damage = merge(damage, now->bounds);
+    if (before)
+      damage = merge(damage, before->bounds);
+  }
+
+  // lists may draw outside the display, which isn't damage
+  damage = {std::max(damage.x, display.x), std::max(damage.y, display.y),
+            std::min(damage.z, display.z), std::min(damage.w, display.w)};
+  return empty(damage) ? ImVec4{} : damage;
+}
@@ -0,0 +1,55 @@
+#ifndef PONG_DAMAGE_HPP
+#define PONG_DAMAGE_HPP
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pong {
+
+/**
+ * Tracks which parts of the display change from one frame's draw data to the
+ * next, so that a frame that looks the same as the one on screen (the WINNER!
+ * screen, say) needn't be submitted or swapped at all.
+ *
+ * Each draw list is summarised by a hash of its vertices, indices and commands
+ * and by the bounds of its commands' clip rectangles.  A list whose hash
+ * differs from that of the list in the same position last frame damages both
+ * its old and its new bounds; a change to the display damages all of it.
+ */
+class damage_t {
+public:
+  /**
+   * the damage between the last frame passed to update and this one, as a
+   * rectangle {min x, min y, max x, max y} in display coordinates (like
+   * ImDrawCmd::ClipRect); empty if the two frames draw the same
+   */
+  ImVec4 update(const ImDrawData &);
+
+  /**
+   * damage the whole of the next frame, e.g. when the window's contents have
+   * been lost
+   */
+  void invalidate() { valid_ = false; }
+
+private:
+  struct list_t {
+    std::uint64_t hash;
+    ImVec4 bounds;
+  };
+
+  std::vector<list_t> lists_;
+  std::vector<list_t> previous_;
+  ImVec2 display_pos_;
+  ImVec2 display_size_;
+  bool valid_{false};
+};
+
+[[nodiscard]] inline bool empty(const ImVec4 &rect) {
+  return rect.z <= rect.x || rect.w <= rect.y;
+}
+
+} // namespace pong
+
+#endif // PONG_DAMAGE_HPP
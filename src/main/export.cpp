@@ -0,0 +1,114 @@
+/**
+ * pong-export : renders an AI vs AI match, without a window or GPU and as
+ * fast as the machine allows, as raw video on stdout (or to a file), e.g.
+ *
+ *   pong-export --seed 7 | ffmpeg -i - -c:v libx264 -pix_fmt yuv420p reel.mp4
+ *
+ *   pong-export [--seed SEED] [--fps N] [--seconds S] [--format y4m|ppm]
+ *               [--threads N] [--ai-skill N] [--winning-score N]
+ *               [--output FILE]
+ *
+ * The match, and so the video, is determined by the seed and rules.  Progress
+ * is reported on stderr.
+ */
+#include "ui.hpp"
+#include "video.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+namespace p = pong;
+
+struct options_t {
+  p::video_options_t video;
+  std::string_view output;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  auto &video = options.video;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--seed")
+      ok = parse(value, video.seed);
+    else if (arg == "--fps")
+      ok = parse(value, video.fps) && video.fps > 0;
+    else if (arg == "--seconds")
+      ok = parse(value, video.seconds) && video.seconds > 0;
+    else if (arg == "--threads")
+      ok = parse(value, video.threads) && video.threads > 0;
+    else if (arg == "--ai-skill")
+      ok = parse(value, video.rules.ai_skill) &&
+           video.rules.ai_skill >= p::settings_t::ai_skill_min &&
+           video.rules.ai_skill <= p::settings_t::ai_skill_max;
+    else if (arg == "--winning-score")
+      ok = parse(value, video.rules.winning_score) &&
+           video.rules.winning_score > 0;
+    else if (arg == "--format") {
+      ok = value == "y4m" || value == "ppm";
+      video.format = value == "y4m" ? p::video_format_t::y4m
+                                    : p::video_format_t::ppm;
+    } else if (arg == "--output")
+      ok = !(options.output = value).empty();
+    if (!ok)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--seed SEED] [--fps N] [--seconds S] "
+                 "[--format y4m|ppm] [--threads N] [--ai-skill N] "
+                 "[--winning-score N] [--output FILE]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!options.output.empty()) {
+    file.open(std::string{options.output}, std::ios::binary);
+    if (!file) {
+      std::fprintf(stderr, "can't open %s\n", std::string{options.output}.c_str());
+      return 1;
+    }
+  }
+  std::ostream &os = options.output.empty() ? std::cout : file;
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto stats = p::write_video(os, options.video);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::fprintf(stderr, "frames   %zu (%.1f s of video)\n", stats.frames,
+               double(stats.frames) / options.video.fps);
+  std::fprintf(stderr, "score    %u - %u\n", stats.last.lhs_score,
+               stats.last.rhs_score);
+  std::fprintf(stderr, "rendered in %.2f s, %.0f fps\n", elapsed.count(),
+               double(stats.frames) / elapsed.count());
+
+  if (!os) {
+    std::fprintf(stderr, "error writing the video\n");
+    return 1;
+  }
+  return 0;
+}
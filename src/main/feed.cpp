@@ -0,0 +1,177 @@
+#include "feed.hpp"
+#include "net.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+[[noreturn]] void fail(const char *what) {
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+// "PONGFEED", read as a little endian word
+constexpr std::uint64_t magic = 0x44454546474e4f50;
+
+// the channels start on a cache line of their own
+constexpr std::size_t header_size = 64;
+
+// shm_open's names start with a slash
+std::string shm_name(const std::string &name) {
+  return name.starts_with('/') ? name : '/' + name;
+}
+
+void *map(int fd, std::size_t size) {
+  void *memory =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED)
+    fail("mmap");
+  return memory;
+}
+
+} // namespace
+
+struct pong::feed_t::header_t {
+  std::atomic<std::uint64_t> magic;
+  std::uint32_t version;
+  std::uint32_t arenas;
+  std::uint32_t states;
+  std::uint32_t commands;
+  std::uint64_t tick_period_ns;
+};
+
+pong::feed_state_t pong::feed_state(const arena_t &a, std::uint64_t match,
+                                    std::uint64_t tick, bool in_play) {
+  auto corners = [](const box_t &b) -> std::array<scalar_t, 4> {
+    return {b.min()(0), b.min()(1), b.max()(0), b.max()(1)};
+  };
+
+  return {
+      .match = match,
+      .tick = tick,
+      .arena = corners(a.box()),
+      .puck = {a.puck().centre()(0), a.puck().centre()(1)},
+      .puck_velocity = {a.puck().velocity()(0), a.puck().velocity()(1)},
+      .puck_radius = a.puck().radius(),
+      .lhs_paddle = corners(a.lhs_paddle().box()),
+      .lhs_velocity = a.lhs_paddle().velocity()(1),
+      .rhs_paddle = corners(a.rhs_paddle().box()),
+      .rhs_velocity = a.rhs_paddle().velocity()(1),
+      .lhs_score = a.lhs_score(),
+      .rhs_score = a.rhs_score(),
+      .in_play = in_play,
+  };
+}
+
+pong::feed_t::feed_t(const std::string &name, std::size_t arenas,
+                     std::chrono::nanoseconds tick_period)
+    : name_{shm_name(name)}, owner_{true}, arenas_{arenas},
+      size_{header_size + arenas * sizeof(channel_t)} {
+  static_assert(sizeof(header_t) <= header_size);
+
+  // a feed left behind by a host that didn't stop cleanly
+  ::shm_unlink(name_.c_str());
+  const fd_t fd{::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)};
+  if (!fd)
+    fail("shm_open");
+  if (::ftruncate(fd.get(), off_t(size_)) < 0) {
+    ::shm_unlink(name_.c_str());
+    fail("ftruncate");
+  }
+  memory_ = map(fd.get(), size_);
+
+  for (std::size_t i = 0; i < arenas; ++i)
+    std::construct_at(&channel(i));
+  auto *header = static_cast<header_t *>(memory_);
+  header->version = version;
+  header->arenas = std::uint32_t(arenas);
+  header->states = std::uint32_t(states);
+  header->commands = std::uint32_t(commands);
+  header->tick_period_ns = std::uint64_t(tick_period.count());
+  // bots take the feed as ready once this is
+  header->magic.store(magic, std::memory_order_release);
+}
+
+pong::feed_t::feed_t(const std::string &name)
+    : name_{shm_name(name)}, owner_{false} {
+  const fd_t fd{::shm_open(name_.c_str(), O_RDWR, 0)};
+  if (!fd)
+    fail("shm_open");
+  struct stat st{};
+  if (::fstat(fd.get(), &st) < 0)
+    fail("fstat");
+  size_ = std::size_t(st.st_size);
+  if (size_ < header_size)
+    throw std::runtime_error{"not a pong feed: " + name_};
+  memory_ = map(fd.get(), size_);
+
+  const auto *header = static_cast<const header_t *>(memory_);
+  arenas_ = header->arenas;
+  if (header->magic.load(std::memory_order_acquire) != magic ||
+      header->version != version || header->states != states ||
+      header->commands != commands ||
+      size_ != header_size + arenas_ * sizeof(channel_t)) {
+    ::munmap(memory_, size_);
+    throw std::runtime_error{"not a pong feed, or not of this version: " +
+                             name_};
+  }
+}
+
+pong::feed_t::~feed_t() {
+  ::munmap(memory_, size_);
+  if (owner_)
+    ::shm_unlink(name_.c_str());
+}
+
+std::chrono::nanoseconds pong::feed_t::tick_period() const {
+  return std::chrono::nanoseconds{
+      static_cast<const header_t *>(memory_)->tick_period_ns};
+}
+
+void pong::feed_t::publish(std::size_t arena, const feed_state_t &state) {
+  auto &c = channel(arena);
+  const auto n = c.published.load(std::memory_order_relaxed);
+  c.ring[n % states].store(state);
+  c.published.store(n + 1, std::memory_order_release);
+}
+
+std::optional<pong::feed_command_t> pong::feed_t::command(std::size_t arena) {
+  auto &queue = channel(arena).queue;
+  const auto *front = queue.front();
+  if (!front)
+    return {};
+  const auto command = *front;
+  queue.pop();
+  return command;
+}
+
+std::uint64_t pong::feed_t::published(std::size_t arena) const {
+  return channel(arena).published.load(std::memory_order_acquire);
+}
+
+std::optional<pong::feed_state_t>
+pong::feed_t::latest(std::size_t arena) const {
+  const auto &c = channel(arena);
+  const auto n = c.published.load(std::memory_order_acquire);
+  if (n == 0)
+    return {};
+  // should the host lap the ring meanwhile, this is a later state still
+  return c.ring[(n - 1) % states].load();
+}
+
+bool pong::feed_t::command(std::size_t arena, const feed_command_t &command) {
+  return channel(arena).queue.push(command);
+}
+
+pong::feed_t::channel_t &pong::feed_t::channel(std::size_t arena) const {
+  return *reinterpret_cast<channel_t *>(static_cast<std::byte *>(memory_) +
+                                        header_size +
+                                        arena * sizeof(channel_t));
+}
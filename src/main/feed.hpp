@@ -0,0 +1,173 @@
+#ifndef PONG_FEED_HPP
+#define PONG_FEED_HPP
+
+#include "concurrency.hpp"
+#include "model.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace pong {
+
+/**
+ * An arena's physics state as a feed publishes it: everything a bot needs
+ * to play, in a fixed layout for bots in other languages to read.  Boxes
+ * are min x, min y, max x, max y; velocities are in pixels per second.
+ */
+struct feed_state_t {
+  // the match the arena holds, which changes when another takes its place,
+  // or 0 if none does
+  std::uint64_t match{};
+  std::uint64_t tick{};
+  std::array<scalar_t, 4> arena{};
+  std::array<scalar_t, 2> puck{};
+  std::array<scalar_t, 2> puck_velocity{};
+  scalar_t puck_radius{};
+  std::array<scalar_t, 4> lhs_paddle{};
+  scalar_t lhs_velocity{};
+  std::array<scalar_t, 4> rhs_paddle{};
+  scalar_t rhs_velocity{};
+  std::uint32_t lhs_score{};
+  std::uint32_t rhs_score{};
+  std::uint32_t in_play{};
+};
+
+static_assert(sizeof(feed_state_t) == 104);
+
+/**
+ * the state of an arena holding match, at the end of tick
+ */
+feed_state_t feed_state(const arena_t &, std::uint64_t match,
+                        std::uint64_t tick, bool in_play);
+
+/**
+ * A bot's command: the speed of its paddle from the next tick on.
+ */
+struct feed_command_t {
+  // the match it's for, so that one for a match that has ended is ignored
+  std::uint64_t match{};
+  // the tick of the state it answers, by which to time the round trip
+  std::uint64_t tick{};
+  // 0 for the lhs paddle, 1 for the rhs
+  std::uint32_t paddle{};
+  scalar_t speed{};
+};
+
+static_assert(sizeof(feed_command_t) == 24);
+
+/**
+ * A live feed of arenas to bots in other processes, over shared memory
+ * (shm_open and mmap), for bots to steer paddles in place of ai_t.
+ *
+ * Each arena has a channel of its own: a ring of the latest states, each
+ * slot a seqlock_t, with the number published so far, and a command ring,
+ * an spsc_queue_t.  The host publishes a state every tick and takes up the
+ * commands that have come at the start of the next; a bot spins on the
+ * number published and answers the latest.  Neither side makes a syscall
+ * to do so, nor blocks the other: a reader retries a state overwritten as
+ * it read it, and a bot too slow to have its commands taken up finds the
+ * ring full.  Each arena's states have one writer, the host, and its
+ * commands one writer, its bot: a bot may play many arenas, but an arena
+ * only one bot at a time.
+ *
+ * The memory is laid out as a 64-byte header (a 64-bit magic, set last,
+ * then 32-bit version, arenas, states and commands and the 64-bit tick
+ * period in nanoseconds) followed by the arenas' channels, with the layout
+ * of channel_t below, each word in the host's byte order.
+ */
+class feed_t {
+public:
+  // the states and commands each arena's rings hold
+  static constexpr std::size_t states = 8;
+  static constexpr std::size_t commands = 16;
+  static constexpr std::uint32_t version = 1;
+
+  /**
+   * create a feed of arenas, replacing any of the same name, which goes
+   * with it
+   */
+  feed_t(const std::string &name, std::size_t arenas,
+         std::chrono::nanoseconds tick_period);
+
+  /**
+   * open a feed some other process created
+   */
+  explicit feed_t(const std::string &name);
+
+  feed_t(const feed_t &) = delete;
+
+  feed_t &operator=(const feed_t &) = delete;
+
+  ~feed_t();
+
+  [[nodiscard]] std::size_t arenas() const { return arenas_; }
+
+  [[nodiscard]] std::chrono::nanoseconds tick_period() const;
+
+  /**
+   * host: publish an arena's latest state
+   */
+  void publish(std::size_t arena, const feed_state_t &);
+
+  /**
+   * host: the oldest command for arena not yet taken, if any
+   */
+  std::optional<feed_command_t> command(std::size_t arena);
+
+  /**
+   * bot: the number of states published for arena so far
+   */
+  [[nodiscard]] std::uint64_t published(std::size_t arena) const;
+
+  /**
+   * bot: the latest state published for arena, if any
+   */
+  [[nodiscard]] std::optional<feed_state_t> latest(std::size_t arena) const;
+
+  /**
+   * bot: send a command, returning false if the ring is full
+   */
+  bool command(std::size_t arena, const feed_command_t &);
+
+private:
+  struct channel_t {
+    alignas(64) std::atomic<std::uint64_t> published{};
+    // state i in slot i % states
+    std::array<seqlock_t<feed_state_t>, states> ring;
+    spsc_queue_t<feed_command_t, commands> queue;
+  };
+
+  struct header_t;
+
+  [[nodiscard]] channel_t &channel(std::size_t arena) const;
+
+  std::string name_;
+  bool owner_;
+  std::size_t arenas_{};
+  std::size_t size_{};
+  void *memory_{};
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::size_t>::is_always_lock_free,
+              "a feed's atomics are shared between processes");
+
+/**
+ * spin once, politely, while waiting on a feed
+ */
+inline void spin() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+} // namespace pong
+
+#endif // PONG_FEED_HPP
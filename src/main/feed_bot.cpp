@@ -0,0 +1,187 @@
+/**
+ * pong-feed-bot : a feed's reference bot (see feed.hpp).  Plays the lhs
+ * paddle of every match on a feed, such as pong-server --feed publishes,
+ * just as the built-in AI would but from another process: each state
+ * published is put back into an arena_t for an ai_t to look at, and the
+ * speed it chooses, if it chooses one, is sent back as a command.
+ *
+ *   pong-feed-bot --feed NAME [--ai-skill N] [--seconds S]
+ *
+ * It spins on the feed, making no syscall while states keep coming, and
+ * yields the CPU only once it has waited a while.  It plays until
+ * interrupted, or for the given seconds, then reports what it did on
+ * stdout.
+ */
+#include "feed.hpp"
+#include "simulation.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+namespace p = pong;
+
+struct options_t {
+  std::string feed;
+  int ai_skill = p::rules_t{}.ai_skill;
+  std::size_t seconds = 0;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--feed") {
+      options.feed = value;
+      ok = true;
+    } else if (arg == "--ai-skill")
+      ok = parse(value, options.ai_skill) &&
+           options.ai_skill >= p::rules_t::ai_skill_min &&
+           options.ai_skill <= p::rules_t::ai_skill_max;
+    else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    if (!ok)
+      return false;
+  }
+  return !options.feed.empty();
+}
+
+// spins before yielding the CPU, none if spinning would only keep the host
+// from running
+const int spins = std::thread::hardware_concurrency() > 1 ? 1 << 12 : 0;
+
+volatile std::sig_atomic_t stopping = 0;
+
+/**
+ * The AI playing one match, and the arena it looks at.
+ */
+struct bot_t {
+  bot_t(const p::feed_state_t &state, int ai_skill)
+      : match{state.match}, arena{p::make_starter(0)},
+        ai{std::mt19937::result_type(state.match),
+           p::ai_stdev(
+               {.paddle_size = state.lhs_paddle[3] - state.lhs_paddle[1],
+                .ai_skill = ai_skill},
+               state.puck_radius)} {}
+
+  // put the arena as it was published
+  void restore(const p::feed_state_t &s) {
+    arena.puck().centre() = p::vec_t{s.puck[0], s.puck[1]};
+    arena.puck().velocity() = p::vec_t{s.puck_velocity[0], s.puck_velocity[1]};
+    arena.puck().radius() = s.puck_radius;
+    for (auto [paddle, box, velocity] :
+         {std::tuple{&arena.lhs_paddle(), s.lhs_paddle, s.lhs_velocity},
+          std::tuple{&arena.rhs_paddle(), s.rhs_paddle, s.rhs_velocity}}) {
+      paddle->box() =
+          p::box_t{p::vec_t{box[0], box[1]}, p::vec_t{box[2], box[3]}};
+      paddle->velocity() = p::vec_t{0, velocity};
+    }
+    arena.lhs_score() = s.lhs_score;
+    arena.rhs_score() = s.rhs_score;
+  }
+
+  std::uint64_t match;
+  p::arena_t arena;
+  p::ai_t ai;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s --feed NAME [--ai-skill N] [--seconds S]\n",
+                 argv[0]);
+    return 1;
+  }
+  using clock_t = std::chrono::steady_clock;
+
+  std::signal(SIGINT, [](int) { stopping = 1; });
+  std::signal(SIGTERM, [](int) { stopping = 1; });
+
+  std::optional<p::feed_t> feed;
+  try {
+    feed.emplace(options.feed);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<bot_t>> bots(feed->arenas());
+  std::vector<std::uint64_t> seen(feed->arenas());
+  std::uint64_t states = 0;
+  std::uint64_t commands = 0;
+  std::uint64_t full = 0;
+
+  const auto start = clock_t::now();
+  const auto until = options.seconds
+                         ? start + std::chrono::seconds{options.seconds}
+                         : clock_t::time_point::max();
+  int idle = 0;
+  while (!stopping && clock_t::now() < until) {
+    bool any = false;
+    for (std::size_t i = 0; i < bots.size(); ++i) {
+      const auto published = feed->published(i);
+      if (published == seen[i])
+        continue;
+      seen[i] = published;
+      any = true;
+
+      const auto state = feed->latest(i);
+      if (!state || !state->match || !state->in_play)
+        continue;
+      ++states;
+      auto &bot = bots[i];
+      if (!bot || bot->match != state->match)
+        bot = std::make_unique<bot_t>(*state, options.ai_skill);
+      bot->restore(*state);
+      const auto speed =
+          bot->ai.paddle_speed(bot->arena, bot->arena.lhs_paddle());
+      if (!speed)
+        continue;
+      if (feed->command(i, {.match = state->match,
+                            .tick = state->tick,
+                            .paddle = 0,
+                            .speed = *speed}))
+        ++commands;
+      else
+        ++full;
+    }
+
+    if (any)
+      idle = 0;
+    else if (++idle < spins)
+      p::spin();
+    else
+      std::this_thread::yield();
+  }
+
+  const auto elapsed =
+      std::chrono::duration<double>(clock_t::now() - start).count();
+  std::printf("seconds      %.1f\n", elapsed);
+  std::printf("arenas       %zu\n", bots.size());
+  std::printf("states       %lu played\n", static_cast<unsigned long>(states));
+  std::printf("commands     %lu sent, %lu to full rings\n",
+              static_cast<unsigned long>(commands),
+              static_cast<unsigned long>(full));
+  return 0;
+}
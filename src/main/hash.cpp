@@ -0,0 +1,147 @@
+#include "hash.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+// a couple of floats or the like, as one word to fold in
+std::uint64_t word(std::uint32_t lo, std::uint32_t hi) {
+  return lo | std::uint64_t(hi) << 32;
+}
+
+std::uint64_t word(pong::scalar_t lo, pong::scalar_t hi) {
+  return word(std::bit_cast<std::uint32_t>(lo),
+              std::bit_cast<std::uint32_t>(hi));
+}
+
+// a multiply and a shift per word, enough to tell states apart, not to stand
+// up to anyone making them collide
+std::uint64_t fold(std::uint64_t hash, std::uint64_t w) {
+  hash = (hash ^ w) * 0x9e3779b97f4a7c15;
+  return hash ^ hash >> 32;
+}
+
+std::uint64_t fold_puck(std::uint64_t hash, const pong::puck_t &puck) {
+  hash = fold(hash, word(puck.centre()(0), puck.centre()(1)));
+  return fold(hash, word(puck.velocity()(0), puck.velocity()(1)));
+}
+
+std::uint64_t fold_paddle(std::uint64_t hash, const pong::paddle_t &paddle) {
+  hash = fold(hash, word(paddle.box().min()(1), paddle.box().max()(1)));
+  return fold(hash, word(paddle.velocity()(0), paddle.velocity()(1)));
+}
+
+std::uint64_t fold_scores(std::uint64_t hash, const pong::arena_t &arena) {
+  return fold(hash, word(arena.lhs_score(), arena.rhs_score()));
+}
+
+} // namespace
+
+pong::hash_history_t::hash_history_t(const arena_t &arena, std::size_t ticks,
+                                     std::size_t actions)
+    : hash_{0xcbf29ce484222325}, tick_ring_(std::bit_ceil(ticks)),
+      action_ring_(std::bit_ceil(actions)) {
+  hash_ = fold_puck(hash_, arena.puck());
+  hash_ = fold_paddle(hash_, arena.lhs_paddle());
+  hash_ = fold_paddle(hash_, arena.rhs_paddle());
+  hash_ = fold_scores(hash_, arena);
+}
+
+void pong::hash_history_t::steer(const paddle_t &paddle) {
+  // the paddle's side by its x, which steering doesn't change
+  hash_ = fold(hash_, word(paddle.box().min()(0), paddle.velocity()(1)));
+}
+
+void pong::hash_history_t::action(const arena_t &arena, scalar_t t,
+                                  const action_t &action) {
+  hash_ = fold(hash_, word(std::uint32_t(action.kind()),
+                           std::bit_cast<std::uint32_t>(t)));
+  // the bodies the action changed, as record() has them
+  switch (action.kind()) {
+  case action_t::kind_t::paddle_stops:
+    hash_ = fold_paddle(hash_, *action.paddle());
+    break;
+  case action_t::kind_t::puck_bounces_x:
+    hash_ = fold_puck(hash_, arena.puck());
+    break;
+  case action_t::kind_t::puck_bounces_y:
+    hash_ = fold_puck(hash_, arena.puck());
+    if (action.paddle())
+      hash_ = fold_paddle(hash_, *action.paddle());
+    break;
+  case action_t::kind_t::lhs_scores:
+  case action_t::kind_t::rhs_scores:
+    hash_ = fold_scores(hash_, arena);
+    hash_ = fold_puck(hash_, arena.puck());
+    break;
+  }
+  action_ring_[actions_++ & (action_ring_.size() - 1)] = hash_;
+}
+
+std::uint64_t pong::hash_history_t::end_tick() {
+  tick_ring_[++ticks_ & (tick_ring_.size() - 1)] = {.hash = hash_,
+                                                    .actions = actions_};
+  return hash_;
+}
+
+std::uint64_t pong::hash_history_t::first() const {
+  return ticks_ < tick_ring_.size() ? 1 : ticks_ - tick_ring_.size() + 1;
+}
+
+std::optional<std::uint64_t>
+pong::hash_history_t::hash(std::uint64_t tick) const {
+  if (tick < first() || tick > ticks_)
+    return {};
+  return tick_ring_[tick & (tick_ring_.size() - 1)].hash;
+}
+
+std::optional<std::vector<std::uint64_t>>
+pong::hash_history_t::actions(std::uint64_t tick) const {
+  if (tick < first() || tick > ticks_)
+    return {};
+  // the actions since the previous tick ended were this tick's, unless the
+  // previous tick is no longer kept
+  if (tick > 1 && tick - 1 < first())
+    return {};
+  const auto mask = tick_ring_.size() - 1;
+  const auto end = tick_ring_[tick & mask].actions;
+  const auto begin = tick > 1 ? tick_ring_[(tick - 1) & mask].actions : 0;
+  // or they have been overwritten by later ones
+  if (begin + action_ring_.size() < actions_)
+    return {};
+  std::vector<std::uint64_t> result;
+  result.reserve(end - begin);
+  for (auto i = begin; i < end; ++i)
+    result.push_back(action_ring_[i & (action_ring_.size() - 1)]);
+  return result;
+}
+
+std::optional<pong::divergence_t>
+pong::first_divergence(const hash_history_t &a, const hash_history_t &b) {
+  auto lo = std::max(a.first(), b.first());
+  auto hi = std::min(a.ticks(), b.ticks());
+  auto agree = [&](std::uint64_t tick) { return a.hash(tick) == b.hash(tick); };
+  if (lo > hi || agree(hi))
+    return {};
+
+  // each tick's hash covers those before it, so once they disagree they
+  // go on disagreeing
+  while (lo < hi) {
+    const auto mid = lo + (hi - lo) / 2;
+    if (agree(mid))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  divergence_t result{.tick = lo, .action = {}};
+  const auto lhs = a.actions(lo);
+  const auto rhs = b.actions(lo);
+  if (lhs && rhs) {
+    const auto [l, r] = std::ranges::mismatch(*lhs, *rhs);
+    if (l != lhs->end() || r != rhs->end())
+      result.action = std::size_t(l - lhs->begin());
+  }
+  return result;
+}
@@ -0,0 +1,120 @@
+#ifndef PONG_HASH_HPP
+#define PONG_HASH_HPP
+
+#include "model.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pong {
+
+/**
+ * A running 64-bit hash of an arena's physics state, and the hash it had at
+ * the end of each of the latest ticks, for peers simulating the same match
+ * to tell cheaply, tick by tick, whether they still agree.
+ *
+ * The hash is folded along as the arena changes rather than computed from
+ * the whole state: it starts from the arena's state, then each velocity a
+ * paddle is steered to (via steer) and each action advance_time resolves
+ * (via its on_action) fold in, the latter with when it happened and the
+ * bodies it changed, as record() would send them.  The rest of the state
+ * follows from these, so a divergence elsewhere (e.g. a puck nudged between
+ * actions) shows up at the next action that touches it.  Each tick's hash
+ * covers every tick before it, so the first divergent tick can be found by
+ * bisection, and within it the first divergent action by the hashes kept
+ * after each.
+ *
+ * Floats are hashed by their bits: peers agree only if their arithmetic is
+ * bit for bit the same.
+ */
+class hash_history_t {
+public:
+  /**
+   * starting from arena, keeping the hashes of (at least) the latest ticks,
+   * and of the actions in them as long as there are no more than actions of
+   * them all told
+   */
+  explicit hash_history_t(const arena_t &arena, std::size_t ticks = 600,
+                          std::size_t actions = 256);
+
+  /**
+   * fold in the velocity a paddle was just steered to
+   */
+  void steer(const paddle_t &);
+
+  /**
+   * fold in an action that just happened, t into the tick, as
+   * advance_time's on_action
+   */
+  void action(const arena_t &, scalar_t t, const action_t &);
+
+  /**
+   * end a tick, whether or not the arena was advanced, and keep its hash,
+   * which is returned
+   */
+  std::uint64_t end_tick();
+
+  /**
+   * the hash so far
+   */
+  [[nodiscard]] std::uint64_t hash() const { return hash_; }
+
+  /**
+   * the number of ticks ended so far, the first being 1
+   */
+  [[nodiscard]] std::uint64_t ticks() const { return ticks_; }
+
+  /**
+   * the earliest tick whose hash is still kept
+   */
+  [[nodiscard]] std::uint64_t first() const;
+
+  /**
+   * the hash at the end of tick, if still kept
+   */
+  [[nodiscard]] std::optional<std::uint64_t> hash(std::uint64_t tick) const;
+
+  /**
+   * the hashes just after each of tick's actions, if still kept
+   */
+  [[nodiscard]] std::optional<std::vector<std::uint64_t>>
+  actions(std::uint64_t tick) const;
+
+private:
+  struct tick_t {
+    std::uint64_t hash;
+    // the number of actions up to the end of the tick
+    std::uint64_t actions;
+  };
+
+  std::uint64_t hash_;
+  std::uint64_t ticks_{};
+  std::uint64_t actions_{};
+  // the latest ticks and actions, tick and action i at i % size(), a power
+  // of two
+  std::vector<tick_t> tick_ring_;
+  std::vector<std::uint64_t> action_ring_;
+};
+
+/**
+ * Where two histories of the same match first disagree.
+ */
+struct divergence_t {
+  std::uint64_t tick;
+  // the index of the tick's first action hashed differently, if any was;
+  // otherwise the state diverged between actions (or the tick's actions
+  // are no longer kept)
+  std::optional<std::size_t> action;
+};
+
+/**
+ * the first tick, kept by both histories, whose hashes differ, and where in
+ * it, if any
+ */
+std::optional<divergence_t> first_divergence(const hash_history_t &,
+                                             const hash_history_t &);
+
+} // namespace pong
+
+#endif // PONG_HASH_HPP
@@ -0,0 +1,34 @@
+#include "headless.hpp"
+
+#include <new>
+
+namespace {
+
+void *allocate(std::size_t size, void *) { return ::operator new(size); }
+
+void deallocate(void *p, void *) { ::operator delete(p); }
+
+} // namespace
+
+pong::headless_t::headless_t(ImVec2 display_size, float delta_time) {
+  ImGui::SetAllocatorFunctions(allocate, deallocate);
+  context_ = ImGui::CreateContext();
+
+  auto &io = ImGui::GetIO();
+  io.IniFilename = nullptr;
+  io.LogFilename = nullptr;
+  io.BackendPlatformName = "pong_headless";
+  io.BackendRendererName = "pong_headless";
+  io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+  io.DisplaySize = display_size;
+  io.DeltaTime = delta_time;
+
+  ImGui::StyleColorsDark();
+
+  unsigned char *pixels;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &font_.width, &font_.height);
+  font_.pixels = reinterpret_cast<const ImU32 *>(pixels);
+  io.Fonts->SetTexID(texture_id(font_));
+}
+
+pong::headless_t::~headless_t() { ImGui::DestroyContext(context_); }
@@ -0,0 +1,38 @@
+#ifndef PONG_HEADLESS_HPP
+#define PONG_HEADLESS_HPP
+
+#include "raster.hpp"
+
+#include "imgui.h"
+
+namespace pong {
+
+/**
+ * A null ImGui backend: a context with a fixed display size and a built font
+ * atlas, so frames can be built without a window or a GPU.  Input is fed
+ * through the context's io as a platform backend would.
+ *
+ * ImGui's own allocations are routed through the global operator new so that
+ * they show up in alloc::counts_t.
+ */
+class headless_t {
+public:
+  explicit headless_t(ImVec2 display_size = {660, 660},
+                      float delta_time = 1.f / 60.f);
+
+  headless_t(const headless_t &) = delete;
+
+  headless_t &operator=(const headless_t &) = delete;
+
+  ~headless_t();
+
+  [[nodiscard]] ImGuiIO &io() { return ImGui::GetIO(); }
+
+private:
+  ImGuiContext *context_;
+  texture_t font_{};
+};
+
+} // namespace pong
+
+#endif // PONG_HEADLESS_HPP
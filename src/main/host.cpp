@@ -0,0 +1,824 @@
+#include "host.hpp"
+#include "trace.hpp"
+#include "wheel.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+namespace protocol = pong::protocol;
+
+// a player's join, which they may repeat until they are welcomed
+struct joiner_t {
+  std::uint32_t host;
+  std::uint16_t port;
+  std::uint64_t nonce;
+
+  friend bool operator==(const joiner_t &, const joiner_t &) = default;
+};
+
+struct joiner_hash_t {
+  std::size_t operator()(const joiner_t &j) const {
+    return std::hash<std::uint64_t>{}(
+        j.nonce ^
+        (std::uint64_t{j.host} << 16 | j.port) * 0x9e3779b97f4a7c15ull);
+  }
+};
+
+} // namespace
+
+pong::server_stats_t &
+pong::server_stats_t::operator+=(const server_stats_t &other) {
+  matches += other.matches;
+  joined += other.joined;
+  ticks += other.ticks;
+  overruns += other.overruns;
+  received += other.received;
+  sent += other.sent;
+  dropped += other.dropped;
+  spectators += other.spectators;
+  skips += other.skips;
+  woken += other.woken;
+  checkpoints += other.checkpoints;
+  resumed += other.resumed;
+  tick_ns += other.tick_ns;
+  return *this;
+}
+
+/**
+ * One core's share of the matches, and the socket their players send to.
+ * Everything but post() and stats() runs on the loop's thread.
+ */
+class pong::server_t::loop_t {
+public:
+  // a match id's bits below its generation are its loop's index and its slot
+  static constexpr unsigned slot_bits = 24;
+  static constexpr std::size_t max_loops = 256;
+
+  // a spectator's watch, or leave, as passed on from another loop
+  struct watch_t {
+    sockaddr_in from;
+    std::uint64_t match;
+    std::uint64_t tick;
+    bool leave;
+  };
+
+  loop_t(const server_options_t &options, unsigned index,
+         const sockaddr_in &address,
+         const std::vector<std::unique_ptr<loop_t>> &loops, feed_t *feed,
+         checkpoint_t *checkpoint)
+      : options_{options}, index_{index}, loops_{loops}, feed_{feed},
+        checkpoint_{checkpoint},
+        checkpoint_ticks_{std::max<std::uint64_t>(
+            std::uint64_t(options.checkpoint_period / options.tick_period),
+            1)},
+        dt_{std::chrono::duration<scalar_t>(options.tick_period).count()},
+        socket_{address, true},
+        ticker_{clock_t::now() + options.tick_period, options.tick_period} {
+    // room for a burst of every player's datagrams
+    socket_.buffers(1 << 22, 1 << 22);
+    epoll_.add(socket_.fd(), EPOLLIN, socket_event);
+    epoll_.add(ticker_.fd(), EPOLLIN, tick_event);
+  }
+
+  [[nodiscard]] sockaddr_in address() const { return socket_.address(); }
+
+  void run(std::stop_token stop) {
+    PONG_TRACE_THREAD_NAME("server loop");
+    while (!stop.stop_requested()) {
+      for (const auto &event : epoll_.wait(std::chrono::milliseconds{100})) {
+        if (event.data.u64 == socket_event) {
+          receive(clock_t::now());
+        } else if (const auto n = ticker_.expirations()) {
+          stats_.overruns += n - 1;
+          // catch up a little, as simulation_t does, rather than stall
+          const auto ticks = std::min<std::uint64_t>(
+              n, simulation_t::max_catch_up_ticks);
+          for (std::uint64_t i = 0; i < ticks; ++i)
+            tick(clock_t::now());
+          publish();
+        }
+      }
+    }
+  }
+
+  // hand a watch of one of this loop's matches over from another loop, to be
+  // taken up at the next tick
+  void post(const watch_t &watch) {
+    std::lock_guard lock{inbox_mutex_};
+    inbox_.push_back(watch);
+  }
+
+  [[nodiscard]] server_stats_t stats() const {
+    std::lock_guard lock{published_mutex_};
+    return published_;
+  }
+
+  // take up the sessions of the loop's latest checkpoint, if it has one;
+  // before the loop runs
+  void resume() {
+    const auto half = checkpoint_->latest(index_);
+    if (!half)
+      return;
+    const auto now = clock_t::now();
+    wheel_ = timer_wheel_t{half->header->tick};
+    saved_ = wheel_.now();
+    joined_ = half->header->joined;
+    sessions_.resize(std::min<std::size_t>(half->header->slots,
+                                           options_.max_matches));
+    // either half may differ from it in any slot
+    dirty_.assign(sessions_.size(), 3);
+
+    for (std::uint32_t slot = 0; slot < sessions_.size(); ++slot) {
+      const auto &saved = half->slots[slot];
+      auto &session = sessions_[slot];
+      session.generation = saved.generation;
+      if (!saved.used) {
+        free_.push_back(slot);
+        continue;
+      }
+      session.match = std::make_unique<remote_match_t>(saved.match);
+      session.player = saved.player;
+      session.joiner = {saved.player.sin_addr.s_addr, saved.player.sin_port,
+                        saved.nonce};
+      session.start = saved.start;
+      session.heard = now;
+      session.sync = saved.sync;
+      session.keyframe = saved.keyframe;
+      session.reported = saved.reported;
+      joiners_.emplace(session.joiner, slot);
+      wheel_.schedule(slot, saved.wake);
+      ++stats_.matches;
+      ++stats_.resumed;
+    }
+    publish();
+  }
+
+  // write the sessions that have changed since the half it writes was last
+  // written, unless the last checkpoint is still being written out
+  void save() {
+    PONG_TRACE_SCOPE("server_t::loop_t::save");
+    const auto half = checkpoint_->begin(index_);
+    if (!half)
+      return;
+    const auto bit = std::uint8_t(1u << half->index);
+    for (std::uint32_t slot = 0; slot < sessions_.size(); ++slot) {
+      if (!(dirty_[slot] & bit))
+        continue;
+      dirty_[slot] &= std::uint8_t(~bit);
+      const auto &session = sessions_[slot];
+      auto &saved = half->slots[slot];
+      saved.used = session.match != nullptr;
+      saved.generation = session.generation;
+      if (!saved.used)
+        continue;
+      saved.player = session.player;
+      saved.nonce = session.joiner.nonce;
+      saved.sync = session.sync;
+      saved.keyframe = session.keyframe;
+      saved.reported = session.reported;
+      saved.start = session.start;
+      saved.wake = wheel_.when(slot).value_or(wheel_.now() + 1);
+      session.match->save(saved.match);
+    }
+    half->header->tick = wheel_.now();
+    half->header->joined = joined_;
+    half->header->slots = sessions_.size();
+    checkpoint_->commit(index_, *half);
+    saved_ = wheel_.now();
+    ++stats_.checkpoints;
+  }
+
+private:
+  static constexpr std::uint64_t socket_event = 0;
+  static constexpr std::uint64_t tick_event = 1;
+
+  // a bound on the batches read between ticks, so that a flood of datagrams
+  // can't hold up the matches
+  static constexpr int max_receive_batches = 64;
+
+  // how often an events session is sent a keyframe, in ticks
+  static constexpr std::uint64_t keyframe_ticks = 60;
+
+  // how far behind a spectator may say they are before they are left to
+  // wait for a keyframe, in ticks: one keeping up has had a keyframe at
+  // least every keyframe_ticks, if nothing else, give or take their watch's
+  // journey
+  static constexpr std::uint64_t lag_ticks = keyframe_ticks * 3 / 2;
+
+  struct watcher_t {
+    sockaddr_in address{};
+    clock_t::time_point heard{};
+    // the tick of the keyframe that started them off, or caught them up
+    std::uint64_t resynced{};
+    // owed a keyframe as soon as possible, having just started watching
+    bool fresh{true};
+    // behind, and sent nothing until the next keyframe
+    bool skipping{};
+  };
+
+  struct session_t {
+    std::unique_ptr<remote_match_t> match;
+    sockaddr_in player{};
+    joiner_t joiner{};
+    std::uint32_t generation{};
+    // the loop's tick before the match's first
+    std::uint64_t start{};
+    clock_t::time_point heard{};
+    protocol::sync_t sync{};
+    // whether an events session is owed a keyframe out of turn
+    bool keyframe{};
+    // the acknowledgement an events session was last sent
+    std::uint32_t reported{};
+    std::vector<watcher_t> watchers;
+    // each watcher's index, by address
+    std::unordered_map<std::uint64_t, std::uint32_t> watching;
+  };
+
+  [[nodiscard]] std::uint64_t id(std::uint32_t slot,
+                                 std::uint32_t generation) const {
+    return std::uint64_t{generation} << 32 |
+           std::uint64_t{index_} << slot_bits | slot;
+  }
+
+  static std::uint64_t key(const sockaddr_in &address) {
+    return std::uint64_t{address.sin_addr.s_addr} << 16 | address.sin_port;
+  }
+
+  void receive(clock_t::time_point now) {
+    for (int i = 0; i < max_receive_batches && in_.receive(socket_) > 0; ++i) {
+      stats_.received += in_.size();
+      for (std::size_t j = 0; j < in_.size(); ++j)
+        handle(in_.payload(j), in_.address(j), now);
+    }
+    flush();
+  }
+
+  void handle(std::span<const std::byte> datagram, const sockaddr_in &from,
+              clock_t::time_point now) {
+    const auto type = protocol::peek(datagram);
+    if (!type)
+      return;
+
+    switch (*type) {
+    case protocol::type_t::join: {
+      protocol::join_t join;
+      if (protocol::decode(datagram, join))
+        this->join(join, from, now);
+      break;
+    }
+    case protocol::type_t::command: {
+      protocol::command_t command;
+      if (!protocol::decode(datagram, command))
+        break;
+      if (auto *session = find(command.match, from)) {
+        session->heard = now;
+        catch_up(*session);
+        session->match->command(command.sequence, command.speed,
+                                command.tick);
+        wake_by(slot(*session),
+                session->start +
+                    session->match->next_tick(dt_, keyframe_ticks));
+      }
+      break;
+    }
+    case protocol::type_t::leave: {
+      protocol::leave_t leave;
+      if (!protocol::decode(datagram, leave))
+        break;
+      if (auto *session = find(leave.match, from))
+        end(*session);
+      else
+        route({.from = from, .match = leave.match, .tick = 0, .leave = true},
+              now);
+      break;
+    }
+    case protocol::type_t::watch: {
+      protocol::watch_t watch;
+      if (protocol::decode(datagram, watch))
+        route({.from = from,
+               .match = watch.match,
+               .tick = watch.tick,
+               .leave = false},
+              now);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  void join(const protocol::join_t &join, const sockaddr_in &from,
+            clock_t::time_point now) {
+    const joiner_t joiner{from.sin_addr.s_addr, from.sin_port, join.nonce};
+
+    std::uint32_t slot;
+    if (const auto i = joiners_.find(joiner); i != joiners_.end()) {
+      // the welcome was lost
+      slot = i->second;
+    } else {
+      if (free_.empty() && sessions_.size() == options_.max_matches)
+        return;
+      if (free_.empty()) {
+        free_.push_back(std::uint32_t(sessions_.size()));
+        sessions_.emplace_back();
+        dirty_.push_back(0);
+      }
+      slot = free_.back();
+      free_.pop_back();
+
+      auto &session = sessions_[slot];
+      const auto seed =
+          options_.seed +
+          3 * std::mt19937::result_type(joined_ * options_.loops + index_);
+      session.match = std::make_unique<remote_match_t>(seed, options_.rules);
+      session.player = from;
+      session.joiner = joiner;
+      ++session.generation;
+      session.sync = join.sync;
+      session.start = wheel_.now();
+      session.reported = 0;
+      joiners_.emplace(joiner, slot);
+      ++joined_;
+      ++stats_.joined;
+      ++stats_.matches;
+    }
+
+    auto &session = sessions_[slot];
+    session.heard = now;
+    // a player joining again may have missed the first keyframe too
+    session.keyframe = true;
+    wake_by(slot, wheel_.now() + 1);
+    const protocol::welcome_t welcome{
+        .nonce = join.nonce,
+        .match = id(slot, session.generation),
+        .tick_period_us = std::uint32_t(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                options_.tick_period)
+                .count()),
+        .seed = std::uint32_t(options_.seed),
+    };
+    queue(welcome, from);
+  }
+
+  session_t *find(std::uint64_t match) {
+    const auto slot = std::uint32_t(match & ((1u << slot_bits) - 1));
+    if ((match >> slot_bits & (max_loops - 1)) != index_ ||
+        slot >= sessions_.size())
+      return nullptr;
+    auto &session = sessions_[slot];
+    if (!session.match || session.generation != std::uint32_t(match >> 32))
+      return nullptr;
+    return &session;
+  }
+
+  session_t *find(std::uint64_t match, const sockaddr_in &from) {
+    auto *session = find(match);
+    return session && session->player == from ? session : nullptr;
+  }
+
+  [[nodiscard]] std::uint32_t slot(const session_t &session) const {
+    return std::uint32_t(&session - sessions_.data());
+  }
+
+  // a session's arena on the feed
+  [[nodiscard]] std::size_t arena(std::uint32_t slot) const {
+    return index_ * options_.max_matches + slot;
+  }
+
+  void end(session_t &session) {
+    wheel_.cancel(slot(session));
+    changed(slot(session));
+    // the arena is empty
+    if (feed_)
+      feed_->publish(arena(slot(session)), {});
+    joiners_.erase(session.joiner);
+    session.match.reset();
+    stats_.spectators -= session.watchers.size();
+    session.watchers.clear();
+    session.watching.clear();
+    free_.push_back(slot(session));
+    --stats_.matches;
+  }
+
+  // a spectator's watch goes to the loop of the match watched
+  void route(const watch_t &watch, clock_t::time_point now) {
+    const auto loop = watch.match >> slot_bits & (max_loops - 1);
+    if (loop == index_)
+      this->watch(watch, now);
+    else if (loop < loops_.size())
+      loops_[loop]->post(watch);
+  }
+
+  void watch(const watch_t &watch, clock_t::time_point now) {
+    auto *session = find(watch.match);
+    if (!session)
+      return;
+    catch_up(*session);
+    const auto i = session->watching.find(key(watch.from));
+    if (watch.leave) {
+      if (i != session->watching.end())
+        forget(*session, i->second);
+      return;
+    }
+    if (i == session->watching.end()) {
+      if (stats_.spectators == options_.max_spectators)
+        return;
+      session->watching.emplace(key(watch.from),
+                                std::uint32_t(session->watchers.size()));
+      session->watchers.push_back({.address = watch.from, .heard = now});
+      ++stats_.spectators;
+      // for their first keyframe
+      wake_by(slot(*session), wheel_.now() + 1);
+      return;
+    }
+
+    auto &watcher = session->watchers[i->second];
+    watcher.heard = now;
+    // unless what they say they've had is from before they caught up
+    if (!watcher.skipping && watch.tick >= watcher.resynced &&
+        session->match->ticks() > watch.tick + lag_ticks)
+      fall_behind(watcher);
+  }
+
+  void forget(session_t &session, std::uint32_t i) {
+    session.watching.erase(key(session.watchers[i].address));
+    if (i + 1 != session.watchers.size()) {
+      session.watchers[i] = session.watchers.back();
+      session.watching[key(session.watchers[i].address)] = i;
+    }
+    session.watchers.pop_back();
+    --stats_.spectators;
+  }
+
+  void fall_behind(watcher_t &watcher) {
+    watcher.skipping = true;
+    ++stats_.skips;
+  }
+
+  void tick(clock_t::time_point now) {
+    PONG_TRACE_SCOPE("server_t::loop_t::tick");
+
+    {
+      std::lock_guard lock{inbox_mutex_};
+      std::swap(inbox_, watches_);
+    }
+    for (const auto &watch : watches_)
+      this->watch(watch, now);
+    watches_.clear();
+
+    woken_.clear();
+    wheel_.advance(woken_);
+    for (const auto slot : woken_)
+      wake(slot, now);
+    flush();
+    if (checkpoint_ && wheel_.now() >= saved_ + checkpoint_ticks_)
+      save();
+
+    ++stats_.ticks;
+    stats_.tick_ns.record(std::uint64_t(
+        std::chrono::nanoseconds{clock_t::now() - now}.count()));
+  }
+
+  void wake(std::uint32_t slot, clock_t::time_point now) {
+    auto &session = sessions_[slot];
+    if (now - session.heard > options_.timeout) {
+      end(session);
+      return;
+    }
+    ++stats_.woken;
+    changed(slot);
+
+    // a match that's over keeps sending its final state until its player
+    // leaves
+    auto &match = *session.match;
+    const bool watched = !session.watchers.empty();
+    events_.clear();
+    if (feed_)
+      steer(slot, session);
+    if (match.in_play()) {
+      auto *events = watched || session.sync == protocol::sync_t::events
+                         ? &events_
+                         : nullptr;
+      match.skip(wheel_.now() - session.start - 1 - match.ticks(), dt_,
+                 events);
+      match.tick(dt_, events);
+    }
+    if (watched)
+      broadcast(slot, session, dt_, now);
+    if (feed_)
+      feed_->publish(arena(slot),
+                     feed_state(match.arena(), id(slot, session.generation),
+                                match.ticks(), match.in_play()));
+
+    if (session.sync == protocol::sync_t::events) {
+      send_events(slot, session, dt_);
+      sleep(slot, session, now);
+      return;
+    }
+
+    queue(protocol::state_t{.match = id(slot, session.generation),
+                            .acknowledged = match.acknowledged(),
+                            .snapshot = match.snapshot()},
+          session.player);
+    wheel_.schedule(slot, wheel_.now() + 1);
+  }
+
+  // have an events session woken when next it must be: for its match's
+  // next tick that can't be skipped, its next keyframe or its timeout
+  void sleep(std::uint32_t slot, const session_t &session,
+             clock_t::time_point now) {
+    const auto tick = wheel_.now();
+    // bots are sent every tick
+    if (feed_) {
+      wheel_.schedule(slot, tick + 1);
+      return;
+    }
+    auto next = tick + keyframe_ticks - (tick + slot) % keyframe_ticks;
+    if (session.match->in_play())
+      next = std::min(next, session.start + session.match->next_tick(
+                                                dt_, keyframe_ticks));
+    const auto left = session.heard + options_.timeout - now;
+    next = std::min(next, tick + 1 +
+                              std::uint64_t(std::max<clock_t::rep>(
+                                  left / options_.tick_period, 0)));
+    wheel_.schedule(slot, next);
+  }
+
+  // take up what a bot has commanded for a session's lhs paddle since its
+  // match's last tick; commands for the match that was in the slot before
+  // are ignored
+  void steer(std::uint32_t slot, session_t &session) {
+    const auto match = id(slot, session.generation);
+    while (const auto command = feed_->command(arena(slot)))
+      if (command->match == match && command->paddle == 0)
+        session.match->bot(command->speed);
+  }
+
+  // have a session woken by tick, if not sooner
+  void wake_by(std::uint32_t slot, std::uint64_t tick) {
+    changed(slot);
+    const auto when = wheel_.when(slot);
+    if (!when || tick < *when)
+      wheel_.schedule(slot, tick);
+  }
+
+  // bring a match that's been left to sleep up to the latest tick, before
+  // it's looked at between ticks; whatever rounding lets happen in the ticks
+  // skipped is put right by the next keyframe
+  void catch_up(session_t &session) {
+    changed(slot(session));
+    auto &match = *session.match;
+    if (match.in_play())
+      match.skip(wheel_.now() - session.start - match.ticks(), dt_);
+  }
+
+  // send an events session whatever changed in its match's tick, if
+  // anything; keyframes are staggered over the sessions so as not to come all
+  // at once
+  void send_events(std::uint32_t slot, session_t &session, scalar_t dt) {
+    auto &match = *session.match;
+    if (session.keyframe || (wheel_.now() + slot) % keyframe_ticks == 0) {
+      keyframe(match.arena(), match.ticks(), dt, match.in_play(), events_);
+      session.keyframe = false;
+    }
+    if (events_.empty() && match.acknowledged() == session.reported)
+      return;
+
+    protocol::events_t message{.match = id(slot, session.generation),
+                               .acknowledged = match.acknowledged(),
+                               .early = std::int16_t(std::clamp(
+                                   match.early(), -32768, 32767)),
+                               .tick = match.ticks()};
+    std::size_t i = 0;
+    do {
+      message.count = std::uint8_t(
+          std::min(events_.size() - i, protocol::max_events));
+      std::copy_n(events_.begin() + std::ptrdiff_t(i), message.count,
+                  message.events.begin());
+      queue(message, session.player);
+      i += message.count;
+    } while (i < events_.size());
+    session.reported = match.acknowledged();
+  }
+
+  // send a watched match's tick to its spectators, as an events session's
+  // but without acknowledgements, encoding it once for them all
+  void broadcast(std::uint32_t slot, session_t &session, scalar_t dt,
+                 clock_t::time_point now) {
+    auto &match = *session.match;
+    const bool keyframe_due = (wheel_.now() + slot) % keyframe_ticks == 0;
+    std::shared_ptr<const payload_t> keyframe;
+    bool encoded = false;
+    deltas_.clear();
+
+    auto &watchers = session.watchers;
+    for (std::uint32_t i = 0; i < watchers.size();) {
+      auto &watcher = watchers[i];
+      if (now - watcher.heard > options_.timeout) {
+        forget(session, i);
+        continue;
+      }
+      const auto tag = std::uint64_t{slot} << 32 | i;
+      if (keyframe_due || watcher.fresh) {
+        if (!keyframe) {
+          frame_.clear();
+          pong::keyframe(match.arena(), match.ticks(), dt, match.in_play(),
+                         frame_);
+          encode(slot, session, frame_, &keyframe);
+        }
+        if (watcher.fresh || watcher.skipping)
+          watcher.resynced = match.ticks();
+        watcher.fresh = watcher.skipping = false;
+        queue(keyframe, watcher.address, tag);
+      } else if (!watcher.skipping && !events_.empty()) {
+        if (!encoded)
+          encode(slot, session, events_);
+        encoded = true;
+        for (const auto &delta : deltas_)
+          queue(delta, watcher.address, tag);
+      }
+      ++i;
+    }
+  }
+
+  // encode events into as many payloads as they take, into deltas_ or the
+  // one payload given
+  void encode(std::uint32_t slot, const session_t &session,
+              const std::vector<event_t> &events,
+              std::shared_ptr<const payload_t> *one = nullptr) {
+    protocol::events_t message{.match = id(slot, session.generation),
+                               .tick = session.match->ticks()};
+    std::size_t i = 0;
+    do {
+      message.count =
+          std::uint8_t(std::min(events.size() - i, protocol::max_events));
+      std::copy_n(events.begin() + std::ptrdiff_t(i), message.count,
+                  message.events.begin());
+      auto p = payload();
+      p->size = protocol::encode(message, p->bytes);
+      if (one)
+        *one = std::move(p);
+      else
+        deltas_.push_back(std::move(p));
+      i += message.count;
+    } while (i < events.size());
+  }
+
+  // a payload no datagram still holds, to encode into
+  std::shared_ptr<payload_t> payload() {
+    for (std::size_t n = 0; n < payloads_.size(); ++n) {
+      auto &p = payloads_[next_payload_++ % payloads_.size()];
+      if (p.use_count() == 1)
+        return p;
+    }
+    return payloads_.emplace_back(std::make_shared<payload_t>());
+  }
+
+  template <typename Message>
+  void queue(const Message &message, const sockaddr_in &to) {
+    auto out = out_.prepare(to);
+    out_.commit(protocol::encode(message, out));
+    if (out_.full())
+      flush();
+  }
+
+  void queue(std::shared_ptr<const payload_t> payload, const sockaddr_in &to,
+             std::uint64_t tag) {
+    fanout_.queue(std::move(payload), to, tag);
+    if (fanout_.full())
+      flush();
+  }
+
+  void flush() {
+    auto queued = out_.size();
+    auto sent = out_.send(socket_);
+    stats_.sent += sent;
+    stats_.dropped += queued - sent;
+    if (fanout_.size() == 0)
+      return;
+
+    queued = fanout_.size();
+    sent = fanout_.send(socket_);
+    stats_.sent += sent;
+    stats_.dropped += queued - sent;
+    // what a spectator misses is only made good by a keyframe
+    for (const auto tag : fanout_.dropped()) {
+      auto &watchers = sessions_[tag >> 32].watchers;
+      const auto i = std::uint32_t(tag);
+      if (i < watchers.size() && !watchers[i].skipping)
+        fall_behind(watchers[i]);
+    }
+  }
+
+  // have a session's slot written to both halves of the checkpoint again
+  void changed(std::uint32_t slot) {
+    if (checkpoint_)
+      dirty_[slot] = 3;
+  }
+
+  void publish() {
+    std::lock_guard lock{published_mutex_};
+    published_ = stats_;
+  }
+
+  const server_options_t &options_;
+  const unsigned index_;
+  const std::vector<std::unique_ptr<loop_t>> &loops_;
+  feed_t *const feed_;
+  checkpoint_t *const checkpoint_;
+  // how often, in ticks
+  const std::uint64_t checkpoint_ticks_;
+  const scalar_t dt_;
+  udp_socket_t socket_;
+  ticker_t ticker_;
+  epoll_t epoll_;
+  datagrams_t in_{64};
+  datagrams_t out_{64};
+  fanout_t fanout_{256};
+
+  std::vector<session_t> sessions_;
+  // when each session's slot is to be woken, by the loop's ticks
+  timer_wheel_t wheel_;
+  std::vector<std::uint32_t> woken_;
+  std::vector<std::uint32_t> free_;
+  std::unordered_map<joiner_t, std::uint32_t, joiner_hash_t> joiners_;
+  std::uint64_t joined_{};
+  // by slot, the halves of the checkpoint (bit 0 and bit 1) that it has
+  // changed since they were written
+  std::vector<std::uint8_t> dirty_;
+  // the tick of the latest checkpoint
+  std::uint64_t saved_{};
+  std::vector<event_t> events_;
+  std::vector<event_t> frame_;
+  std::vector<std::shared_ptr<const payload_t>> deltas_;
+  std::vector<std::shared_ptr<payload_t>> payloads_;
+  std::size_t next_payload_{};
+
+  std::mutex inbox_mutex_;
+  std::vector<watch_t> inbox_;
+  std::vector<watch_t> watches_;
+
+  server_stats_t stats_;
+  mutable std::mutex published_mutex_;
+  server_stats_t published_;
+};
+
+pong::server_t::server_t(const server_options_t &options)
+    : options_{options}, address_{options.address} {
+  // as many as match ids have room for
+  options_.loops =
+      std::clamp(options_.loops, 1u, unsigned(loop_t::max_loops));
+  options_.max_matches =
+      std::min(options_.max_matches, std::size_t{1} << loop_t::slot_bits);
+  if (!options_.feed.empty())
+    feed_ = std::make_unique<feed_t>(options_.feed,
+                                     options_.loops * options_.max_matches,
+                                     options_.tick_period);
+  if (!options_.checkpoint.empty())
+    checkpoint_ = std::make_unique<checkpoint_t>(
+        options_.checkpoint, options_.loops, options_.max_matches,
+        options_.tick_period);
+  for (unsigned i = 0; i < options_.loops; ++i) {
+    loops_.emplace_back(std::make_unique<loop_t>(
+        options_, i, address_, loops_, feed_.get(), checkpoint_.get()));
+    // the rest share the port the first was given
+    address_ = loops_.front()->address();
+    if (checkpoint_)
+      loops_.back()->resume();
+  }
+}
+
+pong::server_t::~server_t() { stop(); }
+
+void pong::server_t::start() {
+  const auto cpus = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < loops_.size(); ++i) {
+    threads_.emplace_back([this, i, cpus, stop = stop_.get_token()]() {
+      if (options_.pin)
+        pin_to_cpu(i % cpus);
+      loops_[i]->run(stop);
+    });
+  }
+}
+
+void pong::server_t::stop() {
+  stop_.request_stop();
+  threads_.clear();
+  if (!checkpoint_)
+    return;
+  // the loops' last checkpoints, once those before are out of the way
+  checkpoint_->flush();
+  for (const auto &loop : loops_)
+    loop->save();
+  checkpoint_->flush();
+}
+
+pong::server_stats_t pong::server_t::stats() const {
+  server_stats_t result;
+  for (const auto &loop : loops_)
+    result += loop->stats();
+  return result;
+}
@@ -0,0 +1,162 @@
+#ifndef PONG_HOST_HPP
+#define PONG_HOST_HPP
+
+#include "checkpoint.hpp"
+#include "feed.hpp"
+#include "match.hpp"
+#include "net.hpp"
+#include "profile.hpp"
+#include "protocol.hpp"
+#include "simulation.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pong {
+
+struct server_options_t {
+  sockaddr_in address = loopback();
+  // one loop, on a thread pinned to a CPU of its own where allowed, per core
+  unsigned loops = std::max(1u, std::thread::hardware_concurrency());
+  std::chrono::steady_clock::duration tick_period =
+      std::chrono::microseconds{1'000'000 / 60};
+  rules_t rules{};
+  std::mt19937::result_type seed = 4242;
+  // matches per loop, beyond which players are turned away
+  std::size_t max_matches = 4096;
+  // spectators per loop, of all its matches, beyond which they are too
+  std::size_t max_spectators = 1 << 16;
+  // how long a match lives without hearing from its player
+  std::chrono::steady_clock::duration timeout = std::chrono::seconds{5};
+  // the name of a feed_t to publish every match to, whose bots steer the
+  // lhs paddles in place of the AI; none if empty
+  std::string feed{};
+  // the file to checkpoint every match to, and to resume them from if it
+  // holds a checkpoint; none if empty
+  std::string checkpoint{};
+  std::chrono::steady_clock::duration checkpoint_period =
+      std::chrono::seconds{1};
+  bool pin = true;
+};
+
+/**
+ * What a server has done since it started.  Tick times are the time each
+ * loop takes to tick all its matches and send their states.
+ */
+struct server_stats_t {
+  std::uint64_t matches{};
+  std::uint64_t joined{};
+  std::uint64_t ticks{};
+  // ticks that started more than a period late, i.e. missed their slot
+  std::uint64_t overruns{};
+  std::uint64_t received{};
+  std::uint64_t sent{};
+  // datagrams the sockets had no room for
+  std::uint64_t dropped{};
+  std::uint64_t spectators{};
+  // times a spectator fell behind and was left to wait for a keyframe
+  std::uint64_t skips{};
+  // sessions woken to tick their matches, the rest of matches * ticks
+  // having been skipped
+  std::uint64_t woken{};
+  // checkpoints written, and matches taken up from one at the start
+  std::uint64_t checkpoints{};
+  std::uint64_t resumed{};
+  histogram_t tick_ns;
+
+  server_stats_t &operator+=(const server_stats_t &);
+};
+
+/**
+ * Hosts remote players' matches on one epoll loop per core.  Each loop has
+ * its own socket on the server's port (SO_REUSEPORT), so the kernel spreads
+ * players over the loops by their addresses and a match never leaves the
+ * loop its player joined.  A loop ticks all of its matches on a timerfd and
+ * sends each player their match's state (or only its events, if that is how
+ * they joined), in batches of sendmmsg; in between it drains its socket
+ * with recvmmsg.
+ *
+ * A loop only wakes a session when it must, on a timer_wheel_t: a player
+ * sent states every tick, but one sent events when their match's next
+ * action is due, or its next command, or the AI may steer, or its next
+ * keyframe, and otherwise when it would time out.  The ticks in between are
+ * skipped all at once (remote_match_t::skip), so that a loop's ticks cost
+ * what happens in them rather than how many matches there are.
+ *
+ * Given a feed, a loop publishes each of its matches' states every tick, to
+ * arena loop * max_matches + slot, and takes up whatever a bot has commanded
+ * for its lhs paddle at the start of the next; such a loop wakes every
+ * session every tick.
+ *
+ * A match's spectators are sent its events too, each tick's encoded once
+ * into a payload_t that every spectator's datagram points at (fanout_t).
+ * Rather than queue what a spectator can't keep up with, a spectator the
+ * socket had no room for, or whose watch says they are behind, is sent
+ * nothing more until the match's next keyframe.  Their datagrams go to
+ * whichever loop the kernel chooses for them, which passes their watches
+ * on to the match's own.  Loops share nothing else but their stats.
+ *
+ * Given a checkpoint file, a loop checkpoints its sessions every
+ * checkpoint period (see checkpoint_t), and once more when the server
+ * stops; a server started on the same file, with the same options, takes
+ * them up, each match at the tick it had reached and waking when it was
+ * to.  Spectators watch again and players' timeouts start over, but
+ * otherwise a match carries on from the checkpoint as it would have.
+ */
+class server_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  /**
+   * taking up the matches checkpointed, if any; throws as checkpoint_t's
+   * constructor does
+   */
+  explicit server_t(const server_options_t &);
+
+  server_t(const server_t &) = delete;
+
+  server_t &operator=(const server_t &) = delete;
+
+  ~server_t();
+
+  /**
+   * the address players send to, with the port chosen for port 0
+   */
+  [[nodiscard]] sockaddr_in address() const { return address_; }
+
+  /**
+   * run every loop on its own thread until stop() or destruction
+   */
+  void start();
+
+  /**
+   * stop the loops, after which they write their last checkpoint
+   */
+  void stop();
+
+  [[nodiscard]] server_stats_t stats() const;
+
+private:
+  class loop_t;
+
+  server_options_t options_;
+  sockaddr_in address_;
+  std::unique_ptr<feed_t> feed_;
+  std::unique_ptr<checkpoint_t> checkpoint_;
+  std::vector<std::unique_ptr<loop_t>> loops_;
+  std::stop_source stop_;
+  std::vector<std::jthread> threads_;
+};
+
+} // namespace pong
+
+#endif // PONG_HOST_HPP
@@ -119,6 +119,7 @@
 #include "imgui.h"
 #ifndef IMGUI_DISABLE
 #include "imgui_impl_opengl3.h"
+#include "trace.hpp"    // pong: compiled out unless PONG_TRACE is defined
 #include <stdio.h>
 #include <stdint.h>     // intptr_t
 #if defined(__APPLE__)
@@ -243,6 +244,14 @@ struct ImGui_ImplOpenGL3_Data
   bool            HasClipOrigin;
   bool            UseBufferSubData;
 
+  // pong: streamed uploads, see ImGui_ImplOpenGL3_SetUpload()
+  ImGui_ImplOpenGL3_Upload Upload;
+  int                      RingRegion;         // Region of the ring written last frame
+  GLintptr                 VtxAttribOffset;    // Byte offset the vertex attribute pointers are currently set to
+  ImVector<ImDrawVert>     StagingVtx;         // Every command list's vertices and indices, concatenated
+  ImVector<ImDrawIdx>      StagingIdx;
+  ImVector<int>            ListBaseVertex;     // Per command list, the staged vertex its indices are relative to
+
   ImGui_ImplOpenGL3_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
 
@@ -412,6 +421,101 @@ void    ImGui_ImplOpenGL3_NewFrame()
     ImGui_ImplOpenGL3_CreateFontsTexture();
 }
 
+void    ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload upload)
+{
+  ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Context or backend not initialized! Did you call ImGui_ImplOpenGL3_Init()?");
+
+  // The buffers' storage is laid out differently by each strategy, so is respecified on the next frame
+  bd->Upload = upload;
+  bd->RingRegion = 0;
+  bd->VertexBufferSize = 0;
+  bd->IndexBufferSize = 0;
+}
+
+// pong: the streamed uploads put every command list in one buffer, so the attributes are pointed at the list being drawn
+// (GL ES 2.0 has no base vertex).
+static void ImGui_ImplOpenGL3_SetupVertexAttribs(GLintptr offset)
+{
+  ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+  bd->VtxAttribOffset = offset;
+  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxPos,   2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(offset + offsetof(ImDrawVert, pos))));
+  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxUV,    2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(offset + offsetof(ImDrawVert, uv))));
+  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)(offset + offsetof(ImDrawVert, col))));
+}
+
+// pong: concatenates every command list into bd->StagingVtx / StagingIdx for a single upload.  Without base vertex
+// support, indices are rebased so that each list's are relative to the first vertex of a run of lists that 16-bit
+// indices can address, which is where the attributes are pointed when drawing them.
+static void ImGui_ImplOpenGL3_StageDrawData(ImDrawData* draw_data, bool base_vertex)
+{
+  ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+  bd->StagingVtx.resize(draw_data->TotalVtxCount);
+  bd->StagingIdx.resize(draw_data->TotalIdxCount);
+  bd->ListBaseVertex.resize(draw_data->CmdListsCount);
+
+  int vtx_start = 0;
+  int idx_start = 0;
+  int base = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* draw_list = draw_data->CmdLists[n];
+    if (!base_vertex && sizeof(ImDrawIdx) == 2 && vtx_start + draw_list->VtxBuffer.Size - base > 0x10000)
+      base = vtx_start;
+    bd->ListBaseVertex[n] = base_vertex ? 0 : base;
+
+    memcpy(bd->StagingVtx.Data + vtx_start, draw_list->VtxBuffer.Data, (size_t)draw_list->VtxBuffer.Size * sizeof(ImDrawVert));
+    const int rebase = base_vertex ? 0 : vtx_start - base;
+    if (rebase == 0)
+      memcpy(bd->StagingIdx.Data + idx_start, draw_list->IdxBuffer.Data, (size_t)draw_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+    else
+      for (int i = 0; i < draw_list->IdxBuffer.Size; i++)
+        bd->StagingIdx.Data[idx_start + i] = (ImDrawIdx)(draw_list->IdxBuffer.Data[i] + rebase);
+
+    vtx_start += draw_list->VtxBuffer.Size;
+    idx_start += draw_list->IdxBuffer.Size;
+  }
+}
+
+// pong: uploads the staged vertices and indices, returning their byte offsets in the buffers
+static void ImGui_ImplOpenGL3_UploadStaged(GLintptr* vtx_offset, GLintptr* idx_offset)
+{
+  ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+  const GLsizeiptr vtx_size = (GLsizeiptr)bd->StagingVtx.size_in_bytes();
+  const GLsizeiptr idx_size = (GLsizeiptr)bd->StagingIdx.size_in_bytes();
+
+  // Grow by half again so that the storage settles after a few frames, keeping region offsets whole vertices
+  const int regions = bd->Upload == ImGui_ImplOpenGL3_Upload_Ring ? 3 : 1;
+  const bool grow_vtx = bd->VertexBufferSize < vtx_size;
+  const bool grow_idx = bd->IndexBufferSize < idx_size;
+  if (grow_vtx)
+    bd->VertexBufferSize = (GLsizeiptr)(bd->StagingVtx.Size + bd->StagingVtx.Size / 2) * (GLsizeiptr)sizeof(ImDrawVert);
+  if (grow_idx)
+    bd->IndexBufferSize = (GLsizeiptr)(bd->StagingIdx.Size + bd->StagingIdx.Size / 2) * (GLsizeiptr)sizeof(ImDrawIdx);
+
+  if (bd->Upload == ImGui_ImplOpenGL3_Upload_Ring)
+  {
+    // Storage is only (re)specified when it grows; otherwise the ring moves on to the region written longest ago
+    bd->RingRegion = (bd->RingRegion + 1) % regions;
+    if (grow_vtx)
+      GL_CALL(glBufferData(GL_ARRAY_BUFFER, bd->VertexBufferSize * regions, nullptr, GL_STREAM_DRAW));
+    if (grow_idx)
+      GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->IndexBufferSize * regions, nullptr, GL_STREAM_DRAW));
+    *vtx_offset = bd->VertexBufferSize * bd->RingRegion;
+    *idx_offset = bd->IndexBufferSize * bd->RingRegion;
+  }
+  else
+  {
+    // Orphan last frame's storage, which the GPU may still be reading, rather than wait for it
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, bd->VertexBufferSize, nullptr, GL_STREAM_DRAW));
+    GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, bd->IndexBufferSize, nullptr, GL_STREAM_DRAW));
+    *vtx_offset = 0;
+    *idx_offset = 0;
+  }
+  GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, *vtx_offset, vtx_size, (const GLvoid*)bd->StagingVtx.Data));
+  GL_CALL(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, *idx_offset, idx_size, (const GLvoid*)bd->StagingIdx.Data));
+}
+
 static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object)
 {
   ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
@@ -481,9 +585,7 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
   GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxPos));
   GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxUV));
   GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxColor));
-  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxPos,   2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)offsetof(ImDrawVert, pos)));
-  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxUV,    2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)offsetof(ImDrawVert, uv)));
-  GL_CALL(glVertexAttribPointer(bd->AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)offsetof(ImDrawVert, col)));
+  ImGui_ImplOpenGL3_SetupVertexAttribs(bd->VtxAttribOffset);
 }
 
 // OpenGL3 Render function.
@@ -491,6 +593,10 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
 // This is in order to be able to run within an OpenGL engine that doesn't do so.
 void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 {
+  PONG_TRACE_SCOPE("ImGui_ImplOpenGL3_RenderDrawData");
+  PONG_TRACE_COUNTER("draw_data.vertices", draw_data->TotalVtxCount);
+  PONG_TRACE_COUNTER("draw_data.indices", draw_data->TotalIdxCount);
+
   // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
   int fb_width = (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
   int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
@@ -545,8 +651,25 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 #ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
   GL_CALL(glGenVertexArrays(1, &vertex_array_object));
 #endif
+  bd->VtxAttribOffset = 0;
   ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
 
+  // pong: with the streamed strategies every command list is uploaded up front, in one call per buffer
+  bool base_vertex = false;
+#ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
+  base_vertex = bd->GlVersion >= 320;
+#endif
+  const bool streamed = bd->Upload != ImGui_ImplOpenGL3_Upload_PerList;
+  GLintptr vtx_region = 0;
+  GLintptr idx_region = 0;
+  if (streamed)
+  {
+    ImGui_ImplOpenGL3_StageDrawData(draw_data, base_vertex);
+    ImGui_ImplOpenGL3_UploadStaged(&vtx_region, &idx_region);
+  }
+  int vtx_start = 0;
+  int idx_start = 0;
+
   // Will project scissor/clipping rectangles into framebuffer space
   ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
   ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
@@ -564,9 +687,22 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
     // - We are now back to using exclusively glBufferData(). So bd->UseBufferSubData IS ALWAYS FALSE in this code.
     //   We are keeping the old code path for a while in case people finding new issues may want to test the bd->UseBufferSubData path.
     // - See https://github.com/ocornut/imgui/issues/4468 and please report any corruption issues.
+    // - pong: streamed lists are already uploaded, so are only pointed at.
     const GLsizeiptr vtx_buffer_size = (GLsizeiptr)draw_list->VtxBuffer.Size * (int)sizeof(ImDrawVert);
     const GLsizeiptr idx_buffer_size = (GLsizeiptr)draw_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx);
-    if (bd->UseBufferSubData)
+    GLintptr idx_offset = 0;
+    int list_base_vertex = 0;
+    if (streamed)
+    {
+      const GLintptr vtx_offset = vtx_region + (GLintptr)bd->ListBaseVertex[n] * (GLintptr)sizeof(ImDrawVert);
+      if (vtx_offset != bd->VtxAttribOffset)
+        ImGui_ImplOpenGL3_SetupVertexAttribs(vtx_offset);
+      idx_offset = idx_region + (GLintptr)idx_start * (GLintptr)sizeof(ImDrawIdx);
+      list_base_vertex = base_vertex ? vtx_start : 0;
+      vtx_start += draw_list->VtxBuffer.Size;
+      idx_start += draw_list->IdxBuffer.Size;
+    }
+    else if (bd->UseBufferSubData)
     {
       if (bd->VertexBufferSize < vtx_buffer_size)
       {
@@ -614,10 +750,11 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
         GL_CALL(glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->GetTexID()));
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
         if (bd->GlVersion >= 320)
-          GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset));
+          GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(idx_offset + pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)(list_base_vertex + pcmd->VtxOffset)));
         else
 #endif
-          GL_CALL(glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))));
+          GL_CALL(glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(idx_offset + pcmd->IdxOffset * sizeof(ImDrawIdx))));
+        (void)list_base_vertex;
       }
     }
   }
@@ -953,6 +1090,7 @@ void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
   ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
   if (bd->VboHandle)      { glDeleteBuffers(1, &bd->VboHandle); bd->VboHandle = 0; }
   if (bd->ElementsHandle) { glDeleteBuffers(1, &bd->ElementsHandle); bd->ElementsHandle = 0; }
+  bd->VertexBufferSize = bd->IndexBufferSize = 0;
   if (bd->ShaderHandle)   { glDeleteProgram(bd->ShaderHandle); bd->ShaderHandle = 0; }
   ImGui_ImplOpenGL3_DestroyFontsTexture();
 }
@@ -44,6 +44,19 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// pong: how the vertex and index buffers reach the GPU each frame.
+// - Stream (default): every command list is concatenated into one upload per buffer per frame, into storage orphaned
+//   with glBufferData(nullptr) so the driver never waits on the GPU still reading last frame's vertices.
+// - Ring: the same single upload, with glBufferSubData only, into the next of 3 regions of a buffer sized for 3 frames.
+// - PerList: upstream behavior, one glBufferData per command list per buffer.
+enum ImGui_ImplOpenGL3_Upload
+{
+  ImGui_ImplOpenGL3_Upload_Stream,
+  ImGui_ImplOpenGL3_Upload_Ring,
+  ImGui_ImplOpenGL3_Upload_PerList,
+};
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload upload);
+
 // Configuration flags to add in your imconfig file:
 //#define IMGUI_IMPL_OPENGL_ES2     // Enable ES 2 (Auto-detected on Emscripten)
 //#define IMGUI_IMPL_OPENGL_ES3     // Enable ES 3 (Auto-detected on iOS/Android)
@@ -0,0 +1,145 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+namespace {
+
+using stage_t = pong::input_latency_t::stage_t;
+
+stage_t next(stage_t stage) { return stage_t(std::size_t(stage) + 1); }
+
+std::uint64_t nanoseconds(std::chrono::steady_clock::duration d) {
+  return std::uint64_t(std::chrono::nanoseconds{d}.count());
+}
+
+} // namespace
+
+std::string_view pong::name(input_latency_t::stage_t stage) {
+  switch (stage) {
+  case stage_t::received:
+    return "received";
+  case stage_t::applied:
+    return "applied";
+  case stage_t::advanced:
+    return "advanced";
+  case stage_t::drawn:
+    return "drawn";
+  case stage_t::presented:
+    return "presented";
+  case stage_t::count:
+    break;
+  }
+  return "unknown";
+}
+
+void pong::input_latency_t::received(clock_t::time_point input) {
+  std::lock_guard lock{mutex_};
+  auto &record = in_flight_[next_++ % in_flight];
+  if (record.reached == stage_t::count)
+    pending_.fetch_add(1, std::memory_order_relaxed);
+  record = {};
+  record.times[std::size_t(stage_t::received)] = input;
+  record.reached = stage_t::received;
+}
+
+template <typename Match>
+void pong::input_latency_t::advance(stage_t from, clock_t::time_point now,
+                                    Match match) {
+  if (pending_.load(std::memory_order_relaxed) == 0)
+    return;
+
+  std::lock_guard lock{mutex_};
+  for (auto &record : in_flight_) {
+    if (record.reached != from || !match(record))
+      continue;
+    record.reached = next(from);
+    record.times[std::size_t(record.reached)] = now;
+    if (record.reached == stage_t::presented) {
+      complete(record);
+      record.reached = stage_t::count;
+      pending_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void pong::input_latency_t::applied(clock_t::time_point input,
+                                    std::uint64_t tick,
+                                    clock_t::time_point now) {
+  advance(stage_t::received, now, [&](record_t &record) {
+    if (record.times[std::size_t(stage_t::received)] != input)
+      return false;
+    record.tick = tick;
+    return true;
+  });
+}
+
+void pong::input_latency_t::advanced(std::uint64_t tick,
+                                     clock_t::time_point now) {
+  advance(stage_t::applied, now,
+          [&](const record_t &record) { return record.tick <= tick; });
+}
+
+void pong::input_latency_t::drawn(std::uint64_t tick, int frame,
+                                  clock_t::time_point now) {
+  advance(stage_t::advanced, now, [&](record_t &record) {
+    if (record.tick > tick)
+      return false;
+    record.frame = frame;
+    return true;
+  });
+}
+
+void pong::input_latency_t::presented(int frame, clock_t::time_point now) {
+  advance(stage_t::drawn, now,
+          [&](const record_t &record) { return record.frame <= frame; });
+}
+
+void pong::input_latency_t::complete(const record_t &record) {
+  history_[completed_++ % history] = record;
+
+  if (!profile_)
+    return;
+
+  // the stages' metrics are in stage order, followed by the end to end one
+  for (auto stage = stage_t::applied; stage != stage_t::count;
+       stage = next(stage)) {
+    profile_->record(
+        metric_t(std::size_t(metric_t::input_apply) + std::size_t(stage) - 1),
+        nanoseconds(record.times[std::size_t(stage)] -
+                    record.times[std::size_t(stage) - 1]));
+  }
+  profile_->record(
+      metric_t::input_latency,
+      nanoseconds(record.times[std::size_t(stage_t::presented)] -
+                  record.times[std::size_t(stage_t::received)]));
+}
+
+std::uint64_t pong::input_latency_t::completed() const {
+  std::lock_guard lock{mutex_};
+  return completed_;
+}
+
+void pong::input_latency_t::write(std::ostream &os) const {
+  std::lock_guard lock{mutex_};
+
+  os << "tick,frame";
+  for (auto stage = stage_t::applied; stage != stage_t::count;
+       stage = next(stage)) {
+    os << ',' << name(stage);
+  }
+  os << '\n';
+
+  const auto n = std::min<std::uint64_t>(completed_, history);
+  for (auto i = completed_ - n; i < completed_; ++i) {
+    const auto &record = history_[i % history];
+    os << record.tick << ',' << record.frame;
+    for (auto stage = stage_t::applied; stage != stage_t::count;
+         stage = next(stage)) {
+      os << ','
+         << nanoseconds(record.times[std::size_t(stage)] -
+                        record.times[std::size_t(stage_t::received)]);
+    }
+    os << '\n';
+  }
+}
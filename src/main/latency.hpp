@@ -0,0 +1,118 @@
+#ifndef PONG_LATENCY_HPP
+#define PONG_LATENCY_HPP
+
+#include "profile.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string_view>
+
+namespace pong {
+
+/**
+ * Follows each user input from its GLFW callback to the screen.  An input is
+ * identified by its own timestamp (input_t::time), and is stamped as it
+ * reaches each stage:
+ *
+ *   received   the GLFW callback (on the main thread)
+ *   applied    the tick that changes the paddle's velocity to suit it
+ *   advanced   the publication of that tick, once the arena has moved
+ *   drawn      the first frame built from that tick or a later one
+ *   presented  the return of the swap of that frame, or of a later one
+ *
+ * Once presented, the time spent in each stage and end to end is recorded
+ * into the input_* metrics of a profile, and the record is kept for write().
+ *
+ * Stages are stamped from whichever threads run them; a mutex guards the
+ * records, but stages other than received return without it when nothing is
+ * in flight.
+ */
+class input_latency_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  enum class stage_t : std::uint8_t {
+    received,
+    applied,
+    advanced,
+    drawn,
+    presented,
+    count,
+  };
+
+  struct record_t {
+    std::array<clock_t::time_point, std::size_t(stage_t::count)> times{};
+    // the first published tick that reflects the input
+    std::uint64_t tick{};
+    // the ImGui frame count of the first frame that drew it
+    int frame{};
+    stage_t reached{stage_t::count};
+  };
+
+  /**
+   * inputs that haven't been presented; when there are more the oldest are
+   * forgotten
+   */
+  static constexpr std::size_t in_flight = 256;
+
+  /**
+   * presented inputs kept for write()
+   */
+  static constexpr std::size_t history = 1024;
+
+  explicit input_latency_t(profile_t *profile = nullptr) : profile_{profile} {}
+
+  input_latency_t(const input_latency_t &) = delete;
+
+  input_latency_t &operator=(const input_latency_t &) = delete;
+
+  void received(clock_t::time_point input);
+
+  void applied(clock_t::time_point input, std::uint64_t tick,
+               clock_t::time_point now);
+
+  void advanced(std::uint64_t tick, clock_t::time_point now);
+
+  void drawn(std::uint64_t tick, int frame, clock_t::time_point now);
+
+  void presented(int frame, clock_t::time_point now);
+
+  /**
+   * the number of inputs presented so far
+   */
+  [[nodiscard]] std::uint64_t completed() const;
+
+  /**
+   * write the stage times, in nanoseconds since receipt, of the most recently
+   * presented inputs as CSV
+   */
+  void write(std::ostream &) const;
+
+private:
+  /**
+   * move every record at stage from that matches to the next stage
+   */
+  template <typename Match>
+  void advance(stage_t from, clock_t::time_point now, Match match);
+
+  void complete(const record_t &);
+
+  profile_t *profile_;
+
+  mutable std::mutex mutex_;
+  std::atomic<std::size_t> pending_{};
+  std::array<record_t, in_flight> in_flight_{};
+  std::size_t next_{};
+  std::array<record_t, history> history_{};
+  std::uint64_t completed_{};
+};
+
+std::string_view name(input_latency_t::stage_t);
+
+} // namespace pong
+
+#endif // PONG_LATENCY_HPP
@@ -0,0 +1,234 @@
+#include "match.hpp"
+
+#include <algorithm>
+#include <utility>
+
+pong::match_t::match_t(std::mt19937::result_type seed, const rules_t &rules)
+    : rules_{rules}, arena_{make_starter(seed)},
+      lhs_{seed + 1, apply_rules(arena_, rules_)},
+      rhs_{seed + 2, apply_rules(arena_, rules_)} {}
+
+void pong::match_t::seat(std::unique_ptr<bot_t> lhs,
+                         std::unique_ptr<bot_t> rhs) {
+  if (lhs)
+    lhs_bot_ = std::move(lhs);
+  if (rhs)
+    rhs_bot_ = std::move(rhs);
+}
+
+void pong::match_t::steer() { steer(nullptr); }
+
+void pong::match_t::steer(hash_history_t &history) { steer(&history); }
+
+void pong::match_t::steer(hash_history_t *history) {
+  auto &lhs = arena_.lhs_paddle();
+  auto &rhs = arena_.rhs_paddle();
+  if (const auto s = lhs_bot_ ? lhs_bot_->paddle_speed(arena_, lhs)
+                              : lhs_.paddle_speed(arena_, lhs)) {
+    lhs.velocity()(1) = *s;
+    if (history)
+      history->steer(lhs);
+  }
+  if (const auto s = rhs_bot_ ? rhs_bot_->paddle_speed(arena_, rhs)
+                              : rhs_.paddle_speed(arena_, rhs)) {
+    rhs.velocity()(1) = *s;
+    if (history)
+      history->steer(rhs);
+  }
+}
+
+std::size_t pong::match_t::advance(scalar_t dt) {
+  return in_play() ? arena_.advance_time(dt) : 0;
+}
+
+std::size_t pong::match_t::advance(scalar_t dt, hash_history_t &history) {
+  const auto actions =
+      in_play() ? arena_.advance_time(dt,
+                                      [&](scalar_t t, const action_t &action) {
+                                        history.action(arena_, t, action);
+                                      })
+                : 0;
+  history.end_tick();
+  return actions;
+}
+
+pong::remote_match_t::remote_match_t(std::mt19937::result_type seed,
+                                     const rules_t &rules)
+    : rules_{rules}, arena_{make_starter(seed)},
+      ai_{seed + 1, apply_rules(arena_, rules_)} {}
+
+pong::remote_match_t::remote_match_t(const state_t &state)
+    : rules_{state.rules}, arena_{state.starter}, ai_{state.ai},
+      speed_{state.speed},
+      bot_{state.botted ? std::optional{state.bot} : std::nullopt},
+      ticks_{state.ticks}, acted_{state.acted},
+      scheduled_(state.scheduled.begin(),
+                 state.scheduled.begin() +
+                     std::min<std::size_t>(state.scheduled_count,
+                                           max_scheduled)),
+      received_{state.received}, acknowledged_{state.acknowledged},
+      early_{state.early} {
+  // which drew the first puck from the starter, so put it back
+  *arena_.starter() = state.starter;
+  auto &puck = arena_.puck();
+  puck.centre() = vec_t{state.puck[0], state.puck[1]};
+  puck.velocity() = vec_t{state.puck[2], state.puck[3]};
+  auto paddle = [](paddle_t &p, const std::array<scalar_t, 5> &from) {
+    p.box() = box_t{vec_t{from[0], from[1]}, vec_t{from[2], from[3]}};
+    p.velocity() = vec_t{0, from[4]};
+  };
+  paddle(arena_.lhs_paddle(), state.lhs_paddle);
+  paddle(arena_.rhs_paddle(), state.rhs_paddle);
+  arena_.lhs_score() = state.lhs_score;
+  arena_.rhs_score() = state.rhs_score;
+}
+
+void pong::remote_match_t::save(state_t &state) const {
+  auto paddle = [](const paddle_t &p) -> std::array<scalar_t, 5> {
+    return {p.box().min()(0), p.box().min()(1), p.box().max()(0),
+            p.box().max()(1), p.velocity()(1)};
+  };
+
+  const auto &puck = arena_.puck();
+  state.rules = rules_;
+  state.puck = {puck.centre()(0), puck.centre()(1), puck.velocity()(0),
+                puck.velocity()(1)};
+  state.lhs_paddle = paddle(arena_.lhs_paddle());
+  state.rhs_paddle = paddle(arena_.rhs_paddle());
+  state.lhs_score = arena_.lhs_score();
+  state.rhs_score = arena_.rhs_score();
+  state.starter = *arena_.starter();
+  state.ai = ai_.state();
+  state.speed = speed_;
+  state.botted = bot_.has_value();
+  state.bot = bot_.value_or(0.f);
+  state.acted = acted_;
+  state.ticks = ticks_;
+  state.received = received_;
+  state.acknowledged = acknowledged_;
+  state.early = early_;
+  state.scheduled_count = std::uint32_t(scheduled_.size());
+  std::ranges::copy(scheduled_, state.scheduled.begin());
+}
+
+void pong::remote_match_t::command(scalar_t speed) {
+  speed_ = clamp_speed(speed);
+}
+
+void pong::remote_match_t::bot(scalar_t speed) { bot_ = clamp_speed(speed); }
+
+void pong::remote_match_t::command(std::uint32_t sequence, scalar_t speed,
+                                    std::uint64_t tick) {
+  if (std::int32_t(sequence - received_) <= 0 ||
+      scheduled_.size() == max_scheduled)
+    return;
+  received_ = sequence;
+  const auto next = ticks_ + 1;
+  const auto at = tick == 0 ? next : tick;
+  scheduled_.push_back(
+      {.sequence = sequence,
+       .speed = speed,
+       .tick = std::max(at, next),
+       .early = std::int32_t(std::int64_t(at) - std::int64_t(next))});
+}
+
+std::size_t pong::remote_match_t::tick(scalar_t dt,
+                                       std::vector<event_t> *events) {
+  ++ticks_;
+
+  auto due = scheduled_.begin();
+  for (; due != scheduled_.end() && due->tick <= ticks_; ++due) {
+    command(due->speed);
+    acknowledged_ = due->sequence;
+    early_ = due->early;
+  }
+  scheduled_.erase(scheduled_.begin(), due);
+
+  // only a change of speed changes a paddle's trajectory
+  auto steer = [&](paddle_t &paddle, body_t body, scalar_t speed) {
+    if (paddle.velocity()(1) == speed)
+      return;
+    paddle.velocity()(1) = speed;
+    if (events)
+      events->push_back(event(arena_, body, ticks_, 0, in_play()));
+  };
+
+  if (bot_)
+    steer(arena_.lhs_paddle(), body_t::lhs_paddle, *bot_);
+  else if (const auto s = ai_.paddle_speed(arena_, arena_.lhs_paddle()))
+    steer(arena_.lhs_paddle(), body_t::lhs_paddle, *s);
+  steer(arena_.rhs_paddle(), body_t::rhs_paddle, speed_);
+
+  acted_ = false;
+  if (!in_play())
+    return 0;
+  const auto actions =
+      events ? arena_.advance_time(dt,
+                                   [&](scalar_t t, const action_t &action) {
+                                     record(arena_, action, ticks_, t,
+                                            in_play(), *events);
+                                   })
+             : arena_.advance_time(dt);
+  acted_ = actions > 0;
+  return actions;
+}
+
+void pong::remote_match_t::skip(std::uint64_t ticks, scalar_t dt,
+                                std::vector<event_t> *events) {
+  if (ticks == 0)
+    return;
+  const auto first = ticks_ + 1;
+  ticks_ += ticks;
+  if (!in_play())
+    return;
+  // nothing should happen, but whatever rounding lets through is put down
+  // to the tick it happened in
+  const auto actions = arena_.advance_time(
+      dt * scalar_t(ticks), [&](scalar_t t, const action_t &action) {
+        if (!events)
+          return;
+        const auto i = std::min(std::uint64_t(t / dt), ticks - 1);
+        record(arena_, action, first + i, t - dt * scalar_t(i), in_play(),
+               *events);
+      });
+  acted_ = actions > 0;
+}
+
+std::uint64_t pong::remote_match_t::next_tick(scalar_t dt,
+                                              std::uint64_t horizon) {
+  auto next = ticks_ + std::max<std::uint64_t>(horizon, 1);
+  if (!scheduled_.empty())
+    next = std::min(next, scheduled_.front().tick);
+  if (!in_play())
+    return next;
+  // while the puck is past it, the AI stops its paddle as soon as it has
+  // moved a little, see ai_t::paddle_speed
+  const auto &puck = arena_.puck();
+  const scalar_t lhs = arena_.lhs_paddle().box().max()(0) + puck.radius();
+  const scalar_t rhs = arena_.rhs_paddle().box().min()(0) - puck.radius();
+  const scalar_t x = puck.centre()(0);
+  const bool past = x < lhs || x > rhs;
+  if (acted_ || (past && arena_.lhs_paddle().velocity()(1) != 0.f))
+    return ticks_ + 1;
+
+  // the tick an action happens in, t from now
+  auto in = [&](scalar_t t) { return ticks_ + 1 + std::uint64_t(t / dt); };
+  const scalar_t span = dt * scalar_t(next - ticks_);
+
+  std::optional<std::tuple<scalar_t, action_t>> action;
+  action = arena_.lhs_paddle().next_action(span, std::move(action));
+  action = arena_.rhs_paddle().next_action(span, std::move(action));
+  action = arena_.next_action(span, std::move(action));
+  if (action)
+    next = std::min(next, in(std::get<0>(*action)));
+
+  // and the puck getting past it, which is no action; see
+  // estimate_next_collision
+  const scalar_t vx = puck.velocity()(0);
+  if (!past && vx != 0.f) {
+    const scalar_t when = ((vx > 0.f ? rhs : lhs) - x) / vx;
+    if (when < span)
+      next = std::min(next, in(when) + 1);
+  }
+  return next;
+}
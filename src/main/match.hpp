@@ -0,0 +1,268 @@
+#ifndef PONG_MATCH_HPP
+#define PONG_MATCH_HPP
+
+#include "bot.hpp"
+#include "hash.hpp"
+#include "model.hpp"
+#include "simulation.hpp"
+#include "trajectory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace pong {
+
+/**
+ * An arena with an AI on both sides.  Everything that happens follows from
+ * the seed and the rules, so a match can be replayed exactly (e.g. to render
+ * it) as long as it's stepped in the same ticks.  Either side may be played
+ * by a plugin's bot_t instead, when the match is as repeatable as the bots
+ * are and as they keep within their budget.
+ */
+class match_t {
+public:
+  explicit match_t(std::mt19937::result_type seed, const rules_t &rules = {});
+
+  match_t(const match_t &) = delete;
+
+  match_t &operator=(const match_t &) = delete;
+
+  /**
+   * seat bots in place of the AIs, on the sides not given nullptr
+   */
+  void seat(std::unique_ptr<bot_t> lhs, std::unique_ptr<bot_t> rhs);
+
+  /**
+   * let both AIs (or bots) choose their paddle speeds; called at the start
+   * of a tick
+   */
+  void steer();
+
+  /**
+   * as above, folding the speeds chosen into history
+   */
+  void steer(hash_history_t &history);
+
+  /**
+   * advance the arena by dt unless the match is over, returning the number
+   * of actions that happened
+   */
+  std::size_t advance(scalar_t dt);
+
+  /**
+   * as above, folding the actions and the end of the tick into history
+   */
+  std::size_t advance(scalar_t dt, hash_history_t &history);
+
+  /**
+   * steer then advance a whole tick of length dt
+   */
+  std::size_t tick(scalar_t dt) {
+    steer();
+    return advance(dt);
+  }
+
+  std::size_t tick(scalar_t dt, hash_history_t &history) {
+    steer(history);
+    return advance(dt, history);
+  }
+
+  /**
+   * false once either side has reached the winning score
+   */
+  [[nodiscard]] bool in_play() const {
+    return arena_.lhs_score() < rules_.winning_score &&
+           arena_.rhs_score() < rules_.winning_score;
+  }
+
+  [[nodiscard]] snapshot_t snapshot(std::uint64_t tick) const {
+    return pong::snapshot(arena_, tick, in_play());
+  }
+
+  [[nodiscard]] const arena_t &arena() const { return arena_; }
+  [[nodiscard]] const rules_t &rules() const { return rules_; }
+
+private:
+  // which moves quiet arenas on itself, see batch.cpp
+  friend class batch_t;
+
+  void steer(hash_history_t *history);
+
+  rules_t rules_;
+  arena_t arena_;
+  ai_t lhs_;
+  ai_t rhs_;
+  std::unique_ptr<bot_t> lhs_bot_;
+  std::unique_ptr<bot_t> rhs_bot_;
+};
+
+/**
+ * A match between the AI, on the lhs, and a remote player, who commands the
+ * speed of the rhs paddle.  Like match_t, everything that happens follows
+ * from the seed, the rules and the commands, tick by tick.
+ */
+class remote_match_t {
+public:
+  /**
+   * the fastest a player may move their paddle, in pixels per second
+   */
+  static constexpr scalar_t max_speed = max_paddle_speed;
+
+  /**
+   * the numbered commands a match holds back at once; any more are ignored
+   * until some are applied, as if they were lost on the way
+   */
+  static constexpr std::size_t max_scheduled = 64;
+
+  struct scheduled_t {
+    std::uint32_t sequence;
+    scalar_t speed;
+    std::uint64_t tick;
+    std::int32_t early;
+  };
+
+  /**
+   * Everything a match goes on from: a match made from the state of
+   * another carries on exactly as the other would, given the same commands
+   * in the same ticks (and skips), in this build.  It's trivially copyable,
+   * to be copied in and out of memory another process maps, but only as
+   * portable as the standard library's PRNGs' layout.
+   */
+  struct state_t {
+    rules_t rules;
+    // centre x, y and velocity x, y
+    std::array<scalar_t, 4> puck;
+    // box min x, min y, max x, max y and velocity y
+    std::array<scalar_t, 5> lhs_paddle;
+    std::array<scalar_t, 5> rhs_paddle;
+    std::uint32_t lhs_score;
+    std::uint32_t rhs_score;
+    starter_t starter;
+    ai_t::state_t ai;
+    scalar_t speed;
+    bool botted;
+    scalar_t bot;
+    bool acted;
+    std::uint64_t ticks;
+    std::uint32_t received;
+    std::uint32_t acknowledged;
+    std::int32_t early;
+    std::uint32_t scheduled_count;
+    std::array<scheduled_t, max_scheduled> scheduled;
+  };
+
+  explicit remote_match_t(std::mt19937::result_type seed,
+                          const rules_t &rules = {});
+
+  explicit remote_match_t(const state_t &);
+
+  remote_match_t(const remote_match_t &) = delete;
+
+  remote_match_t &operator=(const remote_match_t &) = delete;
+
+  /**
+   * the rhs paddle's speed from the next tick on, clamped to max_speed
+   */
+  void command(scalar_t speed);
+
+  /**
+   * as above, but numbered and from tick on: a command is applied at the
+   * start of its tick, or of the next if that has passed (or tick is 0),
+   * after those numbered before it.  Those not numbered after the latest
+   * are ignored.
+   */
+  void command(std::uint32_t sequence, scalar_t speed, std::uint64_t tick);
+
+  /**
+   * the lhs paddle's speed from the next tick on, as a bot commands it (e.g.
+   * over a feed_t) in place of the AI, clamped to max_speed.  The bot plays
+   * the rest of the match; the AI's rules in next_tick() are then moot.
+   */
+  void bot(scalar_t speed);
+
+  /**
+   * the number of the latest command applied
+   */
+  [[nodiscard]] std::uint32_t acknowledged() const { return acknowledged_; }
+
+  /**
+   * how many ticks before its tick the latest command applied came, or
+   * after it (negative) if late
+   */
+  [[nodiscard]] std::int32_t early() const { return early_; }
+
+  /**
+   * steer the AI and advance the arena by dt unless the match is over,
+   * returning the number of actions that happened.  Given events, appends
+   * every change to the arena's trajectory along the way.
+   */
+  std::size_t tick(scalar_t dt, std::vector<event_t> *events = nullptr);
+
+  /**
+   * advance the arena through as many ticks at once, without steering, as if
+   * ticked through them with nothing to steer: up to next_tick(), that is.
+   * Quicker than ticking them, but it rounds differently, and the AI, not
+   * looking in between, isn't swayed by the rounding of its estimates, so a
+   * match is only replayed exactly if skipped through the same ticks.
+   */
+  void skip(std::uint64_t ticks, scalar_t dt,
+            std::vector<event_t> *events = nullptr);
+
+  /**
+   * the next tick that has to be ticked rather than skipped, or horizon
+   * ticks on if that's sooner: the tick of the next action, or of the next
+   * command, or the tick after an action, the AI steering again after
+   * anything changes the puck's course (or the puck gets past its paddle)
+   */
+  [[nodiscard]] std::uint64_t next_tick(scalar_t dt, std::uint64_t horizon);
+
+  [[nodiscard]] bool in_play() const {
+    return arena_.lhs_score() < rules_.winning_score &&
+           arena_.rhs_score() < rules_.winning_score;
+  }
+
+  /**
+   * the number of ticks so far
+   */
+  [[nodiscard]] std::uint64_t ticks() const { return ticks_; }
+
+  [[nodiscard]] snapshot_t snapshot() const {
+    return pong::snapshot(arena_, ticks_, in_play());
+  }
+
+  [[nodiscard]] const arena_t &arena() const { return arena_; }
+  [[nodiscard]] const rules_t &rules() const { return rules_; }
+
+  /**
+   * write the match's state out, in place (e.g. into a checkpoint_t)
+   * rather than by value as it's large
+   */
+  void save(state_t &) const;
+
+private:
+  rules_t rules_;
+  arena_t arena_;
+  ai_t ai_;
+  scalar_t speed_{};
+  std::optional<scalar_t> bot_;
+  std::uint64_t ticks_{};
+  // whether anything happened in the latest tick, so that the AI may steer
+  // differently in the next; at first it has yet to steer at all
+  bool acted_{true};
+  // numbered commands yet to be applied, in order
+  std::vector<scheduled_t> scheduled_;
+  std::uint32_t received_{};
+  std::uint32_t acknowledged_{};
+  std::int32_t early_{};
+};
+
+static_assert(std::is_trivially_copyable_v<remote_match_t::state_t>);
+
+} // namespace pong
+
+#endif // PONG_MATCH_HPP
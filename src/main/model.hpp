@@ -2,7 +2,10 @@
 #define PONG_MODEL_HPP
 
 #include "geometry.hpp"
+#include "trace.hpp"
 
+#include <cstdint>
+#include <functional>
 #include <numeric>
 #include <optional>
 #include <random>
@@ -14,6 +17,7 @@ namespace pong {
     class puck_t;
     class paddle_t;
     class arena_t;
+    class action_t;
     using colour_t = Eigen::Matrix<std::uint8_t, 4, 1>;
 
     /**
@@ -125,6 +129,37 @@ namespace pong {
         void advance_time(scalar_t dt) { centre() = centre() + velocity() * dt; }
     };
 
+    /**
+     * A discrete change to an arena that next_action has found will happen,
+     * applied by arena_t::advance_time when the time comes.  Unlike a
+     * std::function this never allocates.
+     */
+    class action_t {
+    public:
+        enum class kind_t : std::uint8_t {
+            paddle_stops, // a paddle hits the top or bottom of the arena
+            puck_bounces_x, // the puck hits an east / west surface of a paddle
+            puck_bounces_y, // the puck hits a north / south surface
+            lhs_scores,
+            rhs_scores,
+        };
+
+        action_t(kind_t kind, arena_t &arena, paddle_t *paddle = nullptr)
+            : kind_{kind}, arena_{&arena}, paddle_{paddle} {
+        }
+
+        void operator()() const;
+
+        [[nodiscard]] kind_t kind() const { return kind_; }
+
+        [[nodiscard]] paddle_t *paddle() const { return paddle_; }
+
+    private:
+        kind_t kind_;
+        arena_t *arena_;
+        paddle_t *paddle_;
+    };
+
     class paddle_t : public rectangle_t {
     public:
         template<typename... Args>
@@ -132,9 +167,9 @@ namespace pong {
             : rectangle_t{std::forward<Args>(args)...}, arena_{arena} {
         }
 
-        std::optional<std::tuple<scalar_t, std::function<void()> > > next_action(
+        std::optional<std::tuple<scalar_t, action_t> > next_action(
             scalar_t dt,
-            std::optional<std::tuple<scalar_t, std::function<void()> > > result);
+            std::optional<std::tuple<scalar_t, action_t> > result);
 
         void advance_time(scalar_t dt);
 
@@ -142,6 +177,30 @@ namespace pong {
         arena_t &arena_;
     };
 
+    /**
+     * Where and how fast each puck starts, drawn from a seeded PRNG.  Unlike
+     * a lambda its state can be copied out and back, e.g. to carry a match
+     * over to another process, see remote_match_t::state_t.
+     */
+    class starter_t {
+    public:
+        starter_t() = default;
+
+        explicit starter_t(std::mt19937::result_type seed) : prng_{seed} {
+        }
+
+        std::tuple<scalar_t, vec_t> operator()();
+
+    private:
+        std::mt19937 prng_;
+        std::uniform_real_distribution<float> theta_dist_{
+            constant::pi<float>() / 8.f, constant::pi<float>() * 3.f / 8.f
+        };
+        std::uniform_real_distribution<scalar_t> y_dist_{20, 460};
+        std::uniform_int_distribution<int> sign_dist_{0, 1};
+        std::uniform_real_distribution<float> speed_dist_{150, 250};
+    };
+
     class arena_t : public rectangle_t {
     public:
         explicit arena_t(
@@ -189,17 +248,44 @@ namespace pong {
         [[nodiscard]] auto &rhs_score() const { return rhs_score_; }
         auto &rhs_score() { return rhs_score_; }
 
+        /**
+         * the arena's starter, if it was given one of make_starter's
+         */
+        [[nodiscard]] const starter_t *starter() const {
+            return next_puck_velocity_.target<starter_t>();
+        }
+
+        starter_t *starter() { return next_puck_velocity_.target<starter_t>(); }
+
         void restart_puck() {
             const auto [y, vel] = next_puck_velocity_();
             puck().centre() = vec_t{320, y};
             puck().velocity() = vel;
         }
 
-        std::optional<std::tuple<scalar_t, std::function<void()> > > next_action(
+        std::optional<std::tuple<scalar_t, action_t> > next_action(
             scalar_t dt,
-            std::optional<std::tuple<scalar_t, std::function<void()> > > result);
+            std::optional<std::tuple<scalar_t, action_t> > result);
+
+        /**
+         * advance time by dt, returning the number of actions that happened
+         */
+        std::size_t advance_time(scalar_t dt) {
+            return advance_time(dt, [](scalar_t, const action_t &) {
+            });
+        }
+
+        /**
+         * advance time by dt as above, calling on_action(t, action) just
+         * after each action happens, t into dt
+         */
+        template<typename F>
+        std::size_t advance_time(scalar_t dt, F &&on_action) {
+            PONG_TRACE_SCOPE("arena_t::advance_time");
+
+            std::size_t actions = 0;
+            scalar_t elapsed = 0;
 
-        void advance_time(scalar_t dt) {
             auto do_advance = [this](scalar_t t) {
                 puck().advance_time(t);
                 lhs_paddle().advance_time(t);
@@ -207,7 +293,7 @@ namespace pong {
             };
 
             while (dt > 0) {
-                std::optional<std::tuple<scalar_t, std::function<void()> > > next;
+                std::optional<std::tuple<scalar_t, action_t> > next;
 
                 next = lhs_paddle().next_action(dt, std::move(next));
                 next = rhs_paddle().next_action(dt, std::move(next));
@@ -217,12 +303,17 @@ namespace pong {
                     auto &[when, action] = *next;
                     do_advance(when);
                     action();
+                    ++actions;
                     dt -= when;
+                    elapsed += when;
+                    on_action(elapsed, std::as_const(action));
                 } else {
                     do_advance(dt);
                     dt = 0;
                 }
             }
+
+            return actions;
         }
 
     private:
@@ -236,27 +327,86 @@ namespace pong {
 
     class ai_t {
     public:
+        /**
+         * everything the AI's decisions from here on follow from
+         */
+        struct state_t {
+            std::mt19937 prng;
+            std::normal_distribution<scalar_t> error_dist;
+            scalar_t last_estimate;
+        };
+
         explicit ai_t(std::mt19937::result_type seed, scalar_t stdev)
             : prng_(seed), error_dist_(0.f, stdev),
               last_estimate_{std::numeric_limits<scalar_t>::max()} {
         }
 
+        explicit ai_t(const state_t &state)
+            : prng_(state.prng), error_dist_(state.error_dist),
+              last_estimate_{state.last_estimate} {
+        }
+
         ai_t(const ai_t &) = delete;
 
         ai_t &operator=(const ai_t &) = delete;
 
         std::optional<scalar_t> paddle_speed(arena_t &, paddle_t &);
 
+        [[nodiscard]] state_t state() const {
+            return {prng_, error_dist_, last_estimate_};
+        }
+
     private:
         std::mt19937 prng_;
         std::normal_distribution<scalar_t> error_dist_;
         scalar_t last_estimate_;
     };
 
-    std::optional<std::tuple<scalar_t, std::function<void()> > >
+    inline void action_t::operator()() const {
+        switch (kind_) {
+            case kind_t::paddle_stops:
+                paddle_->velocity() = vec_t{0, 0};
+                break;
+            case kind_t::puck_bounces_x:
+                arena_->puck().velocity()(0) *= -1;
+                break;
+            case kind_t::puck_bounces_y: {
+                // how close to the top or bottom a puck bouncing off a paddle
+                // has to be to have no room left to bounce in; any closer and
+                // the bounces between them come ever faster and never finish
+                constexpr scalar_t wedged = 0.01f;
+
+                auto &puck = arena_->puck();
+                const box_t b = bordered(arena_->box(), -puck.radius());
+                if (paddle_ && (puck.centre()(1) <= b.min()(1) + wedged ||
+                                puck.centre()(1) >= b.max()(1) - wedged)) {
+                    // wedged between the paddle and the top or bottom of the
+                    // arena, so neither moves north / south until the puck
+                    // slides out from between them
+                    puck.velocity()(1) = 0;
+                    paddle_->velocity() = vec_t{0, 0};
+                } else {
+                    puck.velocity()(1) *= -1;
+                }
+                break;
+            }
+            case kind_t::lhs_scores:
+                ++arena_->lhs_score();
+                arena_->restart_puck();
+                break;
+            case kind_t::rhs_scores:
+                ++arena_->rhs_score();
+                arena_->restart_puck();
+                break;
+        }
+    }
+
+    std::optional<std::tuple<scalar_t, action_t> >
     inline paddle_t::next_action(
         pong::scalar_t dt,
-        std::optional<std::tuple<scalar_t, std::function<void()> > > result) {
+        std::optional<std::tuple<scalar_t, action_t> > result) {
+        PONG_TRACE_SCOPE("paddle_t::next_action");
+
         // paddle can only move north <-> south
         assert(velocity()(0) == 0.f);
 
@@ -269,9 +419,7 @@ namespace pong {
 
             if (when > -0.f && when <= dt && (!result || when < std::get<0>(*result))) {
                 result.emplace(
-                    std::forward_as_tuple(when, [this]() {
-                        velocity() = vec_t{0, 0};
-                    }));
+                    when, action_t{action_t::kind_t::paddle_stops, arena_, this});
             }
         }
 
@@ -294,8 +442,8 @@ namespace pong {
                 // this collision
                 if (when >= -0.f && when <= dt && x >= b.min()(0) && x <= b.max()(0) &&
                     (!result || when < std::get<0>(*result))) {
-                    result.emplace(std::forward_as_tuple(
-                        when, [this]() { arena_.puck().velocity()(1) *= -1; }));
+                    result.emplace(
+                        when, action_t{action_t::kind_t::puck_bounces_y, arena_, this});
                 }
             }
         }
@@ -318,8 +466,8 @@ namespace pong {
             // collision
             if (when >= -0.f && when <= dt && y >= min_y && y <= max_y &&
                 (!result || when < std::get<0>(*result))) {
-                result.emplace(std::forward_as_tuple(
-                    when, [this]() { arena_.puck().velocity()(0) *= -1; }));
+                result.emplace(
+                    when, action_t{action_t::kind_t::puck_bounces_x, arena_});
             }
         }
 
@@ -342,9 +490,11 @@ namespace pong {
         box().translate(vec_t{0, y - box().min()(1)});
     }
 
-    inline std::optional<std::tuple<scalar_t, std::function<void()> > > arena_t::next_action(
+    inline std::optional<std::tuple<scalar_t, action_t> > arena_t::next_action(
         scalar_t dt,
-        std::optional<std::tuple<scalar_t, std::function<void()> > > result) {
+        std::optional<std::tuple<scalar_t, action_t> > result) {
+        PONG_TRACE_SCOPE("arena_t::next_action");
+
         const box_t b = bordered(box(), -puck().radius());
 
         // north / south
@@ -360,8 +510,8 @@ namespace pong {
 
                 if (when >= -0.f && when <= dt &&
                     (!result || when < std::get<0>(*result))) {
-                    result.emplace(std::forward_as_tuple(
-                        when, [this]() { puck().velocity()(1) *= -1; }));
+                    result.emplace(
+                        when, action_t{action_t::kind_t::puck_bounces_y, *this});
                 }
             }
         }
@@ -375,20 +525,16 @@ namespace pong {
                 const scalar_t when = (b.max()(0) - x0) / s;
                 if (when >= -0.f && when <= dt &&
                     (!result || when < std::get<0>(*result))) {
-                    result.emplace(std::forward_as_tuple(when, [this]() {
-                        ++lhs_score_;
-                        restart_puck();
-                    }));
+                    result.emplace(
+                        when, action_t{action_t::kind_t::lhs_scores, *this});
                 }
             } else {
                 // heading west
                 const scalar_t when = (b.min()(0) - x0) / s;
                 if (when >= -0.f && when <= dt &&
                     (!result || when < std::get<0>(*result))) {
-                    result.emplace(std::forward_as_tuple(when, [this]() {
-                        ++rhs_score_;
-                        restart_puck();
-                    }));
+                    result.emplace(
+                        when, action_t{action_t::kind_t::rhs_scores, *this});
                 }
             }
         }
@@ -398,6 +544,8 @@ namespace pong {
 
     inline std::tuple<scalar_t, scalar_t>
     estimate_next_collision(const arena_t &a, const paddle_t &p) {
+        PONG_TRACE_SCOPE("estimate_next_collision");
+
         assert(&a.lhs_paddle() == &p || &a.rhs_paddle() == &p);
 
         assert(a.puck().velocity()(0) != 0.f);
@@ -462,6 +610,8 @@ namespace pong {
     }
 
     inline std::optional<scalar_t> ai_t::paddle_speed(arena_t &a, paddle_t &p) {
+        PONG_TRACE_SCOPE("ai_t::paddle_speed");
+
         const auto [when, target] = estimate_next_collision(a, p);
 
         if (std::abs(target - std::exchange(last_estimate_, target)) < 2.f)
@@ -470,6 +620,24 @@ namespace pong {
         return when == 0.f ? 0.f : (target - p.centre()(1) + error_dist_(prng_)) / when;
     }
 
+    /**
+     * the fastest anything but the AI (a remote player, a bot) may move a
+     * paddle, in pixels per second
+     */
+    constexpr scalar_t max_paddle_speed = 2000;
+
+    /**
+     * speed clamped to max_paddle_speed; a NaN stops the paddle
+     */
+    inline scalar_t clamp_speed(scalar_t speed) {
+        if (!(std::abs(speed) <= max_paddle_speed))
+            speed = speed > 0 ? max_paddle_speed : speed < 0 ? -max_paddle_speed : 0.f;
+        return speed;
+    }
+
+    /**
+     * a starter_t, as arena_t takes it
+     */
     std::function<std::tuple<scalar_t, vec_t>()>
     make_starter(std::mt19937::result_type);
 } // namespace pong
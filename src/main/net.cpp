@@ -0,0 +1,238 @@
+#include "net.hpp"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <string>
+#include <system_error>
+
+namespace {
+
+[[noreturn]] void fail(const char *what) {
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+// send messages with as few sendmmsg as the socket takes them in, calling
+// dropped(i) for each it had no room for or refused, returning the number
+// taken
+template <typename F>
+std::size_t send_all(int fd, std::span<mmsghdr> messages, F &&dropped) {
+  std::size_t next = 0;
+  std::size_t taken = 0;
+  while (next < messages.size()) {
+    const int n = ::sendmmsg(fd, messages.data() + next,
+                             static_cast<unsigned>(messages.size() - next), 0);
+    if (n > 0) {
+      next += std::size_t(n);
+      taken += std::size_t(n);
+    } else if (n == 0 || errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      // the datagram at next was refused (e.g. with an earlier one's ICMP
+      // port unreachable), so skip it
+      dropped(next++);
+    }
+  }
+  for (; next < messages.size(); ++next)
+    dropped(next);
+  return taken;
+}
+
+timespec to_timespec(std::chrono::nanoseconds t) {
+  const auto s = std::chrono::duration_cast<std::chrono::seconds>(t);
+  return {.tv_sec = s.count(), .tv_nsec = (t - s).count()};
+}
+
+} // namespace
+
+pong::fd_t::~fd_t() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+sockaddr_in pong::ipv4(std::uint32_t host, std::uint16_t port) {
+  sockaddr_in result{};
+  result.sin_family = AF_INET;
+  result.sin_addr.s_addr = htonl(host);
+  result.sin_port = htons(port);
+  return result;
+}
+
+bool pong::parse(std::string_view s, sockaddr_in &address) {
+  const auto colon = s.rfind(':');
+  if (colon == std::string_view::npos)
+    return false;
+
+  std::uint16_t port;
+  const auto digits = s.substr(colon + 1);
+  const auto [end, ec] =
+      std::from_chars(digits.data(), digits.data() + digits.size(), port);
+  if (ec != std::errc{} || end != digits.data() + digits.size())
+    return false;
+
+  address = ipv4(INADDR_ANY, port);
+  const std::string host{s.substr(0, colon)};
+  return host.empty() ||
+         ::inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+}
+
+pong::udp_socket_t::udp_socket_t(const sockaddr_in &address, bool reuse_port)
+    : fd_{::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)} {
+  if (!fd_)
+    fail("socket");
+
+  const int on = 1;
+  if (reuse_port &&
+      ::setsockopt(fd(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) != 0)
+    fail("setsockopt(SO_REUSEPORT)");
+
+  if (::bind(fd(), reinterpret_cast<const sockaddr *>(&address),
+             sizeof address) != 0)
+    fail("bind");
+}
+
+sockaddr_in pong::udp_socket_t::address() const {
+  sockaddr_in result{};
+  socklen_t size = sizeof result;
+  if (::getsockname(fd(), reinterpret_cast<sockaddr *>(&result), &size) != 0)
+    fail("getsockname");
+  return result;
+}
+
+void pong::udp_socket_t::buffers(int receive, int send) {
+  if (::setsockopt(fd(), SOL_SOCKET, SO_RCVBUF, &receive, sizeof receive) !=
+          0 ||
+      ::setsockopt(fd(), SOL_SOCKET, SO_SNDBUF, &send, sizeof send) != 0)
+    fail("setsockopt(SO_RCVBUF / SO_SNDBUF)");
+}
+
+pong::datagrams_t::datagrams_t(std::size_t capacity)
+    : buffer_(capacity * datagram_size), addresses_(capacity),
+      iovecs_(capacity), messages_(capacity) {}
+
+std::size_t pong::datagrams_t::receive(const udp_socket_t &socket) {
+  for (std::size_t i = 0; i < capacity(); ++i) {
+    iovecs_[i] = {slot(i), datagram_size};
+    messages_[i] = {};
+    messages_[i].msg_hdr.msg_name = &addresses_[i];
+    messages_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+    messages_[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const int n = ::recvmmsg(socket.fd(), messages_.data(),
+                           static_cast<unsigned>(capacity()), 0, nullptr);
+  size_ = n > 0 ? std::size_t(n) : 0;
+  return size_;
+}
+
+std::span<std::byte> pong::datagrams_t::prepare(const sockaddr_in &address) {
+  addresses_[size_] = address;
+  return {slot(size_), datagram_size};
+}
+
+void pong::datagrams_t::commit(std::size_t bytes) {
+  iovecs_[size_] = {slot(size_), bytes};
+  messages_[size_] = {};
+  messages_[size_].msg_hdr.msg_name = &addresses_[size_];
+  messages_[size_].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+  messages_[size_].msg_hdr.msg_iov = &iovecs_[size_];
+  messages_[size_].msg_hdr.msg_iovlen = 1;
+  ++size_;
+}
+
+std::size_t pong::datagrams_t::send(const udp_socket_t &socket) {
+  const auto taken = send_all(socket.fd(), {messages_.data(), size_},
+                              [](std::size_t) {});
+  size_ = 0;
+  return taken;
+}
+
+pong::fanout_t::fanout_t(std::size_t capacity)
+    : payloads_(capacity), addresses_(capacity), tags_(capacity),
+      iovecs_(capacity), messages_(capacity) {}
+
+void pong::fanout_t::queue(std::shared_ptr<const payload_t> payload,
+                           const sockaddr_in &address, std::uint64_t tag) {
+  // the payload's bytes themselves, not a copy
+  iovecs_[size_] = {const_cast<std::byte *>(payload->bytes.data()),
+                    payload->size};
+  payloads_[size_] = std::move(payload);
+  addresses_[size_] = address;
+  tags_[size_] = tag;
+  messages_[size_] = {};
+  messages_[size_].msg_hdr.msg_name = &addresses_[size_];
+  messages_[size_].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+  messages_[size_].msg_hdr.msg_iov = &iovecs_[size_];
+  messages_[size_].msg_hdr.msg_iovlen = 1;
+  ++size_;
+}
+
+std::size_t pong::fanout_t::send(const udp_socket_t &socket) {
+  dropped_.clear();
+  const auto taken =
+      send_all(socket.fd(), {messages_.data(), size_},
+               [this](std::size_t i) { dropped_.push_back(tags_[i]); });
+  // done with them
+  std::fill_n(payloads_.begin(), size_, nullptr);
+  size_ = 0;
+  return taken;
+}
+
+pong::epoll_t::epoll_t() : fd_{::epoll_create1(EPOLL_CLOEXEC)}, events_(64) {
+  if (!fd_)
+    fail("epoll_create1");
+}
+
+void pong::epoll_t::add(int fd, std::uint32_t events, std::uint64_t data) {
+  epoll_event event{};
+  event.events = events;
+  event.data.u64 = data;
+  if (::epoll_ctl(fd_.get(), EPOLL_CTL_ADD, fd, &event) != 0)
+    fail("epoll_ctl");
+}
+
+std::span<const epoll_event>
+pong::epoll_t::wait(std::chrono::milliseconds timeout) {
+  const int n = ::epoll_wait(fd_.get(), events_.data(), int(events_.size()),
+                             int(timeout.count()));
+  if (n < 0 && errno != EINTR)
+    fail("epoll_wait");
+  return {events_.data(), n > 0 ? std::size_t(n) : 0};
+}
+
+pong::ticker_t::ticker_t(clock_t::time_point first, clock_t::duration period)
+    : fd_{::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)} {
+  if (!fd_)
+    fail("timerfd_create");
+
+  // steady_clock is CLOCK_MONOTONIC with libstdc++ and libc++ on Linux; a
+  // zero first expiry would disarm the timer
+  const itimerspec spec{
+      .it_interval = to_timespec(period),
+      .it_value = to_timespec(std::max(first.time_since_epoch(),
+                                       clock_t::duration{1})),
+  };
+  if (::timerfd_settime(fd_.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+    fail("timerfd_settime");
+}
+
+std::uint64_t pong::ticker_t::expirations() {
+  std::uint64_t n = 0;
+  if (::read(fd_.get(), &n, sizeof n) != sizeof n)
+    return 0;
+  return n;
+}
+
+bool pong::pin_to_cpu(unsigned cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set) == 0;
+}
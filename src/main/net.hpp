@@ -0,0 +1,261 @@
+#ifndef PONG_NET_HPP
+#define PONG_NET_HPP
+
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pong {
+
+/**
+ * An owned file descriptor, closed on destruction.  The wrappers below throw
+ * std::system_error when setting up fails; once set up, their per datagram
+ * calls report what they managed instead, as a full or empty socket is
+ * normal for a non-blocking one.
+ */
+class fd_t {
+public:
+  fd_t() = default;
+
+  explicit fd_t(int fd) : fd_{fd} {}
+
+  fd_t(fd_t &&other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+
+  fd_t &operator=(fd_t &&other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+
+  ~fd_t();
+
+  [[nodiscard]] int get() const { return fd_; }
+
+  explicit operator bool() const { return fd_ >= 0; }
+
+private:
+  int fd_{-1};
+};
+
+/**
+ * an IPv4 address, e.g. loopback(7777)
+ */
+sockaddr_in ipv4(std::uint32_t host, std::uint16_t port);
+
+inline sockaddr_in loopback(std::uint16_t port = 0) {
+  return ipv4(INADDR_LOOPBACK, port);
+}
+
+/**
+ * parse "a.b.c.d:port" or ":port" (any address)
+ */
+bool parse(std::string_view, sockaddr_in &);
+
+inline bool operator==(const sockaddr_in &l, const sockaddr_in &r) {
+  return l.sin_addr.s_addr == r.sin_addr.s_addr && l.sin_port == r.sin_port;
+}
+
+/**
+ * A non-blocking UDP socket.  Sockets bound to the same address with
+ * reuse_port share its datagrams, which the kernel spreads over them by a
+ * hash of the sender's address, so that each may be served by its own loop.
+ */
+class udp_socket_t {
+public:
+  explicit udp_socket_t(const sockaddr_in &address = loopback(),
+                        bool reuse_port = false);
+
+  [[nodiscard]] int fd() const { return fd_.get(); }
+
+  /**
+   * the address bound, with the port the kernel chose for port 0
+   */
+  [[nodiscard]] sockaddr_in address() const;
+
+  /**
+   * the socket's receive and send buffer sizes, in bytes
+   */
+  void buffers(int receive, int send);
+
+private:
+  fd_t fd_;
+};
+
+/**
+ * Datagrams received with one recvmmsg, or queued to go with one sendmmsg
+ * (or as few as the socket takes), each in a slot of up to datagram_size
+ * bytes.
+ */
+class datagrams_t {
+public:
+  static constexpr std::size_t datagram_size = 1472;
+
+  explicit datagrams_t(std::size_t capacity);
+
+  datagrams_t(const datagrams_t &) = delete;
+
+  datagrams_t &operator=(const datagrams_t &) = delete;
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] std::size_t capacity() const { return messages_.size(); }
+  [[nodiscard]] bool full() const { return size_ == capacity(); }
+
+  [[nodiscard]] std::span<const std::byte> payload(std::size_t i) const {
+    return {slot(i), messages_[i].msg_len};
+  }
+
+  [[nodiscard]] const sockaddr_in &address(std::size_t i) const {
+    return addresses_[i];
+  }
+
+  /**
+   * replace the contents with whatever datagrams are waiting, up to
+   * capacity, returning how many there were
+   */
+  std::size_t receive(const udp_socket_t &);
+
+  /**
+   * the slot to write the next datagram to address into; commit() the
+   * bytes written to queue it
+   */
+  std::span<std::byte> prepare(const sockaddr_in &address);
+
+  void commit(std::size_t bytes);
+
+  /**
+   * send the queued datagrams and empty the queue, returning the number the
+   * socket took; those it had no room for are dropped, as UDP would anyway
+   */
+  std::size_t send(const udp_socket_t &);
+
+  void clear() { size_ = 0; }
+
+private:
+  [[nodiscard]] std::byte *slot(std::size_t i) {
+    return buffer_.data() + i * datagram_size;
+  }
+
+  [[nodiscard]] const std::byte *slot(std::size_t i) const {
+    return buffer_.data() + i * datagram_size;
+  }
+
+  std::vector<std::byte> buffer_;
+  std::vector<sockaddr_in> addresses_;
+  std::vector<iovec> iovecs_;
+  std::vector<mmsghdr> messages_;
+  std::size_t size_{};
+};
+
+/**
+ * A datagram's bytes, encoded once to be sent to any number of addresses.
+ */
+struct payload_t {
+  std::array<std::byte, datagrams_t::datagram_size> bytes;
+  std::size_t size{};
+
+  [[nodiscard]] std::span<const std::byte> data() const {
+    return {bytes.data(), size};
+  }
+};
+
+/**
+ * Datagrams queued to go with one sendmmsg, as datagrams_t's are, but each
+ * pointing at a payload_t shared with the others rather than a copy of its
+ * own, which each keeps alive until sent.  Each is tagged, to tell the
+ * sender which the socket had no room for.
+ */
+class fanout_t {
+public:
+  explicit fanout_t(std::size_t capacity);
+
+  fanout_t(const fanout_t &) = delete;
+
+  fanout_t &operator=(const fanout_t &) = delete;
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] std::size_t capacity() const { return messages_.size(); }
+  [[nodiscard]] bool full() const { return size_ == capacity(); }
+
+  void queue(std::shared_ptr<const payload_t>, const sockaddr_in &,
+             std::uint64_t tag);
+
+  /**
+   * send the queued datagrams and empty the queue, returning the number the
+   * socket took; the tags of those it had no room for, or refused, are
+   * dropped() until the next send
+   */
+  std::size_t send(const udp_socket_t &);
+
+  [[nodiscard]] std::span<const std::uint64_t> dropped() const {
+    return dropped_;
+  }
+
+private:
+  std::vector<std::shared_ptr<const payload_t>> payloads_;
+  std::vector<sockaddr_in> addresses_;
+  std::vector<std::uint64_t> tags_;
+  std::vector<iovec> iovecs_;
+  std::vector<mmsghdr> messages_;
+  std::vector<std::uint64_t> dropped_;
+  std::size_t size_{};
+};
+
+/**
+ * An epoll instance; the data registered with a descriptor is handed back
+ * with its events.
+ */
+class epoll_t {
+public:
+  epoll_t();
+
+  void add(int fd, std::uint32_t events, std::uint64_t data);
+
+  /**
+   * wait up to timeout for events, returning those that happened
+   */
+  std::span<const epoll_event> wait(std::chrono::milliseconds timeout);
+
+private:
+  fd_t fd_;
+  std::vector<epoll_event> events_;
+};
+
+/**
+ * A periodic timerfd on the monotonic clock (that of steady_clock), for
+ * fixed ticks.
+ */
+class ticker_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  ticker_t(clock_t::time_point first, clock_t::duration period);
+
+  [[nodiscard]] int fd() const { return fd_.get(); }
+
+  /**
+   * the number of periods that have elapsed since the last call, without
+   * blocking
+   */
+  std::uint64_t expirations();
+
+private:
+  fd_t fd_;
+};
+
+/**
+ * pin the calling thread to a CPU, returning false if that isn't allowed
+ */
+bool pin_to_cpu(unsigned cpu);
+
+} // namespace pong
+
+#endif // PONG_NET_HPP
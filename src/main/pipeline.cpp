@@ -0,0 +1,103 @@
+#include "pipeline.hpp"
+#include "trace.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// resize keeps an ImVector's capacity, where assignment frees and reallocates
+template <typename T> void copy(ImVector<T> &to, const ImVector<T> &from) {
+  to.resize(from.Size);
+  if (from.Size > 0)
+    std::memcpy(to.Data, from.Data, std::size_t(from.size_in_bytes()));
+}
+
+} // namespace
+
+void pong::draw_data_copy_t::assign(const ImDrawData &from) {
+  PONG_TRACE_SCOPE("draw_data_copy_t::assign");
+
+  while (lists_.size() < std::size_t(from.CmdListsCount))
+    lists_.push_back(std::make_unique<ImDrawList>(nullptr));
+
+  draw_data_.Valid = from.Valid;
+  draw_data_.CmdListsCount = from.CmdListsCount;
+  draw_data_.TotalVtxCount = from.TotalVtxCount;
+  draw_data_.TotalIdxCount = from.TotalIdxCount;
+  draw_data_.DisplayPos = from.DisplayPos;
+  draw_data_.DisplaySize = from.DisplaySize;
+  draw_data_.FramebufferScale = from.FramebufferScale;
+  draw_data_.OwnerViewport = nullptr;
+  draw_data_.CmdLists.resize(from.CmdListsCount);
+
+  for (int i = 0; i < from.CmdListsCount; ++i) {
+    const ImDrawList &source = *from.CmdLists[i];
+    ImDrawList &list = *lists_[std::size_t(i)];
+    copy(list.CmdBuffer, source.CmdBuffer);
+    copy(list.IdxBuffer, source.IdxBuffer);
+    copy(list.VtxBuffer, source.VtxBuffer);
+    list.Flags = source.Flags;
+    draw_data_.CmdLists[i] = &list;
+  }
+}
+
+pong::pipeline_t::pipeline_t(std::function<void()> attach,
+                             std::function<void(frame_t &)> render,
+                             std::function<void()> detach, profile_t *profile)
+    : attach_{std::move(attach)}, render_{std::move(render)},
+      detach_{std::move(detach)}, profile_{profile} {
+  for (std::size_t i = 0; i < frames_in_flight; ++i)
+    free_.push(int(i));
+
+  thread_ = std::jthread{[this]() {
+    PONG_TRACE_THREAD_NAME("render");
+
+    attach_();
+    for (;;) {
+      const auto [i, cancelled] = ended_.pop();
+      if (i < 0)
+        break;
+      if (cancelled) {
+        free_.push(i);
+        continue;
+      }
+
+      auto &frame = frames_[std::size_t(i)];
+      {
+        PONG_TRACE_SCOPE("render frame");
+        render_(frame);
+      }
+      if (profile_) {
+        profile_->record(metric_t::frame_latency,
+                         std::chrono::nanoseconds{clock_t::now() -
+                                                  frame.started}
+                             .count());
+      }
+      rendered_.fetch_add(1, std::memory_order_release);
+      free_.push(i);
+    }
+    detach_();
+  }};
+}
+
+pong::pipeline_t::~pipeline_t() {
+  ended_.push({.slot = -1, .cancelled = false});
+}
+
+pong::pipeline_t::frame_t &pong::pipeline_t::begin() {
+  PONG_TRACE_SCOPE("pipeline_t::begin");
+
+  auto &frame = frames_[std::size_t(free_.pop())];
+  frame.number = next_++;
+  frame.started = clock_t::now();
+  return frame;
+}
+
+void pong::pipeline_t::end(frame_t &frame) {
+  ended_.push({.slot = int(&frame - frames_.data()), .cancelled = false});
+}
+
+void pong::pipeline_t::cancel(frame_t &frame) {
+  ended_.push({.slot = int(&frame - frames_.data()), .cancelled = true});
+}
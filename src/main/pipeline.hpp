@@ -0,0 +1,139 @@
+#ifndef PONG_PIPELINE_HPP
+#define PONG_PIPELINE_HPP
+
+#include "concurrency.hpp"
+#include "profile.hpp"
+
+#include "imgui.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace pong {
+
+/**
+ * A deep copy of an ImDrawData and its draw lists, which stays valid while
+ * ImGui builds the next frame.  The lists' buffers are reused from copy to
+ * copy, so once they have grown to fit, copying doesn't allocate.
+ */
+class draw_data_copy_t {
+public:
+  draw_data_copy_t() = default;
+
+  draw_data_copy_t(const draw_data_copy_t &) = delete;
+
+  draw_data_copy_t &operator=(const draw_data_copy_t &) = delete;
+
+  void assign(const ImDrawData &);
+
+  [[nodiscard]] ImDrawData &get() { return draw_data_; }
+
+private:
+  std::vector<std::unique_ptr<ImDrawList>> lists_;
+  ImDrawData draw_data_;
+};
+
+/**
+ * Pipelined rendering: frames are built on the calling (main) thread and
+ * handed over, deep copied, to a render thread that submits them to the GPU
+ * and waits on the swap while the next frame is built.
+ *
+ * The latency budget is one frame: there are two frame slots, one being
+ * submitted and one being built, and begin() doesn't return (so the next
+ * frame's input isn't polled) until the frame before last has been submitted.
+ * A frame therefore reaches the screen at most one submission later than it
+ * would without the pipeline.
+ */
+class pipeline_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  static constexpr std::size_t frames_in_flight = 2;
+
+  struct frame_t {
+    std::uint64_t number{};
+    clock_t::time_point started;
+    int width{};
+    int height{};
+    // ImGui::GetFrameCount() of the frame the draw data was built in
+    int imgui_frame{};
+    draw_data_copy_t draw_data;
+  };
+
+  /**
+   * attach and detach run on the render thread, before the first frame and
+   * after the last (to make a GL context current there, say); render runs
+   * there for every frame, in order.  The time from begin() to the return of
+   * render is recorded as each frame's frame_latency.
+   */
+  pipeline_t(std::function<void()> attach, std::function<void(frame_t &)> render,
+             std::function<void()> detach, profile_t * = nullptr);
+
+  pipeline_t(const pipeline_t &) = delete;
+
+  pipeline_t &operator=(const pipeline_t &) = delete;
+
+  /**
+   * renders the frames already ended, then stops the render thread
+   */
+  ~pipeline_t();
+
+  /**
+   * wait for a free frame slot and start the next frame in it; call before
+   * polling input
+   */
+  frame_t &begin();
+
+  /**
+   * hand the frame, with its draw data and size filled in, to the render
+   * thread
+   */
+  void end(frame_t &);
+
+  /**
+   * give the frame's slot back without rendering it, by way of the render
+   * thread
+   */
+  void cancel(frame_t &);
+
+  /**
+   * the number of frames rendered so far
+   */
+  [[nodiscard]] std::uint64_t rendered() const {
+    return rendered_.load(std::memory_order_acquire);
+  }
+
+private:
+  std::function<void()> attach_;
+  std::function<void(frame_t &)> render_;
+  std::function<void()> detach_;
+  profile_t *profile_;
+
+  std::array<frame_t, frames_in_flight> frames_;
+  std::uint64_t next_{};
+  std::atomic<std::uint64_t> rendered_{};
+
+  // a frame slot handed to the render thread, to render or, if cancelled,
+  // only to free; slot -1 stops the render thread
+  struct ended_t {
+    int slot;
+    bool cancelled;
+  };
+
+  // the render thread is the only one to push free slots, as a pipe_t
+  // only has room for one producer
+  pipe_t<ended_t, frames_in_flight> ended_;
+  pipe_t<int, frames_in_flight> free_;
+
+  std::jthread thread_;
+};
+
+} // namespace pong
+
+#endif // PONG_PIPELINE_HPP
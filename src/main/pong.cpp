@@ -1,11 +1,26 @@
+#include "damage.hpp"
+#include "latency.hpp"
 #include "model.hpp"
+#include "pipeline.hpp"
+#include "profile.hpp"
+#include "simulation.hpp"
+#include "spectator.hpp"
+#include "trace.hpp"
+#include "ui.hpp"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <memory>
 #include <optional>
 #include <random>
+#include <string_view>
+#include <utility>
 
 #define GL_SILENCE_DEPRECATION
 #include <GLFW/glfw3.h> // Will drag system OpenGL headers
@@ -20,46 +35,106 @@ static void glfw_error_callback(int, const char *) {
 
 namespace {
 
-inline Eigen::Vector2f vec(ImVec2 v) { return {v.x, v.y}; }
+// The paddle is driven from raw GLFW callbacks rather than ImGui's per-frame
+// io state so that each input is timestamped and applied by the simulation at
+// the moment it happened.  These are installed before the ImGui backend, which
+// chains them from its own callbacks.
+
+// the input events since the last frame, as ImGui is handed them: the
+// callbacks below count every one, the paddle's or not
+int events = 0;
+
+void input(GLFWwindow *window, const pong::input_t &input) {
+  if (auto s = static_cast<pong::simulation_t *>(
+          glfwGetWindowUserPointer(window))) {
+    // the input's timestamp follows it to the screen
+    if (auto *latency = s->latency())
+      latency->received(input.time);
+    s->input(input);
+  }
+}
 
-inline ImVec2 vec(Eigen::Vector2f v) { return {v(0), v(1)}; }
+void scroll_callback(GLFWwindow *window, double, double yoffset) {
+  ++events;
+  const auto now = pong::simulation_t::clock_t::now();
+  input(window, {now, pong::input_t::kind_t::wheel, pong::scalar_t(yoffset)});
+}
 
-inline ImU32 col(Eigen::Matrix<std::uint8_t, 4, 1> v) {
-  return IM_COL32(v(0), v(1), v(2), v(3));
+void key_callback(GLFWwindow *window, int key, int, int action, int) {
+  ++events;
+  const auto now = pong::simulation_t::clock_t::now();
+  if (action == GLFW_REPEAT || (key != GLFW_KEY_W && key != GLFW_KEY_S))
+    return;
+  input(window, {now,
+                 key == GLFW_KEY_W ? pong::input_t::kind_t::up
+                                   : pong::input_t::kind_t::down,
+                 action == GLFW_PRESS ? 1.f : 0.f});
 }
 
-struct settings_t {
-  static constexpr int ai_skill_min = 5;
-  static constexpr int ai_skill_default = 70;
-  static constexpr int ai_skill_max = 95;
-  int ai_skill = ai_skill_default;
+void cursor_pos_callback(GLFWwindow *, double, double) { ++events; }
 
-  static constexpr float paddle_size_min = 20;
-  static constexpr float paddle_size_default = 40;
-  static constexpr float paddle_size_max = 60;
-  float paddle_size = paddle_size_default;
+void mouse_button_callback(GLFWwindow *, int, int, int) { ++events; }
 
-  static constexpr float mouse_wheel_sensitivity_min = 1;
-  static constexpr float mouse_wheel_sensitivity_default = 5;
-  static constexpr float mouse_wheel_sensitivity_max = 20;
-  float mouse_wheel_sensitivity = mouse_wheel_sensitivity_default;
+void char_callback(GLFWwindow *, unsigned int) { ++events; }
 
-  static constexpr int winning_score_min = 5;
-  static constexpr int winning_score_default = 10;
-  static constexpr int winning_score_max = 100;
-  int winning_score = winning_score_default;
+// set when the window system has lost the window's contents, which must then
+// be drawn again whether or not they changed
+bool exposed = false;
 
-  friend bool operator==(const settings_t &, const settings_t &) = default;
-};
+void refresh_callback(GLFWwindow *) { exposed = true; }
 
 std::tuple<pong::scalar_t, pong::vec_t> starter() {
     static auto starter = pong::make_starter(std::random_device{}());
     return starter();
 }
 
+// COLUMNSxROWS, e.g. 20x20
+std::optional<std::pair<int, int>> grid(std::string_view grid) {
+  int columns = 0, rows = 0;
+  const auto [x, ec1] =
+      std::from_chars(grid.data(), grid.data() + grid.size(), columns);
+  if (ec1 != std::errc{} || x == grid.data() + grid.size() || *x != 'x')
+    return {};
+  const auto [end, ec2] =
+      std::from_chars(x + 1, grid.data() + grid.size(), rows);
+  if (ec2 != std::errc{} || end != grid.data() + grid.size() || columns < 1 ||
+      rows < 1)
+    return {};
+
+  return std::pair{columns, rows};
+}
+
+struct options_t {
+  // --spectate COLUMNSxROWS shows a wall of AI vs AI matches instead of the
+  // game
+  std::optional<std::pair<int, int>> grid;
+  // --pipeline submits each frame from a render thread while the next is
+  // built (not in the browser, which has the one thread)
+  bool pipeline = false;
+  // --on-demand only draws frames that differ from the one on screen and,
+  // once nothing is moving, sleeps until there is input
+  bool on_demand = false;
+};
+
+options_t parse(int argc, char *argv[]) {
+  options_t options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg == "--spectate" && i + 1 < argc)
+      options.grid = grid(argv[++i]);
+    else if (arg == "--pipeline")
+      options.pipeline = true;
+    else if (arg == "--on-demand")
+      options.on_demand = true;
+  }
+  return options;
+}
+
 } // namespace
 
-int main(int, char **) {
+int main(int argc, char *argv[]) {
+  const auto options = parse(argc, argv);
+
   glfwSetErrorCallback(glfw_error_callback);
   if (!glfwInit())
     return 1;
@@ -85,25 +160,99 @@ int main(int, char **) {
 
   ImGui::StyleColorsDark();
 
+  glfwSetScrollCallback(window, scroll_callback);
+  glfwSetKeyCallback(window, key_callback);
+  glfwSetCursorPosCallback(window, cursor_pos_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
+  glfwSetCharCallback(window, char_callback);
+  glfwSetWindowRefreshCallback(window, refresh_callback);
+
+  // installs (and chains) the backend's callbacks
   ImGui_ImplGlfw_InitForOpenGL(window, true);
 #ifdef __EMSCRIPTEN__
   ImGui_ImplGlfw_InstallEmscriptenCallbacks(window, "#canvas");
-#else
-  ImGui_ImplGlfw_InstallCallbacks(window);
 #endif
   ImGui_ImplOpenGL3_Init(glsl_version);
 
   const ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-  settings_t settings;
-  bool in_play = true;
+  pong::simulation_t simulation{starter, std::random_device{}(),
+                                pong::rules(pong::settings_t{})};
+  glfwSetWindowUserPointer(window, &simulation);
+
+  // on the heap as it's too big for the browser's stack
+  const auto profile = std::make_unique<pong::profile_t>();
+  simulation.profile(profile.get());
+  pong::input_latency_t latency{profile.get()};
+  simulation.latency(&latency);
+
+  pong::ui_t ui{simulation, profile.get()};
+
+  std::optional<pong::spectator_t> spectator;
+  if (options.grid) {
+    spectator.emplace(options.grid->first, options.grid->second,
+                      std::random_device{}());
+  }
+
+  // GL submission and the swap, on this thread or the render thread
+  const auto present = [&](int width, int height, ImDrawData &draw_data,
+                           int imgui_frame) {
+    glViewport(0, 0, width, height);
+    glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w,
+                 clear_color.z * clear_color.w, clear_color.w);
+    glClear(GL_COLOR_BUFFER_BIT);
+    {
+      pong::scoped_timer_t timer{profile.get(),
+                                 pong::metric_t::render_draw_data};
+      ImGui_ImplOpenGL3_RenderDrawData(&draw_data);
+    }
+
+    {
+      PONG_TRACE_SCOPE("swap_buffers");
+      pong::scoped_timer_t timer{profile.get(), pong::metric_t::swap_wait};
+      glfwSwapBuffers(window);
+    }
+    // in the browser the swap is a no-op and the canvas is composited once
+    // the main loop returns, so this is as close to the screen as we can see
+    latency.presented(imgui_frame, pong::input_latency_t::clock_t::now());
+  };
+
+  std::unique_ptr<pong::pipeline_t> pipeline;
+#ifndef __EMSCRIPTEN__
+  if (options.pipeline) {
+    // the device objects are created while the context is current here; from
+    // then on it belongs to the render thread
+    ImGui_ImplOpenGL3_NewFrame();
+    glfwMakeContextCurrent(nullptr);
+    pipeline = std::make_unique<pong::pipeline_t>(
+        [window]() { glfwMakeContextCurrent(window); },
+        [&](pong::pipeline_t::frame_t &frame) {
+          present(frame.width, frame.height, frame.draw_data.get(),
+                  frame.imgui_frame);
+        },
+        []() { glfwMakeContextCurrent(nullptr); }, profile.get());
+  }
+#endif
+
+  PONG_TRACE_THREAD_NAME("main");
 
-  std::mt19937 prng{std::random_device{}()};
-  pong::arena_t arena{starter};
+  // on demand, frames are built as ever (ImGui needs them to handle input) but
+  // only those that differ from the one on screen are submitted.  The
+  // damage's extent isn't used: redrawing part of the frame would need the
+  // back buffer's age, which GLFW doesn't expose
+  pong::damage_t damage;
+  // how many more frames to poll for before waiting on input; some changes,
+  // like a widget's hover state, take ImGui a frame or two to show
+  constexpr int frames_to_settle = 3;
+  int settle = frames_to_settle;
 
-  std::optional<pong::ai_t> ai;
-  ai.emplace(prng(), (settings.paddle_size / 2.f + arena.puck().radius()) /
-                 pong::z_scores[settings.ai_skill]);
+  pong::cpu_meter_t cpu_meter{profile.get()};
+
+  // the simulation keeps time on its own thread, however janky the frames;
+  // the main loop only reads the latest state.  Without threads, as in the
+  // browser, the main loop advances the simulation itself
+  if (!spectator && pong::threads)
+    simulation.start();
 
 #ifdef __EMSCRIPTEN__
   EMSCRIPTEN_MAINLOOP_BEGIN
@@ -111,159 +260,108 @@ int main(int, char **) {
   while (!glfwWindowShouldClose(window))
 #endif
   {
-    glfwPollEvents();
+    PONG_TRACE_SCOPE("frame");
+
+    // pipelined, this waits until the frame before last has been submitted
+    const auto started = pong::pipeline_t::clock_t::now();
+    auto *frame = pipeline ? &pipeline->begin() : nullptr;
+
+    // the spectator's matches are always moving
+    const bool idle = !spectator && simulation.idle();
+    {
+      PONG_TRACE_SCOPE("poll_events");
+#ifndef __EMSCRIPTEN__
+      // the browser calls us back once per display refresh regardless.  The
+      // timeout gives anything ImGui times (a double click, key repeat) a
+      // frame now and then
+      if (options.on_demand && idle && settle == 0)
+        glfwWaitEventsTimeout(.5);
+      else
+#endif
+        glfwPollEvents();
+    }
+    cpu_meter.sample(pong::cpu_meter_t::clock_t::now(), !idle);
+
     if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0) {
+      if (frame)
+        pipeline->cancel(*frame);
       ImGui_ImplGlfw_Sleep(10);
       continue;
     }
 
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
-    auto viewport = ImGui::GetMainViewport();
-    ImGui::SetNextWindowPos(viewport->Pos);
-    ImGui::SetNextWindowSize(viewport->Size);
-
-    if (ImGui::Begin("PONG", nullptr,
-                     ImGuiWindowFlags_NoScrollbar |
-                         ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration)) {
-      settings_t new_settings = settings;
-      ImGui::SliderInt("AI skill", &new_settings.ai_skill,
-                       settings_t::ai_skill_min, settings_t::ai_skill_max);
-      ImGui::SliderFloat("Paddle size", &new_settings.paddle_size,
-                         settings_t::paddle_size_min,
-                         settings_t::paddle_size_max, "%.0f");
-      ImGui::SliderFloat("Mouse wheel sensitivity",
-                         &new_settings.mouse_wheel_sensitivity,
-                         settings_t::mouse_wheel_sensitivity_min,
-                         settings_t::mouse_wheel_sensitivity_max, "%.0f");
-      ImGui::SliderInt("Winning score", &new_settings.winning_score,
-                       settings_t::winning_score_min,
-                       settings_t::winning_score_max);
-
-      if (new_settings != std::exchange(settings, new_settings)) {
-        arena.lhs_paddle().box().min()(1) =
-            arena.centre()(1) - settings.paddle_size / 2.f;
-        arena.lhs_paddle().box().max()(1) =
-            arena.lhs_paddle().box().min()(1) + settings.paddle_size;
-        arena.rhs_paddle().box().min()(1) =
-            arena.centre()(1) - settings.paddle_size / 2.f;
-        arena.rhs_paddle().box().max()(1) =
-            arena.rhs_paddle().box().min()(1) + settings.paddle_size;
-        ai.emplace(prng(),
-                   (settings.paddle_size / 2.f + arena.puck().radius()) /
-                       pong::z_scores[settings.ai_skill]);
-      }
+    profile->record(pong::metric_t::events_per_frame, events);
+    if (std::exchange(events, 0) > 0)
+      settle = frames_to_settle;
 
-      if (ImGui::Button("Reset scores")) {
-        arena.lhs_score() = 0;
-        arena.rhs_score() = 0;
-      }
+    if (!spectator && !pong::threads)
+      simulation.advance_to(pong::simulation_t::clock_t::now());
 
-      if (ImGui::BeginChild("Arena", {640, 480})) {
-        const auto draw_list = ImGui::GetWindowDrawList();
-        const auto origin = vec(ImGui::GetCursorScreenPos());
-        constexpr auto solid_white = IM_COL32(255, 255, 255, 255);
-
-        if (const auto s = ai->paddle_speed(arena, arena.lhs_paddle())) {
-          arena.lhs_paddle().velocity()(1) = *s;
-        }
-
-        arena.rhs_paddle().velocity()(1) = ImGui::GetIO().MouseWheel *
-                                           settings.mouse_wheel_sensitivity /
-                                           ImGui::GetIO().DeltaTime;
-
-        if (in_play) {
-          arena.advance_time(ImGui::GetIO().DeltaTime);
-        }
-
-        in_play = arena.lhs_score() < std::uint32_t(settings.winning_score) &&
-                  arena.rhs_score() < std::uint32_t(settings.winning_score);
-
-        // arena outline
-        draw_list->AddRect(vec(origin + arena.box().min()),
-                           vec(origin + arena.box().max()), solid_white, 5.f,
-                           ImDrawFlags_RoundCornersAll);
-
-        // centre line
-        {
-          pong::vec_t p1{arena.box().min()(0) +
-                             (arena.box().max()(0) - arena.box().min()(0)) /
-                                 2.f,
-                         arena.box().min()(1)};
-          pong::vec_t p2{p1(0), arena.box().max()(1)};
-          draw_list->AddLine(vec(origin + p1), vec(origin + p2), solid_white);
-        }
-
-        // scores
-        if (in_play) {
-          auto lhs_score = std::to_string(arena.lhs_score());
-          auto rhs_score = std::to_string(arena.rhs_score());
-          auto lhs_width =
-              ImGui::CalcTextSize(&*lhs_score.begin(), &*lhs_score.end()).x;
-          auto rhs_width =
-              ImGui::CalcTextSize(&*rhs_score.begin(), &*rhs_score.end()).x;
-          auto arena_width = (arena.box().max() - arena.box().min())(0);
-          auto arena_height = (arena.box().max() - arena.box().min())(1);
-          auto lhs_x = origin(0) + arena.box().min()(0) + arena_width * .25f -
-                       lhs_width / 2.f;
-          auto rhs_x = origin(0) + arena.box().min()(0) + arena_width * .75f -
-                       rhs_width / 2.f;
-          auto y = origin(1) + arena.box().min()(1) + arena_height * .125f;
-          draw_list->AddText({lhs_x, y}, solid_white, &*lhs_score.begin(),
-                             &*lhs_score.end());
-          draw_list->AddText({rhs_x, y}, solid_white, &*rhs_score.begin(),
-                             &*rhs_score.end());
-          // puck
-          draw_list->AddCircleFilled(vec(origin + arena.puck().centre()),
-                                     arena.puck().radius(),
-                                     col(arena.puck().colour()));
-          // lhs paddle
-          draw_list->AddRectFilled(vec(origin + arena.lhs_paddle().box().min()),
-                                   vec(origin + arena.lhs_paddle().box().max()),
-                                   col(arena.lhs_paddle().colour()));
-
-          // rhs paddle
-          draw_list->AddRectFilled(vec(origin + arena.rhs_paddle().box().min()),
-                                   vec(origin + arena.rhs_paddle().box().max()),
-                                   col(arena.rhs_paddle().colour()));
-        } else {
-          const std::string s = "WINNER!";
-          const auto width = ImGui::CalcTextSize(&*s.begin(), &*s.end()).x;
-
-          auto arena_width = (arena.box().max() - arena.box().min())(0);
-          const auto x = arena.lhs_score() < arena.rhs_score()
-                             ? origin(0) + arena.box().min()(0) +
-                                   arena_width * .75f - width / 2.f
-                             : origin(0) + arena.box().min()(0) +
-                                   arena_width * .25f - width / 2.f;
-
-          auto arena_height = (arena.box().max() - arena.box().min())(1);
-          auto y = origin(1) + arena.box().min()(1) + arena_height * .125f;
-          draw_list->AddText({x, y}, solid_white, &*s.begin(), &*s.end());
-        }
+    std::optional<pong::scoped_timer_t> build_timer{
+        std::in_place, profile.get(), pong::metric_t::imgui_build};
+#ifdef PONG_TRACE
+    std::optional<pong::trace::span_t> build_span{std::in_place,
+                                                  "imgui_build"};
+#endif
 
+    if (!pipeline)
+      ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+    if (spectator)
+      spectator->frame(pong::simulation_t::clock_t::now());
+    else
+      ui.frame(pong::simulation_t::clock_t::now());
+    ImGui::Render();
+    build_timer.reset();
+#ifdef PONG_TRACE
+    build_span.reset();
+#endif
+
+    if (options.on_demand) {
+      if (std::exchange(exposed, false))
+        damage.invalidate();
+      if (pong::empty(damage.update(*ImGui::GetDrawData()))) {
+        if (frame)
+          pipeline->cancel(*frame);
+        settle = std::max(settle - 1, 0);
+        continue;
       }
-      ImGui::EndChild();
+      settle = frames_to_settle;
     }
-    ImGui::End();
 
-    ImGui::Render();
     int display_w, display_h;
     glfwGetFramebufferSize(window, &display_w, &display_h);
-    glViewport(0, 0, display_w, display_h);
-    glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w,
-                 clear_color.z * clear_color.w, clear_color.w);
-    glClear(GL_COLOR_BUFFER_BIT);
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-    glfwSwapBuffers(window);
+    if (frame) {
+      frame->width = display_w;
+      frame->height = display_h;
+      frame->imgui_frame = ImGui::GetFrameCount();
+      frame->draw_data.assign(*ImGui::GetDrawData());
+      pipeline->end(*frame);
+    } else {
+      present(display_w, display_h, *ImGui::GetDrawData(),
+              ImGui::GetFrameCount());
+      profile->record(pong::metric_t::frame_latency,
+                      std::chrono::nanoseconds{
+                          pong::pipeline_t::clock_t::now() - started}
+                          .count());
+    }
   }
 #ifdef __EMSCRIPTEN__
   EMSCRIPTEN_MAINLOOP_END;
 #endif
 
   // Cleanup
+#ifdef PONG_TRACE
+  {
+    std::ofstream os{"pong-trace.json"};
+    pong::trace::write(os);
+  }
+#endif
+  glfwSetWindowUserPointer(window, nullptr);
+  if (pipeline) {
+    pipeline.reset();
+    glfwMakeContextCurrent(window);
+  }
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
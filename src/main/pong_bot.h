@@ -0,0 +1,67 @@
+/*
+ * The C ABI of a bot plugin: a shared object that plays a paddle in place
+ * of the built-in AI (see bot.hpp).  A plugin exports pong_bot(), returning
+ * the table below; the runner calls create once per paddle it seats the bot
+ * at, then paddle_speed at the start of every tick of that paddle's match,
+ * until destroy.  Different instances may be called on different threads at
+ * once, but an instance only on one thread at a time.
+ *
+ * This header is C, so that a bot can be written in anything that speaks
+ * it.  Coordinates are in pixels, y down, speeds in pixels per second, as
+ * everywhere in the game; boxes are min x, min y, max x, max y.
+ */
+#ifndef PONG_BOT_H
+#define PONG_BOT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PONG_BOT_ABI_VERSION 1
+
+/* the name of the function a plugin exports */
+#define PONG_BOT_ENTRY "pong_bot"
+
+/* an arena as a bot sees it */
+struct pong_bot_state {
+  float arena[4];
+  float puck[2];
+  float puck_velocity[2];
+  float puck_radius;
+  float lhs_paddle[4];
+  float lhs_velocity;
+  float rhs_paddle[4];
+  float rhs_velocity;
+  uint32_t lhs_score;
+  uint32_t rhs_score;
+  /* the bot's own paddle: 0 for the lhs, 1 for the rhs */
+  uint32_t side;
+};
+
+struct pong_bot_api {
+  /* PONG_BOT_ABI_VERSION, as the plugin was built with */
+  uint32_t abi_version;
+  const char *name;
+
+  /* a bot for one paddle, or NULL if there can't be one */
+  void *(*create)(uint32_t seed);
+
+  void (*destroy)(void *bot);
+
+  /*
+   * the speed of the bot's paddle from this tick on: returns non-zero
+   * having set *speed, or zero to leave the paddle as it is
+   */
+  int (*paddle_speed)(void *bot, const struct pong_bot_state *state,
+                      float *speed);
+};
+
+const struct pong_bot_api *pong_bot(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PONG_BOT_H */
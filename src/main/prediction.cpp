@@ -0,0 +1,148 @@
+#include "prediction.hpp"
+
+#include <cmath>
+
+namespace {
+
+// whether sequence number a is after b, allowing for wrap around
+bool after(std::uint32_t a, std::uint32_t b) {
+  return std::int32_t(a - b) > 0;
+}
+
+// a restarted puck waits on the centre line for the server to send it off,
+// as only the server knows where it'll go
+std::tuple<pong::scalar_t, pong::vec_t> parked() {
+  return {240.f, {0.f, 0.f}};
+}
+
+// a correction too small to be worth taking up any longer
+constexpr pong::scalar_t negligible = 1e-2f;
+
+} // namespace
+
+pong::predictor_t::predictor_t(scalar_t tick_period)
+    : tick_period_{tick_period}, trajectory_{tick_period}, arena_{parked} {}
+
+void pong::predictor_t::apply(const event_t &e) { trajectory_.apply(e); }
+
+pong::correction_t pong::predictor_t::reconcile(std::uint64_t tick,
+                                                std::uint32_t acknowledged,
+                                                std::int32_t early) {
+  if (!trajectory_.complete())
+    return {};
+
+  if (after(acknowledged, acknowledged_)) {
+    auto applied = pending_.begin();
+    for (; applied != pending_.end() &&
+           !after(applied->command.sequence, acknowledged);
+         ++applied)
+      speed_ = applied->command.speed;
+    if (applied != pending_.begin() &&
+        (applied - 1)->command.sequence == acknowledged) {
+      // as early as it would have been, made as far ahead as now
+      const auto e =
+          scalar_t(std::int64_t(early) + shifted_ - (applied - 1)->shifted);
+      if (acknowledged_ == 0) {
+        early_ = e;
+      } else {
+        spread_ += (std::abs(e - early_) - spread_) / 8;
+        early_ += (e - early_) / 8;
+        // but a late one can't wait
+        early_ = std::min(early_, e);
+      }
+    }
+    pending_.erase(pending_.begin(), applied);
+    acknowledged_ = acknowledged;
+  }
+
+  // commands are to reach the server a little before their ticks, allowing
+  // for the jitter, but no sooner than need be; each shift moves the
+  // prediction a tick, so only by whole ticks off
+  const auto margin = std::max(1.f, std::ceil(2 * spread_));
+  if (const auto shift = std::int64_t(margin - early_);
+      acknowledged_ != 0 && shift != 0) {
+    tick_ = std::uint64_t(
+        std::max<std::int64_t>(0, std::int64_t(tick_) + shift));
+    early_ += scalar_t(shift);
+    shifted_ += shift;
+  }
+  tick_ = std::max(tick_, tick);
+
+  const auto puck = arena_.puck().centre();
+  const auto lhs = arena_.lhs_paddle().box().min()(1);
+  const auto rhs = arena_.rhs_paddle().box().min()(1);
+
+  trajectory_.restore(arena_, tick);
+  in_play_ = trajectory_.snapshot(tick).in_play;
+  for (auto t = tick + 1; t <= tick_; ++t)
+    step(t);
+
+  if (!ready_) {
+    ready_ = true;
+    return {};
+  }
+
+  const correction_t correction{
+      .puck = (arena_.puck().centre() - puck).norm(),
+      .own_paddle = std::abs(arena_.rhs_paddle().box().min()(1) - rhs),
+      .other_paddle = std::abs(arena_.lhs_paddle().box().min()(1) - lhs),
+  };
+
+  // shown where it was, to be taken up over the next few ticks
+  puck_error_ += puck - arena_.puck().centre();
+  lhs_error_ += lhs - arena_.lhs_paddle().box().min()(1);
+  rhs_error_ += rhs - arena_.rhs_paddle().box().min()(1);
+  if (puck_error_.norm() > jump)
+    puck_error_ = {0, 0};
+  if (std::abs(lhs_error_) > jump)
+    lhs_error_ = 0;
+  if (std::abs(rhs_error_) > jump)
+    rhs_error_ = 0;
+
+  return correction;
+}
+
+pong::predictor_t::command_t pong::predictor_t::command(scalar_t speed) {
+  pending_.push_back(
+      {.command = {.sequence = ++sequence_, .tick = tick_ + 1, .speed = speed},
+       .shifted = shifted_});
+  return pending_.back().command;
+}
+
+void pong::predictor_t::tick() {
+  if (!ready_)
+    return;
+  step(++tick_);
+
+  puck_error_ *= smoothing;
+  lhs_error_ *= smoothing;
+  rhs_error_ *= smoothing;
+  if (puck_error_.norm() < negligible)
+    puck_error_ = {0, 0};
+  if (std::abs(lhs_error_) < negligible)
+    lhs_error_ = 0;
+  if (std::abs(rhs_error_) < negligible)
+    rhs_error_ = 0;
+}
+
+pong::snapshot_t pong::predictor_t::snapshot() const {
+  auto s = pong::snapshot(arena_, tick_, in_play_);
+  s.puck[0] += puck_error_(0);
+  s.puck[1] += puck_error_(1);
+  s.lhs_paddle[1] += lhs_error_;
+  s.lhs_paddle[3] += lhs_error_;
+  s.rhs_paddle[1] += rhs_error_;
+  s.rhs_paddle[3] += rhs_error_;
+  return s;
+}
+
+void pong::predictor_t::step(std::uint64_t tick) {
+  // the latest command predicted to have reached the server by then
+  auto speed = speed_;
+  for (const auto &pending : pending_)
+    if (pending.command.tick <= tick)
+      speed = pending.command.speed;
+  arena_.rhs_paddle().velocity()(1) = speed;
+  if (in_play_)
+    arena_.advance_time(tick_period_);
+}
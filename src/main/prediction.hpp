@@ -0,0 +1,151 @@
+#ifndef PONG_PREDICTION_HPP
+#define PONG_PREDICTION_HPP
+
+#include "model.hpp"
+#include "simulation.hpp"
+#include "trajectory.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace pong {
+
+/**
+ * How far a reconciliation moved the predicted bodies, in pixels.
+ */
+struct correction_t {
+  scalar_t puck{};
+  // the player's own, rhs, paddle
+  scalar_t own_paddle{};
+  scalar_t other_paddle{};
+
+  [[nodiscard]] scalar_t max() const {
+    return std::max({puck, own_paddle, other_paddle});
+  }
+};
+
+/**
+ * A remote player's view of their match (sync_t::events), predicted ahead
+ * of what the server has sent so that their paddle answers their input at
+ * once rather than a round trip later.
+ *
+ * The prediction is an arena_t run on from the server's latest state: the
+ * player's commands steer the rhs paddle from the tick they're made, the
+ * AI's paddle keeps its last known speed and the puck bounces as it would.
+ * Whenever the server is heard from, the prediction is run again from its
+ * state with the commands it hadn't applied yet.  Each command is for the
+ * predicted tick it was made in, which the server holds it back for; the
+ * prediction keeps far enough ahead of the server for commands to reach it
+ * in time, going by how early the server says they came.  What the new
+ * prediction moved is taken up over a few ticks rather than all at once,
+ * unless it's a jump.
+ */
+class predictor_t {
+public:
+  // corrections larger than this are jumped to rather than smoothed
+  static constexpr scalar_t jump = 32;
+  // the fraction of a correction left after each tick
+  static constexpr scalar_t smoothing = .7f;
+
+  struct command_t {
+    std::uint32_t sequence;
+    // the tick it is predicted to apply from
+    std::uint64_t tick;
+    scalar_t speed;
+  };
+
+  explicit predictor_t(scalar_t tick_period);
+
+  predictor_t(const predictor_t &) = delete;
+
+  predictor_t &operator=(const predictor_t &) = delete;
+
+  /**
+   * take an event heard from the server into account; reconcile() once the
+   * events of a message are all applied
+   */
+  void apply(const event_t &);
+
+  /**
+   * predict again from the server's state at the end of tick, which has
+   * applied the player's commands up to acknowledged, the last of which
+   * came early ticks before its tick, returning how far the prediction
+   * moved
+   */
+  correction_t reconcile(std::uint64_t tick, std::uint32_t acknowledged,
+                         std::int32_t early);
+
+  /**
+   * the player's paddle speed from the next tick on, returning the command
+   * to send the server
+   */
+  command_t command(scalar_t speed);
+
+  /**
+   * predict one more tick
+   */
+  void tick();
+
+  /**
+   * whether the server has been heard from enough to predict anything
+   */
+  [[nodiscard]] bool ready() const { return ready_; }
+
+  /**
+   * the predicted tick, i.e. that the server will be at when a command made
+   * now reaches it
+   */
+  [[nodiscard]] std::uint64_t ticks() const { return tick_; }
+
+  /**
+   * the commands not yet acknowledged
+   */
+  [[nodiscard]] std::size_t pending() const { return pending_.size(); }
+
+  /**
+   * the prediction as it is to be shown, smoothed
+   */
+  [[nodiscard]] snapshot_t snapshot() const;
+
+  /**
+   * the prediction itself
+   */
+  [[nodiscard]] const arena_t &arena() const { return arena_; }
+
+private:
+  struct pending_t {
+    command_t command;
+    // how far the prediction had moved ahead when it was made
+    std::int64_t shifted;
+  };
+
+  // steer and advance the arena through one tick
+  void step(std::uint64_t tick);
+
+  scalar_t tick_period_;
+  trajectory_t trajectory_;
+  arena_t arena_;
+  bool ready_{};
+  bool in_play_{};
+  std::uint64_t tick_{};
+  std::uint32_t sequence_{};
+  std::uint32_t acknowledged_{};
+  // the speed the server has applied, and those it is yet to
+  scalar_t speed_{};
+  std::vector<pending_t> pending_;
+  // how many ticks before their ticks commands reach the server, on
+  // average, and give or take
+  scalar_t early_{};
+  scalar_t spread_{.5f};
+  // how far the prediction has moved ahead to keep them coming in time
+  std::int64_t shifted_{};
+  // what is yet to be taken up of the corrections so far
+  vec_t puck_error_{0, 0};
+  scalar_t lhs_error_{};
+  scalar_t rhs_error_{};
+};
+
+} // namespace pong
+
+#endif // PONG_PREDICTION_HPP
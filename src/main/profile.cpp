@@ -0,0 +1,124 @@
+#include "profile.hpp"
+
+#include <cmath>
+#include <ctime>
+#include <ostream>
+
+std::uint64_t pong::histogram_t::quantile(double q) const {
+  if (count_ == 0)
+    return 0;
+
+  const auto rank = std::max<std::uint64_t>(
+      1, std::uint64_t(std::ceil(q * double(count_))));
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank)
+      return highest(i);
+  }
+
+  return highest(counts_.size() - 1);
+}
+
+std::string_view pong::name(metric_t metric) {
+  switch (metric) {
+  case metric_t::advance_time:
+    return "advance_time";
+  case metric_t::ai:
+    return "ai";
+  case metric_t::imgui_build:
+    return "imgui_build";
+  case metric_t::render_draw_data:
+    return "render_draw_data";
+  case metric_t::swap_wait:
+    return "swap_wait";
+  case metric_t::events_per_frame:
+    return "events_per_frame";
+  case metric_t::frame_latency:
+    return "frame_latency";
+  case metric_t::cpu_in_play:
+    return "cpu_in_play";
+  case metric_t::cpu_idle:
+    return "cpu_idle";
+  case metric_t::input_apply:
+    return "input_apply";
+  case metric_t::input_advance:
+    return "input_advance";
+  case metric_t::input_draw:
+    return "input_draw";
+  case metric_t::input_present:
+    return "input_present";
+  case metric_t::input_latency:
+    return "input_latency";
+  case metric_t::count:
+    break;
+  }
+  return "unknown";
+}
+
+void pong::profile_t::record(metric_t metric, std::uint64_t value) {
+  auto &entry = entries_[std::size_t(metric)];
+  std::lock_guard lock{entry.mutex};
+  entry.histogram.record(value);
+}
+
+pong::profile_t::summary_t pong::profile_t::summary(metric_t metric) const {
+  const auto &entry = entries_[std::size_t(metric)];
+  std::lock_guard lock{entry.mutex};
+  const auto &h = entry.histogram.histogram();
+  return {h.quantile(.5), h.quantile(.99), h.max(), h.count()};
+}
+
+void pong::profile_t::write(std::ostream &os) const {
+  os << "metric,p50,p99,max,count\n";
+  for (std::size_t i = 0; i < entries_.size(); ++i) {
+    const auto s = summary(metric_t(i));
+    os << name(metric_t(i)) << ',' << s.p50 << ',' << s.p99 << ',' << s.max
+       << ',' << s.count << '\n';
+  }
+
+  os << "\nmetric,bucket_max,count\n";
+  for (std::size_t i = 0; i < entries_.size(); ++i) {
+    histogram_t h;
+    {
+      std::lock_guard lock{entries_[i].mutex};
+      h = entries_[i].histogram.histogram();
+    }
+    for (std::size_t j = 0; j < h.buckets().size(); ++j) {
+      if (h.buckets()[j] != 0) {
+        os << name(metric_t(i)) << ',' << histogram_t::highest(j) << ','
+           << h.buckets()[j] << '\n';
+      }
+    }
+  }
+}
+
+void pong::cpu_meter_t::sample(clock_t::time_point now,
+                               std::chrono::nanoseconds cpu, bool in_play) {
+  if (!started_ || in_play != in_play_) {
+    start_ = now;
+    start_cpu_ = cpu;
+    in_play_ = in_play;
+    started_ = true;
+    return;
+  }
+
+  const auto wall = now - start_;
+  if (wall < period_)
+    return;
+
+  if (profile_) {
+    profile_->record(in_play ? metric_t::cpu_in_play : metric_t::cpu_idle,
+                     std::uint64_t((cpu - start_cpu_).count() * 1000 /
+                                   std::chrono::nanoseconds{wall}.count()));
+  }
+  start_ = now;
+  start_cpu_ = cpu;
+}
+
+std::chrono::nanoseconds pong::cpu_meter_t::cpu_time() {
+  // std::clock is the process's CPU time, across all threads, on POSIX
+  return std::chrono::nanoseconds{std::int64_t(
+      double(std::clock()) * (1e9 / double(CLOCKS_PER_SEC)))};
+}
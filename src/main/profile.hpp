@@ -0,0 +1,246 @@
+#ifndef PONG_PROFILE_HPP
+#define PONG_PROFILE_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string_view>
+
+namespace pong {
+
+/**
+ * A log-linear (HDR style) histogram of non-negative integer samples.  Each
+ * power of two is split into sub_buckets linear buckets, so any recorded
+ * value is reported to within 1 / sub_buckets of itself.
+ */
+class histogram_t {
+public:
+  static constexpr unsigned sub_bucket_bits = 5;
+  static constexpr std::uint64_t sub_buckets = 1 << sub_bucket_bits;
+  static constexpr unsigned max_bits = 48;
+  static constexpr std::size_t bucket_count =
+      (max_bits - sub_bucket_bits + 1) * sub_buckets;
+
+  static std::size_t index(std::uint64_t value) {
+    value = std::min(value, (std::uint64_t{1} << max_bits) - 1);
+    if (value < sub_buckets)
+      return value;
+    const unsigned group = std::bit_width(value) - sub_bucket_bits;
+    return group * sub_buckets + ((value >> (group - 1)) - sub_buckets);
+  }
+
+  /**
+   * the largest value that maps to bucket i
+   */
+  static std::uint64_t highest(std::size_t i) {
+    if (i < sub_buckets)
+      return i;
+    const std::uint64_t group = i / sub_buckets;
+    const std::uint64_t lowest = (sub_buckets + i % sub_buckets) << (group - 1);
+    return lowest + (std::uint64_t{1} << (group - 1)) - 1;
+  }
+
+  void record(std::uint64_t value) {
+    ++counts_[index(value)];
+    ++count_;
+  }
+
+  void erase(std::uint64_t value) {
+    --counts_[index(value)];
+    --count_;
+  }
+
+  /**
+   * add other's samples to these
+   */
+  histogram_t &operator+=(const histogram_t &other) {
+    for (std::size_t i = 0; i < bucket_count; ++i)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    return *this;
+  }
+
+  /**
+   * take away other's samples, which must all be among these
+   */
+  histogram_t &operator-=(const histogram_t &other) {
+    for (std::size_t i = 0; i < bucket_count; ++i)
+      counts_[i] -= other.counts_[i];
+    count_ -= other.count_;
+    return *this;
+  }
+
+  [[nodiscard]] std::uint64_t count() const { return count_; }
+
+  /**
+   * the (bucket resolution) value below which fraction q of samples lie
+   */
+  [[nodiscard]] std::uint64_t quantile(double q) const;
+
+  [[nodiscard]] std::uint64_t max() const { return quantile(1.); }
+
+  [[nodiscard]] const std::array<std::uint32_t, bucket_count> &
+  buckets() const {
+    return counts_;
+  }
+
+private:
+  std::array<std::uint32_t, bucket_count> counts_{};
+  std::uint64_t count_{};
+};
+
+/**
+ * A histogram over the most recent window samples.
+ */
+class rolling_histogram_t {
+public:
+  static constexpr std::size_t window = 1024;
+
+  void record(std::uint64_t value) {
+    if (recent_count_ == window)
+      histogram_.erase(recent_[next_]);
+    else
+      ++recent_count_;
+    recent_[next_] = value;
+    next_ = (next_ + 1) % window;
+    histogram_.record(value);
+  }
+
+  [[nodiscard]] const histogram_t &histogram() const { return histogram_; }
+
+private:
+  histogram_t histogram_;
+  std::array<std::uint64_t, window> recent_{};
+  std::size_t recent_count_{};
+  std::size_t next_{};
+};
+
+/**
+ * The things we measure about a frame.  Timings are in nanoseconds, CPU use
+ * in per mille of one core.
+ */
+enum class metric_t : std::uint8_t {
+  advance_time,
+  ai,
+  imgui_build,
+  render_draw_data,
+  swap_wait,
+  events_per_frame,
+  frame_latency,
+  cpu_in_play,
+  cpu_idle,
+  // an input's time in each stage of input_latency_t, then end to end
+  input_apply,
+  input_advance,
+  input_draw,
+  input_present,
+  input_latency,
+  count,
+};
+
+std::string_view name(metric_t);
+
+/**
+ * A set of rolling histograms, one per metric, that may be recorded into
+ * from any thread.
+ */
+class profile_t {
+public:
+  struct summary_t {
+    std::uint64_t p50;
+    std::uint64_t p99;
+    std::uint64_t max;
+    std::uint64_t count;
+  };
+
+  void record(metric_t, std::uint64_t value);
+
+  [[nodiscard]] summary_t summary(metric_t) const;
+
+  /**
+   * write a summary and the non-empty buckets of every metric
+   */
+  void write(std::ostream &) const;
+
+private:
+  struct entry_t {
+    mutable std::mutex mutex;
+    rolling_histogram_t histogram;
+  };
+
+  std::array<entry_t, std::size_t(metric_t::count)> entries_;
+};
+
+/**
+ * Records the lifetime of the timer into a metric of a profile (if any).
+ */
+class scoped_timer_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  scoped_timer_t(profile_t *profile, metric_t metric)
+      : profile_{profile}, metric_{metric}, start_{clock_t::now()} {}
+
+  scoped_timer_t(const scoped_timer_t &) = delete;
+
+  scoped_timer_t &operator=(const scoped_timer_t &) = delete;
+
+  ~scoped_timer_t() {
+    if (profile_) {
+      profile_->record(metric_, std::chrono::nanoseconds{clock_t::now() - start_}
+                                    .count());
+    }
+  }
+
+private:
+  profile_t *profile_;
+  metric_t metric_;
+  clock_t::time_point start_;
+};
+
+/**
+ * Measures the CPU time the whole process uses against wall time, recording
+ * one sample per period into cpu_in_play or cpu_idle depending on whether a
+ * match was in play.  A period in which that changed is discarded.
+ */
+class cpu_meter_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  static constexpr clock_t::duration default_period = std::chrono::seconds{1};
+
+  explicit cpu_meter_t(profile_t *profile,
+                       clock_t::duration period = default_period)
+      : profile_{profile}, period_{period} {}
+
+  /**
+   * call once per frame (or wake up)
+   */
+  void sample(clock_t::time_point now, bool in_play) {
+    sample(now, cpu_time(), in_play);
+  }
+
+  void sample(clock_t::time_point now, std::chrono::nanoseconds cpu,
+              bool in_play);
+
+  /**
+   * the CPU time used by every thread of the process so far
+   */
+  static std::chrono::nanoseconds cpu_time();
+
+private:
+  profile_t *profile_;
+  clock_t::duration period_;
+  clock_t::time_point start_;
+  std::chrono::nanoseconds start_cpu_{};
+  bool in_play_{};
+  bool started_{};
+};
+
+} // namespace pong
+
+#endif // PONG_PROFILE_HPP
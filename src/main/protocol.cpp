@@ -0,0 +1,257 @@
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+namespace {
+
+namespace p = pong::protocol;
+
+// little endian, whatever the host
+class writer_t {
+public:
+  explicit writer_t(std::span<std::byte> out) : out_{out} {}
+
+  template <typename T> void operator()(const T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      (*this)(std::uint8_t(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+      static_assert(sizeof(T) == sizeof(std::uint32_t));
+      (*this)(std::bit_cast<std::uint32_t>(value));
+    } else if constexpr (std::is_enum_v<T>) {
+      (*this)(std::underlying_type_t<T>(value));
+    } else {
+      using unsigned_t = std::make_unsigned_t<T>;
+      const auto bits = unsigned_t(value);
+      for (std::size_t i = 0; i < sizeof(T); ++i)
+        out_[size_++] = std::byte(bits >> (8 * i));
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+private:
+  std::span<std::byte> out_;
+  std::size_t size_{};
+};
+
+class reader_t {
+public:
+  explicit reader_t(std::span<const std::byte> in) : in_{in} {}
+
+  template <typename T> void operator()(T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      std::uint8_t byte{};
+      (*this)(byte);
+      value = byte != 0;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      std::uint32_t bits{};
+      (*this)(bits);
+      value = std::bit_cast<T>(bits);
+    } else if constexpr (std::is_enum_v<T>) {
+      std::underlying_type_t<T> underlying{};
+      (*this)(underlying);
+      value = T(underlying);
+    } else {
+      if (size_ + sizeof(T) > in_.size()) {
+        ok_ = false;
+        return;
+      }
+      using unsigned_t = std::make_unsigned_t<T>;
+      unsigned_t bits = 0;
+      for (std::size_t i = 0; i < sizeof(T); ++i)
+        bits |= unsigned_t(unsigned_t(in_[size_++]) << (8 * i));
+      value = T(bits);
+    }
+  }
+
+  // every field was there, and nothing more
+  [[nodiscard]] bool done() const { return ok_ && size_ == in_.size(); }
+
+private:
+  std::span<const std::byte> in_;
+  std::size_t size_{};
+  bool ok_{true};
+};
+
+template <typename F> void fields(F &f, pong::snapshot_t &s) {
+  f(s.tick);
+  for (auto &v : s.puck)
+    f(v);
+  f(s.puck_radius);
+  for (auto &v : s.lhs_paddle)
+    f(v);
+  for (auto &v : s.rhs_paddle)
+    f(v);
+  f(s.lhs_score);
+  f(s.rhs_score);
+  f(s.in_play);
+}
+
+template <typename F> void fields(F &f, pong::event_t &e) {
+  f(e.body);
+  f(e.offset);
+  if (e.body == pong::body_t::scores) {
+    f(e.lhs_score);
+    f(e.rhs_score);
+    f(e.in_play);
+  } else {
+    for (auto &v : e.position)
+      f(v);
+    for (auto &v : e.velocity)
+      f(v);
+  }
+}
+
+template <typename F> void fields(F &f, p::join_t &m) {
+  f(m.nonce);
+  f(m.sync);
+}
+
+template <typename F> void fields(F &f, p::welcome_t &m) {
+  f(m.nonce);
+  f(m.match);
+  f(m.tick_period_us);
+  f(m.seed);
+}
+
+template <typename F> void fields(F &f, p::command_t &m) {
+  f(m.match);
+  f(m.sequence);
+  f(m.speed);
+  f(m.tick);
+}
+
+template <typename F> void fields(F &f, p::state_t &m) {
+  f(m.match);
+  f(m.acknowledged);
+  fields(f, m.snapshot);
+}
+
+template <typename F> void fields(F &f, p::leave_t &m) { f(m.match); }
+
+template <typename F> void fields(F &f, p::events_t &m) {
+  f(m.match);
+  f(m.acknowledged);
+  f(m.early);
+  f(m.tick);
+  f(m.count);
+  for (std::size_t i = 0; i < std::min<std::size_t>(m.count, p::max_events);
+       ++i) {
+    fields(f, m.events[i]);
+    m.events[i].tick = m.tick;
+  }
+}
+
+template <typename F> void fields(F &f, p::watch_t &m) {
+  f(m.match);
+  f(m.tick);
+}
+
+template <typename T> constexpr p::type_t type_of();
+template <> constexpr p::type_t type_of<p::join_t>() { return p::type_t::join; }
+template <> constexpr p::type_t type_of<p::welcome_t>() {
+  return p::type_t::welcome;
+}
+template <> constexpr p::type_t type_of<p::command_t>() {
+  return p::type_t::command;
+}
+template <> constexpr p::type_t type_of<p::state_t>() {
+  return p::type_t::state;
+}
+template <> constexpr p::type_t type_of<p::leave_t>() {
+  return p::type_t::leave;
+}
+template <> constexpr p::type_t type_of<p::events_t>() {
+  return p::type_t::events;
+}
+template <> constexpr p::type_t type_of<p::watch_t>() {
+  return p::type_t::watch;
+}
+
+template <typename T>
+std::size_t encode_message(T message, std::span<std::byte> out) {
+  writer_t writer{out};
+  writer(type_of<T>());
+  fields(writer, message);
+  return writer.size();
+}
+
+template <typename T>
+bool decode_message(std::span<const std::byte> in, T &message) {
+  if (p::peek(in) != type_of<T>())
+    return false;
+  reader_t reader{in.subspan(1)};
+  fields(reader, message);
+  return reader.done();
+}
+
+} // namespace
+
+std::optional<p::type_t> p::peek(std::span<const std::byte> in) {
+  if (in.empty())
+    return {};
+  const auto type = type_t(in[0]);
+  if (type < type_t::join || type > type_t::watch)
+    return {};
+  return type;
+}
+
+std::size_t p::encode(const join_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const welcome_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const command_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const state_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const leave_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const events_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+std::size_t p::encode(const watch_t &m, std::span<std::byte> out) {
+  return encode_message(m, out);
+}
+
+bool p::decode(std::span<const std::byte> in, join_t &m) {
+  return decode_message(in, m) && m.sync <= sync_t::events;
+}
+
+bool p::decode(std::span<const std::byte> in, welcome_t &m) {
+  return decode_message(in, m);
+}
+
+bool p::decode(std::span<const std::byte> in, command_t &m) {
+  return decode_message(in, m);
+}
+
+bool p::decode(std::span<const std::byte> in, state_t &m) {
+  return decode_message(in, m);
+}
+
+bool p::decode(std::span<const std::byte> in, leave_t &m) {
+  return decode_message(in, m);
+}
+
+bool p::decode(std::span<const std::byte> in, events_t &m) {
+  return decode_message(in, m) && m.count <= max_events &&
+         std::all_of(m.events.begin(), m.events.begin() + m.count,
+                     [](const event_t &e) { return e.body <= body_t::scores; });
+}
+
+bool p::decode(std::span<const std::byte> in, watch_t &m) {
+  return decode_message(in, m);
+}
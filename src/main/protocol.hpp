@@ -0,0 +1,164 @@
+#ifndef PONG_PROTOCOL_HPP
+#define PONG_PROTOCOL_HPP
+
+#include "geometry.hpp"
+#include "simulation.hpp"
+#include "trajectory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace pong::protocol {
+
+/**
+ * The datagrams between pong-server and its players.  Each is one message:
+ * a type byte then the message's fields, little endian and unpadded.
+ *
+ * A player joins with a nonce of their choosing and is welcomed into a new
+ * match, against the AI, with the id they then address it by.  They command
+ * the speed of the rhs paddle, each command numbered so that the server can
+ * acknowledge the latest it applied, and are sent the match's state every
+ * tick.  A command may be for a tick to come, as a player predicting their
+ * match (predictor_t) makes it, so that it takes effect when they predicted
+ * it would.  A match the server hasn't heard from for a while is ended.
+ *
+ * A player may instead join to be sent only the match's events: the changes
+ * to its bodies' otherwise straight line trajectories, timed to the tick,
+ * from which a trajectory_t reconstructs every state in between.  A keyframe
+ * of every body follows the join and then comes every second or so, to make
+ * up for lost datagrams.
+ *
+ * Anyone may watch a match, by its id, without playing: a spectator is sent
+ * its events as a player synced by events is, until they leave or stop
+ * sending the watch again every so often with the latest tick they have
+ * had.  A spectator who falls behind is sent nothing more until the next
+ * keyframe.
+ */
+enum class type_t : std::uint8_t {
+  join = 1,
+  welcome,
+  command,
+  state,
+  leave,
+  events,
+  watch,
+};
+
+/**
+ * what a player is sent of their match
+ */
+enum class sync_t : std::uint8_t {
+  states,
+  events,
+};
+
+struct join_t {
+  std::uint64_t nonce{};
+  sync_t sync{};
+
+  friend bool operator==(const join_t &, const join_t &) = default;
+};
+
+struct welcome_t {
+  std::uint64_t nonce{};
+  std::uint64_t match{};
+  std::uint32_t tick_period_us{};
+  std::uint32_t seed{};
+
+  friend bool operator==(const welcome_t &, const welcome_t &) = default;
+};
+
+/**
+ * the rhs paddle's speed, in pixels per second, from tick on or, if that has
+ * passed or is 0, from the next tick
+ */
+struct command_t {
+  std::uint64_t match{};
+  std::uint32_t sequence{};
+  scalar_t speed{};
+  std::uint64_t tick{};
+
+  friend bool operator==(const command_t &, const command_t &) = default;
+};
+
+struct state_t {
+  std::uint64_t match{};
+  // the sequence number of the latest command applied
+  std::uint32_t acknowledged{};
+  snapshot_t snapshot{};
+};
+
+/**
+ * the most events in one message; a tick with more is sent in several
+ */
+inline constexpr std::size_t max_events = 32;
+
+/**
+ * the events that happened during a tick, each of which has that tick
+ */
+struct events_t {
+  std::uint64_t match{};
+  // the sequence number of the latest command applied, and how many ticks
+  // before its tick it came (negative if late)
+  std::uint32_t acknowledged{};
+  std::int16_t early{};
+  std::uint64_t tick{};
+  std::uint8_t count{};
+  std::array<event_t, max_events> events{};
+};
+
+struct leave_t {
+  std::uint64_t match{};
+
+  friend bool operator==(const leave_t &, const leave_t &) = default;
+};
+
+/**
+ * watch a match, having had its events up to tick (0 for none yet)
+ */
+struct watch_t {
+  std::uint64_t match{};
+  std::uint64_t tick{};
+
+  friend bool operator==(const watch_t &, const watch_t &) = default;
+};
+
+/**
+ * the largest encoding of any message
+ */
+inline constexpr std::size_t max_size = 1024;
+
+/**
+ * the type of the message in a datagram, if it has one
+ */
+std::optional<type_t> peek(std::span<const std::byte>);
+
+/**
+ * encode a message into out, which must hold max_size bytes, returning the
+ * number of bytes written
+ */
+std::size_t encode(const join_t &, std::span<std::byte> out);
+std::size_t encode(const welcome_t &, std::span<std::byte> out);
+std::size_t encode(const command_t &, std::span<std::byte> out);
+std::size_t encode(const state_t &, std::span<std::byte> out);
+std::size_t encode(const leave_t &, std::span<std::byte> out);
+std::size_t encode(const events_t &, std::span<std::byte> out);
+std::size_t encode(const watch_t &, std::span<std::byte> out);
+
+/**
+ * decode a datagram, false unless it is exactly a message of that type
+ */
+bool decode(std::span<const std::byte>, join_t &);
+bool decode(std::span<const std::byte>, welcome_t &);
+bool decode(std::span<const std::byte>, command_t &);
+bool decode(std::span<const std::byte>, state_t &);
+bool decode(std::span<const std::byte>, leave_t &);
+bool decode(std::span<const std::byte>, events_t &);
+bool decode(std::span<const std::byte>, watch_t &);
+
+} // namespace pong::protocol
+
+#endif // PONG_PROTOCOL_HPP
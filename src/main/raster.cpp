@@ -0,0 +1,511 @@
+#include "raster.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+namespace {
+
+// four pixels of a row at a time; GCC / clang vector extensions compile to
+// SSE / NEON / WASM SIMD where available
+using f32x4 = float __attribute__((vector_size(16)));
+using i32x4 = std::int32_t __attribute__((vector_size(16)));
+using u32x4 = std::uint32_t __attribute__((vector_size(16)));
+// two pixels' channels, widened for blending
+using u8x8 = std::uint8_t __attribute__((vector_size(8)));
+using u16x8 = std::uint16_t __attribute__((vector_size(16)));
+
+constexpr f32x4 lane_centre = {.5f, 1.5f, 2.5f, 3.5f};
+constexpr i32x4 lane_index = {0, 1, 2, 3};
+
+inline bool any(i32x4 mask) {
+  return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
+
+inline f32x4 plane(const float (&p)[3], f32x4 x, float y) {
+  return p[0] * x + (p[1] * y + p[2]);
+}
+
+inline float channel(ImU32 c, int shift) { return float((c >> shift) & 255); }
+
+inline u32x4 channel(u32x4 pixels, int shift) {
+  return (pixels >> shift) & 255u;
+}
+
+inline u32x4 to_channel(f32x4 v) {
+  const i32x4 i = __builtin_convertvector(v + .5f, i32x4);
+  const i32x4 lo = i & (i > 0);
+  return u32x4((lo & (lo <= 255)) | (255 & (lo > 255)));
+}
+
+inline u16x8 widen(std::uint64_t pixels) {
+  u8x8 bytes;
+  std::memcpy(&bytes, &pixels, sizeof(bytes));
+  return __builtin_convertvector(bytes, u16x8);
+}
+
+inline std::uint64_t narrow(u16x8 channels) {
+  const u8x8 bytes = __builtin_convertvector(channels, u8x8);
+  std::uint64_t result;
+  std::memcpy(&result, &bytes, sizeof(result));
+  return result;
+}
+
+/**
+ * straight alpha blending of four pixels: src * a + dst * (1 - a) for the
+ * colours and a + dst * (1 - a) for alpha.  src is premultiplied (with 255 *
+ * a as its alpha), inverse is 255 - a, both per channel.  Nothing exceeds 16
+ * bits: src * a + dst * (255 - a) <= 255 * 255.
+ */
+inline u32x4 blend(u32x4 dst, const u16x8 (&src)[2], const u16x8 (&inverse)[2]) {
+  std::uint64_t half[2];
+  std::memcpy(half, &dst, sizeof(half));
+  for (int i = 0; i < 2; ++i) {
+    // (x + 128 + ((x + 128) >> 8)) >> 8 is x / 255, rounded
+    u16x8 x = widen(half[i]) * inverse[i] + src[i] + 128;
+    half[i] = narrow((x + (x >> 8)) >> 8);
+  }
+  u32x4 result;
+  std::memcpy(&result, half, sizeof(result));
+  return result;
+}
+
+} // namespace
+
+void pong::write_ppm(std::ostream &os, const framebuffer_t &framebuffer) {
+  os << "P6\n"
+     << framebuffer.width() << ' ' << framebuffer.height() << "\n255\n";
+
+  std::vector<char> row(std::size_t(framebuffer.width()) * 3);
+  for (int y = 0; y < framebuffer.height(); ++y) {
+    for (int x = 0; x < framebuffer.width(); ++x) {
+      const auto c = framebuffer.at(x, y);
+      row[std::size_t(x) * 3 + 0] = char(c & 255);
+      row[std::size_t(x) * 3 + 1] = char((c >> 8) & 255);
+      row[std::size_t(x) * 3 + 2] = char((c >> 16) & 255);
+    }
+    os.write(row.data(), std::streamsize(row.size()));
+  }
+}
+
+pong::rasterizer_t::rasterizer_t(unsigned threads) {
+  for (unsigned i = 1; i < threads; ++i) {
+    workers_.emplace_back([this]() { run(); });
+  }
+}
+
+pong::rasterizer_t::~rasterizer_t() {
+  stop_.store(true, std::memory_order_relaxed);
+  work_.fetch_add(std::uint64_t{1} << 32, std::memory_order_release);
+  work_.notify_all();
+}
+
+void pong::rasterizer_t::render(const ImDrawData &draw_data,
+                                framebuffer_t &framebuffer,
+                                ImU32 clear_colour) {
+  PONG_TRACE_SCOPE("rasterizer_t::render");
+
+  // close the last frame's generation before anything of this one is set
+  // up, so that a worker still in it (whose tiles are all claimed) can't
+  // take this frame's tile count for its own and claim one more
+  const auto generation = (work_.load(std::memory_order_relaxed) >> 32) + 1;
+  work_.store(generation << 32 | closed, std::memory_order_relaxed);
+
+  target_ = &framebuffer;
+  clear_colour_ = clear_colour;
+  offset_ = draw_data.DisplayPos;
+  scale_ = draw_data.FramebufferScale;
+
+  tiles_x_ = (framebuffer.width() + tile_size - 1) / tile_size;
+  tiles_y_ = (framebuffer.height() + tile_size - 1) / tile_size;
+  bins_.resize(std::size_t(tiles_x_ * tiles_y_));
+
+  bin(draw_data);
+
+  // hand the tiles out to the workers and join in; a worker that sees
+  // this count sees the generation closed too
+  const int tiles = tiles_x_ * tiles_y_;
+  tiles_.store(tiles, std::memory_order_release);
+  remaining_.store(tiles, std::memory_order_relaxed);
+  work_.store(generation << 32, std::memory_order_release);
+  work_.notify_all();
+
+  work(generation);
+
+  for (int r; (r = remaining_.load(std::memory_order_acquire)) != 0;) {
+    remaining_.wait(r, std::memory_order_acquire);
+  }
+}
+
+void pong::rasterizer_t::bin(const ImDrawData &draw_data) {
+  PONG_TRACE_SCOPE("rasterizer_t::bin");
+
+  triangles_.clear();
+  for (auto &b : bins_)
+    b.clear();
+
+  for (const ImDrawList *list : draw_data.CmdLists) {
+    const ImDrawVert *vertices = list->VtxBuffer.Data;
+    const ImDrawIdx *indices = list->IdxBuffer.Data;
+
+    for (const ImDrawCmd &cmd : list->CmdBuffer) {
+      if (cmd.UserCallback) {
+        if (cmd.UserCallback != ImDrawCallback_ResetRenderState)
+          cmd.UserCallback(list, &cmd);
+        continue;
+      }
+
+      const ImVec4 clip{(cmd.ClipRect.x - offset_.x) * scale_.x,
+                        (cmd.ClipRect.y - offset_.y) * scale_.y,
+                        (cmd.ClipRect.z - offset_.x) * scale_.x,
+                        (cmd.ClipRect.w - offset_.y) * scale_.y};
+      const auto *texture = pong::texture(cmd.GetTexID());
+
+      const ImDrawVert *v = vertices + cmd.VtxOffset;
+      const ImDrawIdx *i = indices + cmd.IdxOffset;
+      for (unsigned n = 0; n + 2 < cmd.ElemCount; n += 3) {
+        setup(v[i[n]], v[i[n + 1]], v[i[n + 2]], clip, texture);
+      }
+    }
+  }
+}
+
+void pong::rasterizer_t::setup(const ImDrawVert &v0, const ImDrawVert &v1,
+                               const ImDrawVert &v2, const ImVec4 &clip,
+                               const texture_t *texture) {
+  const ImDrawVert *v[3] = {&v0, &v1, &v2};
+  ImVec2 p[3];
+  for (int i = 0; i < 3; ++i) {
+    p[i] = {(v[i]->pos.x - offset_.x) * scale_.x,
+            (v[i]->pos.y - offset_.y) * scale_.y};
+  }
+
+  float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+               (p[1].y - p[0].y) * (p[2].x - p[0].x);
+  if (area == 0.f || !std::isfinite(area))
+    return;
+  if (area < 0.f) {
+    std::swap(p[1], p[2]);
+    std::swap(v[1], v[2]);
+    area = -area;
+  }
+
+  // scissor to the clip rect (as glScissor would) and the framebuffer
+  const auto [lo_x, hi_x] = std::minmax({p[0].x, p[1].x, p[2].x});
+  const auto [lo_y, hi_y] = std::minmax({p[0].y, p[1].y, p[2].y});
+  const int min_x = std::max({0, int(clip.x), int(std::floor(lo_x))});
+  const int min_y = std::max({0, int(clip.y), int(std::floor(lo_y))});
+  const int max_x =
+      std::min({target_->width(), int(clip.z), int(std::ceil(hi_x))}) - 1;
+  const int max_y =
+      std::min({target_->height(), int(clip.w), int(std::ceil(hi_y))}) - 1;
+  if (min_x > max_x || min_y > max_y)
+    return;
+
+  triangle_t t;
+  t.min_x = min_x;
+  t.min_y = min_y;
+  t.max_x = max_x;
+  t.max_y = max_y;
+
+  // edge i is opposite vertex i, so edge i / area is the barycentric
+  // weight of vertex i
+  for (int i = 0; i < 3; ++i) {
+    const auto &a = p[(i + 1) % 3];
+    const auto &b = p[(i + 2) % 3];
+    const float ea = a.y - b.y;
+    const float eb = b.x - a.x;
+    t.edge[i][0] = ea;
+    t.edge[i][1] = eb;
+    t.edge[i][2] = -(ea * a.x + eb * a.y);
+    // inside is to the right of a left edge, below a top edge
+    t.top_left[i] = ea > 0.f || (ea == 0.f && eb > 0.f);
+    // the pixel (centre) x at which the edge crosses row y
+    if (ea != 0.f) {
+      t.span[i][0] = -eb / ea;
+      t.span[i][1] = -t.edge[i][2] / ea - .5f;
+    }
+  }
+
+  auto make_plane = [&](float (&out)[3], float a0, float a1, float a2) {
+    for (int k = 0; k < 3; ++k) {
+      out[k] = (a0 * t.edge[0][k] + a1 * t.edge[1][k] + a2 * t.edge[2][k]) /
+               area;
+    }
+  };
+
+  const bool same_uv = v[0]->uv.x == v[1]->uv.x && v[0]->uv.x == v[2]->uv.x &&
+                       v[0]->uv.y == v[1]->uv.y && v[0]->uv.y == v[2]->uv.y;
+
+  // a texture sampled at a single point is folded into the vertex colours
+  ImU32 texel = IM_COL32_WHITE;
+  t.texture = nullptr;
+  if (texture && same_uv) {
+    const int x = std::clamp(int(v[0]->uv.x * float(texture->width)), 0,
+                             texture->width - 1);
+    const int y = std::clamp(int(v[0]->uv.y * float(texture->height)), 0,
+                             texture->height - 1);
+    texel = texture->pixels[std::size_t(y) * std::size_t(texture->width) +
+                            std::size_t(x)];
+  } else if (texture) {
+    t.texture = texture;
+    make_plane(t.uv[0], v[0]->uv.x * float(texture->width),
+               v[1]->uv.x * float(texture->width),
+               v[2]->uv.x * float(texture->width));
+    make_plane(t.uv[1], v[0]->uv.y * float(texture->height),
+               v[1]->uv.y * float(texture->height),
+               v[2]->uv.y * float(texture->height));
+  }
+
+  t.flat = !t.texture && v[0]->col == v[1]->col && v[0]->col == v[2]->col;
+  if (t.flat) {
+    t.flat_colour = 0;
+    for (int c = 0; c < 4; ++c) {
+      t.flat_colour |= ImU32(channel(v[0]->col, c * 8) *
+                                 channel(texel, c * 8) / 255.f +
+                             .5f)
+                       << (c * 8);
+    }
+    // invisible
+    if ((t.flat_colour >> 24) == 0)
+      return;
+  } else {
+    for (int c = 0; c < 4; ++c) {
+      const float k = channel(texel, c * 8) / 255.f;
+      make_plane(t.colour[c], channel(v[0]->col, c * 8) * k,
+                 channel(v[1]->col, c * 8) * k, channel(v[2]->col, c * 8) * k);
+    }
+  }
+
+  const auto index = std::uint32_t(triangles_.size());
+  triangles_.push_back(t);
+
+  for (int ty = min_y / tile_size; ty <= max_y / tile_size; ++ty) {
+    for (int tx = min_x / tile_size; tx <= max_x / tile_size; ++tx) {
+      bins_[std::size_t(ty * tiles_x_ + tx)].push_back(index);
+    }
+  }
+}
+
+void pong::rasterizer_t::run() {
+  std::uint64_t done = 0;
+  for (;;) {
+    const auto w = work_.load(std::memory_order_acquire);
+    if (stop_.load(std::memory_order_relaxed))
+      return;
+    if ((w >> 32) == done || std::uint32_t(w) == closed) {
+      work_.wait(w, std::memory_order_acquire);
+      continue;
+    }
+    done = w >> 32;
+    work(done);
+  }
+}
+
+void pong::rasterizer_t::work(std::uint64_t generation) {
+  for (;;) {
+    auto w = work_.load(std::memory_order_acquire);
+    do {
+      const auto tiles = std::uint32_t(tiles_.load(std::memory_order_acquire));
+      if ((w >> 32) != generation || std::uint32_t(w) >= tiles)
+        return;
+    } while (!work_.compare_exchange_weak(w, w + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire));
+
+    shade(int(std::uint32_t(w)));
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      remaining_.notify_all();
+  }
+}
+
+void pong::rasterizer_t::shade(int tile) {
+  auto &fb = *target_;
+  const int x0 = (tile % tiles_x_) * tile_size;
+  const int y0 = (tile / tiles_x_) * tile_size;
+  const int x1 = std::min(x0 + tile_size, fb.width());
+  const int y1 = std::min(y0 + tile_size, fb.height());
+
+  for (int y = y0; y < y1; ++y) {
+    std::fill(&fb.at(x0, y), &fb.at(x0, y) + (x1 - x0), clear_colour_);
+  }
+
+  for (const auto index : bins_[std::size_t(tile)]) {
+    const triangle_t &t = triangles_[index];
+
+    const int ty0 = std::max(y0, t.min_y);
+    const int ty1 = std::min(y1 - 1, t.max_y);
+    const int tx0 = std::max(x0, t.min_x);
+    const int tx1 = std::min(x1 - 1, t.max_x);
+
+    // two pixels' worth of the premultiplied flat colour
+    u16x8 flat_src[2]{}, flat_inverse[2]{};
+    const auto flat_alpha = t.flat_colour >> 24;
+    const bool opaque = t.flat && flat_alpha == 255;
+    if (t.flat) {
+      const auto src = widen(std::uint64_t(t.flat_colour | 0xff000000u) *
+                             0x100000001u);
+      flat_src[0] = flat_src[1] = src * std::uint16_t(flat_alpha);
+      flat_inverse[0] = flat_inverse[1] =
+          u16x8{} + std::uint16_t(255 - flat_alpha);
+    }
+
+    // shade n (<= 4) pixels from row[x] that are in the mask
+    auto shade4 = [&](ImU32 *row, int x, float py, i32x4 mask, int n) {
+      const u16x8(&src)[2] = flat_src;
+      const u16x8(&inverse)[2] = flat_inverse;
+      u16x8 varying_src[2], varying_inverse[2];
+
+      if (!t.flat) {
+        const f32x4 px = float(x) + lane_centre;
+        f32x4 s[4];
+        for (int c = 0; c < 4; ++c)
+          s[c] = plane(t.colour[c], px, py);
+
+        if (t.texture) {
+          const f32x4 u = plane(t.uv[0], px, py);
+          const f32x4 v = plane(t.uv[1], px, py);
+          u32x4 texels;
+          for (int l = 0; l < 4; ++l) {
+            const int tx = std::clamp(int(u[l]), 0, t.texture->width - 1);
+            const int ty = std::clamp(int(v[l]), 0, t.texture->height - 1);
+            texels[l] = t.texture->pixels[std::size_t(ty) *
+                                              std::size_t(t.texture->width) +
+                                          std::size_t(tx)];
+          }
+          for (int c = 0; c < 4; ++c) {
+            s[c] *= __builtin_convertvector(channel(texels, c * 8), f32x4) *
+                    (1.f / 255.f);
+          }
+        }
+
+        const u32x4 a = to_channel(s[3]);
+        const u32x4 colour = to_channel(s[0]) | to_channel(s[1]) << 8 |
+                             to_channel(s[2]) << 16 | 0xff000000u;
+        const u32x4 alpha = a * 0x01010101u;
+        std::uint64_t c[2], al[2];
+        std::memcpy(c, &colour, sizeof(c));
+        std::memcpy(al, &alpha, sizeof(al));
+        for (int i = 0; i < 2; ++i) {
+          const u16x8 wa = widen(al[i]);
+          varying_src[i] = widen(c[i]) * wa;
+          varying_inverse[i] = 255 - wa;
+        }
+      }
+
+      u32x4 d{};
+      if (n == 4)
+        std::memcpy(&d, row + x, sizeof(d));
+      else
+        for (int l = 0; l < n; ++l)
+          d[l] = row[x + l];
+
+      const u32x4 m = u32x4(mask);
+      const u32x4 out = opaque   ? u32x4{} + t.flat_colour
+                        : t.flat ? blend(d, src, inverse)
+                                 : blend(d, varying_src, varying_inverse);
+      d = (out & m) | (d & ~m);
+
+      if (n == 4)
+        std::memcpy(row + x, &d, sizeof(d));
+      else
+        for (int l = 0; l < n; ++l)
+          row[x + l] = d[l];
+    };
+
+    // shade the pixels in [x, end) that pass the edge tests
+    auto shade_edges = [&](ImU32 *row, int x, int end, float py) {
+      for (; x < end; x += 4) {
+        const int n = std::min(4, end - x);
+        const f32x4 px = float(x) + lane_centre;
+        i32x4 mask = lane_index < n;
+        for (int i = 0; i < 3; ++i) {
+          const f32x4 e = plane(t.edge[i], px, py);
+          mask &= t.top_left[i] ? i32x4(e >= 0.f) : i32x4(e > 0.f);
+        }
+        if (any(mask))
+          shade4(row, x, py, mask, n);
+      }
+    };
+
+    // shade every pixel in [x, end)
+    auto shade_span = [&](ImU32 *row, int x, int end, float py) {
+      if (opaque) {
+        std::fill(row + x, row + end, t.flat_colour);
+        return;
+      }
+      if (t.flat) {
+        for (; x + 4 <= end; x += 4) {
+          u32x4 d;
+          std::memcpy(&d, row + x, sizeof(d));
+          d = blend(d, flat_src, flat_inverse);
+          std::memcpy(row + x, &d, sizeof(d));
+        }
+      } else {
+        for (; x + 4 <= end; x += 4)
+          shade4(row, x, py, i32x4{} - 1, 4);
+      }
+      if (x < end)
+        shade4(row, x, py, lane_index < end - x, end - x);
+    };
+
+    // a triangle covering the whole of its part of the tile needs no edge
+    // tests (it's convex, so it's enough that the corners are inside)
+    bool covers = true;
+    for (const auto &e : t.edge) {
+      for (const float y : {float(ty0) + .5f, float(ty1) + .5f}) {
+        for (const float x : {float(tx0) + .5f, float(tx1) + .5f}) {
+          covers &= e[0] * x + e[1] * y + e[2] > 0.f;
+        }
+      }
+    }
+    if (covers) {
+      for (int y = ty0; y <= ty1; ++y) {
+        shade_span(&fb.at(0, y), tx0, tx1 + 1, float(y) + .5f);
+      }
+      continue;
+    }
+
+    for (int y = ty0; y <= ty1; ++y) {
+      const float py = float(y) + .5f;
+
+      // the row's span between the edges; pixels more than one away from its
+      // ends are certainly inside, those near them get the exact edge tests
+      float left = float(tx0);
+      float right = float(tx1);
+      bool on_edge = false;
+      for (int i = 0; i < 3; ++i) {
+        const auto &e = t.edge[i];
+        if (e[0] > 0.f) {
+          left = std::max(left, t.span[i][0] * py + t.span[i][1]);
+        } else if (e[0] < 0.f) {
+          right = std::min(right, t.span[i][0] * py + t.span[i][1]);
+        } else {
+          const float r = e[1] * py + e[2];
+          if (r < 0.f)
+            right = left - 2.f;
+          on_edge |= r == 0.f;
+        }
+      }
+
+      const int lo = std::max(tx0, int(std::floor(left)));
+      const int end = std::min(tx1, int(std::ceil(right))) + 1;
+      if (lo >= end)
+        continue;
+
+      int inner_lo = end;
+      int inner_end = end;
+      if (!on_edge) {
+        inner_lo = std::clamp(int(std::ceil(left)) + 1, lo, end);
+        inner_end = std::clamp(int(std::floor(right)), inner_lo, end);
+      }
+
+      ImU32 *row = &fb.at(0, y);
+      shade_edges(row, lo, inner_lo, py);
+      shade_span(row, inner_lo, inner_end, py);
+      shade_edges(row, inner_end, end, py);
+    }
+  }
+}
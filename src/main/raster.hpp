@@ -0,0 +1,154 @@
+#ifndef PONG_RASTER_HPP
+#define PONG_RASTER_HPP
+
+#include "imgui.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <thread>
+#include <vector>
+
+namespace pong {
+
+/**
+ * An in-memory RGBA framebuffer.  Pixels are packed as ImU32 (IM_COL32), so
+ * on a little endian machine the bytes are in R, G, B, A order.
+ */
+class framebuffer_t {
+public:
+  framebuffer_t(int width, int height)
+      : width_{width}, height_{height},
+        pixels_(std::size_t(width) * std::size_t(height)) {}
+
+  [[nodiscard]] int width() const { return width_; }
+  [[nodiscard]] int height() const { return height_; }
+
+  [[nodiscard]] ImU32 *data() { return pixels_.data(); }
+  [[nodiscard]] const ImU32 *data() const { return pixels_.data(); }
+
+  [[nodiscard]] ImU32 &at(int x, int y) {
+    return pixels_[std::size_t(y) * std::size_t(width_) + std::size_t(x)];
+  }
+
+  [[nodiscard]] ImU32 at(int x, int y) const {
+    return pixels_[std::size_t(y) * std::size_t(width_) + std::size_t(x)];
+  }
+
+private:
+  int width_;
+  int height_;
+  std::vector<ImU32> pixels_;
+};
+
+/**
+ * write a framebuffer as a binary (P6) PPM, dropping alpha
+ */
+void write_ppm(std::ostream &, const framebuffer_t &);
+
+/**
+ * An RGBA texture the rasterizer can sample.  ImTextureIDs given to ImGui
+ * for software rendering are the addresses of these, see texture_id.
+ */
+struct texture_t {
+  const ImU32 *pixels;
+  int width;
+  int height;
+};
+
+static_assert(sizeof(ImTextureID) >= sizeof(std::uintptr_t),
+              "an ImTextureID must be able to hold a texture_t's address");
+
+/**
+ * texture's address as an ImTextureID, which is a void * before ImGui
+ * 1.91.4 and an ImU64 from it on (or whatever imconfig.h makes it); the
+ * cast is a reinterpret_cast for the one and a conversion for the other
+ */
+inline ImTextureID texture_id(const texture_t &texture) {
+  return (ImTextureID)reinterpret_cast<std::uintptr_t>(&texture);
+}
+
+/**
+ * the texture_t whose texture_id id is
+ */
+inline const texture_t *texture(ImTextureID id) {
+  return reinterpret_cast<const texture_t *>((std::uintptr_t)id);
+}
+
+/**
+ * Renders ImDrawData into a framebuffer on the CPU, with the same results as
+ * the OpenGL backend: gouraud shaded triangles, nearest texture sampling,
+ * straight alpha blending and scissoring to each command's clip rect.
+ *
+ * Triangles are binned into square tiles which are shaded in parallel by a
+ * pool of threads (the calling thread being one of them), four pixels at a
+ * time.  Each tile draws its triangles in submission order, so the result
+ * doesn't depend on the number of threads.
+ */
+class rasterizer_t {
+public:
+  static constexpr int tile_size = 64;
+
+  explicit rasterizer_t(unsigned threads = std::thread::hardware_concurrency());
+
+  rasterizer_t(const rasterizer_t &) = delete;
+
+  rasterizer_t &operator=(const rasterizer_t &) = delete;
+
+  ~rasterizer_t();
+
+  /**
+   * clear the framebuffer to clear_colour then draw the draw data into it
+   */
+  void render(const ImDrawData &, framebuffer_t &, ImU32 clear_colour);
+
+  [[nodiscard]] unsigned threads() const { return unsigned(workers_.size()) + 1; }
+
+private:
+  // a triangle set up for shading: edge functions and attribute planes in
+  // pixel coordinates, its scissored bounds and how it is to be shaded
+  struct triangle_t {
+    float edge[3][3]; // a * x + b * y + c, >= 0 inside
+    float span[3][2]; // where edge i crosses a row: x = m * y + k
+    bool top_left[3];
+    float colour[4][3]; // r, g, b, a planes, 0 - 255
+    float uv[2][3];     // texel planes
+    int min_x, min_y, max_x, max_y; // inclusive
+    const texture_t *texture;
+    bool flat; // constant colour and untextured
+    ImU32 flat_colour;
+  };
+
+  void bin(const ImDrawData &);
+  void setup(const ImDrawVert &, const ImDrawVert &, const ImDrawVert &,
+             const ImVec4 &clip, const texture_t *);
+  void work(std::uint64_t generation);
+  void shade(int tile);
+  void run();
+
+  std::vector<triangle_t> triangles_;
+  std::vector<std::vector<std::uint32_t>> bins_;
+  int tiles_x_{};
+  int tiles_y_{};
+
+  // the frame being rendered
+  framebuffer_t *target_{};
+  ImU32 clear_colour_{};
+  ImVec2 offset_{};
+  ImVec2 scale_{};
+
+  // the generation (frame number) << 32 | the next tile to be shaded, or
+  // closed while the frame is set up; tiles are claimed by compare and swap
+  // so that a worker that is late to a frame can't claim a tile of the next
+  // one
+  static constexpr std::uint32_t closed = 0xffffffff;
+  std::atomic<std::uint64_t> work_{};
+  std::atomic<int> tiles_{};
+  std::atomic<int> remaining_{};
+  std::atomic<bool> stop_{};
+  std::vector<std::jthread> workers_;
+};
+
+} // namespace pong
+
+#endif // PONG_RASTER_HPP
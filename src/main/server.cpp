@@ -0,0 +1,165 @@
+/**
+ * pong-server : hosts matches against the AI for remote players, who send
+ * their paddle's speed over UDP and are sent their match's state every tick
+ * (see protocol.hpp), and for anyone watching.
+ *
+ *   pong-server [--address HOST:PORT] [--loops N] [--max-matches N]
+ *               [--max-spectators N] [--seed SEED] [--ai-skill N]
+ *               [--winning-score N] [--feed NAME] [--checkpoint FILE]
+ *               [--seconds S]
+ *
+ * With --feed, every match is published to bots over shared memory, and a
+ * bot's commands steer its lhs paddle in place of the AI (see feed.hpp and
+ * pong-feed-bot).
+ *
+ * With --checkpoint, every match is checkpointed to the file every second
+ * and when the server stops, and a server started on a file that holds a
+ * checkpoint (with the same options) first takes its matches up where they
+ * left off, e.g. to roll out a new build without ending them.
+ *
+ * It serves until interrupted, or for the given seconds, then reports what
+ * it did on stdout.
+ */
+#include "host.hpp"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string_view>
+
+namespace {
+
+namespace p = pong;
+
+struct options_t {
+  p::server_options_t server{.address = p::ipv4(INADDR_ANY, 4242)};
+  std::size_t seconds = 0;
+};
+
+template <typename T> bool parse(std::string_view s, T &value) {
+  const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return ec == std::errc{} && end == s.data() + s.size();
+}
+
+bool parse(int argc, char *argv[], options_t &options) {
+  auto &server = options.server;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 == argc)
+      return false;
+    const std::string_view value{argv[++i]};
+    bool ok = false;
+    if (arg == "--address")
+      ok = p::parse(value, server.address);
+    else if (arg == "--loops")
+      ok = parse(value, server.loops);
+    else if (arg == "--max-matches")
+      ok = parse(value, server.max_matches);
+    else if (arg == "--max-spectators")
+      ok = parse(value, server.max_spectators);
+    else if (arg == "--seed")
+      ok = parse(value, server.seed);
+    else if (arg == "--ai-skill")
+      ok = parse(value, server.rules.ai_skill) &&
+           server.rules.ai_skill >= p::rules_t::ai_skill_min &&
+           server.rules.ai_skill <= p::rules_t::ai_skill_max;
+    else if (arg == "--winning-score")
+      ok = parse(value, server.rules.winning_score);
+    else if (arg == "--feed") {
+      server.feed = value;
+      ok = !value.empty();
+    } else if (arg == "--checkpoint") {
+      server.checkpoint = value;
+      ok = !value.empty();
+    } else if (arg == "--seconds")
+      ok = parse(value, options.seconds);
+    if (!ok)
+      return false;
+  }
+  return server.loops > 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options_t options;
+  if (!parse(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--address HOST:PORT] [--loops N] "
+                 "[--max-matches N] [--max-spectators N] [--seed SEED] "
+                 "[--ai-skill N] [--winning-score N] [--feed NAME] "
+                 "[--checkpoint FILE] [--seconds S]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  // block the signals before the loops start, so that they inherit the mask
+  // and only sigtimedwait below sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  const auto started = std::chrono::steady_clock::now();
+  p::server_t server{options.server};
+  if (const auto resumed = server.stats().resumed)
+    std::fprintf(stderr, "resumed %lu matches in %.1f ms\n",
+                 static_cast<unsigned long>(resumed),
+                 std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - started)
+                     .count());
+  server.start();
+
+  const auto address = server.address();
+  char host[INET_ADDRSTRLEN] = {};
+  ::inet_ntop(AF_INET, &address.sin_addr, host, sizeof host);
+  std::fprintf(stderr, "serving on %s:%u with %u loops\n", host,
+               unsigned(ntohs(address.sin_port)), options.server.loops);
+
+  const auto start = std::chrono::steady_clock::now();
+  if (options.seconds > 0) {
+    const timespec timeout{.tv_sec = time_t(options.seconds), .tv_nsec = 0};
+    ::sigtimedwait(&signals, nullptr, &timeout);
+  } else {
+    int signal;
+    ::sigwait(&signals, &signal);
+  }
+  const auto elapsed = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  const auto stats = server.stats();
+  server.stop();
+
+  const auto us = [&](double q) {
+    return double(stats.tick_ns.quantile(q)) / 1e3;
+  };
+  std::printf("seconds      %.1f\n", elapsed);
+  std::printf("matches      %lu now, %lu joined\n",
+              static_cast<unsigned long>(stats.matches),
+              static_cast<unsigned long>(stats.joined));
+  std::printf("spectators   %lu now, %lu skips to keyframes\n",
+              static_cast<unsigned long>(stats.spectators),
+              static_cast<unsigned long>(stats.skips));
+  std::printf("ticks        %lu, %lu overran, %.1f matches woken per tick\n",
+              static_cast<unsigned long>(stats.ticks),
+              static_cast<unsigned long>(stats.overruns),
+              double(stats.woken) / double(std::max<std::uint64_t>(
+                                        stats.ticks, 1)));
+  std::printf("tick us      p50 %.1f  p99 %.1f  max %.1f\n", us(.5), us(.99),
+              double(stats.tick_ns.max()) / 1e3);
+  if (!options.server.checkpoint.empty())
+    std::printf("checkpoints  %lu, %lu matches resumed\n",
+                static_cast<unsigned long>(stats.checkpoints),
+                static_cast<unsigned long>(stats.resumed));
+  std::printf("datagrams    %lu in, %lu out, %lu dropped\n",
+              static_cast<unsigned long>(stats.received),
+              static_cast<unsigned long>(stats.sent),
+              static_cast<unsigned long>(stats.dropped));
+  return 0;
+}
@@ -0,0 +1,262 @@
+#include "simulation.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+pong::snapshot_t pong::snapshot(const arena_t &a, std::uint64_t tick,
+                                bool in_play) {
+  auto corners = [](const box_t &b) -> std::array<scalar_t, 4> {
+    return {b.min()(0), b.min()(1), b.max()(0), b.max()(1)};
+  };
+
+  return {
+      .tick = tick,
+      .puck = {a.puck().centre()(0), a.puck().centre()(1)},
+      .puck_radius = a.puck().radius(),
+      .lhs_paddle = corners(a.lhs_paddle().box()),
+      .rhs_paddle = corners(a.rhs_paddle().box()),
+      .lhs_score = a.lhs_score(),
+      .rhs_score = a.rhs_score(),
+      .in_play = in_play,
+  };
+}
+
+pong::layout_t pong::layout(const arena_t &a) {
+  return {
+      .box = a.box(),
+      .puck_colour = a.puck().colour(),
+      .lhs_paddle_colour = a.lhs_paddle().colour(),
+      .rhs_paddle_colour = a.rhs_paddle().colour(),
+  };
+}
+
+pong::scalar_t pong::ai_stdev(const rules_t &rules, scalar_t puck_radius) {
+  assert(rules.ai_skill >= rules_t::ai_skill_min &&
+         rules.ai_skill <= rules_t::ai_skill_max);
+  return (rules.paddle_size / 2.f + puck_radius) / z_scores[rules.ai_skill];
+}
+
+pong::scalar_t pong::apply_rules(arena_t &a, const rules_t &rules) {
+  for (auto *paddle : {&a.lhs_paddle(), &a.rhs_paddle()}) {
+    paddle->box().min()(1) = a.centre()(1) - rules.paddle_size / 2.f;
+    paddle->box().max()(1) = paddle->box().min()(1) + rules.paddle_size;
+  }
+  return ai_stdev(rules, a.puck().radius());
+}
+
+pong::snapshot_t pong::interpolate(const snapshot_t &from,
+                                   const snapshot_t &to, scalar_t alpha) {
+  if (from.lhs_score != to.lhs_score || from.rhs_score != to.rhs_score)
+    return to;
+
+  auto lerp = [alpha](const auto &l, const auto &r) {
+    auto result = r;
+    for (std::size_t i = 0; i < result.size(); ++i)
+      result[i] = l[i] + (r[i] - l[i]) * alpha;
+    return result;
+  };
+
+  snapshot_t result = to;
+  result.puck = lerp(from.puck, to.puck);
+  result.lhs_paddle = lerp(from.lhs_paddle, to.lhs_paddle);
+  result.rhs_paddle = lerp(from.rhs_paddle, to.rhs_paddle);
+  return result;
+}
+
+pong::simulation_t::simulation_t(
+    std::function<std::tuple<scalar_t, vec_t>()> starter,
+    std::mt19937::result_type seed, const rules_t &rules,
+    clock_t::duration tick_period)
+    : tick_period_{tick_period}, prng_{seed}, arena_{std::move(starter)},
+      layout_{pong::layout(arena_)}, rules_{rules} {
+  configure();
+  last_ = snapshot(arena_, tick_, in_play_);
+  frame_.store({last_, last_, clock_t::now().time_since_epoch().count()});
+}
+
+pong::simulation_t::~simulation_t() = default;
+
+void pong::simulation_t::start(clock_t::time_point now) {
+  next_tick_ = now;
+  thread_ = std::jthread{[this](std::stop_token stop) {
+    PONG_TRACE_THREAD_NAME("simulation");
+    while (!stop.stop_requested()) {
+      if (idle()) {
+        std::unique_lock lock{controls_mutex_};
+        while (!woken_.wait_for(lock, stop, idle_drain_period,
+                                [this]() { return !idle(); }) &&
+               !stop.stop_requested())
+          drain_inputs();
+        if (stop.stop_requested())
+          break;
+        drain_inputs();
+        // nothing happened while asleep, so there's nothing to catch up
+        next_tick_ = clock_t::now();
+      }
+      std::this_thread::sleep_until(next_tick_);
+      advance_to(clock_t::now());
+    }
+  }};
+}
+
+void pong::simulation_t::advance_to(clock_t::time_point now) {
+  if (next_tick_ == clock_t::time_point{})
+    next_tick_ = now;
+
+  for (int i = 0; i < max_catch_up_ticks && next_tick_ <= now; ++i) {
+    tick(next_tick_);
+    // before publication, so that whoever draws the tick finds its inputs
+    // advanced
+    if (latency_)
+      latency_->advanced(tick_, clock_t::now());
+    publish(next_tick_);
+    next_tick_ += tick_period_;
+  }
+
+  if (next_tick_ <= now)
+    next_tick_ = now + tick_period_;
+
+  std::lock_guard lock{controls_mutex_};
+  idle_.store(!in_play_ && !controls_.rules && !controls_.reset_scores,
+              std::memory_order_release);
+}
+
+void pong::simulation_t::tick(clock_t::time_point end) {
+  PONG_TRACE_SCOPE("simulation_t::tick");
+
+  controls_t controls;
+  {
+    std::lock_guard lock{controls_mutex_};
+    controls = std::exchange(controls_, {});
+  }
+  apply(controls);
+
+  {
+    scoped_timer_t timer{profile_, metric_t::ai};
+    if (const auto s = ai_->paddle_speed(arena_, arena_.lhs_paddle())) {
+      arena_.lhs_paddle().velocity()(1) = *s;
+    }
+  }
+
+  // split the tick at each input (and at the end of each wheel movement) so
+  // that the rhs paddle changes speed exactly when the input happened
+  auto now = end - tick_period_;
+  auto advance = [&](clock_t::time_point until) {
+    arena_.rhs_paddle().velocity()(1) = rhs_paddle_speed(now);
+    if (in_play_ && until > now) {
+      arena_.advance_time(std::chrono::duration<scalar_t>(until - now).count());
+    }
+    now = std::max(now, until);
+  };
+
+  {
+    scoped_timer_t timer{profile_, metric_t::advance_time};
+
+    for (;;) {
+      const auto *input = inputs_.front();
+      const auto next_input = input && input->time < end ? input->time : end;
+
+      if (wheel_until_ > now && wheel_until_ < next_input)
+        advance(wheel_until_);
+
+      if (next_input == end)
+        break;
+
+      advance(next_input);
+      apply(*input, now);
+      if (latency_)
+        latency_->applied(input->time, tick_ + 1, clock_t::now());
+      inputs_.pop();
+    }
+
+    advance(end);
+  }
+
+  in_play_ = arena_.lhs_score() < rules_.winning_score &&
+             arena_.rhs_score() < rules_.winning_score;
+
+  ++tick_;
+}
+
+pong::scalar_t pong::simulation_t::alpha(const frame_t &f,
+                                         clock_t::time_point now) const {
+  const auto since = now.time_since_epoch().count() - f.current_time;
+  return std::clamp(scalar_t(since) / scalar_t(tick_period_.count()),
+                    scalar_t{0}, scalar_t{1});
+}
+
+void pong::simulation_t::set_rules(const rules_t &rules) {
+  std::lock_guard lock{controls_mutex_};
+  controls_.rules = rules;
+  idle_.store(false, std::memory_order_release);
+  woken_.notify_one();
+}
+
+void pong::simulation_t::reset_scores() {
+  std::lock_guard lock{controls_mutex_};
+  controls_.reset_scores = true;
+  idle_.store(false, std::memory_order_release);
+  woken_.notify_one();
+}
+
+void pong::simulation_t::apply(const input_t &input,
+                               clock_t::time_point time) {
+  switch (input.kind) {
+  case input_t::kind_t::wheel: {
+    // carry over any of the previous movement that hasn't happened yet
+    const scalar_t remaining =
+        wheel_until_ > time
+            ? wheel_speed_ *
+                  std::chrono::duration<scalar_t>(wheel_until_ - time).count()
+            : 0.f;
+    wheel_speed_ = (remaining + input.value * rules_.mouse_wheel_sensitivity) /
+                   std::chrono::duration<scalar_t>(tick_period_).count();
+    wheel_until_ = time + tick_period_;
+    break;
+  }
+  case input_t::kind_t::up:
+    up_ = input.value != 0.f;
+    break;
+  case input_t::kind_t::down:
+    down_ = input.value != 0.f;
+    break;
+  }
+}
+
+void pong::simulation_t::drain_inputs() {
+  while (const auto *input = inputs_.front()) {
+    if (input->kind != input_t::kind_t::wheel)
+      apply(*input, input->time);
+    inputs_.pop();
+  }
+}
+
+pong::scalar_t
+pong::simulation_t::rhs_paddle_speed(clock_t::time_point now) const {
+  return (now < wheel_until_ ? wheel_speed_ : 0.f) +
+         (scalar_t(down_) - scalar_t(up_)) * key_paddle_speed;
+}
+
+void pong::simulation_t::apply(const controls_t &controls) {
+  if (controls.rules &&
+      *controls.rules != std::exchange(rules_, *controls.rules)) {
+    configure();
+  }
+
+  if (controls.reset_scores) {
+    arena_.lhs_score() = 0;
+    arena_.rhs_score() = 0;
+  }
+}
+
+void pong::simulation_t::configure() {
+  ai_.emplace(prng_(), apply_rules(arena_, rules_));
+}
+
+void pong::simulation_t::publish(clock_t::time_point when) {
+  const auto current = snapshot(arena_, tick_, in_play_);
+  frame_.store({std::exchange(last_, current), current,
+                when.time_since_epoch().count()});
+}
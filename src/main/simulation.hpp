@@ -0,0 +1,279 @@
+#ifndef PONG_SIMULATION_HPP
+#define PONG_SIMULATION_HPP
+
+#include "concurrency.hpp"
+#include "latency.hpp"
+#include "model.hpp"
+#include "profile.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <tuple>
+
+namespace pong {
+
+/**
+ * The parts of an arena that change over time, in a form that can be
+ * published through a seqlock_t.  Boxes are stored as {min x, min y, max x,
+ * max y}.
+ */
+struct snapshot_t {
+  std::uint64_t tick{};
+  std::array<scalar_t, 2> puck{};
+  scalar_t puck_radius{};
+  std::array<scalar_t, 4> lhs_paddle{};
+  std::array<scalar_t, 4> rhs_paddle{};
+  std::uint32_t lhs_score{};
+  std::uint32_t rhs_score{};
+  bool in_play{};
+};
+
+/**
+ * The parts of an arena that are fixed once it has been constructed.
+ */
+struct layout_t {
+  box_t box;
+  colour_t puck_colour;
+  colour_t lhs_paddle_colour;
+  colour_t rhs_paddle_colour;
+};
+
+/**
+ * The two most recent simulation states and the time at which the latest
+ * was produced; renderers interpolate between them.
+ */
+struct frame_t {
+  snapshot_t previous;
+  snapshot_t current;
+  std::chrono::steady_clock::rep current_time;
+};
+
+/**
+ * The user adjustable rules of the game, as applied by the simulation.
+ */
+struct rules_t {
+  // the skills an AI can be given; below 5 the AI's aim is all but random,
+  // and z_scores ends at 99
+  static constexpr int ai_skill_min = 5;
+  static constexpr int ai_skill_max = 95;
+
+  scalar_t paddle_size{40};
+  int ai_skill{70}; // percentage of pucks the ai should return, see z_scores
+  std::uint32_t winning_score{10};
+  scalar_t mouse_wheel_sensitivity{5};
+
+  friend bool operator==(const rules_t &, const rules_t &) = default;
+};
+
+/**
+ * A timestamped user input for the rhs paddle.  A wheel event moves the
+ * paddle by value * mouse_wheel_sensitivity over one tick; up and down hold
+ * the paddle at a fixed speed while value is non-zero (pressed).
+ */
+struct input_t {
+  enum class kind_t : std::uint8_t { wheel, up, down };
+
+  std::chrono::steady_clock::time_point time;
+  kind_t kind;
+  scalar_t value;
+};
+
+snapshot_t snapshot(const arena_t &, std::uint64_t tick, bool in_play);
+
+layout_t layout(const arena_t &);
+
+/**
+ * the spread of aim (the stdev of an ai_t) such that an AI returns ai_skill
+ * percent of pucks of puck_radius with paddles of the rules' size; ai_skill
+ * must be within rules_t::ai_skill_min and ai_skill_max
+ */
+scalar_t ai_stdev(const rules_t &, scalar_t puck_radius);
+
+/**
+ * size an arena's paddles to the rules, returning the ai_stdev its AIs need;
+ * the same whenever it's applied, so it may be applied for each AI
+ */
+scalar_t apply_rules(arena_t &, const rules_t &);
+
+/**
+ * Linearly interpolate between two snapshots, alpha in [0, 1].  Positions
+ * are not interpolated across a restart of the puck (i.e. when the scores
+ * differ) since the puck teleports to the centre line.
+ */
+snapshot_t interpolate(const snapshot_t &from, const snapshot_t &to,
+                       scalar_t alpha);
+
+/**
+ * Runs an arena and its AI at a fixed tick rate, either on its own thread
+ * (start) or driven by the caller (advance_to).  The renderer reads the
+ * published frame_t and never touches the arena directly.  In the browser,
+ * which has no threads (see pong::threads), it is driven by the main loop.
+ */
+class simulation_t {
+public:
+  using clock_t = std::chrono::steady_clock;
+
+  static constexpr clock_t::duration default_tick_period =
+      std::chrono::microseconds{1'000'000 / 120};
+
+  /**
+   * the maximum number of ticks advance_to will run per call; any further
+   * backlog (e.g. a browser tab in the background) is dropped
+   */
+  static constexpr int max_catch_up_ticks = 8;
+
+  /**
+   * speed of the rhs paddle while up or down is held
+   */
+  static constexpr scalar_t key_paddle_speed = 400;
+
+  /**
+   * how often a sleeping simulation thread takes the inputs queued since it
+   * last looked, so that the queue never fills while it's idle
+   */
+  static constexpr clock_t::duration idle_drain_period =
+      std::chrono::milliseconds{100};
+
+  simulation_t(std::function<std::tuple<scalar_t, vec_t>()> starter,
+               std::mt19937::result_type seed, const rules_t &rules,
+               clock_t::duration tick_period = default_tick_period);
+
+  simulation_t(const simulation_t &) = delete;
+
+  simulation_t &operator=(const simulation_t &) = delete;
+
+  ~simulation_t();
+
+  /**
+   * run the simulation on its own thread until destruction
+   */
+  void start(clock_t::time_point now = clock_t::now());
+
+  /**
+   * run as many ticks as are due at now; for use when not started
+   */
+  void advance_to(clock_t::time_point now);
+
+  /**
+   * the latest two published states; safe to call from any thread
+   */
+  [[nodiscard]] frame_t frame() const { return frame_.load(); }
+
+  /**
+   * fraction of a tick by which to interpolate frame() at time now such that
+   * rendering lags the simulation by exactly one tick
+   */
+  [[nodiscard]] scalar_t alpha(const frame_t &,
+                               clock_t::time_point now) const;
+
+  [[nodiscard]] const layout_t &layout() const { return layout_; }
+
+  [[nodiscard]] clock_t::duration tick_period() const { return tick_period_; }
+
+  /**
+   * true once the match has been won and no control is pending, i.e. ticking
+   * wouldn't change anything anyone can see; safe to call from any thread.
+   * A started simulation sleeps while idle, until set_rules or reset_scores,
+   * draining its inputs now and then.
+   */
+  [[nodiscard]] bool idle() const {
+    return idle_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * record the cost of the ai and of advancing the arena into profile; must
+   * be set before start
+   */
+  void profile(profile_t *profile) { profile_ = profile; }
+
+  /**
+   * stamp inputs as they are applied and their ticks advanced; must be set
+   * before start
+   */
+  void latency(input_latency_t *latency) { latency_ = latency; }
+
+  [[nodiscard]] input_latency_t *latency() const { return latency_; }
+
+  // thread safe controls, applied at the start of the next tick
+
+  void set_rules(const rules_t &);
+
+  void reset_scores();
+
+  /**
+   * queue an input to be applied at the simulation time corresponding to
+   * input.time; single producer only, returns false if the queue is full
+   */
+  bool input(const input_t &input) { return inputs_.push(input); }
+
+private:
+  struct controls_t {
+    std::optional<rules_t> rules;
+    bool reset_scores{};
+  };
+
+  /**
+   * run the tick ending at end
+   */
+  void tick(clock_t::time_point end);
+
+  void apply(const controls_t &);
+
+  /**
+   * apply input as if it happened at time (which is never before the start of
+   * the current tick)
+   */
+  void apply(const input_t &input, clock_t::time_point time);
+
+  /**
+   * take the inputs queued while idle: the keys they leave held carry over,
+   * but their times and any wheel movement are stale once play resumes
+   */
+  void drain_inputs();
+
+  [[nodiscard]] scalar_t rhs_paddle_speed(clock_t::time_point) const;
+
+  void configure();
+
+  void publish(clock_t::time_point when);
+
+  const clock_t::duration tick_period_;
+  std::mt19937 prng_;
+  arena_t arena_;
+  const layout_t layout_;
+  rules_t rules_;
+  std::optional<ai_t> ai_;
+  std::uint64_t tick_{};
+  bool in_play_{true};
+  profile_t *profile_{};
+  input_latency_t *latency_{};
+  snapshot_t last_{};
+  clock_t::time_point next_tick_{};
+
+  std::mutex controls_mutex_;
+  controls_t controls_;
+  std::atomic<bool> idle_{false};
+  std::condition_variable_any woken_;
+
+  spsc_queue_t<input_t, 256> inputs_;
+  scalar_t wheel_speed_{};
+  clock_t::time_point wheel_until_{};
+  bool up_{};
+  bool down_{};
+
+  seqlock_t<frame_t> frame_;
+
+  std::jthread thread_;
+};
+
+} // namespace pong
+
+#endif // PONG_SIMULATION_HPP
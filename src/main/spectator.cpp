@@ -0,0 +1,356 @@
+#include "spectator.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numbers>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+// pucks are drawn as a fan of this many triangles
+constexpr int puck_segments = 12;
+
+// per arena, per frame: a puck and two paddles
+constexpr int dynamic_vertices = puck_segments + 1 + 2 * 4;
+constexpr int dynamic_indices = puck_segments * 3 + 2 * 6;
+
+// the most vertices one PrimReserve may add, so that its indices fit
+constexpr int max_reserve = sizeof(ImDrawIdx) == 2 ? 0xffff : 1 << 30;
+
+// the most an arena's text adds: two scores of up to 10 digits, a quad each
+constexpr int text_vertices =
+    2 * (std::numeric_limits<std::uint32_t>::digits10 + 1) * 4;
+
+constexpr ImGuiWindowFlags overlay_flags =
+    ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoInputs |
+    ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings;
+
+const auto unit_circle = []() {
+  std::array<ImVec2, puck_segments> result;
+  for (int i = 0; i < puck_segments; ++i) {
+    const auto theta = 2.f * std::numbers::pi_v<float> * float(i) /
+                       float(puck_segments);
+    result[std::size_t(i)] = {std::cos(theta), std::sin(theta)};
+  }
+  return result;
+}();
+
+inline ImU32 col(const pong::colour_t &v) {
+  return IM_COL32(v(0), v(1), v(2), v(3));
+}
+
+// the top left corner of arena i's scaled 640 x 480 area, centred in its cell
+ImVec2 corner(const ImVec2 &origin, const ImVec2 &cell, float scale,
+              const pong::vec_t &extent, int columns, int i) {
+  return {std::floor(origin.x + float(i % columns) * cell.x +
+                     (cell.x - extent(0) * scale) / 2.f),
+          std::floor(origin.y + float(i / columns) * cell.y +
+                     (cell.y - extent(1) * scale) / 2.f)};
+}
+
+} // namespace
+
+pong::spectator_t::spectator_t(int columns, int rows,
+                               std::mt19937::result_type seed,
+                               const rules_t &rules)
+    : columns_{columns}, rows_{rows}, rules_{rules},
+      layout_{[&]() {
+        const match_t match{seed, rules};
+        return pong::layout(match.arena());
+      }()},
+      next_seed_{seed} {
+  const auto arenas = std::size_t(columns_) * std::size_t(rows_);
+  for (std::size_t i = 0; i < arenas; ++i) {
+    // a match uses its seed and the next two
+    matches_.emplace_back(std::make_unique<match_t>(next_seed_, rules_));
+    next_seed_ += 3;
+    current_.push_back(matches_.back()->snapshot(0));
+  }
+  previous_ = current_;
+  finished_.resize(arenas);
+}
+
+void pong::spectator_t::tick() {
+  PONG_TRACE_SCOPE("spectator_t::tick");
+
+  constexpr scalar_t dt =
+      std::chrono::duration<scalar_t>(simulation_t::default_tick_period)
+          .count();
+  const auto hold_ticks = std::uint32_t(hold / simulation_t::default_tick_period);
+
+  ++ticks_;
+  for (std::size_t i = 0; i < matches_.size(); ++i) {
+    auto &match = matches_[i];
+    previous_[i] = current_[i];
+
+    if (match->in_play()) {
+      match->tick(dt);
+    } else if (++finished_[i] >= hold_ticks) {
+      match = std::make_unique<match_t>(next_seed_, rules_);
+      next_seed_ += 3;
+      finished_[i] = 0;
+      ++restarts_;
+    }
+
+    current_[i] = match->snapshot(ticks_);
+  }
+}
+
+void pong::spectator_t::frame(clock_t::time_point now) {
+  PONG_TRACE_SCOPE("spectator_t::frame");
+
+  const auto period = simulation_t::default_tick_period;
+
+  if (next_tick_ == clock_t::time_point{})
+    next_tick_ = now;
+
+  for (int i = 0; i < simulation_t::max_catch_up_ticks && next_tick_ <= now;
+       ++i) {
+    tick();
+    next_tick_ += period;
+  }
+
+  if (next_tick_ <= now)
+    next_tick_ = now + period;
+
+  // as simulation_t::alpha, lagging the matches by a tick
+  const auto alpha = std::clamp(
+      std::chrono::duration<scalar_t>(now - (next_tick_ - period)) / period,
+      scalar_t{0}, scalar_t{1});
+
+  auto viewport = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(viewport->Pos);
+  ImGui::SetNextWindowSize(viewport->Size);
+
+  if (ImGui::Begin("Spectators", nullptr,
+                   ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoResize |
+                       ImGuiWindowFlags_NoMove |
+                       ImGuiWindowFlags_NoDecoration |
+                       ImGuiWindowFlags_NoBringToFrontOnFocus |
+                       ImGuiWindowFlags_NoSavedSettings)) {
+    const auto origin = ImGui::GetCursorScreenPos();
+    const auto avail = ImGui::GetContentRegionAvail();
+    const ImVec2 cell{avail.x / float(columns_), avail.y / float(rows_)};
+    const vec_t extent = layout_.box.max() + layout_.box.min();
+
+    const grid_t grid{
+        .origin = origin,
+        .cell = cell,
+        .scale = std::max(std::min(cell.x / extent(0), cell.y / extent(1)),
+                          0.f),
+        .white = ImGui::GetFontTexUvWhitePixel(),
+    };
+
+    if (grid != grid_)
+      tessellate(grid);
+
+    // as many arenas to a draw list as its indices reach, unless the
+    // renderer takes vertex offsets
+    const bool split =
+        sizeof(ImDrawIdx) == 2 && !(ImGui::GetIO().BackendFlags &
+                                    ImGuiBackendFlags_RendererHasVtxOffset);
+    const auto arenas = int(matches_.size());
+    const auto per_arena = int(static_vertices_.size()) / arenas +
+                           dynamic_vertices + text_vertices;
+
+    for (int first = 0, list = 0; first < arenas; ++list) {
+      if (list > 0) {
+        ImGui::SetCursorScreenPos(origin);
+        ImGui::BeginChild(ImGuiID(list), avail, ImGuiChildFlags_None,
+                          overlay_flags);
+      }
+      auto &draw_list = *ImGui::GetWindowDrawList();
+      const auto room = int(0xffff - draw_list._VtxCurrentIdx) / per_arena;
+      const auto last =
+          split ? std::min(first + std::max(room, 1), arenas) : arenas;
+      draw_static(draw_list, first, last);
+      draw_dynamic(draw_list, grid, alpha, first, last);
+      if (list > 0)
+        ImGui::EndChild();
+      first = last;
+    }
+
+    ImGui::SetCursorScreenPos(origin);
+    ImGui::Dummy(avail);
+  }
+  ImGui::End();
+}
+
+void pong::spectator_t::tessellate(const grid_t &grid) {
+  PONG_TRACE_SCOPE("spectator_t::tessellate");
+
+  grid_ = grid;
+  ++layouts_;
+
+  static_vertices_.clear();
+  static_indices_.clear();
+
+  const vec_t extent = layout_.box.max() + layout_.box.min();
+  constexpr auto solid_white = IM_COL32(255, 255, 255, 255);
+
+  // ImGui's own tessellation (rounding, anti-aliasing), recorded into a
+  // scratch list at each arena's position
+  ImDrawList scratch{ImGui::GetDrawListSharedData()};
+
+  for (std::size_t i = 0; i < matches_.size(); ++i) {
+    const auto at = corner(grid.origin, grid.cell, grid.scale, extent,
+                           columns_, int(i));
+    auto point = [&](const vec_t &p) {
+      return ImVec2{at.x + p(0) * grid.scale, at.y + p(1) * grid.scale};
+    };
+
+    scratch._ResetForNewFrame();
+    scratch.AddRect(point(layout_.box.min()), point(layout_.box.max()),
+                    solid_white, 5.f * grid.scale, ImDrawFlags_RoundCornersAll);
+    const auto mid = (layout_.box.min()(0) + layout_.box.max()(0)) / 2.f;
+    scratch.AddLine(point(vec_t{mid, layout_.box.min()(1)}),
+                    point(vec_t{mid, layout_.box.max()(1)}), solid_white);
+
+    // every arena is the same shape, so tessellates to the same triangles
+    if (i == 0) {
+      static_indices_.assign(scratch.IdxBuffer.begin(),
+                             scratch.IdxBuffer.end());
+    }
+    IM_ASSERT(scratch.IdxBuffer.Size == int(static_indices_.size()));
+    static_vertices_.insert(static_vertices_.end(), scratch.VtxBuffer.begin(),
+                            scratch.VtxBuffer.end());
+  }
+}
+
+void pong::spectator_t::draw_static(ImDrawList &draw_list, int first,
+                                    int last) const {
+  PONG_TRACE_SCOPE("spectator_t::draw_static");
+
+  const auto vertices = int(static_vertices_.size()) / int(matches_.size());
+  const auto indices = int(static_indices_.size());
+  if (vertices == 0)
+    return;
+
+  // each reservation must fit within 16 bit indices
+  const int batch = std::max(max_reserve / vertices, 1);
+
+  for (int from = first; from < last; from += batch) {
+    const int n = std::min(batch, last - from);
+    draw_list.PrimReserve(n * indices, n * vertices);
+
+    std::memcpy(draw_list._VtxWritePtr,
+                static_vertices_.data() + std::size_t(from * vertices),
+                std::size_t(n * vertices) * sizeof(ImDrawVert));
+    draw_list._VtxWritePtr += n * vertices;
+
+    for (int k = 0; k < n; ++k) {
+      const auto base = draw_list._VtxCurrentIdx;
+      for (const auto index : static_indices_)
+        *draw_list._IdxWritePtr++ = ImDrawIdx(base + index);
+      draw_list._VtxCurrentIdx += unsigned(vertices);
+    }
+  }
+}
+
+void pong::spectator_t::draw_dynamic(ImDrawList &draw_list,
+                                     const grid_t &grid, scalar_t alpha,
+                                     int first, int last) const {
+  PONG_TRACE_SCOPE("spectator_t::draw_dynamic");
+
+  const vec_t extent = layout_.box.max() + layout_.box.min();
+  const auto puck_colour = col(layout_.puck_colour);
+  const auto lhs_colour = col(layout_.lhs_paddle_colour);
+  const auto rhs_colour = col(layout_.rhs_paddle_colour);
+
+  auto state = [&](int i) {
+    return interpolate(previous_[std::size_t(i)], current_[std::size_t(i)],
+                       alpha);
+  };
+
+  constexpr int batch = max_reserve / dynamic_vertices;
+
+  for (int from = first; from < last; from += batch) {
+    const int n = std::min(batch, last - from);
+    draw_list.PrimReserve(n * dynamic_indices, n * dynamic_vertices);
+    int unused = 0;
+
+    for (int i = from; i < from + n; ++i) {
+      const auto s = state(i);
+      if (!s.in_play) {
+        ++unused;
+        continue;
+      }
+
+      const auto at =
+          corner(grid.origin, grid.cell, grid.scale, extent, columns_, i);
+      auto point = [&](scalar_t x, scalar_t y) {
+        return ImVec2{at.x + x * grid.scale, at.y + y * grid.scale};
+      };
+
+      // puck, as a fan around its centre
+      const auto base = draw_list._VtxCurrentIdx;
+      const auto centre = point(s.puck[0], s.puck[1]);
+      const auto radius = s.puck_radius * grid.scale;
+      draw_list.PrimWriteVtx(centre, grid.white, puck_colour);
+      for (const auto &u : unit_circle) {
+        draw_list.PrimWriteVtx({centre.x + u.x * radius, centre.y + u.y * radius},
+                               grid.white, puck_colour);
+      }
+      for (unsigned k = 0; k < puck_segments; ++k) {
+        draw_list.PrimWriteIdx(ImDrawIdx(base));
+        draw_list.PrimWriteIdx(ImDrawIdx(base + 1 + k));
+        draw_list.PrimWriteIdx(ImDrawIdx(base + 1 + (k + 1) % puck_segments));
+      }
+
+      draw_list.PrimRect(point(s.lhs_paddle[0], s.lhs_paddle[1]),
+                         point(s.lhs_paddle[2], s.lhs_paddle[3]), lhs_colour);
+      draw_list.PrimRect(point(s.rhs_paddle[0], s.rhs_paddle[1]),
+                         point(s.rhs_paddle[2], s.rhs_paddle[3]), rhs_colour);
+    }
+
+    draw_list.PrimUnreserve(unused * dynamic_indices,
+                            unused * dynamic_vertices);
+  }
+
+  // scores, or the winner, as draw_arena has them; the text is scaled down
+  // less than the arena so that it stays readable
+  auto *font = ImGui::GetFont();
+  const auto font_size = std::min(ImGui::GetFontSize(), grid.cell.y / 4.f);
+  constexpr auto solid_white = IM_COL32(255, 255, 255, 255);
+  const auto width = layout_.box.max()(0) - layout_.box.min()(0);
+  const auto height = layout_.box.max()(1) - layout_.box.min()(1);
+
+  for (int i = first; i < last; ++i) {
+    const auto &s = current_[std::size_t(i)];
+    const auto at =
+        corner(grid.origin, grid.cell, grid.scale, extent, columns_, i);
+    const auto y = at.y + (layout_.box.min()(1) + height * .125f) * grid.scale;
+
+    auto text = [&](std::string_view chars, float fraction) {
+      const auto w =
+          font->CalcTextSizeA(font_size, std::numeric_limits<float>::max(), 0.f,
+                              chars.data(), chars.data() + chars.size())
+              .x;
+      const auto x =
+          at.x + (layout_.box.min()(0) + width * fraction) * grid.scale -
+          w / 2.f;
+      draw_list.AddText(font, font_size, {x, y}, solid_white, chars.data(),
+                        chars.data() + chars.size());
+    };
+
+    if (s.in_play) {
+      for (const auto &[score, fraction] :
+           {std::pair{s.lhs_score, .25f}, std::pair{s.rhs_score, .75f}}) {
+        std::array<char, std::numeric_limits<std::uint32_t>::digits10 + 1>
+            digits;
+        const auto end =
+            std::to_chars(digits.data(), digits.data() + digits.size(), score)
+                .ptr;
+        text({digits.data(), end}, fraction);
+      }
+    } else {
+      text("WINNER!", s.lhs_score < s.rhs_score ? .75f : .25f);
+    }
+  }
+}
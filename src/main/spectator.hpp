@@ -0,0 +1,112 @@
+#ifndef PONG_SPECTATOR_HPP
+#define PONG_SPECTATOR_HPP
+
+#include "match.hpp"
+#include "simulation.hpp"
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace pong {
+
+/**
+ * A wall of AI vs AI matches in a columns x rows grid, filling the window.
+ * Finished matches are replaced by new ones after a short pause.
+ *
+ * Every arena is drawn into the one window draw list in bulk (PrimReserve and
+ * direct writes) rather than shape by shape.  The arena outlines and centre
+ * lines are tessellated once per layout (window size and grid) and copied in
+ * on each frame; only the pucks, paddles and scores are generated per frame.
+ * A renderer that can't take vertex offsets (GL ES 2 / WebGL 1, or GL before
+ * 3.2) with 16-bit indices can't draw a list of more than 64k vertices, so
+ * for it the arenas are spread over as many lists as that takes, each in a
+ * child window over the whole wall.
+ */
+class spectator_t {
+public:
+  using clock_t = simulation_t::clock_t;
+
+  /**
+   * how long a finished match stays up before it is replaced
+   */
+  static constexpr clock_t::duration hold = std::chrono::seconds{2};
+
+  spectator_t(int columns, int rows, std::mt19937::result_type seed,
+              const rules_t &rules = {});
+
+  spectator_t(const spectator_t &) = delete;
+
+  spectator_t &operator=(const spectator_t &) = delete;
+
+  /**
+   * advance every match to now and build this frame's window; call between
+   * ImGui::NewFrame() and ImGui::Render()
+   */
+  void frame(clock_t::time_point now);
+
+  [[nodiscard]] int columns() const { return columns_; }
+  [[nodiscard]] int rows() const { return rows_; }
+
+  /**
+   * the number of times the static geometry has been tessellated
+   */
+  [[nodiscard]] std::uint64_t layouts() const { return layouts_; }
+
+  /**
+   * the number of matches that have finished and been replaced
+   */
+  [[nodiscard]] std::uint64_t restarts() const { return restarts_; }
+
+private:
+  // where the arenas are drawn; the static geometry is rebuilt when it changes
+  struct grid_t {
+    ImVec2 origin;
+    ImVec2 cell;
+    float scale;
+    ImVec2 white; // uv of the font atlas' white pixel
+
+    friend bool operator==(const grid_t &l, const grid_t &r) {
+      auto equal = [](const ImVec2 &a, const ImVec2 &b) {
+        return a.x == b.x && a.y == b.y;
+      };
+      return equal(l.origin, r.origin) && equal(l.cell, r.cell) &&
+             l.scale == r.scale && equal(l.white, r.white);
+    }
+  };
+
+  void tick();
+  void tessellate(const grid_t &);
+  // arenas [first, last)
+  void draw_static(ImDrawList &, int first, int last) const;
+  void draw_dynamic(ImDrawList &, const grid_t &, scalar_t alpha, int first,
+                    int last) const;
+
+  const int columns_;
+  const int rows_;
+  const rules_t rules_;
+  const layout_t layout_;
+  std::mt19937::result_type next_seed_;
+
+  std::vector<std::unique_ptr<match_t>> matches_;
+  std::vector<snapshot_t> previous_;
+  std::vector<snapshot_t> current_;
+  std::vector<std::uint32_t> finished_; // ticks since the match was won
+  std::uint64_t ticks_{};
+  clock_t::time_point next_tick_{};
+  std::uint64_t restarts_{};
+
+  // the outline and centre line of every arena, already in place, and the
+  // indices of one arena's share, relative to its first vertex
+  grid_t grid_{};
+  std::vector<ImDrawVert> static_vertices_;
+  std::vector<ImDrawIdx> static_indices_;
+  std::uint64_t layouts_{};
+};
+
+} // namespace pong
+
+#endif // PONG_SPECTATOR_HPP
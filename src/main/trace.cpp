@@ -0,0 +1,146 @@
+#include "trace.hpp"
+
+#ifdef PONG_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace {
+
+struct event_t {
+  const char *name;
+  char phase; // 'X' complete span, 'C' counter
+  std::int64_t ts;
+  std::int64_t value; // duration for a span
+};
+
+/**
+ * A fixed size, single writer buffer; events beyond its capacity are
+ * dropped (and counted) rather than reallocating under a concurrent export.
+ */
+struct buffer_t {
+  static constexpr std::size_t capacity = 1 << 18;
+
+  explicit buffer_t(std::size_t tid) : tid{tid} {}
+
+  void push(const event_t &event) {
+    const auto n = size.load(std::memory_order_relaxed);
+    if (n == capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    events[n] = event;
+    size.store(n + 1, std::memory_order_release);
+  }
+
+  const std::size_t tid;
+  std::atomic<const char *> name{nullptr};
+  std::atomic<std::size_t> size{};
+  std::atomic<std::size_t> dropped{};
+  std::unique_ptr<event_t[]> events{new event_t[capacity]};
+};
+
+struct registry_t {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<buffer_t>> buffers;
+  const pong::trace::clock_t::time_point epoch = pong::trace::clock_t::now();
+};
+
+registry_t &registry() {
+  static registry_t result;
+  return result;
+}
+
+// buffers are owned by the registry so they outlive their threads
+buffer_t &buffer() {
+  thread_local buffer_t *result = [] {
+    auto &r = registry();
+    std::lock_guard lock{r.mutex};
+    return r.buffers.emplace_back(std::make_unique<buffer_t>(r.buffers.size()))
+        .get();
+  }();
+  return *result;
+}
+
+std::int64_t since_epoch(pong::trace::clock_t::time_point t) {
+  return std::max<std::int64_t>(
+      0, std::chrono::nanoseconds{t - registry().epoch}.count());
+}
+
+} // namespace
+
+void pong::trace::complete(const char *name, clock_t::time_point start,
+                           clock_t::time_point end) {
+  buffer().push({name, 'X', since_epoch(start),
+                 std::chrono::nanoseconds{end - start}.count()});
+}
+
+void pong::trace::counter(const char *name, std::int64_t value) {
+  buffer().push({name, 'C', since_epoch(clock_t::now()), value});
+}
+
+void pong::trace::thread_name(const char *name) {
+  buffer().name.store(name, std::memory_order_relaxed);
+}
+
+void pong::trace::write(std::ostream &os) {
+  auto &r = registry();
+  std::lock_guard lock{r.mutex};
+
+  // timestamps are in microseconds
+  auto us = [&os](std::int64_t ns) -> std::ostream & {
+    return os << ns / 1000 << '.' << char('0' + ns / 100 % 10)
+              << char('0' + ns / 10 % 10) << char('0' + ns % 10);
+  };
+
+  const char *separator = "\n";
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  for (const auto &b : r.buffers) {
+    if (const char *name = b->name.load(std::memory_order_relaxed)) {
+      os << separator << R"({"ph":"M","pid":1,"tid":)" << b->tid
+         << R"(,"name":"thread_name","args":{"name":")" << name << "\"}}";
+      separator = ",\n";
+    }
+
+    const auto size = b->size.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < size; ++i) {
+      const auto &e = b->events[i];
+      os << separator << R"({"ph":")" << e.phase << R"(","pid":1,"tid":)"
+         << b->tid << R"(,"name":")" << e.name << R"(","ts":)";
+      us(e.ts);
+      if (e.phase == 'X') {
+        os << ",\"dur\":";
+        us(e.value);
+        os << '}';
+      } else {
+        os << R"(,"args":{"value":)" << e.value << "}}";
+      }
+      separator = ",\n";
+    }
+
+    if (const auto dropped = b->dropped.load(std::memory_order_relaxed)) {
+      os << separator << R"({"ph":"C","pid":1,"tid":)" << b->tid
+         << R"(,"name":"trace_events_dropped","ts":0,"args":{"value":)"
+         << dropped << "}}";
+      separator = ",\n";
+    }
+  }
+
+  os << "\n]}\n";
+}
+
+void pong::trace::clear() {
+  auto &r = registry();
+  std::lock_guard lock{r.mutex};
+  for (auto &b : r.buffers) {
+    b->size.store(0, std::memory_order_release);
+    b->dropped.store(0, std::memory_order_relaxed);
+  }
+}
+
+#endif // PONG_TRACE
@@ -0,0 +1,89 @@
+#ifndef PONG_TRACE_HPP
+#define PONG_TRACE_HPP
+
+/**
+ * Scoped trace spans and counters, exported as Chrome trace-event JSON (which
+ * can be loaded into https://ui.perfetto.dev).
+ *
+ * Tracing is compiled in by defining PONG_TRACE (cmake -DPONG_TRACE=ON).
+ * Otherwise the macros below expand to nothing and no tracing code is
+ * generated at all.
+ *
+ * Names must be string literals (or otherwise outlive the trace).
+ */
+
+#ifdef PONG_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+#define PONG_TRACE_CONCAT_(a, b) a##b
+#define PONG_TRACE_CONCAT(a, b) PONG_TRACE_CONCAT_(a, b)
+
+#define PONG_TRACE_SCOPE(name)                                                 \
+  const ::pong::trace::span_t PONG_TRACE_CONCAT(pong_trace_span_, __LINE__) {  \
+    name                                                                       \
+  }
+
+#define PONG_TRACE_COUNTER(name, value)                                        \
+  ::pong::trace::counter(name, static_cast<std::int64_t>(value))
+
+#define PONG_TRACE_THREAD_NAME(name) ::pong::trace::thread_name(name)
+
+namespace pong::trace {
+
+using clock_t = std::chrono::steady_clock;
+
+/**
+ * record a complete span on the calling thread's buffer
+ */
+void complete(const char *name, clock_t::time_point start,
+              clock_t::time_point end);
+
+/**
+ * record the value of a counter on the calling thread's buffer
+ */
+void counter(const char *name, std::int64_t value);
+
+/**
+ * name the calling thread in exported traces
+ */
+void thread_name(const char *name);
+
+/**
+ * write every buffered event from every thread as Chrome trace-event JSON
+ */
+void write(std::ostream &);
+
+/**
+ * discard every buffered event; only safe while no other thread is tracing
+ */
+void clear();
+
+class span_t {
+public:
+  explicit span_t(const char *name) : name_{name}, start_{clock_t::now()} {}
+
+  span_t(const span_t &) = delete;
+
+  span_t &operator=(const span_t &) = delete;
+
+  ~span_t() { complete(name_, start_, clock_t::now()); }
+
+private:
+  const char *name_;
+  clock_t::time_point start_;
+};
+
+} // namespace pong::trace
+
+#else
+
+#define PONG_TRACE_SCOPE(name) static_cast<void>(0)
+#define PONG_TRACE_COUNTER(name, value) static_cast<void>(0)
+#define PONG_TRACE_THREAD_NAME(name) static_cast<void>(0)
+
+#endif // PONG_TRACE
+
+#endif // PONG_TRACE_HPP
@@ -0,0 +1,74 @@
+/**
+ * pong-tracker-bot : an example bot plugin (see pong_bot.h), built as a
+ * shared object with nothing of the game linked in.  It works out where the
+ * puck will cross its paddle, bouncing off the top and bottom of the arena,
+ * and heads there in time; with the puck going away it drifts back to the
+ * middle.  Unlike ai_t it never misjudges, so it only misses what it can't
+ * reach.
+ */
+#include "pong_bot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+namespace {
+
+// as fast as a player may move their paddle
+constexpr float max_speed = 2000;
+
+struct tracker_t {
+  // decisions made, for no reason but to show a bot may keep state
+  unsigned long decisions = 0;
+};
+
+// y folded back into [lo, hi] as the puck bounces between them
+float fold(float y, float lo, float hi) {
+  const auto span = hi - lo;
+  if (span <= 0)
+    return lo;
+  auto t = std::fmod(y - lo, 2 * span);
+  if (t < 0)
+    t += 2 * span;
+  return lo + (t <= span ? t : 2 * span - t);
+}
+
+void *create(uint32_t) { return new (std::nothrow) tracker_t; }
+
+void destroy(void *bot) { delete static_cast<tracker_t *>(bot); }
+
+int paddle_speed(void *bot, const pong_bot_state *s, float *speed) {
+  ++static_cast<tracker_t *>(bot)->decisions;
+
+  const float *paddle = s->side ? s->rhs_paddle : s->lhs_paddle;
+  const float centre = (paddle[1] + paddle[3]) / 2;
+  // the x the puck's centre is at when it touches the paddle's face
+  const float face = s->side ? paddle[0] - s->puck_radius
+                             : paddle[2] + s->puck_radius;
+  const float vx = s->puck_velocity[0];
+
+  float target = (s->arena[1] + s->arena[3]) / 2;
+  float when = 0.5f;
+  if (vx != 0 && (face - s->puck[0]) / vx > 0) {
+    when = (face - s->puck[0]) / vx;
+    target = fold(s->puck[1] + s->puck_velocity[1] * when,
+                  s->arena[1] + s->puck_radius, s->arena[3] - s->puck_radius);
+  }
+
+  // there by when, or as near as can be
+  *speed = std::clamp((target - centre) / std::max(when, 1.f / 60),
+                      -max_speed, max_speed);
+  return 1;
+}
+
+constexpr pong_bot_api api{
+    .abi_version = PONG_BOT_ABI_VERSION,
+    .name = "tracker",
+    .create = create,
+    .destroy = destroy,
+    .paddle_speed = paddle_speed,
+};
+
+} // namespace
+
+extern "C" const pong_bot_api *pong_bot() { return &api; }
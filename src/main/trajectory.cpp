@@ -0,0 +1,166 @@
+#include "trajectory.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const pong::paddle_t &paddle(const pong::arena_t &arena, pong::body_t body) {
+  return body == pong::body_t::lhs_paddle ? arena.lhs_paddle()
+                                          : arena.rhs_paddle();
+}
+
+} // namespace
+
+pong::event_t pong::event(const arena_t &arena, body_t body,
+                          std::uint64_t tick, scalar_t offset, bool in_play) {
+  event_t result{.tick = tick, .offset = offset, .body = body};
+  switch (body) {
+  case body_t::puck:
+    result.position = {arena.puck().centre()(0), arena.puck().centre()(1)};
+    result.velocity = {arena.puck().velocity()(0), arena.puck().velocity()(1)};
+    break;
+  case body_t::lhs_paddle:
+  case body_t::rhs_paddle: {
+    const auto &p = paddle(arena, body);
+    result.position = {p.box().min()(1), p.box().max()(1)};
+    result.velocity = {p.velocity()(0), p.velocity()(1)};
+    break;
+  }
+  case body_t::scores:
+    result.lhs_score = arena.lhs_score();
+    result.rhs_score = arena.rhs_score();
+    result.in_play = in_play;
+    break;
+  }
+  return result;
+}
+
+void pong::record(const arena_t &arena, const action_t &action,
+                  std::uint64_t tick, scalar_t offset, bool in_play,
+                  std::vector<event_t> &events) {
+  auto add = [&](body_t body) {
+    events.push_back(event(arena, body, tick, offset, in_play));
+  };
+  auto add_paddle = [&](const paddle_t *p) {
+    add(p == &arena.lhs_paddle() ? body_t::lhs_paddle : body_t::rhs_paddle);
+  };
+
+  switch (action.kind()) {
+  case action_t::kind_t::paddle_stops:
+    add_paddle(action.paddle());
+    break;
+  case action_t::kind_t::puck_bounces_x:
+    add(body_t::puck);
+    break;
+  case action_t::kind_t::puck_bounces_y:
+    add(body_t::puck);
+    // a wedged puck stops the paddle too
+    if (action.paddle())
+      add_paddle(action.paddle());
+    break;
+  case action_t::kind_t::lhs_scores:
+  case action_t::kind_t::rhs_scores:
+    add(body_t::scores);
+    add(body_t::puck);
+    break;
+  }
+}
+
+void pong::keyframe(const arena_t &arena, std::uint64_t tick,
+                    scalar_t tick_period, bool in_play,
+                    std::vector<event_t> &events) {
+  for (const auto body : {body_t::puck, body_t::lhs_paddle,
+                          body_t::rhs_paddle, body_t::scores})
+    events.push_back(event(arena, body, tick, tick_period, in_play));
+}
+
+pong::trajectory_t::trajectory_t(scalar_t tick_period)
+    : tick_period_{tick_period} {
+  // the parts every arena has in common
+  const arena_t arena{[]() -> std::tuple<scalar_t, vec_t> {
+    return {240.f, {1.f, 0.f}};
+  }};
+  arena_box_ = arena.box();
+  puck_radius_ = arena.puck().radius();
+  lhs_paddle_box_ = arena.lhs_paddle().box();
+  rhs_paddle_box_ = arena.rhs_paddle().box();
+}
+
+double pong::trajectory_t::time(std::uint64_t tick, scalar_t offset) const {
+  return (double(tick) - 1) * tick_period_ + double(offset);
+}
+
+bool pong::trajectory_t::apply(const event_t &e) {
+  const auto i = std::size_t(e.body);
+  if (i >= bodies)
+    return false;
+  auto &latest = latest_[i];
+  if (heard_[i] &&
+      time(e.tick, e.offset) < time(latest.tick, latest.offset))
+    return false;
+  latest = e;
+  heard_[i] = true;
+  tick_ = std::max(tick_, e.tick);
+  return true;
+}
+
+bool pong::trajectory_t::complete() const {
+  return std::ranges::all_of(heard_, [](bool heard) { return heard; });
+}
+
+std::array<pong::scalar_t, 4>
+pong::trajectory_t::paddle(body_t body, double now, bool *stopped) const {
+  const auto &e = latest_[std::size_t(body)];
+  const auto &box = body == body_t::lhs_paddle ? lhs_paddle_box_
+                                               : rhs_paddle_box_;
+  const auto size = e.position[1] - e.position[0];
+  const auto y = e.position[0] +
+                 e.velocity[1] * scalar_t(now - time(e.tick, e.offset));
+  // a paddle stops short of the top and bottom, as paddle_t::advance_time
+  // has it, whether or not the stop has been heard of yet
+  const auto clamped = std::clamp(y, arena_box_.min()(1) + 1,
+                                  arena_box_.max()(1) - size - 1);
+  if (stopped)
+    *stopped = clamped != y;
+  return {box.min()(0), clamped, box.max()(0), clamped + size};
+}
+
+pong::snapshot_t pong::trajectory_t::snapshot(std::uint64_t tick) const {
+  const double now = double(tick) * tick_period_;
+  const auto &puck = latest_[std::size_t(body_t::puck)];
+  const auto t = scalar_t(now - time(puck.tick, puck.offset));
+  const auto &scores = latest_[std::size_t(body_t::scores)];
+  return {
+      .tick = tick,
+      .puck = {puck.position[0] + puck.velocity[0] * t,
+               puck.position[1] + puck.velocity[1] * t},
+      .puck_radius = puck_radius_,
+      .lhs_paddle = paddle(body_t::lhs_paddle, now),
+      .rhs_paddle = paddle(body_t::rhs_paddle, now),
+      .lhs_score = scores.lhs_score,
+      .rhs_score = scores.rhs_score,
+      .in_play = scores.in_play,
+  };
+}
+
+void pong::trajectory_t::restore(arena_t &arena, std::uint64_t tick) const {
+  const double now = double(tick) * tick_period_;
+  const auto s = snapshot(tick);
+  const auto &puck = latest_[std::size_t(body_t::puck)];
+  arena.puck().centre() = {s.puck[0], s.puck[1]};
+  arena.puck().velocity() = {puck.velocity[0], puck.velocity[1]};
+
+  for (const auto body : {body_t::lhs_paddle, body_t::rhs_paddle}) {
+    auto &p = body == body_t::lhs_paddle ? arena.lhs_paddle()
+                                         : arena.rhs_paddle();
+    bool stopped = false;
+    const auto box = paddle(body, now, &stopped);
+    p.box().min()(1) = box[1];
+    p.box().max()(1) = box[3];
+    // by now, if not heard of yet
+    p.velocity() = {0, stopped ? 0 : latest_[std::size_t(body)].velocity[1]};
+  }
+
+  arena.lhs_score() = s.lhs_score;
+  arena.rhs_score() = s.rhs_score;
+}
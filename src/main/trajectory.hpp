@@ -0,0 +1,117 @@
+#ifndef PONG_TRAJECTORY_HPP
+#define PONG_TRAJECTORY_HPP
+
+#include "model.hpp"
+#include "simulation.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace pong {
+
+enum class body_t : std::uint8_t {
+  puck,
+  lhs_paddle,
+  rhs_paddle,
+  scores,
+};
+
+/**
+ * A change to an arena's trajectory, which is otherwise linear: a body's
+ * position (the puck's centre, a paddle's top and bottom) and velocity from
+ * the event's time on, or the scores.  An event happens offset seconds into
+ * tick, i.e. between snapshots tick - 1 and tick.
+ */
+struct event_t {
+  std::uint64_t tick{};
+  scalar_t offset{};
+  body_t body{};
+  std::array<scalar_t, 2> position{};
+  std::array<scalar_t, 2> velocity{};
+  std::uint32_t lhs_score{};
+  std::uint32_t rhs_score{};
+  bool in_play{};
+};
+
+/**
+ * a body's (or the scores') event, as it is at the time given
+ */
+event_t event(const arena_t &, body_t, std::uint64_t tick, scalar_t offset,
+              bool in_play);
+
+/**
+ * append the events an action just caused
+ */
+void record(const arena_t &, const action_t &, std::uint64_t tick,
+            scalar_t offset, bool in_play, std::vector<event_t> &);
+
+/**
+ * append every body's event and the scores, as they are at the end of tick,
+ * from which a trajectory_t can start over
+ */
+void keyframe(const arena_t &, std::uint64_t tick, scalar_t tick_period,
+              bool in_play, std::vector<event_t> &);
+
+/**
+ * An arena reconstructed from its events alone: between events each body
+ * moves in a straight line, so its position at any time follows from the
+ * body's latest event.  Events may come late, out of order or not at all
+ * (a keyframe puts things right).
+ */
+class trajectory_t {
+public:
+  explicit trajectory_t(scalar_t tick_period);
+
+  /**
+   * take an event into account, unless its body has a later one already,
+   * returning whether it was
+   */
+  bool apply(const event_t &);
+
+  /**
+   * whether every body, and the scores, have had an event
+   */
+  [[nodiscard]] bool complete() const;
+
+  /**
+   * the latest tick any event has been heard from
+   */
+  [[nodiscard]] std::uint64_t tick() const { return tick_; }
+
+  /**
+   * the arena as it is (or will be, bar events yet to be heard) at the end
+   * of tick
+   */
+  [[nodiscard]] snapshot_t snapshot(std::uint64_t tick) const;
+
+  /**
+   * put an arena's bodies, with their velocities, and scores where they are
+   * at the end of tick, so that it can be simulated on from there
+   */
+  void restore(arena_t &, std::uint64_t tick) const;
+
+private:
+  // seconds from the start of tick 1
+  [[nodiscard]] double time(std::uint64_t tick, scalar_t offset) const;
+
+  // a paddle's box at now, in seconds, and whether it has stopped at the top
+  // or bottom by then
+  [[nodiscard]] std::array<scalar_t, 4> paddle(body_t, double now,
+                                               bool *stopped = nullptr) const;
+
+  static constexpr std::size_t bodies = 4;
+
+  double tick_period_;
+  box_t arena_box_;
+  scalar_t puck_radius_;
+  box_t lhs_paddle_box_;
+  box_t rhs_paddle_box_;
+  std::array<event_t, bodies> latest_{};
+  std::array<bool, bodies> heard_{};
+  std::uint64_t tick_{};
+};
+
+} // namespace pong
+
+#endif // PONG_TRAJECTORY_HPP
@@ -0,0 +1,249 @@
+#include "ui.hpp"
+#include "trace.hpp"
+
+#include "imgui.h"
+
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+inline Eigen::Vector2f vec(ImVec2 v) { return {v.x, v.y}; }
+
+inline ImVec2 vec(Eigen::Vector2f v) { return {v(0), v(1)}; }
+
+inline ImU32 col(Eigen::Matrix<std::uint8_t, 4, 1> v) {
+  return IM_COL32(v(0), v(1), v(2), v(3));
+}
+
+/**
+ * An unsigned number formatted into a fixed buffer, rather than a
+ * std::string, so that drawing the scores doesn't allocate.
+ */
+class digits_t {
+public:
+  explicit digits_t(std::uint32_t n)
+      : size_(std::to_chars(chars_.data(), chars_.data() + chars_.size(), n)
+                  .ptr -
+              chars_.data()) {}
+
+  [[nodiscard]] const char *begin() const { return chars_.data(); }
+  [[nodiscard]] const char *end() const { return chars_.data() + size_; }
+
+private:
+  std::array<char, std::numeric_limits<std::uint32_t>::digits10 + 1> chars_;
+  std::size_t size_;
+};
+
+/**
+ * A window summarising the rolling frame profile, with buttons to dump it
+ * and the latest inputs' latencies to files.
+ */
+void profile_window(const pong::profile_t &profile,
+                    const pong::input_latency_t *latency, bool *open) {
+  ImGui::SetNextWindowBgAlpha(.8f);
+  if (ImGui::Begin("Profile", open,
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                       ImGuiWindowFlags_NoSavedSettings)) {
+    if (ImGui::BeginTable("metrics", 5,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_SizingFixedFit)) {
+      ImGui::TableSetupColumn("metric");
+      ImGui::TableSetupColumn("p50");
+      ImGui::TableSetupColumn("p99");
+      ImGui::TableSetupColumn("max");
+      ImGui::TableSetupColumn("n");
+      ImGui::TableHeadersRow();
+
+      for (int i = 0; i < int(pong::metric_t::count); ++i) {
+        const auto metric = pong::metric_t(i);
+        const auto summary = profile.summary(metric);
+        // timings are shown in microseconds, CPU use in percent of a core and
+        // counts as they are
+        const double scale =
+            metric == pong::metric_t::events_per_frame ? 1.
+            : metric == pong::metric_t::cpu_in_play ||
+                    metric == pong::metric_t::cpu_idle
+                ? .1
+                : 1e-3;
+
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(pong::name(metric).data());
+        for (auto value : {summary.p50, summary.p99, summary.max}) {
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1f", double(value) * scale);
+        }
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(summary.count));
+      }
+      ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Dump to pong-profile.csv")) {
+      std::ofstream os{"pong-profile.csv"};
+      profile.write(os);
+    }
+
+    if (latency && ImGui::Button("Write input latency to pong-latency.csv")) {
+      std::ofstream os{"pong-latency.csv"};
+      latency->write(os);
+    }
+
+#ifdef PONG_TRACE
+    if (ImGui::Button("Write trace to pong-trace.json")) {
+      std::ofstream os{"pong-trace.json"};
+      pong::trace::write(os);
+    }
+#endif
+  }
+  ImGui::End();
+}
+
+} // namespace
+
+pong::rules_t pong::rules(const settings_t &settings) {
+  return {
+      .paddle_size = settings.paddle_size,
+      .ai_skill = settings.ai_skill,
+      .winning_score = std::uint32_t(settings.winning_score),
+      .mouse_wheel_sensitivity = settings.mouse_wheel_sensitivity,
+  };
+}
+
+void pong::draw_arena(ImDrawList &draw_list, ImVec2 top_left,
+                      const layout_t &layout, const snapshot_t &state) {
+  const auto origin = vec(top_left);
+  constexpr auto solid_white = IM_COL32(255, 255, 255, 255);
+
+  auto corner = [&](const auto &box, std::size_t i) {
+    return ImVec2{origin(0) + box[i], origin(1) + box[i + 1]};
+  };
+
+  // arena outline
+  draw_list.AddRect(vec(origin + layout.box.min()),
+                    vec(origin + layout.box.max()), solid_white, 5.f,
+                    ImDrawFlags_RoundCornersAll);
+
+  // centre line
+  {
+    vec_t p1{layout.box.min()(0) +
+                 (layout.box.max()(0) - layout.box.min()(0)) / 2.f,
+             layout.box.min()(1)};
+    vec_t p2{p1(0), layout.box.max()(1)};
+    draw_list.AddLine(vec(origin + p1), vec(origin + p2), solid_white);
+  }
+
+  // scores
+  if (state.in_play) {
+    const digits_t lhs_score{state.lhs_score};
+    const digits_t rhs_score{state.rhs_score};
+    auto lhs_width = ImGui::CalcTextSize(lhs_score.begin(), lhs_score.end()).x;
+    auto rhs_width = ImGui::CalcTextSize(rhs_score.begin(), rhs_score.end()).x;
+    auto arena_width = (layout.box.max() - layout.box.min())(0);
+    auto arena_height = (layout.box.max() - layout.box.min())(1);
+    auto lhs_x = origin(0) + layout.box.min()(0) + arena_width * .25f -
+                 lhs_width / 2.f;
+    auto rhs_x = origin(0) + layout.box.min()(0) + arena_width * .75f -
+                 rhs_width / 2.f;
+    auto y = origin(1) + layout.box.min()(1) + arena_height * .125f;
+    draw_list.AddText({lhs_x, y}, solid_white, lhs_score.begin(),
+                      lhs_score.end());
+    draw_list.AddText({rhs_x, y}, solid_white, rhs_score.begin(),
+                      rhs_score.end());
+    // puck
+    draw_list.AddCircleFilled(corner(state.puck, 0), state.puck_radius,
+                              col(layout.puck_colour));
+    // lhs paddle
+    draw_list.AddRectFilled(corner(state.lhs_paddle, 0),
+                            corner(state.lhs_paddle, 2),
+                            col(layout.lhs_paddle_colour));
+
+    // rhs paddle
+    draw_list.AddRectFilled(corner(state.rhs_paddle, 0),
+                            corner(state.rhs_paddle, 2),
+                            col(layout.rhs_paddle_colour));
+  } else {
+    constexpr std::string_view s = "WINNER!";
+    const auto width = ImGui::CalcTextSize(s.data(), s.data() + s.size()).x;
+
+    auto arena_width = (layout.box.max() - layout.box.min())(0);
+    const auto x = state.lhs_score < state.rhs_score
+                       ? origin(0) + layout.box.min()(0) + arena_width * .75f -
+                             width / 2.f
+                       : origin(0) + layout.box.min()(0) + arena_width * .25f -
+                             width / 2.f;
+
+    auto arena_height = (layout.box.max() - layout.box.min())(1);
+    auto y = origin(1) + layout.box.min()(1) + arena_height * .125f;
+    draw_list.AddText({x, y}, solid_white, s.data(), s.data() + s.size());
+  }
+}
+
+pong::ui_t::ui_t(simulation_t &simulation, profile_t *profile)
+    : simulation_{simulation}, profile_{profile} {}
+
+void pong::ui_t::frame(simulation_t::clock_t::time_point now) {
+  PONG_TRACE_SCOPE("ui_t::frame");
+
+  const auto &layout = simulation_.layout();
+
+  auto viewport = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(viewport->Pos);
+  ImGui::SetNextWindowSize(viewport->Size);
+
+  if (ImGui::Begin("PONG", nullptr,
+                   ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoResize |
+                       ImGuiWindowFlags_NoMove |
+                       ImGuiWindowFlags_NoDecoration |
+                       ImGuiWindowFlags_NoBringToFrontOnFocus)) {
+    settings_t new_settings = settings_;
+    ImGui::SliderInt("AI skill", &new_settings.ai_skill,
+                     settings_t::ai_skill_min, settings_t::ai_skill_max);
+    ImGui::SliderFloat("Paddle size", &new_settings.paddle_size,
+                       settings_t::paddle_size_min,
+                       settings_t::paddle_size_max, "%.0f");
+    ImGui::SliderFloat("Mouse wheel sensitivity",
+                       &new_settings.mouse_wheel_sensitivity,
+                       settings_t::mouse_wheel_sensitivity_min,
+                       settings_t::mouse_wheel_sensitivity_max, "%.0f");
+    ImGui::SliderInt("Winning score", &new_settings.winning_score,
+                     settings_t::winning_score_min,
+                     settings_t::winning_score_max);
+
+    if (new_settings != std::exchange(settings_, new_settings)) {
+      simulation_.set_rules(rules(settings_));
+    }
+
+    if (ImGui::Button("Reset scores")) {
+      simulation_.reset_scores();
+    }
+
+    ImGui::SameLine();
+    ImGui::Checkbox("Profile (F1)", &show_profile_);
+    if (ImGui::IsKeyPressed(ImGuiKey_F1, false)) {
+      show_profile_ = !show_profile_;
+    }
+
+    if (ImGui::BeginChild("Arena", {640, 480})) {
+      const auto frame = simulation_.frame();
+      draw_arena(*ImGui::GetWindowDrawList(), ImGui::GetCursorScreenPos(),
+                 layout,
+                 interpolate(frame.previous, frame.current,
+                             simulation_.alpha(frame, now)));
+      if (auto *latency = simulation_.latency()) {
+        latency->drawn(frame.current.tick, ImGui::GetFrameCount(),
+                       simulation_t::clock_t::now());
+      }
+    }
+    ImGui::EndChild();
+  }
+  ImGui::End();
+
+  if (show_profile_ && profile_) {
+    profile_window(*profile_, simulation_.latency(), &show_profile_);
+  }
+}
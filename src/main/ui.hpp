@@ -0,0 +1,79 @@
+#ifndef PONG_UI_HPP
+#define PONG_UI_HPP
+
+#include "profile.hpp"
+#include "simulation.hpp"
+
+#include "imgui.h"
+
+namespace pong {
+
+/**
+ * The values of the settings sliders.
+ */
+struct settings_t {
+  static constexpr int ai_skill_min = rules_t::ai_skill_min;
+  static constexpr int ai_skill_default = 70;
+  static constexpr int ai_skill_max = rules_t::ai_skill_max;
+  int ai_skill = ai_skill_default;
+
+  static constexpr float paddle_size_min = 20;
+  static constexpr float paddle_size_default = 40;
+  static constexpr float paddle_size_max = 60;
+  float paddle_size = paddle_size_default;
+
+  static constexpr float mouse_wheel_sensitivity_min = 1;
+  static constexpr float mouse_wheel_sensitivity_default = 5;
+  static constexpr float mouse_wheel_sensitivity_max = 20;
+  float mouse_wheel_sensitivity = mouse_wheel_sensitivity_default;
+
+  static constexpr int winning_score_min = 5;
+  static constexpr int winning_score_default = 10;
+  static constexpr int winning_score_max = 100;
+  int winning_score = winning_score_default;
+
+  friend bool operator==(const settings_t &, const settings_t &) = default;
+};
+
+rules_t rules(const settings_t &);
+
+/**
+ * draw an arena, as the game shows it, with its top left corner at top_left;
+ * call between ImGui::NewFrame() and ImGui::Render()
+ */
+void draw_arena(ImDrawList &, ImVec2 top_left, const layout_t &,
+                const snapshot_t &);
+
+/**
+ * The game's user interface: the settings, the arena and the profile window.
+ * It only talks to ImGui, so it runs the same behind a real window or a
+ * headless context.
+ */
+class ui_t {
+public:
+  ui_t(simulation_t &, profile_t *);
+
+  ui_t(const ui_t &) = delete;
+
+  ui_t &operator=(const ui_t &) = delete;
+
+  /**
+   * build this frame's windows, showing the simulation as it is at time now;
+   * call between ImGui::NewFrame() and ImGui::Render()
+   */
+  void frame(simulation_t::clock_t::time_point now);
+
+  [[nodiscard]] const settings_t &settings() const { return settings_; }
+
+  [[nodiscard]] bool show_profile() const { return show_profile_; }
+
+private:
+  simulation_t &simulation_;
+  profile_t *profile_;
+  settings_t settings_;
+  bool show_profile_{false};
+};
+
+} // namespace pong
+
+#endif // PONG_UI_HPP
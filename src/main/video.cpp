@@ -0,0 +1,199 @@
+#include "video.hpp"
+#include "concurrency.hpp"
+#include "headless.hpp"
+#include "match.hpp"
+#include "trace.hpp"
+#include "ui.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <utility>
+
+namespace {
+
+constexpr std::uint64_t ticks_per_second = 120;
+constexpr int video_width = 640;
+constexpr int video_height = 480;
+constexpr ImU32 background = IM_COL32(0, 0, 0, 255);
+
+// framebuffers in flight between the rasterizer and the writer
+constexpr std::size_t pool_size = 4;
+
+// BT.601 limited range, as 8.8 fixed point
+inline char luma(int r, int g, int b) {
+  return char(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline char blue_difference(int r, int g, int b) {
+  return char(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline char red_difference(int r, int g, int b) {
+  return char(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+} // namespace
+
+pong::video_writer_t::video_writer_t(std::ostream &os, video_format_t format,
+                                     int fps)
+    : os_{os}, format_{format}, fps_{fps} {}
+
+void pong::video_writer_t::write(const framebuffer_t &framebuffer) {
+  PONG_TRACE_SCOPE("video_writer_t::write");
+
+  const auto pixels =
+      std::size_t(framebuffer.width()) * std::size_t(framebuffer.height());
+  buffer_.resize(pixels * 3);
+  const auto *data = framebuffer.data();
+
+  switch (format_) {
+  case video_format_t::y4m: {
+    if (!std::exchange(header_, true)) {
+      os_ << "YUV4MPEG2 W" << framebuffer.width() << " H"
+          << framebuffer.height() << " F" << fps_
+          << ":1 Ip A1:1 C444\n";
+    }
+    // planar: all of Y, then U, then V
+    auto *y = buffer_.data();
+    auto *u = y + pixels;
+    auto *v = u + pixels;
+    for (std::size_t i = 0; i < pixels; ++i) {
+      const int r = int(data[i] & 255);
+      const int g = int((data[i] >> 8) & 255);
+      const int b = int((data[i] >> 16) & 255);
+      y[i] = luma(r, g, b);
+      u[i] = blue_difference(r, g, b);
+      v[i] = red_difference(r, g, b);
+    }
+    os_ << "FRAME\n";
+    break;
+  }
+  case video_format_t::ppm:
+    for (std::size_t i = 0; i < pixels; ++i) {
+      buffer_[i * 3 + 0] = char(data[i] & 255);
+      buffer_[i * 3 + 1] = char((data[i] >> 8) & 255);
+      buffer_[i * 3 + 2] = char((data[i] >> 16) & 255);
+    }
+    os_ << "P6\n"
+        << framebuffer.width() << ' ' << framebuffer.height() << "\n255\n";
+    break;
+  }
+
+  os_.write(buffer_.data(), std::streamsize(buffer_.size()));
+}
+
+pong::video_stats_t pong::write_video(std::ostream &os,
+                                      const video_options_t &options) {
+  const auto fps = std::uint64_t(options.fps);
+  const auto max_frames =
+      std::uint64_t(std::llround(options.seconds * double(fps)));
+  const auto hold_frames =
+      std::uint64_t(std::llround(options.hold * double(fps)));
+
+  video_stats_t stats;
+
+  // stage 1: the simulation, sampled at each frame time
+  pipe_t<std::optional<snapshot_t>, 8> snapshots;
+  // stage 2 to 3: framebuffers ready to write, by index into the pool; -1
+  // ends the stream
+  pipe_t<int, pool_size> rendered;
+  // stage 3 to 2: framebuffers that have been written and can be reused
+  pipe_t<int, pool_size> free;
+
+  std::vector<framebuffer_t> pool(pool_size, {video_width, video_height});
+  for (std::size_t i = 0; i < pool_size; ++i)
+    free.push(int(i));
+
+  const auto layout = [&]() {
+    const match_t match{options.seed, options.rules};
+    return pong::layout(match.arena());
+  }();
+
+  std::jthread simulation{[&]() {
+    PONG_TRACE_THREAD_NAME("video simulation");
+
+    match_t match{options.seed, options.rules};
+
+    // time is counted in units of 1 / (ticks_per_second * fps) seconds so
+    // that both tick and frame boundaries fall exactly on a unit
+    const auto unit = scalar_t(1) / scalar_t(ticks_per_second * fps);
+    std::uint64_t now = 0;
+    std::uint64_t next_tick = 0;
+    std::uint64_t tick = 0;
+    std::uint64_t held = 0;
+
+    for (std::uint64_t frame = 0; frame < max_frames && held <= hold_frames;
+         ++frame) {
+      PONG_TRACE_SCOPE("video simulation frame");
+
+      // a tick that spans a frame boundary is split there, so each frame
+      // shows the arena exactly at its own time
+      const auto until = frame * ticks_per_second;
+      while (now < until) {
+        if (now == next_tick) {
+          match.steer();
+          next_tick += fps;
+          ++tick;
+        }
+        const auto to = std::min(until, next_tick);
+        match.advance(scalar_t(to - now) * unit);
+        now = to;
+      }
+
+      if (!match.in_play())
+        ++held;
+
+      snapshots.push(match.snapshot(tick));
+    }
+    stats.ticks = tick;
+    snapshots.push(std::nullopt);
+  }};
+
+  video_writer_t writer{os, options.format, options.fps};
+  std::jthread writing{[&]() {
+    PONG_TRACE_THREAD_NAME("video writer");
+
+    for (;;) {
+      const auto i = rendered.pop();
+      if (i < 0)
+        break;
+      if (os)
+        writer.write(pool[std::size_t(i)]);
+      free.push(i);
+    }
+  }};
+
+  // stage 2, on this thread as it owns the ImGui context
+  {
+    headless_t headless{{float(video_width), float(video_height)},
+                        1.f / float(options.fps)};
+    rasterizer_t rasterizer{options.threads};
+
+    while (const auto snapshot = snapshots.pop()) {
+      PONG_TRACE_SCOPE("video render frame");
+
+      ImGui::NewFrame();
+      draw_arena(*ImGui::GetBackgroundDrawList(), {0, 0}, layout, *snapshot);
+      ImGui::Render();
+
+      const auto i = free.pop();
+      rasterizer.render(*ImGui::GetDrawData(), pool[std::size_t(i)],
+                        background);
+      rendered.push(i);
+
+      ++stats.frames;
+      stats.last = *snapshot;
+    }
+    rendered.push(-1);
+  }
+
+  simulation.join();
+  writing.join();
+  os.flush();
+  return stats;
+}
@@ -0,0 +1,73 @@
+#ifndef PONG_VIDEO_HPP
+#define PONG_VIDEO_HPP
+
+#include "raster.hpp"
+#include "simulation.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace pong {
+
+enum class video_format_t {
+  y4m, // YUV4MPEG2, 4:4:4, BT.601 limited range
+  ppm, // concatenated binary PPM images
+};
+
+/**
+ * Writes framebuffers as a stream of raw video frames, e.g. to be piped into
+ * an encoder.
+ */
+class video_writer_t {
+public:
+  video_writer_t(std::ostream &, video_format_t, int fps);
+
+  /**
+   * write the next frame; every frame must be the same size
+   */
+  void write(const framebuffer_t &);
+
+private:
+  std::ostream &os_;
+  video_format_t format_;
+  int fps_;
+  bool header_{false};
+  std::vector<char> buffer_;
+};
+
+struct video_options_t {
+  std::mt19937::result_type seed = 4242;
+  rules_t rules{};
+  int fps = 60;
+  double seconds = 600; // stop here if the match hasn't finished
+  double hold = 2;      // seconds to keep showing the winner
+  video_format_t format = video_format_t::y4m;
+  unsigned threads = std::thread::hardware_concurrency(); // rasterizer's
+};
+
+struct video_stats_t {
+  std::size_t frames{};
+  std::size_t ticks{};
+  snapshot_t last{};
+};
+
+/**
+ * Render the AI vs AI match given by options.seed and options.rules, at a
+ * fixed frame rate, as video.  The same options always produce the same
+ * bytes.
+ *
+ * Simulation, rasterisation and writing run as a pipeline on their own
+ * threads, connected by bounded queues; a slow stage (usually the consumer of
+ * os) holds the others back rather than frames piling up.  Framebuffers come
+ * from a fixed pool, so nothing is allocated per frame.
+ *
+ * Uses its own ImGui context, so must not be called while another is in use.
+ */
+video_stats_t write_video(std::ostream &, const video_options_t &);
+
+} // namespace pong
+
+#endif // PONG_VIDEO_HPP
@@ -0,0 +1,84 @@
+#include "wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+void pong::timer_wheel_t::schedule(std::uint32_t id, std::uint64_t tick) {
+  if (id >= nodes_.size())
+    nodes_.resize(std::size_t{id} + 1);
+  if (nodes_[id].list != nil)
+    unlink(id);
+  else
+    ++size_;
+  nodes_[id].tick = std::clamp(tick, now_ + 1, now_ + span - 1);
+  insert(id);
+}
+
+void pong::timer_wheel_t::cancel(std::uint32_t id) {
+  if (id < nodes_.size() && nodes_[id].list != nil) {
+    unlink(id);
+    --size_;
+  }
+}
+
+std::optional<std::uint64_t>
+pong::timer_wheel_t::when(std::uint32_t id) const {
+  if (id >= nodes_.size() || nodes_[id].list == nil)
+    return {};
+  return nodes_[id].tick;
+}
+
+void pong::timer_wheel_t::advance(std::vector<std::uint32_t> &woken) {
+  const auto now = ++now_;
+
+  // the slots coming round on the levels above, highest first so that what
+  // they hold is cascaded all the way down
+  for (auto level = levels - 1; level > 0; --level) {
+    const auto shift = level * slot_bits;
+    if (now & ((std::uint64_t{1} << shift) - 1))
+      continue;
+    auto &head = heads_[level * slots + ((now >> shift) & (slots - 1))];
+    for (auto id = std::exchange(head, nil); id != nil;) {
+      const auto next = nodes_[id].next;
+      insert(id);
+      id = next;
+    }
+  }
+
+  auto &head = heads_[now & (slots - 1)];
+  for (auto id = std::exchange(head, nil); id != nil;) {
+    auto &node = nodes_[id];
+    const auto next = node.next;
+    node = {.tick = node.tick};
+    woken.push_back(id);
+    --size_;
+    id = next;
+  }
+}
+
+void pong::timer_wheel_t::insert(std::uint32_t id) {
+  auto &node = nodes_[id];
+  const auto delta = node.tick - now_;
+  // the level whose slots are as wide as it is far off
+  const auto level =
+      delta < slots ? 0u : unsigned(std::bit_width(delta) - 1) / slot_bits;
+  const auto slot = (node.tick >> (level * slot_bits)) & (slots - 1);
+  node.list = std::uint32_t(level * slots + slot);
+  node.prev = nil;
+  node.next = heads_[node.list];
+  if (node.next != nil)
+    nodes_[node.next].prev = id;
+  heads_[node.list] = id;
+}
+
+void pong::timer_wheel_t::unlink(std::uint32_t id) {
+  auto &node = nodes_[id];
+  if (node.prev != nil)
+    nodes_[node.prev].next = node.next;
+  else
+    heads_[node.list] = node.next;
+  if (node.next != nil)
+    nodes_[node.next].prev = node.prev;
+  node.prev = node.next = node.list = nil;
+}
@@ -0,0 +1,92 @@
+#ifndef PONG_WHEEL_HPP
+#define PONG_WHEEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pong {
+
+/**
+ * A hierarchical timer wheel of ids (small integers, e.g. slots) to be woken
+ * at given ticks.  Each level has 64 slots, a slot of level l spanning 64^l
+ * ticks; a timer goes in the level whose slots are as wide as it is far
+ * off, and is moved down a level (cascaded) once its slot comes round.
+ * Scheduling, cancelling and waking a timer are O(1) whatever the number of
+ * timers, and a tick with nothing due costs next to nothing, so that what
+ * a loop of them costs follows how many are woken rather than how many
+ * there are.
+ */
+class timer_wheel_t {
+public:
+  static constexpr unsigned slot_bits = 6;
+  static constexpr std::size_t slots = std::size_t{1} << slot_bits;
+  static constexpr unsigned levels = 4;
+
+  /**
+   * how far ahead a timer may be set; one set later is woken this far
+   * ahead, to be set again
+   */
+  static constexpr std::uint64_t span = std::uint64_t{1}
+                                        << (slot_bits * levels);
+
+  explicit timer_wheel_t(std::uint64_t now = 0) : now_{now} {}
+
+  /**
+   * the latest tick advanced to
+   */
+  [[nodiscard]] std::uint64_t now() const { return now_; }
+
+  /**
+   * the number of timers set
+   */
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  /**
+   * wake id at tick, or the next tick if that has come, instead of whenever
+   * it was to be woken
+   */
+  void schedule(std::uint32_t id, std::uint64_t tick);
+
+  void cancel(std::uint32_t id);
+
+  /**
+   * when id is to be woken, if it is
+   */
+  [[nodiscard]] std::optional<std::uint64_t> when(std::uint32_t id) const;
+
+  /**
+   * move on to the next tick, appending the ids woken then
+   */
+  void advance(std::vector<std::uint32_t> &woken);
+
+private:
+  static constexpr std::uint32_t nil = ~std::uint32_t{};
+
+  struct node_t {
+    std::uint64_t tick{};
+    std::uint32_t prev{nil};
+    std::uint32_t next{nil};
+    // the list it's in, of a level's slot, or nil
+    std::uint32_t list{nil};
+  };
+
+  // put a timer in the list its tick belongs in, from now_
+  void insert(std::uint32_t id);
+
+  void unlink(std::uint32_t id);
+
+  std::uint64_t now_;
+  std::size_t size_{};
+  std::vector<node_t> nodes_;
+  std::array<std::uint32_t, levels * slots> heads_ = [] {
+    std::array<std::uint32_t, levels * slots> heads;
+    heads.fill(nil);
+    return heads;
+  }();
+};
+
+} // namespace pong
+
+#endif // PONG_WHEEL_HPP
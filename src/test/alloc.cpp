@@ -0,0 +1,91 @@
+#include <catch2/catch_all.hpp>
+
+#include "alloc.hpp"
+#include "model.hpp"
+#include "profile.hpp"
+#include "simulation.hpp"
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <random>
+
+namespace {
+namespace p = pong;
+namespace a = p::alloc;
+namespace c = Catch;
+
+using namespace std::chrono_literals;
+
+} // namespace
+
+TEST_CASE("allocations are counted per scope") {
+  a::counts_t counts;
+  {
+    a::scope_t scope;
+    const auto i = std::make_unique<int>(1);
+    const auto v = std::make_unique<std::array<double, 4>[]>(4);
+    counts = scope.counts();
+  }
+
+  CHECK(counts.allocations == 2);
+  CHECK(counts.deallocations == 0);
+  CHECK(counts.bytes >= sizeof(int) + 4 * sizeof(std::array<double, 4>));
+}
+
+TEST_CASE("advance_time doesn't allocate") {
+  std::mt19937 prng{c::rngSeed()};
+  std::exponential_distribution<float> dt_dist{60.f};
+
+  p::arena_t arena{p::make_starter(c::rngSeed())};
+  p::ai_t lhs{prng(), 10.f};
+  p::ai_t rhs{prng(), 10.f};
+
+  std::size_t actions = 0;
+  a::counts_t counts;
+  {
+    a::scope_t scope;
+    for (int i = 0; i < 1 << 14; ++i) {
+      if (const auto s = lhs.paddle_speed(arena, arena.lhs_paddle()))
+        arena.lhs_paddle().velocity()(1) = *s;
+      if (const auto s = rhs.paddle_speed(arena, arena.rhs_paddle()))
+        arena.rhs_paddle().velocity()(1) = *s;
+      actions += arena.advance_time(dt_dist(prng));
+    }
+    counts = scope.counts();
+  }
+
+  // make sure that we actually simulated some events (bounces, scores etc.)
+  CHECK(actions > 100);
+  CHECK(counts.allocations == 0);
+}
+
+TEST_CASE("simulation ticks don't allocate") {
+  const auto period = p::simulation_t::default_tick_period;
+  const p::simulation_t::clock_t::time_point start{1s};
+
+  p::profile_t profile;
+  p::simulation_t s{p::make_starter(c::rngSeed()), c::rngSeed(), p::rules_t{}};
+  s.profile(&profile);
+
+  // warm up
+  s.advance_to(start);
+
+  a::counts_t counts;
+  {
+    a::scope_t scope;
+    for (int i = 1; i < 1 << 12; ++i) {
+      const auto now = start + period * i;
+      if (i % 16 == 0) {
+        s.set_rules({.ai_skill = 50 + i % 32});
+        s.input({now - period / 2, p::input_t::kind_t::wheel, 1.f});
+      }
+      s.advance_to(now);
+      static_cast<void>(s.frame());
+    }
+    counts = scope.counts();
+  }
+
+  CHECK(s.frame().current.tick == 1 << 12);
+  CHECK(counts.allocations == 0);
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch_all.hpp>
+
+#include "batch.hpp"
+#include "match.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+constexpr p::scalar_t dt = 1.f / 120.f;
+
+// exactly, as a batch should step its matches bit for bit as match_t does
+bool same(const p::arena_t &a, const p::arena_t &b) {
+  return a.puck().centre() == b.puck().centre() &&
+         a.puck().velocity() == b.puck().velocity() &&
+         a.lhs_paddle().box().min() == b.lhs_paddle().box().min() &&
+         a.lhs_paddle().box().max() == b.lhs_paddle().box().max() &&
+         a.lhs_paddle().velocity() == b.lhs_paddle().velocity() &&
+         a.rhs_paddle().box().min() == b.rhs_paddle().box().min() &&
+         a.rhs_paddle().box().max() == b.rhs_paddle().box().max() &&
+         a.rhs_paddle().velocity() == b.rhs_paddle().velocity() &&
+         a.lhs_score() == b.lhs_score() && a.rhs_score() == b.rhs_score();
+}
+
+} // namespace
+
+TEST_CASE("a batch steps its matches exactly as match_t::tick does") {
+  const p::rules_t rules{.ai_skill = 80, .winning_score = 3};
+  const auto seed = c::rngSeed();
+
+  // not a whole number of lanes
+  const std::size_t n = 3 * p::batch_t::lanes + 5;
+  p::batch_t batch{seed, n, rules};
+  std::vector<std::unique_ptr<p::match_t>> matches;
+  for (std::size_t i = 0; i < n; ++i)
+    matches.emplace_back(std::make_unique<p::match_t>(
+        seed + 3 * std::mt19937::result_type(i), rules));
+
+  p::batch_t::stats_t stats;
+  std::size_t actions = 0;
+  // until every match is won, some minutes at most
+  for (int t = 0; t < 120 * 60 * 10 && batch.in_play() > 0; ++t) {
+    stats += batch.tick(dt);
+    for (auto &match : matches)
+      actions += match->tick(dt);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      INFO("tick " << t << " match " << i);
+      REQUIRE(same(batch[i].arena(), matches[i]->arena()));
+    }
+  }
+
+  CHECK(batch.in_play() == 0);
+  CHECK(stats.actions == actions);
+  // most ticks are quiet
+  CHECK(stats.vectorised > stats.ticks * 9 / 10);
+}
+
+TEST_CASE("a batch run on several workers steps as one on a single thread") {
+  const auto seed = c::rngSeed();
+  const std::size_t n = 100;
+  p::batch_t one{seed, n};
+  p::batch_t many{seed, n};
+
+  const auto a = one.run(600, dt, 1);
+  const auto b = many.run(600, dt, 4);
+
+  CHECK(a.ticks == b.ticks);
+  CHECK(a.vectorised == b.vectorised);
+  CHECK(a.actions == b.actions);
+  for (std::size_t i = 0; i < n; ++i) {
+    INFO("match " << i);
+    CHECK(same(one[i].arena(), many[i].arena()));
+  }
+}
+
+TEST_CASE("a batch counts only the ticks of matches in play") {
+  p::batch_t batch{c::rngSeed(), 10, {.winning_score = 1}};
+  const auto before = batch.run(120 * 60 * 5, dt, 2);
+  REQUIRE(batch.in_play() == 0);
+  CHECK(before.ticks < 10 * 120 * 60 * 5);
+
+  const auto after = batch.run(10, dt, 2);
+  CHECK(after.ticks == 0);
+  CHECK(after.actions == 0);
+}
+
+TEST_CASE("a batch runs with more workers than lanes of matches") {
+  p::batch_t batch{c::rngSeed(), 3};
+  const auto stats = batch.run(10, dt, 16);
+  CHECK(stats.ticks == 30);
+
+  p::batch_t empty{c::rngSeed(), 0};
+  CHECK(empty.run(10, dt, 4).ticks == 0);
+}
@@ -0,0 +1,176 @@
+#include <catch2/catch_all.hpp>
+
+#include "batch.hpp"
+#include "bot.hpp"
+#include "match.hpp"
+
+#include <time.h>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+// a linked in plugin whose bots answer as the test has them
+struct fake_t {
+  // calls from which each takes slow of CPU time
+  int slow_from = 1 << 30;
+  std::chrono::nanoseconds slow{};
+  int calls = 0;
+  pong_bot_state state{};
+  // the speeds to answer in turn instead, if any
+  std::vector<float> speeds{};
+};
+
+fake_t fake;
+
+void *create(std::uint32_t) { return &fake; }
+
+void destroy(void *) {}
+
+std::chrono::nanoseconds cpu_time() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+// 100 px / s on the first call, 200 on the second and so on
+int paddle_speed(void *bot, const pong_bot_state *state, float *speed) {
+  auto &f = *static_cast<fake_t *>(bot);
+  f.state = *state;
+  if (++f.calls >= f.slow_from)
+    for (const auto start = cpu_time(); cpu_time() - start < f.slow;)
+      ;
+  *speed = f.speeds.empty()
+               ? 100.f * p::scalar_t(f.calls)
+               : f.speeds[std::size_t(f.calls - 1) % f.speeds.size()];
+  return 1;
+}
+
+constexpr pong_bot_api api{.abi_version = PONG_BOT_ABI_VERSION,
+                           .name = "fake",
+                           .create = create,
+                           .destroy = destroy,
+                           .paddle_speed = paddle_speed};
+
+} // namespace
+
+TEST_CASE("a bot plays its paddle as its plugin decides") {
+  fake = {};
+  p::plugin_t plugin{api, std::chrono::milliseconds{100}};
+  CHECK(plugin.name() == "fake");
+
+  p::match_t match{c::rngSeed()};
+  match.seat(nullptr, std::make_unique<p::bot_t>(plugin, 1));
+  match.steer();
+  CHECK(match.arena().rhs_paddle().velocity()(1) == 100.f);
+
+  // it sees the arena from its own side
+  const auto &arena = match.arena();
+  CHECK(fake.state.side == 1);
+  CHECK(fake.state.puck[0] == arena.puck().centre()(0));
+  CHECK(fake.state.puck_velocity[1] == arena.puck().velocity()(1));
+  CHECK(fake.state.rhs_paddle[3] == arena.rhs_paddle().box().max()(1));
+  CHECK(fake.state.arena[2] == arena.box().max()(0));
+
+  match.tick(dt);
+  CHECK(match.arena().rhs_paddle().velocity()(1) == 200.f);
+  CHECK(plugin.stats().cpu_ns.count() == 2);
+  CHECK(plugin.stats().over_budget == 0);
+}
+
+TEST_CASE("a bot over budget keeps its previous speed, then strikes out") {
+  fake = {.slow_from = 3, .slow = std::chrono::milliseconds{2}};
+  p::plugin_t plugin{api, std::chrono::milliseconds{1}, 3};
+
+  p::match_t match{c::rngSeed()};
+  match.seat(std::make_unique<p::bot_t>(plugin, 1), nullptr);
+  match.steer();
+  match.steer();
+  CHECK(match.arena().lhs_paddle().velocity()(1) == 200.f);
+
+  // the third and later decisions are too slow to count
+  match.steer();
+  CHECK(match.arena().lhs_paddle().velocity()(1) == 200.f);
+  CHECK(plugin.stats().over_budget == 1);
+  CHECK(plugin.stats().suspended == 0);
+
+  match.steer();
+  match.steer();
+  CHECK(plugin.stats().over_budget == 3);
+  CHECK(plugin.stats().suspended == 1);
+  CHECK(fake.calls == 5);
+
+  // and isn't asked again
+  for (int i = 0; i < 10; ++i)
+    match.steer();
+  CHECK(fake.calls == 5);
+  CHECK(match.arena().lhs_paddle().velocity()(1) == 200.f);
+}
+
+TEST_CASE("a bot's speeds are clamped, and those that aren't finite dropped") {
+  constexpr auto inf = std::numeric_limits<float>::infinity();
+  fake = {.speeds = {5000.f, inf}};
+  p::plugin_t plugin{api, std::chrono::milliseconds{100}, 3};
+
+  p::match_t match{c::rngSeed(), {.winning_score = 1000}};
+  match.seat(nullptr, std::make_unique<p::bot_t>(plugin, 1));
+  match.steer();
+  CHECK(match.arena().rhs_paddle().velocity()(1) == p::max_paddle_speed);
+  match.steer();
+  CHECK(match.arena().rhs_paddle().velocity()(1) == p::max_paddle_speed);
+  CHECK(plugin.stats().unplayable == 1);
+
+  // and a bot that only answers so strikes out, the match going on
+  fake = {.speeds = {inf, -inf, std::nanf("")}};
+  p::match_t unplayable{c::rngSeed(), {.winning_score = 1000}};
+  unplayable.seat(std::make_unique<p::bot_t>(plugin, 1),
+                  std::make_unique<p::bot_t>(plugin, 2));
+  constexpr int end = 60 * 60;
+  int t = 0;
+  for (; t < end; ++t)
+    unplayable.tick(dt);
+  CHECK(t == end);
+  CHECK(fake.calls == 6);
+  CHECK(plugin.stats().unplayable == 7);
+  CHECK(plugin.stats().suspended == 2);
+}
+
+TEST_CASE("a plugin's bots play a batch as they play match by match") {
+  p::plugin_t tracker{PONG_TRACKER_BOT, std::chrono::milliseconds{100}};
+  CHECK(tracker.name() == "tracker");
+
+  const p::rules_t rules{.ai_skill = 90, .winning_score = 5};
+  const auto seed = c::rngSeed();
+  constexpr std::size_t matches = 6;
+  p::batch_t batch{seed, matches, rules};
+  for (std::size_t i = 0; i < matches; ++i)
+    batch.seat(i, std::make_unique<p::bot_t>(tracker, 1), nullptr);
+  batch.run(60 * 60, dt, 2);
+
+  for (std::size_t i = 0; i < matches; ++i) {
+    p::match_t match{seed + 3 * std::uint32_t(i), rules};
+    match.seat(std::make_unique<p::bot_t>(tracker, 1), nullptr);
+    for (int t = 0; t < 60 * 60; ++t)
+      match.tick(dt);
+    CHECK(match.arena().puck().centre() == batch[i].arena().puck().centre());
+    CHECK(match.arena().lhs_score() == batch[i].arena().lhs_score());
+    CHECK(match.arena().rhs_score() == batch[i].arena().rhs_score());
+  }
+  CHECK(tracker.stats().cpu_ns.count() > 0);
+  CHECK(tracker.stats().suspended == 0);
+}
+
+TEST_CASE("what isn't a bot plugin isn't loaded") {
+  CHECK_THROWS_AS((p::plugin_t{"/nonexistent/bot.so", {}}),
+                  std::runtime_error);
+}
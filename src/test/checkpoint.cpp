@@ -0,0 +1,131 @@
+#include <catch2/catch_all.hpp>
+
+#include "checkpoint.hpp"
+#include "match.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+// play a match on to tick end as a server would: numbered commands now and
+// then, some for ticks ahead, skipping what needn't be ticked
+void play(p::remote_match_t &match, std::uint64_t end) {
+  while (match.ticks() < end) {
+    const auto t = match.ticks();
+    if (t % 7 == 0)
+      match.command(std::uint32_t(t / 7 + 1), t % 3 ? 400.f : -700.f,
+                    t + t % 4);
+    const auto next = std::min(match.next_tick(dt, 60), end);
+    match.skip(next - t - 1, dt);
+    match.tick(dt);
+  }
+}
+
+// every last bit of two matches' states is the same
+void check_same(const p::remote_match_t &a, const p::remote_match_t &b) {
+  auto sa = std::make_unique<p::remote_match_t::state_t>();
+  auto sb = std::make_unique<p::remote_match_t::state_t>();
+  a.save(*sa);
+  b.save(*sb);
+  CHECK(sa->rules == sb->rules);
+  CHECK(sa->puck == sb->puck);
+  CHECK(sa->lhs_paddle == sb->lhs_paddle);
+  CHECK(sa->rhs_paddle == sb->rhs_paddle);
+  CHECK(sa->lhs_score == sb->lhs_score);
+  CHECK(sa->rhs_score == sb->rhs_score);
+  CHECK(sa->starter() == sb->starter());
+  CHECK(sa->ai.prng == sb->ai.prng);
+  CHECK(sa->ai.error_dist == sb->ai.error_dist);
+  CHECK(sa->ai.last_estimate == sb->ai.last_estimate);
+  CHECK(sa->speed == sb->speed);
+  CHECK(sa->acted == sb->acted);
+  CHECK(sa->ticks == sb->ticks);
+  CHECK(sa->acknowledged == sb->acknowledged);
+  CHECK(sa->scheduled_count == sb->scheduled_count);
+}
+
+// a file of the test's own, gone with it
+struct temporary_t {
+  std::string path = "/tmp/pong-checkpoint-" + std::to_string(::getpid()) +
+                     "-" + std::to_string(c::rngSeed());
+
+  temporary_t() { std::remove(path.c_str()); }
+
+  ~temporary_t() { std::remove(path.c_str()); }
+};
+
+} // namespace
+
+TEST_CASE("a match made from another's state carries on exactly as it") {
+  const p::rules_t rules{.ai_skill = 60, .winning_score = 100};
+  p::remote_match_t match{c::rngSeed(), rules};
+  play(match, 60 * 30);
+  const auto scores = match.arena().lhs_score() + match.arena().rhs_score();
+
+  auto state = std::make_unique<p::remote_match_t::state_t>();
+  match.save(*state);
+  p::remote_match_t resumed{*state};
+  check_same(match, resumed);
+
+  // through enough points for the starter to have been drawn from again
+  play(match, 60 * 300);
+  play(resumed, 60 * 300);
+  CHECK(match.arena().lhs_score() + match.arena().rhs_score() > scores);
+  check_same(match, resumed);
+  CHECK(match.snapshot().puck == resumed.snapshot().puck);
+}
+
+TEST_CASE("a checkpoint's halves take turns, the newer standing") {
+  const temporary_t file;
+  const std::chrono::nanoseconds period{16'666'667};
+  {
+    p::checkpoint_t checkpoint{file.path, 2, 8, period};
+    CHECK(!checkpoint.latest(0));
+
+    auto half = checkpoint.begin(1);
+    REQUIRE(half);
+    half->header->tick = 100;
+    half->header->slots = 1;
+    half->slots[0].used = true;
+    half->slots[0].generation = 3;
+    checkpoint.commit(1, *half);
+    checkpoint.flush();
+    REQUIRE(checkpoint.latest(1));
+    CHECK(checkpoint.latest(1)->index == half->index);
+
+    // written into the other half, which only becomes the newer once it's
+    // committed
+    auto next = checkpoint.begin(1);
+    REQUIRE(next);
+    CHECK(next->index != half->index);
+    next->header->tick = 200;
+    next->header->slots = 1;
+    next->slots[0] = half->slots[0];
+    ++next->slots[0].generation;
+    CHECK(checkpoint.latest(1)->header->tick == 100);
+    checkpoint.commit(1, *next);
+  }
+
+  p::checkpoint_t checkpoint{file.path, 2, 8, period};
+  CHECK(!checkpoint.latest(0));
+  const auto latest = checkpoint.latest(1);
+  REQUIRE(latest);
+  CHECK(latest->header->tick == 200);
+  CHECK(latest->slots[0].generation == 4);
+
+  // not one of these options
+  CHECK_THROWS_AS((p::checkpoint_t{file.path, 3, 8, period}),
+                  std::runtime_error);
+  CHECK_THROWS_AS((p::checkpoint_t{file.path, 2, 8, period * 2}),
+                  std::runtime_error);
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch_all.hpp>
+
+#include "damage.hpp"
+#include "headless_fixture.hpp"
+#include "simulation.hpp"
+#include "ui.hpp"
+
+#include "imgui.h"
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+// the game's frames, and the damage each does to the one before
+struct fixture_t : p::headless_fixture_t {
+  explicit fixture_t(const p::rules_t &rules = {})
+      : simulation{p::make_starter(c::rngSeed()), c::rngSeed(), rules},
+        ui{simulation, nullptr} {}
+
+  ImVec4 frame() {
+    return damage.update(build([this](clock_t::time_point now) {
+      simulation.advance_to(now);
+      ui.frame(now);
+    }));
+  }
+
+  p::simulation_t simulation;
+  p::ui_t ui;
+  p::damage_t damage;
+};
+
+bool contains(const ImVec4 &outer, const ImVec4 &inner) {
+  return outer.x <= inner.x && outer.y <= inner.y && inner.z <= outer.z &&
+         inner.w <= outer.w;
+}
+
+} // namespace
+
+TEST_CASE("the first frame is damaged in full") {
+  fixture_t f;
+  const auto damage = f.frame();
+  CHECK(damage.x == 0);
+  CHECK(damage.y == 0);
+  CHECK(damage.z == 660);
+  CHECK(damage.w == 660);
+}
+
+TEST_CASE("frames in play damage the arena only") {
+  fixture_t f;
+  f.frame();
+
+  const ImVec4 display{0, 0, 660, 660};
+  for (int i = 0; i < 60; ++i) {
+    const auto damage = f.frame();
+    INFO(i);
+    REQUIRE(!p::empty(damage));
+    REQUIRE(contains(display, damage));
+    // the settings above the arena don't change
+    CHECK(damage.y > 0);
+    CHECK(damage.w - damage.y < 660);
+  }
+}
+
+TEST_CASE("the winner screen isn't redrawn") {
+  fixture_t f{{.ai_skill = 95, .winning_score = 1}};
+
+  // a few minutes at 60 fps
+  for (int i = 0; i < 60 * 60 * 5 && !f.simulation.idle(); ++i)
+    f.frame();
+  REQUIRE(f.simulation.idle());
+
+  // the last frame in play and the first of the winner screen differ
+  f.frame();
+  f.frame();
+  for (int i = 0; i < 60; ++i) {
+    INFO(i);
+    CHECK(p::empty(f.frame()));
+  }
+
+  // until the window is exposed or resized
+  f.damage.invalidate();
+  CHECK(!p::empty(f.frame()));
+  CHECK(p::empty(f.frame()));
+
+  f.headless.io().DisplaySize = {800, 600};
+  const auto damage = f.frame();
+  CHECK(damage.z == 800);
+  CHECK(damage.w == 600);
+}
+
+TEST_CASE("hovering a widget damages the frame until it settles") {
+  fixture_t f{{.ai_skill = 95, .winning_score = 1}};
+  for (int i = 0; i < 60 * 60 * 5 && !f.simulation.idle(); ++i)
+    f.frame();
+  for (int i = 0; i < 3; ++i)
+    f.frame();
+  REQUIRE(p::empty(f.frame()));
+
+  // over the settings sliders, which highlight when hovered
+  bool damaged = false;
+  for (float y = 5; y < 100; y += 5) {
+    f.headless.io().AddMousePosEvent(100, y);
+    damaged = damaged || !p::empty(f.frame());
+  }
+  CHECK(damaged);
+
+  // the hover highlight stays put while the mouse does
+  f.frame();
+  f.frame();
+  CHECK(p::empty(f.frame()));
+}
@@ -0,0 +1,168 @@
+#include <catch2/catch_all.hpp>
+
+#include "feed.hpp"
+#include "host.hpp"
+#include "net.hpp"
+#include "protocol.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace {
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace c = Catch;
+
+auto now() { return std::chrono::steady_clock::now(); }
+
+// a name no other test run uses at the same time
+std::string name(const char *what) {
+  return std::string{"/pong-test-"} + what + '-' + std::to_string(::getpid());
+}
+
+// a state whose every field follows from n, to tell a torn one by
+p::feed_state_t state(std::uint64_t n) {
+  const auto x = p::scalar_t(n % 1000);
+  return {.match = n,
+          .tick = n * 3,
+          .arena = {x, x, x, x},
+          .puck = {x, -x},
+          .puck_velocity = {-x, x},
+          .puck_radius = x,
+          .lhs_paddle = {x, x, x, x},
+          .lhs_velocity = x,
+          .rhs_paddle = {x, x, x, x},
+          .rhs_velocity = x,
+          .lhs_score = std::uint32_t(n),
+          .rhs_score = std::uint32_t(n),
+          .in_play = 1};
+}
+
+} // namespace
+
+TEST_CASE("a feed carries states and commands between its handles") {
+  p::feed_t host{name("handles"), 3, std::chrono::microseconds{16'666}};
+  p::feed_t bot{name("handles")};
+  CHECK(bot.arenas() == 3);
+  CHECK(bot.tick_period() == std::chrono::microseconds{16'666});
+
+  CHECK(bot.published(1) == 0);
+  CHECK_FALSE(bot.latest(1));
+  for (std::uint64_t n = 1; n <= p::feed_t::states + 3; ++n)
+    host.publish(1, state(n));
+  CHECK(bot.published(1) == p::feed_t::states + 3);
+  REQUIRE(bot.latest(1));
+  CHECK(bot.latest(1)->match == p::feed_t::states + 3);
+  CHECK(bot.published(0) == 0);
+
+  CHECK_FALSE(host.command(2));
+  for (std::size_t i = 0; i < p::feed_t::commands; ++i)
+    CHECK(bot.command(2, {.match = 7, .tick = i, .speed = 1.5f}));
+  // a bot the host doesn't keep up with finds the ring full
+  CHECK_FALSE(bot.command(2, {.match = 7}));
+  for (std::size_t i = 0; i < p::feed_t::commands; ++i) {
+    const auto command = host.command(2);
+    REQUIRE(command);
+    CHECK(command->match == 7);
+    CHECK(command->tick == i);
+    CHECK(command->speed == 1.5f);
+  }
+  CHECK_FALSE(host.command(2));
+  CHECK_FALSE(host.command(0));
+}
+
+TEST_CASE("a feed that isn't there isn't opened") {
+  CHECK_THROWS(p::feed_t{name("missing")});
+
+  // nor is one gone with its host
+  { p::feed_t host{name("gone"), 1, std::chrono::milliseconds{1}}; }
+  CHECK_THROWS(p::feed_t{name("gone")});
+}
+
+TEST_CASE("a state read as it is published is never torn") {
+  p::feed_t host{name("torn"), 1, std::chrono::microseconds{1}};
+  const p::feed_t bot{name("torn")};
+
+  // on until the reader has read plenty, however the two are scheduled
+  std::atomic<std::uint64_t> reads{0};
+  std::atomic<std::uint64_t> written{0};
+  std::thread writer{[&] {
+    std::uint64_t n = 0;
+    while (reads < 100'000 || n < 100'000)
+      host.publish(0, state(++n));
+    written = n;
+  }};
+
+  std::uint64_t last = 0;
+  while (!written) {
+    const auto read = bot.latest(0);
+    if (!read)
+      continue;
+    ++reads;
+    const auto expected = state(read->match);
+    REQUIRE(read->tick == expected.tick);
+    REQUIRE(read->puck == expected.puck);
+    REQUIRE(read->rhs_paddle == expected.rhs_paddle);
+    REQUIRE(read->rhs_score == expected.rhs_score);
+    // and never goes back
+    REQUIRE(read->match >= last);
+    last = read->match;
+  }
+  writer.join();
+  CHECK(bot.latest(0)->match == written);
+}
+
+TEST_CASE("a bot on a server's feed steers its match's lhs paddle") {
+  p::server_t server{{.loops = 1,
+                      .rules = {.ai_skill = 80, .winning_score = 100},
+                      .seed = c::rngSeed(),
+                      .max_matches = 4,
+                      .feed = name("server"),
+                      .pin = false}};
+  server.start();
+  const p::feed_t feed{name("server")};
+  CHECK(feed.arenas() == 4);
+
+  const p::udp_socket_t player;
+  p::datagrams_t out{1};
+  out.commit(
+      pr::encode(pr::join_t{.nonce = 42}, out.prepare(server.address())));
+  REQUIRE(out.send(player) == 1);
+
+  // the arena the match is published to
+  std::optional<std::size_t> arena;
+  const auto deadline = now() + std::chrono::seconds{2};
+  while (!arena && now() < deadline)
+    for (std::size_t i = 0; i < feed.arenas(); ++i)
+      if (const auto s = feed.latest(i); s && s->match && s->in_play)
+        arena = i;
+  REQUIRE(arena);
+  const auto match = feed.latest(*arena)->match;
+
+  // commands for another match are ignored
+  p::feed_t bot{name("server")};
+  REQUIRE(bot.command(*arena, {.match = match + 1, .speed = -77}));
+  REQUIRE(bot.command(*arena, {.match = match, .speed = 123}));
+  std::optional<p::feed_state_t> steered;
+  while (now() < deadline) {
+    steered = feed.latest(*arena);
+    REQUIRE(steered);
+    REQUIRE(steered->lhs_velocity != -77);
+    if (steered->lhs_velocity == 123)
+      break;
+  }
+  CHECK(steered->lhs_velocity == 123);
+
+  // and it keeps to it, without the AI's say
+  const auto tick = steered->tick;
+  while (feed.latest(*arena)->tick < tick + 5 && now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  CHECK(feed.latest(*arena)->lhs_velocity == 123);
+
+  server.stop();
+}
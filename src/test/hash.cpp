@@ -0,0 +1,127 @@
+#include <catch2/catch_all.hpp>
+
+#include "hash.hpp"
+#include "match.hpp"
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+void tick(p::arena_t &arena, p::hash_history_t &history) {
+  arena.advance_time(dt, [&](p::scalar_t t, const p::action_t &action) {
+    history.action(arena, t, action);
+  });
+  history.end_tick();
+}
+
+// steer the lhs paddle, as a match would
+void steer(p::arena_t &arena, p::hash_history_t &history, p::scalar_t speed) {
+  arena.lhs_paddle().velocity()(1) = speed;
+  history.steer(arena.lhs_paddle());
+}
+
+// the first tick after from with as many actions as given
+std::uint64_t find_tick(std::mt19937::result_type seed, std::uint64_t from,
+                        std::size_t actions) {
+  p::arena_t arena{p::make_starter(seed)};
+  p::hash_history_t history{arena};
+  for (;;) {
+    tick(arena, history);
+    if (history.ticks() > from &&
+        history.actions(history.ticks())->size() == actions)
+      return history.ticks();
+  }
+}
+
+} // namespace
+
+TEST_CASE("matches played alike hash alike, tick by tick") {
+  p::match_t a{c::rngSeed(), {.winning_score = 2}};
+  p::match_t b{c::rngSeed(), {.winning_score = 2}};
+  p::match_t other{c::rngSeed() + 1, {.winning_score = 2}};
+  constexpr std::size_t ticks = 60 * 60;
+  p::hash_history_t ha{a.arena(), ticks}, hb{b.arena(), ticks},
+      hother{other.arena(), ticks};
+  std::size_t actions = 0;
+  for (std::size_t t = 0; t < ticks; ++t) {
+    actions += a.tick(dt, ha);
+    b.tick(dt, hb);
+    other.tick(dt, hother);
+    REQUIRE(ha.hash() == hb.hash());
+  }
+  CHECK(actions > 0);
+  CHECK(ha.ticks() == ticks);
+  CHECK_FALSE(p::first_divergence(ha, hb));
+
+  // the puck starts off elsewhere
+  const auto divergence = p::first_divergence(ha, hother);
+  REQUIRE(divergence);
+  CHECK(divergence->tick == 1);
+}
+
+TEST_CASE("a desync is pinpointed to its tick and action") {
+  const auto seed = c::rngSeed();
+  // a tick with an action in it
+  const auto when = find_tick(seed, 100, 1);
+
+  p::arena_t a{p::make_starter(seed)};
+  p::arena_t b{p::make_starter(seed)};
+  p::hash_history_t ha{a}, hb{b};
+  for (std::uint64_t t = 1; t <= when + 100; ++t) {
+    // b's arithmetic rounds differently, once
+    if (t == when)
+      b.puck().centre()(0) += 1e-3f;
+    tick(a, ha);
+    tick(b, hb);
+  }
+
+  const auto divergence = p::first_divergence(ha, hb);
+  REQUIRE(divergence);
+  CHECK(divergence->tick == when);
+  REQUIRE(divergence->action);
+  CHECK(*divergence->action == 0);
+}
+
+TEST_CASE("a desync between actions is pinpointed to its tick") {
+  const auto seed = c::rngSeed();
+  const auto when = find_tick(seed, 100, 0);
+
+  p::arena_t a{p::make_starter(seed)};
+  p::arena_t b{p::make_starter(seed)};
+  p::hash_history_t ha{a}, hb{b};
+  for (std::uint64_t t = 1; t <= when + 100; ++t) {
+    // a paddle steered differently
+    if (t == when) {
+      steer(a, ha, -1);
+      steer(b, hb, 1);
+    }
+    tick(a, ha);
+    tick(b, hb);
+  }
+
+  const auto divergence = p::first_divergence(ha, hb);
+  REQUIRE(divergence);
+  CHECK(divergence->tick == when);
+  CHECK_FALSE(divergence->action);
+}
+
+TEST_CASE("only the latest ticks' hashes are kept") {
+  p::arena_t arena{p::make_starter(c::rngSeed())};
+  p::hash_history_t history{arena, 16, 4};
+  for (int t = 0; t < 100; ++t)
+    tick(arena, history);
+
+  CHECK(history.first() == 85);
+  CHECK_FALSE(history.hash(84));
+  CHECK(history.hash(100) == history.hash());
+  CHECK_FALSE(history.hash(101));
+
+  // and their actions, as long as there are few enough
+  std::size_t kept = 0;
+  for (std::uint64_t t = 85; t <= 100; ++t)
+    if (const auto actions = history.actions(t))
+      kept += actions->size();
+  CHECK(kept <= 4);
+}
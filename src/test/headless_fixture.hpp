@@ -0,0 +1,44 @@
+#ifndef PONG_HEADLESS_FIXTURE_HPP
+#define PONG_HEADLESS_FIXTURE_HPP
+
+#include "headless.hpp"
+#include "simulation.hpp"
+
+#include "imgui.h"
+
+#include <chrono>
+
+namespace pong {
+
+/**
+ * The UI tests' common fixture: a headless context, and the times of the
+ * frames built in it, every other tick from a second in.  Tests derive
+ * their own, with what they draw.
+ */
+struct headless_fixture_t {
+  using clock_t = simulation_t::clock_t;
+
+  explicit headless_fixture_t(ImVec2 display_size = {660, 660})
+      : headless{display_size} {}
+
+  /**
+   * build the next frame, of what draw(now) submits
+   */
+  template <typename F> const ImDrawData &build(F &&draw) {
+    const auto now = start + period * frames++;
+    ImGui::NewFrame();
+    draw(now);
+    ImGui::Render();
+    return *ImGui::GetDrawData();
+  }
+
+  headless_t headless;
+
+  const clock_t::time_point start{std::chrono::seconds{1}};
+  const clock_t::duration period = simulation_t::default_tick_period * 2;
+  int frames = 0;
+};
+
+} // namespace pong
+
+#endif // PONG_HEADLESS_FIXTURE_HPP
@@ -0,0 +1,136 @@
+#include <catch2/catch_all.hpp>
+
+#include "latency.hpp"
+#include "match.hpp"
+#include "simulation.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+using namespace std::chrono_literals;
+
+using time_point = p::input_latency_t::clock_t::time_point;
+
+} // namespace
+
+TEST_CASE("inputs are timed through every stage") {
+  p::profile_t profile;
+  p::input_latency_t latency{&profile};
+  const time_point t{1h};
+
+  latency.received(t);
+  latency.applied(t, 5, t + 1ms);
+
+  // a tick before the input's doesn't show it
+  latency.advanced(4, t + 2ms);
+  latency.drawn(4, 10, t + 3ms);
+  latency.advanced(5, t + 4ms);
+
+  // nor does a frame drawn before the tick was published
+  latency.presented(10, t + 5ms);
+  latency.drawn(6, 11, t + 7ms);
+  latency.presented(10, t + 8ms);
+  CHECK(latency.completed() == 0);
+
+  latency.presented(11, t + 10ms);
+  REQUIRE(latency.completed() == 1);
+
+  const auto ms = [&](p::metric_t metric) {
+    const auto s = profile.summary(metric);
+    REQUIRE(s.count == 1);
+    return std::chrono::nanoseconds{s.p50};
+  };
+  // to the histogram's resolution
+  CHECK(ms(p::metric_t::input_apply) >= 1ms);
+  CHECK(ms(p::metric_t::input_apply) < 1050us);
+  CHECK(ms(p::metric_t::input_advance) >= 3ms);
+  CHECK(ms(p::metric_t::input_advance) < 3150us);
+  CHECK(ms(p::metric_t::input_draw) >= 3ms);
+  CHECK(ms(p::metric_t::input_draw) < 3150us);
+  CHECK(ms(p::metric_t::input_present) >= 3ms);
+  CHECK(ms(p::metric_t::input_present) < 3150us);
+  CHECK(ms(p::metric_t::input_latency) >= 10ms);
+  CHECK(ms(p::metric_t::input_latency) < 10500us);
+}
+
+TEST_CASE("inputs are matched by their timestamps") {
+  p::input_latency_t latency;
+  const time_point t{1h};
+
+  latency.received(t);
+  latency.received(t + 1ms);
+  latency.received(t + 2ms);
+
+  // applied out of order and in different ticks
+  latency.applied(t + 2ms, 1, t + 3ms);
+  latency.applied(t, 1, t + 3ms);
+  latency.advanced(1, t + 4ms);
+  latency.drawn(1, 1, t + 5ms);
+  latency.presented(1, t + 6ms);
+  CHECK(latency.completed() == 2);
+
+  latency.applied(t + 1ms, 2, t + 7ms);
+  latency.advanced(2, t + 8ms);
+  latency.drawn(2, 2, t + 9ms);
+  latency.presented(2, t + 10ms);
+  CHECK(latency.completed() == 3);
+
+  std::ostringstream os;
+  latency.write(os);
+  CHECK(os.str() == "tick,frame,applied,advanced,drawn,presented\n"
+                    "1,1,3000000,4000000,5000000,6000000\n"
+                    "1,1,1000000,2000000,3000000,4000000\n"
+                    "2,2,6000000,7000000,8000000,9000000\n");
+}
+
+TEST_CASE("the oldest inputs in flight are forgotten") {
+  p::input_latency_t latency;
+  const time_point t{1h};
+
+  for (std::size_t i = 0; i < p::input_latency_t::in_flight + 1; ++i)
+    latency.received(t + 1ms * i);
+  for (std::size_t i = 0; i < p::input_latency_t::in_flight + 1; ++i)
+    latency.applied(t + 1ms * i, 1, t + 1s);
+  latency.advanced(1, t + 1s);
+  latency.drawn(1, 1, t + 1s);
+  latency.presented(1, t + 1s);
+
+  CHECK(latency.completed() == p::input_latency_t::in_flight);
+}
+
+TEST_CASE("the simulation stamps the inputs it applies") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{p::make_starter(c::rngSeed()), c::rngSeed(),
+                    p::rules_t{}};
+  p::input_latency_t latency;
+  s.latency(&latency);
+
+  const p::simulation_t::clock_t::time_point start{1s};
+  s.advance_to(start);
+
+  const auto input = start + period / 2;
+  latency.received(input);
+  s.input({input, p::input_t::kind_t::wheel, 1.f});
+
+  // the input lands in the second tick
+  s.advance_to(start + period);
+  const auto tick = s.frame().current.tick;
+  REQUIRE(tick == 2);
+
+  latency.drawn(tick - 1, 1, p::input_latency_t::clock_t::now());
+  latency.presented(1, p::input_latency_t::clock_t::now());
+  CHECK(latency.completed() == 0);
+
+  latency.drawn(tick, 2, p::input_latency_t::clock_t::now());
+  latency.presented(2, p::input_latency_t::clock_t::now());
+  CHECK(latency.completed() == 1);
+
+  std::ostringstream os;
+  latency.write(os);
+  CHECK(os.str().find("\n2,2,") != std::string::npos);
+}
@@ -206,6 +206,28 @@ TEST_CASE("puck collides with moving paddle") {
   CHECK(a.puck().velocity()(1) == -puck_velocity(1));
 }
 
+TEST_CASE("puck wedged between a paddle and the arena boundary") {
+  p::arena_t a{make_starter()};
+
+  // the paddle closing on the puck faster than the puck can get away, with
+  // the puck against the south boundary and under the paddle's corner
+  a.rhs_paddle().box().translate(
+      p::vec_t{0, a.box().max()(1) - a.rhs_paddle().box().max()(1) - 10});
+  a.rhs_paddle().velocity() = p::vec_t{0, 209.085449f};
+  a.puck().centre() =
+      p::vec_t{620, a.box().max()(1) - a.puck().radius()};
+  a.puck().velocity() = p::vec_t{110.431198f, 209.087189f};
+
+  // rather than bouncing between them forever
+  a.advance_time(1.f / 60.f);
+  CHECK(a.puck().velocity()(1) == 0.f);
+  CHECK(a.rhs_paddle().velocity()(1) == 0.f);
+
+  // it slides out from under the paddle and on to score
+  a.advance_time(1.f);
+  CHECK(a.lhs_score() == 1);
+}
+
 TEST_CASE("linear_oscillation") {
   std::vector<std::uint64_t> positions;
 
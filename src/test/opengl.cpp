@@ -0,0 +1,348 @@
+#include <catch2/catch_all.hpp>
+
+#include "headless.hpp"
+#include "spectator.hpp"
+
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+
+// EGL first: the loader only defines the khrplatform types if nothing else has
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "imgui_impl_opengl3_loader.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+using namespace std::chrono_literals;
+
+constexpr int width = 640;
+constexpr int height = 480;
+
+// what the backend asked of GL while rendering a frame
+struct gl_counts_t {
+  std::size_t calls{};
+  std::size_t buffer_data{};     // glBufferData, uploading or orphaning
+  std::size_t buffer_sub_data{}; // glBufferSubData
+  std::size_t bytes{};           // uploaded by either
+};
+
+gl_counts_t counts;
+
+// the backend calls GL through the loader's table of function pointers, so
+// every entry is swapped for one that counts the call and forwards it
+std::array<GL3WglProc, IM_ARRAYSIZE(ImGL3WProcs::ptr)> forward;
+
+template <std::size_t I, typename R, typename... A> R counted(A... a) {
+  ++counts.calls;
+  return reinterpret_cast<R (*)(A...)>(forward[I])(a...);
+}
+
+template <std::size_t I, typename R, typename... A> void count(R (*&f)(A...)) {
+  forward[I] = reinterpret_cast<GL3WglProc>(f);
+  f = counted<I, R, A...>;
+}
+
+#define PONG_GL_FUNCTIONS(X)                                                   \
+  X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindSampler)                \
+  X(BindTexture) X(BindVertexArray) X(BlendEquation)                           \
+  X(BlendEquationSeparate) X(BlendFuncSeparate) X(BufferData)                  \
+  X(BufferSubData) X(Clear) X(ClearColor) X(CompileShader) X(CreateProgram)    \
+  X(CreateShader) X(DeleteBuffers) X(DeleteProgram) X(DeleteShader)            \
+  X(DeleteTextures) X(DeleteVertexArrays) X(DetachShader) X(Disable)           \
+  X(DisableVertexAttribArray) X(DrawElements) X(DrawElementsBaseVertex)        \
+  X(Enable) X(EnableVertexAttribArray) X(Flush) X(GenBuffers) X(GenTextures)   \
+  X(GenVertexArrays) X(GetAttribLocation) X(GetError) X(GetIntegerv)           \
+  X(GetProgramInfoLog) X(GetProgramiv) X(GetShaderInfoLog) X(GetShaderiv)      \
+  X(GetString) X(GetStringi) X(GetUniformLocation)                             \
+  X(GetVertexAttribPointerv) X(GetVertexAttribiv) X(IsEnabled) X(IsProgram)    \
+  X(LinkProgram) X(PixelStorei) X(PolygonMode) X(ReadPixels) X(Scissor)        \
+  X(ShaderSource) X(TexImage2D) X(TexParameteri) X(Uniform1i)                  \
+  X(UniformMatrix4fv) X(UseProgram) X(VertexAttribPointer) X(Viewport)
+
+#define PONG_COUNT(NAME)                                                       \
+  count<offsetof(decltype(imgl3wProcs.gl), NAME) / sizeof(GL3WglProc)>(        \
+      imgl3wProcs.gl.NAME);
+
+void count_calls() {
+  PONG_GL_FUNCTIONS(PONG_COUNT)
+
+  // and the uploads are measured on the way through
+  static PFNGLBUFFERDATAPROC buffer_data;
+  static PFNGLBUFFERSUBDATAPROC buffer_sub_data;
+  buffer_data = imgl3wProcs.gl.BufferData;
+  buffer_sub_data = imgl3wProcs.gl.BufferSubData;
+  imgl3wProcs.gl.BufferData = [](GLenum target, GLsizeiptr size,
+                                 const void *data, GLenum usage) {
+    ++counts.buffer_data;
+    counts.bytes += data != nullptr ? std::size_t(size) : 0;
+    buffer_data(target, size, data, usage);
+  };
+  imgl3wProcs.gl.BufferSubData = [](GLenum target, GLintptr offset,
+                                    GLsizeiptr size, const void *data) {
+    ++counts.buffer_sub_data;
+    counts.bytes += std::size_t(size);
+    buffer_sub_data(target, offset, size, data);
+  };
+}
+
+#undef PONG_COUNT
+#undef PONG_GL_FUNCTIONS
+
+// a GL ES context on an offscreen surface, from Mesa's software rasterizer
+// (llvmpipe) so the results don't depend on the machine's GPU.  ctest runs
+// these tests with MESA_GLES_VERSION_OVERRIDE=3.2 and again with 3.0, which
+// takes away the base vertex draws
+class context_t {
+public:
+  context_t() {
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+    const auto get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display == nullptr)
+      return;
+    display_ = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, nullptr);
+    if (display_ == EGL_NO_DISPLAY ||
+        !eglInitialize(display_, nullptr, nullptr))
+      return;
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE,
+        EGL_OPENGL_ES2_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE,
+        8, EGL_ALPHA_SIZE, 8, EGL_NONE};
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(display_, config_attributes, &config, 1, &configs) ||
+        configs == 0)
+      return;
+
+    const EGLint surface_attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height,
+                                         EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surface_attributes);
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint context_attributes[] = {EGL_CONTEXT_CLIENT_VERSION, 2,
+                                         EGL_NONE};
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT,
+                                context_attributes);
+    current_ = surface_ != EGL_NO_SURFACE && context_ != EGL_NO_CONTEXT &&
+               eglMakeCurrent(display_, surface_, surface_, context_);
+  }
+
+  context_t(const context_t &) = delete;
+
+  context_t &operator=(const context_t &) = delete;
+
+  ~context_t() {
+    if (display_ == EGL_NO_DISPLAY)
+      return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_ != EGL_NO_CONTEXT)
+      eglDestroyContext(display_, context_);
+    if (surface_ != EGL_NO_SURFACE)
+      eglDestroySurface(display_, surface_);
+    eglTerminate(display_);
+  }
+
+  explicit operator bool() const { return current_; }
+
+private:
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+  EGLContext context_ = EGL_NO_CONTEXT;
+  bool current_ = false;
+};
+
+// the GL backend on a headless context, as the game sets it up
+struct backend_t {
+  backend_t() : headless{{float(width), float(height)}} {
+    // the backend only claims this on GL 3.2+ / ES 3.2+
+    headless.io().BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+    ImGui_ImplOpenGL3_Init("#version 100");
+    count_calls();
+  }
+
+  backend_t(const backend_t &) = delete;
+
+  backend_t &operator=(const backend_t &) = delete;
+
+  ~backend_t() { ImGui_ImplOpenGL3_Shutdown(); }
+
+  template <typename F> ImDrawData &frame(F &&f) {
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui::NewFrame();
+    f();
+    ImGui::Render();
+    return *ImGui::GetDrawData();
+  }
+
+  // render the frame and count what it took
+  gl_counts_t render(ImDrawData &draw_data) {
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    counts = {};
+    ImGui_ImplOpenGL3_RenderDrawData(&draw_data);
+    return counts;
+  }
+
+  std::vector<ImU32> pixels() {
+    std::vector<ImU32> pixels(std::size_t(width) * height);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    return pixels;
+  }
+
+  p::headless_t headless;
+};
+
+// a spectator wall with a window and some text over it: several draw lists
+struct wall_t {
+  wall_t() : spectator{10, 10, c::rngSeed()} {}
+
+  void operator()() {
+    spectator.frame(start + period * frames++);
+    ImGui::Begin("uploads");
+    ImGui::Text("frame %d", frames);
+    ImGui::End();
+    ImGui::GetForegroundDrawList()->AddText({10, 10}, IM_COL32_WHITE, "PONG");
+  }
+
+  p::spectator_t spectator;
+  const p::spectator_t::clock_t::time_point start{1s};
+  const p::spectator_t::clock_t::duration period =
+      p::simulation_t::default_tick_period * 2;
+  int frames = 0;
+};
+
+// 80 x 60 distinct quads in a quadrant of the window, 19200 vertices
+void quads(ImDrawList &l, int quadrant) {
+  const ImVec2 origin{float(quadrant % 2 * width / 2),
+                      float(quadrant / 2 * height / 2)};
+  for (int y = 0; y < 60; ++y)
+    for (int x = 0; x < 80; ++x) {
+      const ImVec2 min{origin.x + float(x * 4), origin.y + float(y * 4)};
+      l.AddRectFilled(min, {min.x + 3, min.y + 3},
+                      IM_COL32(x * 3, y * 4, quadrant * 60, 255));
+    }
+}
+
+std::size_t bytes(const ImDrawData &draw_data) {
+  return std::size_t(draw_data.TotalVtxCount) * sizeof(ImDrawVert) +
+         std::size_t(draw_data.TotalIdxCount) * sizeof(ImDrawIdx);
+}
+
+} // namespace
+
+TEST_CASE("the context is the GL ES version ctest asked for") {
+  const char *asked = std::getenv("MESA_GLES_VERSION_OVERRIDE");
+  if (asked == nullptr)
+    SKIP("no MESA_GLES_VERSION_OVERRIDE");
+  context_t context;
+  if (!context)
+    SKIP("no Mesa EGL display");
+  backend_t backend;
+
+  // else a run meant for one version would quietly test another
+  const auto *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+  REQUIRE(version != nullptr);
+  INFO("GL_VERSION " << version);
+  CHECK(std::string_view{version}.starts_with(std::string{"OpenGL ES "} +
+                                              asked));
+}
+
+TEST_CASE("streamed uploads are one call per buffer per frame") {
+  context_t context;
+  if (!context)
+    SKIP("no Mesa EGL display");
+  backend_t backend;
+  wall_t wall;
+
+  auto &draw_data = backend.frame(wall);
+  REQUIRE(draw_data.CmdListsCount >= 3);
+
+  // the first frame of each sizes its buffers
+  ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload_PerList);
+  backend.render(draw_data);
+  const auto per_list = backend.render(draw_data);
+  ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload_Stream);
+  backend.render(draw_data);
+  const auto stream = backend.render(draw_data);
+
+  CHECK(per_list.buffer_data == 2 * std::size_t(draw_data.CmdListsCount));
+  CHECK(per_list.buffer_sub_data == 0);
+  CHECK(per_list.bytes == bytes(draw_data));
+
+  // one orphaning glBufferData and one glBufferSubData for each buffer
+  CHECK(stream.buffer_data == 2);
+  CHECK(stream.buffer_sub_data == 2);
+  CHECK(stream.bytes == bytes(draw_data));
+  CHECK(stream.calls < per_list.calls);
+}
+
+TEST_CASE("ring uploads stop respecifying their buffers once grown") {
+  context_t context;
+  if (!context)
+    SKIP("no Mesa EGL display");
+  backend_t backend;
+  wall_t wall;
+  ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload_Ring);
+
+  for (int i = 0; i < 10; ++i)
+    backend.render(backend.frame(wall));
+
+  for (int i = 0; i < 60; ++i) {
+    auto &draw_data = backend.frame(wall);
+    const auto ring = backend.render(draw_data);
+    INFO("frame " << i);
+    CHECK(ring.buffer_data == 0);
+    CHECK(ring.buffer_sub_data == 2);
+    CHECK(ring.bytes == bytes(draw_data));
+  }
+}
+
+TEST_CASE("every upload strategy draws the same pixels") {
+  context_t context;
+  if (!context)
+    SKIP("no Mesa EGL display");
+  backend_t backend;
+
+  // more vertices than 16-bit indices can address from one place, over two
+  // draw lists
+  auto &draw_data = backend.frame([] {
+    quads(*ImGui::GetBackgroundDrawList(), 0);
+    quads(*ImGui::GetBackgroundDrawList(), 1);
+    quads(*ImGui::GetForegroundDrawList(), 2);
+    quads(*ImGui::GetForegroundDrawList(), 3);
+  });
+  REQUIRE(draw_data.TotalVtxCount > 0x10000);
+
+  ImGui_ImplOpenGL3_SetUpload(ImGui_ImplOpenGL3_Upload_PerList);
+  backend.render(draw_data);
+  const auto expected = backend.pixels();
+  CHECK(std::count(expected.begin(), expected.end(), IM_COL32_BLACK) <
+        std::ptrdiff_t(expected.size() / 2));
+
+  for (const auto upload :
+       {ImGui_ImplOpenGL3_Upload_Stream, ImGui_ImplOpenGL3_Upload_Ring}) {
+    ImGui_ImplOpenGL3_SetUpload(upload);
+    // every region of the ring
+    for (int i = 0; i < 3; ++i) {
+      backend.render(draw_data);
+      INFO("upload " << upload << ", frame " << i);
+      CHECK(backend.pixels() == expected);
+    }
+  }
+}
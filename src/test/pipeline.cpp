@@ -0,0 +1,194 @@
+#include <catch2/catch_all.hpp>
+
+#include "alloc.hpp"
+#include "headless_fixture.hpp"
+#include "pipeline.hpp"
+#include "spectator.hpp"
+
+#include "imgui.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace a = p::alloc;
+namespace c = Catch;
+
+using namespace std::chrono_literals;
+
+// a spectator wall's frames, which change from one to the next
+struct fixture_t : p::headless_fixture_t {
+  fixture_t()
+      : headless_fixture_t{{1280, 720}}, spectator{8, 6, c::rngSeed()} {}
+
+  const ImDrawData &frame() {
+    return build([this](clock_t::time_point now) { spectator.frame(now); });
+  }
+
+  p::spectator_t spectator;
+};
+
+bool equal(const ImDrawData &l, const ImDrawData &r) {
+  if (l.CmdListsCount != r.CmdListsCount ||
+      l.TotalVtxCount != r.TotalVtxCount ||
+      l.TotalIdxCount != r.TotalIdxCount)
+    return false;
+  for (int i = 0; i < l.CmdListsCount; ++i) {
+    const auto &a = *l.CmdLists[i];
+    const auto &b = *r.CmdLists[i];
+    if (a.CmdBuffer.Size != b.CmdBuffer.Size ||
+        a.VtxBuffer.Size != b.VtxBuffer.Size ||
+        a.IdxBuffer.Size != b.IdxBuffer.Size ||
+        std::memcmp(a.VtxBuffer.Data, b.VtxBuffer.Data,
+                    std::size_t(a.VtxBuffer.size_in_bytes())) != 0 ||
+        std::memcmp(a.IdxBuffer.Data, b.IdxBuffer.Data,
+                    std::size_t(a.IdxBuffer.size_in_bytes())) != 0)
+      return false;
+    for (int j = 0; j < a.CmdBuffer.Size; ++j) {
+      const auto &x = a.CmdBuffer[j];
+      const auto &y = b.CmdBuffer[j];
+      if (x.ElemCount != y.ElemCount || x.IdxOffset != y.IdxOffset ||
+          x.VtxOffset != y.VtxOffset || x.GetTexID() != y.GetTexID())
+        return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+TEST_CASE("draw data copies outlive the frame they were taken from") {
+  fixture_t f;
+
+  p::draw_data_copy_t copy;
+  copy.assign(f.frame());
+  REQUIRE(equal(copy.get(), *ImGui::GetDrawData()));
+  CHECK(copy.get().CmdLists[0] != ImGui::GetDrawData()->CmdLists[0]);
+
+  // ImGui reuses its buffers for the next frame, the copy keeps the last one
+  p::draw_data_copy_t previous;
+  previous.assign(copy.get());
+  f.frame();
+  CHECK(!equal(copy.get(), *ImGui::GetDrawData()));
+  CHECK(equal(copy.get(), previous.get()));
+}
+
+TEST_CASE("steady state draw data copies don't allocate") {
+  fixture_t f;
+  p::draw_data_copy_t copy;
+
+  for (int i = 0; i < 60; ++i)
+    copy.assign(f.frame());
+
+  a::counts_t counts;
+  for (int i = 0; i < 60; ++i) {
+    const auto &draw_data = f.frame();
+    a::scope_t scope;
+    copy.assign(draw_data);
+    counts = scope.counts();
+    REQUIRE(counts.allocations == 0);
+  }
+}
+
+TEST_CASE("pipelined frames are rendered in order on the render thread") {
+  const auto main = std::this_thread::get_id();
+  std::mutex mutex;
+  std::vector<std::uint64_t> rendered;
+  std::vector<int> widths;
+  bool attached = false;
+  bool detached = false;
+  bool elsewhere = true;
+
+  {
+    p::profile_t profile;
+    p::pipeline_t pipeline{
+        [&]() { attached = std::this_thread::get_id() != main; },
+        [&](p::pipeline_t::frame_t &frame) {
+          const std::scoped_lock lock{mutex};
+          elsewhere = elsewhere && std::this_thread::get_id() != main;
+          rendered.push_back(frame.number);
+          widths.push_back(frame.width);
+        },
+        [&]() { detached = std::this_thread::get_id() != main; }, &profile};
+
+    for (int i = 0; i < 100; ++i) {
+      auto &frame = pipeline.begin();
+      frame.width = i;
+      pipeline.end(frame);
+    }
+
+    // a cancelled frame isn't rendered, nor does it hold up the others
+    pipeline.cancel(pipeline.begin());
+    for (int i = 100; i < 110; ++i) {
+      auto &frame = pipeline.begin();
+      frame.width = i;
+      pipeline.end(frame);
+    }
+
+    // the destructor renders what has been ended; by then these are mostly
+    // done
+    while (pipeline.rendered() < 100)
+      std::this_thread::yield();
+    CHECK(profile.summary(p::metric_t::frame_latency).count >= 100);
+  }
+
+  CHECK(attached);
+  CHECK(detached);
+  CHECK(elsewhere);
+  REQUIRE(rendered.size() == 110);
+  for (std::size_t i = 0; i < rendered.size(); ++i) {
+    INFO(i);
+    CHECK(widths[i] == int(i));
+    CHECK(rendered[i] == (i < 100 ? i : i + 1));
+  }
+}
+
+TEST_CASE("frames cancelled while others render are neither lost nor shared") {
+  // frames ended and rendered, by number, which a slot handed out twice
+  // would have overwritten in flight; a slot lost would stall begin()
+  std::vector<std::uint64_t> ended;
+  std::vector<std::uint64_t> rendered;
+  {
+    p::pipeline_t pipeline{[]() {},
+                           [&](p::pipeline_t::frame_t &frame) {
+                             rendered.push_back(frame.number);
+                           },
+                           []() {}};
+
+    std::minstd_rand prng{c::rngSeed()};
+    for (int i = 0; i < 100'000; ++i) {
+      auto &frame = pipeline.begin();
+      if (prng() % 2) {
+        pipeline.cancel(frame);
+      } else {
+        ended.push_back(frame.number);
+        pipeline.end(frame);
+      }
+    }
+  }
+  CHECK(rendered == ended);
+}
+
+TEST_CASE("pipelining adds at most one frame of latency") {
+  // a slow render thread, as when the swap waits for vsync, and a fast main
+  // thread that would otherwise run ahead
+  p::pipeline_t pipeline{
+      []() {}, [](p::pipeline_t::frame_t &) { std::this_thread::sleep_for(2ms); },
+      []() {}};
+
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    auto &frame = pipeline.begin();
+    INFO(i);
+    REQUIRE(frame.number == i);
+    // frame i is only started once frame i - 2 is on screen: i - 1 is the
+    // only one between it and the display
+    CHECK(pipeline.rendered() + 2 > i);
+    pipeline.end(frame);
+  }
+}
@@ -0,0 +1,193 @@
+#include <catch2/catch_all.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "match.hpp"
+#include "prediction.hpp"
+
+#include <cmath>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+namespace m = c::Matchers;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+/**
+ * A server's match and a player predicting it, latency ticks apart each
+ * way, without the sockets: each tick the player commands and predicts, and
+ * the server applies whatever commands have reached it, ticks and sends its
+ * events, as pong-server does.
+ */
+class link_t {
+public:
+  link_t(std::mt19937::result_type seed, std::uint64_t latency)
+      : server_{seed, {.ai_skill = 80, .winning_score = 100}},
+        latency_{latency} {}
+
+  // returns the corrections the player made this tick
+  std::vector<p::correction_t> tick(std::optional<p::scalar_t> speed = {}) {
+    if (speed && predictor_.ready())
+      to_server_.push_back(
+          {.due = ticks_ + latency_, .command = predictor_.command(*speed)});
+    predictor_.tick();
+
+    while (!to_server_.empty() && to_server_.front().due <= ticks_) {
+      const auto &command = to_server_.front().command;
+      server_.command(command.sequence, command.speed, command.tick);
+      to_server_.pop_front();
+    }
+    message_t message{.due = ticks_ + latency_};
+    server_.tick(dt, &message.events);
+    if (server_.ticks() % 60 == 1)
+      p::keyframe(server_.arena(), server_.ticks(), dt, server_.in_play(),
+                  message.events);
+    message.tick = server_.ticks();
+    message.acknowledged = server_.acknowledged();
+    message.early = server_.early();
+    to_player_.push_back(std::move(message));
+
+    std::vector<p::correction_t> corrections;
+    while (!to_player_.empty() && to_player_.front().due <= ticks_) {
+      const auto &m = to_player_.front();
+      for (const auto &e : m.events)
+        predictor_.apply(e);
+      corrections.push_back(
+          predictor_.reconcile(m.tick, m.acknowledged, m.early));
+      to_player_.pop_front();
+    }
+    ++ticks_;
+    return corrections;
+  }
+
+  [[nodiscard]] const p::remote_match_t &server() const { return server_; }
+  [[nodiscard]] const p::predictor_t &predictor() const { return predictor_; }
+
+private:
+  struct command_t {
+    std::uint64_t due;
+    p::predictor_t::command_t command;
+  };
+
+  struct message_t {
+    std::uint64_t due{};
+    std::uint64_t tick{};
+    std::uint32_t acknowledged{};
+    std::int32_t early{};
+    std::vector<p::event_t> events{};
+  };
+
+  p::remote_match_t server_;
+  p::predictor_t predictor_{dt};
+  std::uint64_t latency_;
+  std::uint64_t ticks_{};
+  std::deque<command_t> to_server_;
+  std::deque<message_t> to_player_;
+};
+
+// up and down the arena, as a player might
+p::scalar_t speed(std::uint64_t tick) {
+  return tick % 90 < 45 ? 300.f : -300.f;
+}
+
+} // namespace
+
+TEST_CASE("without latency a player's own paddle is never corrected") {
+  link_t link{c::rngSeed(), 0};
+  for (std::uint64_t t = 0; t < 60 * 20; ++t) {
+    const auto corrections = link.tick(speed(t));
+    // once the first command has told the prediction how far ahead to be
+    if (t < 60)
+      continue;
+    // with a tick to spare
+    CHECK(link.predictor().ticks() == link.server().ticks() + 1);
+    // only the AI's speed changes, and where the puck restarts, can't be
+    // foreseen
+    for (const auto &correction : corrections)
+      CHECK(correction.own_paddle < 1e-2f);
+  }
+  CHECK(link.predictor().pending() <= 1);
+}
+
+TEST_CASE("a prediction keeps a round trip ahead of the server") {
+  constexpr std::uint64_t latency = 4;
+  link_t link{c::rngSeed(), latency};
+  std::uint64_t t = 0;
+  while (!link.predictor().ready())
+    link.tick(speed(t++));
+
+  // once the first commands are acknowledged, for a while
+  std::size_t checked = 0;
+  for (; t < 60 * 20; ++t) {
+    const auto corrections = link.tick(speed(t));
+    if (t < 60)
+      continue;
+    // so that commands arrive a tick before they're due
+    CHECK(link.predictor().ticks() == link.server().ticks() + latency + 1);
+    // the player's own paddle goes where it was predicted to; everything
+    // else is up to the AI
+    for (const auto &correction : corrections) {
+      CHECK(correction.own_paddle < 1e-2f);
+      ++checked;
+    }
+  }
+  CHECK(checked > 0);
+  CHECK(link.predictor().pending() <= 2 * latency + 1);
+}
+
+TEST_CASE("a player's own paddle answers their command at once") {
+  link_t link{c::rngSeed(), 6};
+  while (!link.predictor().ready())
+    link.tick();
+
+  const auto before = link.predictor().snapshot();
+  const auto server = link.server().arena().rhs_paddle().box().min()(1);
+  link.tick(200.f);
+  const auto after = link.predictor().snapshot();
+  CHECK_THAT(after.rhs_paddle[1] - before.rhs_paddle[1],
+             m::WithinAbs(200 * dt, 1e-3));
+  // which the server hasn't heard of yet
+  CHECK(link.server().arena().rhs_paddle().box().min()(1) == server);
+}
+
+TEST_CASE("a correction is taken up over a few ticks") {
+  p::arena_t arena{p::make_starter(c::rngSeed())};
+  p::predictor_t predictor{dt};
+  std::vector<p::event_t> events;
+  p::keyframe(arena, 1, dt, true, events);
+  for (const auto &e : events)
+    predictor.apply(e);
+  predictor.reconcile(1, 0, 0);
+  REQUIRE(predictor.ready());
+  const auto before = predictor.snapshot();
+
+  // the server says the puck is 10 pixels along from where it was thought
+  auto puck = p::event(arena, p::body_t::puck, 1, dt, true);
+  puck.position[0] += 10;
+  predictor.apply(puck);
+  const auto correction = predictor.reconcile(1, 0, 0);
+  CHECK_THAT(correction.puck, m::WithinAbs(10, 1e-3));
+  CHECK(correction.own_paddle == 0);
+
+  // shown where it was, then closer and closer to where it is
+  CHECK_THAT(predictor.snapshot().puck[0], m::WithinAbs(before.puck[0], 1e-3));
+  p::scalar_t error = 10;
+  for (int i = 0; i < 10; ++i) {
+    predictor.tick();
+    const auto shown = predictor.snapshot().puck[0];
+    const auto actual = predictor.arena().puck().centre()(0);
+    CHECK(std::abs(actual - shown) < error);
+    error = std::abs(actual - shown);
+  }
+  CHECK(error < .5f);
+
+  // but a jump is jumped to
+  puck = p::event(predictor.arena(), p::body_t::puck, 11, dt, true);
+  puck.position[1] += 100;
+  predictor.apply(puck);
+  CHECK(predictor.reconcile(11, 0, 0).puck > p::predictor_t::jump);
+  CHECK(predictor.snapshot().puck[1] == predictor.arena().puck().centre()(1));
+}
@@ -0,0 +1,110 @@
+#include <catch2/catch_all.hpp>
+
+#include "profile.hpp"
+
+#include <random>
+#include <sstream>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+} // namespace
+
+TEST_CASE("histogram buckets") {
+  using h = p::histogram_t;
+
+  // small values are exact
+  for (std::uint64_t v = 0; v < h::sub_buckets; ++v) {
+    CHECK(h::index(v) == v);
+    CHECK(h::highest(h::index(v)) == v);
+  }
+
+  // larger values are within 1 / sub_buckets
+  std::mt19937_64 prng{c::rngSeed()};
+  for (int i = 0; i < 1 << 14; ++i) {
+    const std::uint64_t v = prng() >> (prng() % 40 + 20);
+    const auto highest = h::highest(h::index(v));
+    REQUIRE(h::index(v) < h::bucket_count);
+    REQUIRE(highest >= v);
+    REQUIRE(double(highest - v) <= double(v) / h::sub_buckets);
+    REQUIRE(h::index(highest) == h::index(v));
+    REQUIRE(h::index(highest + 1) == h::index(v) + 1);
+  }
+}
+
+TEST_CASE("histogram quantiles") {
+  p::histogram_t h;
+  CHECK(h.quantile(.5) == 0);
+
+  for (std::uint64_t v = 1; v <= 1000; ++v)
+    h.record(v * 1000);
+
+  CHECK(h.count() == 1000);
+  CHECK_THAT(double(h.quantile(.5)), c::Matchers::WithinRel(500'000., 1. / 32));
+  CHECK_THAT(double(h.quantile(.99)),
+             c::Matchers::WithinRel(990'000., 1. / 32));
+  CHECK_THAT(double(h.max()), c::Matchers::WithinRel(1'000'000., 1. / 32));
+}
+
+TEST_CASE("rolling histogram forgets old samples") {
+  p::rolling_histogram_t r;
+
+  for (std::size_t i = 0; i < p::rolling_histogram_t::window; ++i)
+    r.record(1'000'000);
+
+  CHECK(r.histogram().quantile(.5) >= 1'000'000);
+
+  for (std::size_t i = 0; i < p::rolling_histogram_t::window; ++i)
+    r.record(10);
+
+  CHECK(r.histogram().count() == p::rolling_histogram_t::window);
+  CHECK(r.histogram().max() == 10);
+}
+
+TEST_CASE("profile write") {
+  p::profile_t profile;
+  profile.record(p::metric_t::swap_wait, 16'000'000);
+  profile.record(p::metric_t::events_per_frame, 3);
+
+  { p::scoped_timer_t timer{&profile, p::metric_t::ai}; }
+
+  CHECK(profile.summary(p::metric_t::ai).count == 1);
+  CHECK(profile.summary(p::metric_t::events_per_frame).max == 3);
+
+  std::ostringstream os;
+  profile.write(os);
+  CHECK(os.str().find("swap_wait,") != std::string::npos);
+  CHECK(os.str().find("events_per_frame,3,3,3,1") != std::string::npos);
+}
+
+TEST_CASE("cpu meter samples utilisation per period") {
+  using namespace std::chrono_literals;
+  using clock = p::cpu_meter_t::clock_t;
+
+  p::profile_t profile;
+  p::cpu_meter_t meter{&profile, 1s};
+  const clock::time_point start{1h};
+
+  // a quarter of a core in play
+  for (int i = 0; i <= 10; ++i)
+    meter.sample(start + 500ms * i, 125ms * i, true);
+  CHECK(profile.summary(p::metric_t::cpu_in_play).count == 5);
+  // to the histogram's resolution
+  CHECK(profile.summary(p::metric_t::cpu_in_play).p50 ==
+        p::histogram_t::highest(p::histogram_t::index(250)));
+
+  // a period spanning the end of play counts for neither
+  meter.sample(start + 5500ms, 1375ms, false);
+  meter.sample(start + 6000ms, 1376ms, false);
+  CHECK(profile.summary(p::metric_t::cpu_in_play).count == 5);
+  CHECK(profile.summary(p::metric_t::cpu_idle).count == 0);
+
+  meter.sample(start + 6500ms, 1380ms, false);
+  CHECK(profile.summary(p::metric_t::cpu_idle).count == 1);
+  CHECK(profile.summary(p::metric_t::cpu_idle).p50 == 5);
+
+  // the process's own cpu time only goes forward
+  const auto before = p::cpu_meter_t::cpu_time();
+  CHECK(before.count() > 0);
+  CHECK(p::cpu_meter_t::cpu_time() >= before);
+}
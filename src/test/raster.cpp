@@ -0,0 +1,170 @@
+#include <catch2/catch_all.hpp>
+
+#include "headless.hpp"
+#include "raster.hpp"
+#include "simulation.hpp"
+#include "ui.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+using namespace std::chrono_literals;
+
+constexpr ImU32 black = IM_COL32(0, 0, 0, 255);
+constexpr ImU32 white = IM_COL32(255, 255, 255, 255);
+
+// a frame with nothing but what's drawn on the background draw list
+template <typename F> const ImDrawData &draw(F &&f) {
+  ImGui::NewFrame();
+  f(*ImGui::GetBackgroundDrawList());
+  ImGui::Render();
+  return *ImGui::GetDrawData();
+}
+
+} // namespace
+
+TEST_CASE("a filled rect covers exactly its pixels") {
+  p::headless_t headless{{128, 96}};
+  p::rasterizer_t rasterizer{1};
+  p::framebuffer_t framebuffer{128, 96};
+
+  const auto &draw_data =
+      draw([](ImDrawList &l) { l.AddRectFilled({10, 20}, {70, 50}, white); });
+  rasterizer.render(draw_data, framebuffer, black);
+
+  for (int y = 0; y < framebuffer.height(); ++y) {
+    for (int x = 0; x < framebuffer.width(); ++x) {
+      const bool inside = x >= 10 && x < 70 && y >= 20 && y < 50;
+      INFO(x << ", " << y);
+      REQUIRE(framebuffer.at(x, y) == (inside ? white : black));
+    }
+  }
+}
+
+TEST_CASE("a translucent rect is blended without a seam") {
+  p::headless_t headless{{128, 128}};
+  p::rasterizer_t rasterizer{1};
+  p::framebuffer_t framebuffer{128, 128};
+
+  // the rect is two triangles sharing a diagonal: if pixels on it were
+  // drawn twice they'd come out brighter than the rest
+  const auto &draw_data = draw([](ImDrawList &l) {
+    l.AddRectFilled({0, 0}, {128, 128}, IM_COL32(255, 255, 255, 128));
+  });
+  rasterizer.render(draw_data, framebuffer, black);
+
+  const auto expected = framebuffer.at(0, 0);
+  CHECK((expected & 0xff) > 120);
+  CHECK((expected & 0xff) < 136);
+  for (int y = 0; y < framebuffer.height(); ++y) {
+    for (int x = 0; x < framebuffer.width(); ++x) {
+      INFO(x << ", " << y);
+      REQUIRE(framebuffer.at(x, y) == expected);
+    }
+  }
+}
+
+TEST_CASE("draw commands are scissored to their clip rect") {
+  p::headless_t headless{{128, 128}};
+  p::rasterizer_t rasterizer{1};
+  p::framebuffer_t framebuffer{128, 128};
+
+  const auto &draw_data = draw([](ImDrawList &l) {
+    l.PushClipRect({32, 32}, {64, 96});
+    l.AddRectFilled({0, 0}, {128, 128}, white);
+    l.PopClipRect();
+  });
+  rasterizer.render(draw_data, framebuffer, black);
+
+  for (int y = 0; y < framebuffer.height(); ++y) {
+    for (int x = 0; x < framebuffer.width(); ++x) {
+      const bool inside = x >= 32 && x < 64 && y >= 32 && y < 96;
+      INFO(x << ", " << y);
+      REQUIRE(framebuffer.at(x, y) == (inside ? white : black));
+    }
+  }
+}
+
+TEST_CASE("the ui renders the same on any number of threads") {
+  p::headless_t headless;
+  const auto profile = std::make_unique<p::profile_t>();
+  p::simulation_t simulation{p::make_starter(c::rngSeed()), c::rngSeed(),
+                             p::rules(p::settings_t{})};
+  p::ui_t ui{simulation, profile.get()};
+
+  const p::simulation_t::clock_t::time_point now{1s};
+  simulation.advance_to(now);
+  ImGui::NewFrame();
+  ui.frame(now);
+  ImGui::Render();
+  const auto &draw_data = *ImGui::GetDrawData();
+
+  const int width = int(headless.io().DisplaySize.x);
+  const int height = int(headless.io().DisplaySize.y);
+  p::framebuffer_t one{width, height};
+  p::rasterizer_t{1}.render(draw_data, one, black);
+
+  // text and widgets drew something
+  std::size_t drawn = 0;
+  for (int i = 0; i < width * height; ++i)
+    drawn += one.data()[i] != black;
+  CHECK(drawn > std::size_t(width * height / 4));
+
+  const auto threads = GENERATE(2u, 3u, 8u);
+  p::rasterizer_t rasterizer{threads};
+  REQUIRE(rasterizer.threads() == threads);
+  p::framebuffer_t many{width, height};
+  // twice, so that a frame is rendered by workers that have seen one before
+  for (int i = 0; i < 2; ++i) {
+    rasterizer.render(draw_data, many, black);
+    REQUIRE(std::equal(one.data(), one.data() + width * height, many.data()));
+  }
+}
+
+TEST_CASE("frames of changing size render the same on any number of threads") {
+  p::headless_t headless{{256, 256}};
+  const auto &draw_data = draw([](ImDrawList &l) {
+    l.AddRectFilled({10, 20}, {200, 230}, IM_COL32(255, 255, 255, 128));
+    l.AddCircleFilled({40, 40}, 30, white);
+  });
+
+  // a small frame's workers, late to it, see a large one's tile count
+  const int sizes[] = {32, 256};
+  p::framebuffer_t one[] = {{32, 32}, {256, 256}};
+  p::framebuffer_t many[] = {{32, 32}, {256, 256}};
+  p::rasterizer_t{1}.render(draw_data, one[0], black);
+  p::rasterizer_t{1}.render(draw_data, one[1], black);
+
+  p::rasterizer_t rasterizer{4};
+  for (int i = 0; i < 1000; ++i) {
+    const auto size = sizes[i % 2];
+    rasterizer.render(draw_data, many[i % 2], black);
+    REQUIRE(std::equal(one[i % 2].data(), one[i % 2].data() + size * size,
+                       many[i % 2].data()));
+  }
+}
+
+TEST_CASE("framebuffers are written as PPM") {
+  p::framebuffer_t framebuffer{3, 2};
+  framebuffer.at(0, 0) = IM_COL32(1, 2, 3, 4);
+  framebuffer.at(2, 1) = IM_COL32(5, 6, 7, 8);
+
+  std::ostringstream os;
+  p::write_ppm(os, framebuffer);
+  const auto ppm = os.str();
+
+  const std::string header = "P6\n3 2\n255\n";
+  REQUIRE(ppm.size() == header.size() + 3 * 2 * 3);
+  CHECK(ppm.substr(0, header.size()) == header);
+  CHECK(ppm.substr(header.size(), 3) == "\x01\x02\x03");
+  CHECK(ppm.substr(ppm.size() - 3) == "\x05\x06\x07");
+}
@@ -0,0 +1,479 @@
+#include <catch2/catch_all.hpp>
+
+#include "host.hpp"
+#include "match.hpp"
+#include "net.hpp"
+#include "protocol.hpp"
+#include "trajectory.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace pr = pong::protocol;
+namespace c = Catch;
+
+auto now() { return std::chrono::steady_clock::now(); }
+
+template <typename Message>
+void send(const p::udp_socket_t &socket, const sockaddr_in &to,
+          const Message &message) {
+  p::datagrams_t out{1};
+  out.commit(pr::encode(message, out.prepare(to)));
+  REQUIRE(out.send(socket) == 1);
+}
+
+// the next message of that type, skipping others, if one comes in time
+template <typename Message>
+std::optional<Message> receive(const p::udp_socket_t &socket,
+                               std::chrono::milliseconds timeout =
+                                   std::chrono::seconds{2}) {
+  p::datagrams_t in{16};
+  const auto deadline = now() + timeout;
+  while (now() < deadline) {
+    in.receive(socket);
+    for (std::size_t i = 0; i < in.size(); ++i) {
+      Message message;
+      if (pr::decode(in.payload(i), message))
+        return message;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  return {};
+}
+
+p::server_options_t options() {
+  return {.loops = 1,
+          .rules = {.ai_skill = 80, .winning_score = 100},
+          .seed = c::rngSeed(),
+          .timeout = std::chrono::milliseconds{300},
+          .pin = false};
+}
+
+} // namespace
+
+TEST_CASE("messages survive encoding and decoding") {
+  std::array<std::byte, pr::max_size> buffer{};
+
+  const pr::welcome_t welcome{
+      .nonce = 0x0123456789abcdef, .match = 7ull << 32 | 3,
+      .tick_period_us = 16'666, .seed = 4242};
+  const auto n = pr::encode(welcome, buffer);
+  CHECK(n <= pr::max_size);
+  CHECK(pr::peek({buffer.data(), n}) == pr::type_t::welcome);
+  pr::welcome_t decoded;
+  REQUIRE(pr::decode({buffer.data(), n}, decoded));
+  CHECK(decoded == welcome);
+
+  const pr::command_t command{.match = 9, .sequence = 123, .speed = -640.5f};
+  pr::command_t decoded_command;
+  REQUIRE(pr::decode({buffer.data(), pr::encode(command, buffer)},
+                     decoded_command));
+  CHECK(decoded_command == command);
+
+  const pr::watch_t watch{.match = 7ull << 32 | 1 << 24 | 3, .tick = 1234};
+  pr::watch_t decoded_watch;
+  REQUIRE(pr::decode({buffer.data(), pr::encode(watch, buffer)},
+                     decoded_watch));
+  CHECK(decoded_watch == watch);
+
+  p::match_t match{c::rngSeed()};
+  for (int i = 0; i < 100; ++i)
+    match.tick(1.f / 60.f);
+  const pr::state_t state{
+      .match = 9, .acknowledged = 122, .snapshot = match.snapshot(100)};
+  const auto size = pr::encode(state, buffer);
+  CHECK(size <= pr::max_size);
+  pr::state_t decoded_state;
+  REQUIRE(pr::decode({buffer.data(), size}, decoded_state));
+  CHECK(decoded_state.match == state.match);
+  CHECK(decoded_state.acknowledged == state.acknowledged);
+  CHECK(decoded_state.snapshot.tick == state.snapshot.tick);
+  CHECK(decoded_state.snapshot.puck == state.snapshot.puck);
+  CHECK(decoded_state.snapshot.rhs_paddle == state.snapshot.rhs_paddle);
+  CHECK(decoded_state.snapshot.in_play == state.snapshot.in_play);
+
+  pr::events_t events{.match = 9, .acknowledged = 122, .tick = 100};
+  std::vector<p::event_t> keyframe;
+  p::keyframe(match.arena(), 100, 1.f / 60.f, true, keyframe);
+  events.count = std::uint8_t(keyframe.size());
+  std::ranges::copy(keyframe, events.events.begin());
+  const auto events_size = pr::encode(events, buffer);
+  pr::events_t decoded_events;
+  REQUIRE(pr::decode({buffer.data(), events_size}, decoded_events));
+  CHECK(decoded_events.tick == 100);
+  REQUIRE(decoded_events.count == keyframe.size());
+  for (std::size_t i = 0; i < keyframe.size(); ++i) {
+    const auto &e = decoded_events.events[i];
+    CHECK(e.tick == 100);
+    CHECK(e.body == keyframe[i].body);
+    CHECK(e.offset == keyframe[i].offset);
+    CHECK(e.position == keyframe[i].position);
+    CHECK(e.velocity == keyframe[i].velocity);
+    CHECK(e.lhs_score == keyframe[i].lhs_score);
+    CHECK(e.in_play == keyframe[i].in_play);
+  }
+
+  // at most a tick's worth fits one datagram
+  events.count = pr::max_events;
+  CHECK(pr::encode(events, buffer) <= pr::max_size);
+}
+
+TEST_CASE("malformed datagrams are rejected") {
+  std::array<std::byte, pr::max_size> buffer{};
+  const auto n = pr::encode(pr::command_t{.match = 1, .sequence = 2}, buffer);
+
+  pr::command_t command;
+  CHECK_FALSE(pr::decode({buffer.data(), n - 1}, command));
+  CHECK_FALSE(pr::decode({buffer.data(), n + 1}, command));
+  CHECK_FALSE(pr::decode({}, command));
+
+  pr::leave_t leave;
+  CHECK_FALSE(pr::decode({buffer.data(), n}, leave));
+
+  const auto join = pr::encode(pr::join_t{.nonce = 1}, buffer);
+  buffer[join - 1] = std::byte{7};
+  pr::join_t decoded_join;
+  CHECK_FALSE(pr::decode({buffer.data(), join}, decoded_join));
+
+  pr::events_t events{.count = 1};
+  events.events[0].body = p::body_t::puck;
+  const auto size = pr::encode(events, buffer);
+  pr::events_t decoded_events;
+  CHECK(pr::decode({buffer.data(), size}, decoded_events));
+  // an unknown body, or more events than there can be (the count comes
+  // after the type, match, acknowledged, early and tick)
+  constexpr std::size_t count = 1 + 8 + 4 + 2 + 8;
+  buffer[count + 1] = std::byte{9};
+  CHECK_FALSE(pr::decode({buffer.data(), size}, decoded_events));
+  buffer[count + 1] = std::byte{0};
+  buffer[count] = std::byte{pr::max_events + 1};
+  CHECK_FALSE(pr::decode({buffer.data(), size}, decoded_events));
+
+  buffer[0] = std::byte{0};
+  CHECK_FALSE(pr::peek({buffer.data(), n}));
+  buffer[0] = std::byte{99};
+  CHECK_FALSE(pr::peek({buffer.data(), n}));
+}
+
+TEST_CASE("a remote match's rhs paddle follows its commands") {
+  p::remote_match_t match{c::rngSeed()};
+  constexpr p::scalar_t dt = 1.f / 60.f;
+
+  match.command(300);
+  match.tick(dt);
+  CHECK(match.arena().rhs_paddle().velocity().y() == 300);
+  CHECK(match.ticks() == 1);
+
+  match.command(-1e9f);
+  match.tick(dt);
+  CHECK(match.arena().rhs_paddle().velocity().y() ==
+        -p::remote_match_t::max_speed);
+
+  match.command(std::nanf(""));
+  match.tick(dt);
+  CHECK(match.arena().rhs_paddle().velocity().y() == 0);
+  CHECK(match.snapshot().tick == 3);
+}
+
+TEST_CASE("a remote match holds a command back until its tick") {
+  p::remote_match_t match{c::rngSeed()};
+  constexpr p::scalar_t dt = 1.f / 60.f;
+  auto speed = [&]() { return match.arena().rhs_paddle().velocity().y(); };
+
+  match.command(1, 300, 3);
+  match.tick(dt);
+  CHECK(speed() == 0);
+  CHECK(match.acknowledged() == 0);
+  match.tick(dt);
+  match.tick(dt);
+  CHECK(speed() == 300);
+  CHECK(match.acknowledged() == 1);
+  CHECK(match.early() == 2);
+
+  // late, then out of date
+  match.command(2, -300, 1);
+  match.command(1, 0, 0);
+  match.tick(dt);
+  CHECK(speed() == -300);
+  CHECK(match.acknowledged() == 2);
+  CHECK(match.early() == -3);
+}
+
+TEST_CASE("a server plays a match with a player over loopback") {
+  p::server_t server{options()};
+  server.start();
+
+  const p::udp_socket_t player;
+  send(player, server.address(), pr::join_t{.nonce = 42});
+  const auto welcome = receive<pr::welcome_t>(player);
+  REQUIRE(welcome);
+  CHECK(welcome->nonce == 42);
+  CHECK(welcome->tick_period_us == 16'666);
+
+  // a repeated join is the same match, as its welcome may have been lost
+  send(player, server.address(), pr::join_t{.nonce = 42});
+  const auto again = receive<pr::welcome_t>(player);
+  REQUIRE(again);
+  CHECK(again->match == welcome->match);
+
+  const auto first = receive<pr::state_t>(player);
+  REQUIRE(first);
+  CHECK(first->match == welcome->match);
+  CHECK(first->snapshot.in_play);
+
+  send(player, server.address(),
+       pr::command_t{.match = welcome->match, .sequence = 1, .speed = 100});
+  std::optional<pr::state_t> state;
+  const auto deadline = now() + std::chrono::seconds{2};
+  do {
+    state = receive<pr::state_t>(player);
+    REQUIRE(state);
+  } while (state->acknowledged != 1 && now() < deadline);
+  CHECK(state->acknowledged == 1);
+  CHECK(state->snapshot.tick > first->snapshot.tick);
+
+  // commands for another match, or that are out of date, are ignored
+  send(player, server.address(),
+       pr::command_t{.match = welcome->match + 1, .sequence = 5});
+  send(player, server.address(),
+       pr::command_t{.match = welcome->match, .sequence = 0});
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  state = receive<pr::state_t>(player);
+  REQUIRE(state);
+  CHECK(state->acknowledged == 1);
+
+  send(player, server.address(), pr::leave_t{.match = welcome->match});
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  const auto stats = server.stats();
+  CHECK(stats.joined == 1);
+  CHECK(stats.matches == 0);
+  CHECK(stats.ticks > 0);
+  CHECK(stats.tick_ns.count() == stats.ticks);
+}
+
+TEST_CASE("a player synced by events is sent far fewer bytes than states") {
+  auto o = options();
+  o.timeout = std::chrono::seconds{5};
+  p::server_t server{o};
+  server.start();
+
+  const p::udp_socket_t states_player;
+  const p::udp_socket_t events_player;
+  send(states_player, server.address(), pr::join_t{.nonce = 1});
+  send(events_player, server.address(),
+       pr::join_t{.nonce = 2, .sync = pr::sync_t::events});
+  REQUIRE(receive<pr::welcome_t>(states_player));
+  const auto welcome = receive<pr::welcome_t>(events_player);
+  REQUIRE(welcome);
+
+  // a keyframe first, then only what changed
+  p::trajectory_t trajectory{float(welcome->tick_period_us) / 1e6f};
+  const auto first = receive<pr::events_t>(events_player);
+  REQUIRE(first);
+  CHECK(first->match == welcome->match);
+  for (std::size_t i = 0; i < first->count; ++i)
+    trajectory.apply(first->events[i]);
+  CHECK(trajectory.complete());
+
+  std::size_t states_bytes = 0;
+  std::size_t events_bytes = 0;
+  p::datagrams_t in{16};
+  const auto deadline = now() + std::chrono::seconds{1};
+  while (now() < deadline) {
+    in.receive(states_player);
+    for (std::size_t i = 0; i < in.size(); ++i)
+      states_bytes += in.payload(i).size();
+    in.receive(events_player);
+    for (std::size_t i = 0; i < in.size(); ++i) {
+      events_bytes += in.payload(i).size();
+      pr::events_t events;
+      REQUIRE(pr::decode(in.payload(i), events));
+      for (std::size_t j = 0; j < events.count; ++j)
+        trajectory.apply(events.events[j]);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  }
+  CHECK(trajectory.tick() > first->tick);
+  CHECK(states_bytes > 0);
+  CHECK(events_bytes * 5 < states_bytes);
+}
+
+TEST_CASE("a server ends the matches of players it no longer hears from") {
+  p::server_t server{options()};
+  server.start();
+
+  const p::udp_socket_t player;
+  send(player, server.address(), pr::join_t{.nonce = 1});
+  REQUIRE(receive<pr::welcome_t>(player));
+  CHECK(server.stats().matches <= 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{600});
+  const auto stats = server.stats();
+  CHECK(stats.joined == 1);
+  CHECK(stats.matches == 0);
+}
+
+TEST_CASE("spectators are sent a watched match's events") {
+  // spectators reach the match through whichever loop they land on
+  auto o = options();
+  o.loops = 2;
+  // for as long as it takes to hear from them all, one by one
+  o.timeout = std::chrono::seconds{30};
+  p::server_t server{o};
+  server.start();
+
+  const p::udp_socket_t player;
+  send(player, server.address(), pr::join_t{.nonce = 1});
+  const auto welcome = receive<pr::welcome_t>(player);
+  REQUIRE(welcome);
+
+  constexpr std::size_t count = 8;
+  std::vector<p::udp_socket_t> spectators(count);
+  for (const auto &spectator : spectators)
+    send(spectator, server.address(), pr::watch_t{.match = welcome->match});
+
+  // a keyframe first, then what changes
+  const p::scalar_t dt = float(welcome->tick_period_us) / 1e6f;
+  for (const auto &spectator : spectators) {
+    p::trajectory_t trajectory{dt};
+    const auto first = receive<pr::events_t>(spectator);
+    REQUIRE(first);
+    CHECK(first->match == welcome->match);
+    for (std::size_t i = 0; i < first->count; ++i)
+      trajectory.apply(first->events[i]);
+    CHECK(trajectory.complete());
+    const auto next = receive<pr::events_t>(spectator);
+    REQUIRE(next);
+    CHECK(next->tick > first->tick);
+  }
+  CHECK(server.stats().spectators == count);
+
+  // a watch of a match that isn't is ignored
+  const p::udp_socket_t stray;
+  send(stray, server.address(), pr::watch_t{.match = welcome->match + 1});
+  CHECK_FALSE(receive<pr::events_t>(stray, std::chrono::milliseconds{200}));
+
+  for (const auto &spectator : spectators)
+    send(spectator, server.address(), pr::leave_t{.match = welcome->match});
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  const auto stats = server.stats();
+  CHECK(stats.spectators == 0);
+  // the player's match goes on
+  CHECK(stats.matches == 1);
+}
+
+TEST_CASE("a spectator who falls behind is sent only the next keyframe") {
+  auto o = options();
+  o.timeout = std::chrono::seconds{5};
+  p::server_t server{o};
+  server.start();
+
+  const p::udp_socket_t player;
+  send(player, server.address(), pr::join_t{.nonce = 1});
+  const auto welcome = receive<pr::welcome_t>(player);
+  REQUIRE(welcome);
+
+  const p::udp_socket_t spectator;
+  send(spectator, server.address(), pr::watch_t{.match = welcome->match});
+  const auto first = receive<pr::events_t>(spectator);
+  REQUIRE(first);
+
+  // a couple of seconds on, well over a keyframe since, says they've had
+  // nothing since
+  std::this_thread::sleep_for(std::chrono::seconds{2});
+  send(spectator, server.address(),
+       pr::watch_t{.match = welcome->match, .tick = first->tick});
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  CHECK(server.stats().skips == 1);
+
+  // after whatever was already on its way, the next is a keyframe: every
+  // body, as it is at the end of the tick
+  p::datagrams_t in{16};
+  while (in.receive(spectator) > 0)
+    ;
+  const auto keyframe = receive<pr::events_t>(spectator);
+  REQUIRE(keyframe);
+  REQUIRE(keyframe->count == 4);
+  const p::scalar_t dt = float(welcome->tick_period_us) / 1e6f;
+  for (std::size_t i = 0; i < keyframe->count; ++i) {
+    CHECK(keyframe->events[i].body == p::body_t(i));
+    CHECK(keyframe->events[i].offset == dt);
+  }
+}
+
+TEST_CASE("a server started on another's checkpoint carries on its matches") {
+  const auto path = "/tmp/pong-server-checkpoint-" +
+                    std::to_string(::getpid()) + "-" +
+                    std::to_string(c::rngSeed());
+  std::remove(path.c_str());
+  auto o = options();
+  o.timeout = std::chrono::seconds{5};
+  o.checkpoint = path;
+
+  const p::udp_socket_t player;
+  std::optional<pr::welcome_t> welcome;
+  std::optional<pr::state_t> last;
+  {
+    p::server_t server{o};
+    server.start();
+    send(player, server.address(), pr::join_t{.nonce = 1});
+    welcome = receive<pr::welcome_t>(player);
+    REQUIRE(welcome);
+    send(player, server.address(),
+         pr::command_t{.match = welcome->match, .sequence = 1, .speed = 100});
+    const auto deadline = now() + std::chrono::seconds{2};
+    do {
+      last = receive<pr::state_t>(player);
+      REQUIRE(last);
+    } while (last->acknowledged != 1 && now() < deadline);
+    server.stop();
+
+    // the state the match was checkpointed in
+    while (const auto state =
+               receive<pr::state_t>(player, std::chrono::milliseconds{100}))
+      last = state;
+  }
+
+  p::server_t server{o};
+  const auto stats = server.stats();
+  CHECK(stats.resumed == 1);
+  CHECK(stats.matches == 1);
+  server.start();
+
+  // the match takes up from the tick it was at, the player's commands as
+  // before
+  const auto first = receive<pr::state_t>(player);
+  REQUIRE(first);
+  CHECK(first->match == welcome->match);
+  CHECK(first->acknowledged == 1);
+  CHECK(first->snapshot.tick == last->snapshot.tick + 1);
+  send(player, server.address(),
+       pr::command_t{.match = welcome->match, .sequence = 2, .speed = -100});
+  auto state = first;
+  const auto deadline = now() + std::chrono::seconds{2};
+  do {
+    state = receive<pr::state_t>(player);
+    REQUIRE(state);
+  } while (state->acknowledged != 2 && now() < deadline);
+  CHECK(state->acknowledged == 2);
+
+  // a new player's match is another
+  const p::udp_socket_t other;
+  send(other, server.address(), pr::join_t{.nonce = 1});
+  const auto joined = receive<pr::welcome_t>(other);
+  REQUIRE(joined);
+  CHECK(joined->match != welcome->match);
+  server.stop();
+  std::remove(path.c_str());
+}
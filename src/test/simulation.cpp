@@ -0,0 +1,400 @@
+#include <catch2/catch_all.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "concurrency.hpp"
+#include "match.hpp"
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <tuple>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+namespace m = c::Matchers;
+
+using namespace std::chrono_literals;
+
+auto make_starter() { return p::make_starter(c::rngSeed()); }
+
+} // namespace
+
+TEST_CASE("seqlock round trip") {
+  p::seqlock_t<std::array<int, 5>> lock{{1, 2, 3, 4, 5}};
+  CHECK(lock.load() == std::array{1, 2, 3, 4, 5});
+  lock.store({5, 4, 3, 2, 1});
+  CHECK(lock.load() == std::array{5, 4, 3, 2, 1});
+  CHECK(lock.version() == 2);
+}
+
+TEST_CASE("seqlock readers never observe torn writes") {
+  // every published value has all elements equal, so any torn read would
+  // show up as a mix of elements
+  p::seqlock_t<std::array<std::uint64_t, 16>> lock;
+  std::atomic<bool> done{false};
+
+  std::jthread writer{[&]() {
+    for (std::uint64_t i = 0; i < 1 << 16; ++i) {
+      std::array<std::uint64_t, 16> value;
+      value.fill(i);
+      lock.store(value);
+    }
+    done = true;
+  }};
+
+  std::uint64_t last = 0;
+  while (!done) {
+    const auto value = lock.load();
+    REQUIRE(std::all_of(value.begin(), value.end(),
+                        [&](auto v) { return v == value[0]; }));
+    REQUIRE(value[0] >= last);
+    last = value[0];
+  }
+}
+
+TEST_CASE("interpolate snapshots") {
+  p::snapshot_t from{};
+  from.puck = {0.f, 10.f};
+  from.rhs_paddle = {0.f, 0.f, 4.f, 40.f};
+  p::snapshot_t to = from;
+  to.puck = {10.f, 20.f};
+  to.rhs_paddle = {0.f, 10.f, 4.f, 50.f};
+
+  const auto half = p::interpolate(from, to, .5f);
+  CHECK(half.puck == std::array{5.f, 15.f});
+  CHECK(half.rhs_paddle == std::array{0.f, 5.f, 4.f, 45.f});
+
+  CHECK(p::interpolate(from, to, 0.f).puck == from.puck);
+  CHECK(p::interpolate(from, to, 1.f).puck == to.puck);
+
+  // puck restarted
+  ++to.lhs_score;
+  CHECK(p::interpolate(from, to, .5f).puck == to.puck);
+}
+
+TEST_CASE("simulation advances in fixed ticks") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}};
+
+  const p::simulation_t::clock_t::time_point start{1s};
+  s.advance_to(start);
+  CHECK(s.frame().current.tick == 1);
+
+  // not yet due
+  s.advance_to(start + period / 2);
+  CHECK(s.frame().current.tick == 1);
+
+  s.advance_to(start + period * 3);
+  CHECK(s.frame().current.tick == 4);
+  CHECK(s.frame().previous.tick == 3);
+
+  // a long stall only catches up a bounded number of ticks
+  s.advance_to(start + period * 1000);
+  CHECK(s.frame().current.tick == 4 + p::simulation_t::max_catch_up_ticks);
+}
+
+TEST_CASE("simulation is independent of the rate at which it is driven") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t a{make_starter(), c::rngSeed(), p::rules_t{}};
+  p::simulation_t b{make_starter(), c::rngSeed(), p::rules_t{}};
+
+  const p::simulation_t::clock_t::time_point start{1s};
+
+  for (int i = 0; i < 1 << 10; ++i) {
+    a.advance_to(start + period * i);
+  }
+
+  for (int i = 0; i < 1 << 10; i += 4) {
+    b.advance_to(start + period * i);
+  }
+  b.advance_to(start + period * 1023);
+
+  const auto sa = a.frame().current;
+  const auto sb = b.frame().current;
+  CHECK(sa.tick == sb.tick);
+  CHECK(sa.puck == sb.puck);
+  CHECK(sa.lhs_paddle == sb.lhs_paddle);
+  CHECK(sa.lhs_score == sb.lhs_score);
+  CHECK(sa.rhs_score == sb.rhs_score);
+}
+
+TEST_CASE("simulation controls") {
+  p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}};
+  const p::simulation_t::clock_t::time_point start{1s};
+
+  // paddles are resized about the centre of the arena
+  s.set_rules({.paddle_size = 60.f, .ai_skill = 50, .winning_score = 5});
+  s.advance_to(start);
+
+  const auto rhs = s.frame().current.rhs_paddle;
+  CHECK_THAT(rhs[3] - rhs[1], m::WithinAbs(60.f, 1e-3f));
+  CHECK_THAT(rhs[1], m::WithinAbs(240.f - 30.f, 1e-3f));
+}
+
+TEST_CASE("wheel input is applied at the time it happened") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(),
+                    p::rules_t{.mouse_wheel_sensitivity = 10.f}};
+  const p::simulation_t::clock_t::time_point start{1s};
+  s.advance_to(start);
+  const auto y0 = s.frame().current.rhs_paddle[1];
+
+  // halfway through the next tick, so half of the movement happens in it and
+  // the rest in the tick after
+  s.input({start + period / 2, p::input_t::kind_t::wheel, 1.f});
+  s.advance_to(start + period);
+  CHECK_THAT(s.frame().current.rhs_paddle[1] - y0, m::WithinAbs(5.f, 1e-2f));
+
+  s.advance_to(start + period * 2);
+  CHECK_THAT(s.frame().current.rhs_paddle[1] - y0, m::WithinAbs(10.f, 1e-2f));
+
+  s.advance_to(start + period * 3);
+  CHECK_THAT(s.frame().current.rhs_paddle[1] - y0, m::WithinAbs(10.f, 1e-2f));
+}
+
+TEST_CASE("wheel input is independent of the tick rate") {
+  const p::simulation_t::clock_t::time_point start{1s};
+  p::scalar_t moved[2];
+
+  for (int i = 0; i < 2; ++i) {
+    const auto period = std::chrono::milliseconds{i == 0 ? 1 : 7};
+    p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}, period};
+    s.advance_to(start);
+    const auto y0 = s.frame().current.rhs_paddle[1];
+
+    for (int j = 1; j <= 5; ++j) {
+      s.input({start + j * 3ms, p::input_t::kind_t::wheel, -1.f});
+    }
+
+    for (auto t = start; t < start + 100ms; t += period) {
+      s.advance_to(t);
+    }
+
+    moved[i] = s.frame().current.rhs_paddle[1] - y0;
+  }
+
+  CHECK_THAT(moved[0], m::WithinAbs(-25.f, 1e-2f));
+  CHECK_THAT(moved[1], m::WithinAbs(-25.f, 1e-2f));
+}
+
+TEST_CASE("key input holds the paddle at a fixed speed") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}};
+  const p::simulation_t::clock_t::time_point start{1s};
+  s.advance_to(start);
+  const auto y0 = s.frame().current.rhs_paddle[1];
+
+  s.input({start + period / 4, p::input_t::kind_t::down, 1.f});
+  s.input({start + period / 2, p::input_t::kind_t::down, 0.f});
+  s.advance_to(start + period);
+
+  CHECK_THAT(s.frame().current.rhs_paddle[1] - y0,
+             m::WithinAbs(p::simulation_t::key_paddle_speed *
+                              std::chrono::duration<float>(period / 4).count(),
+                          1e-2f));
+}
+
+TEST_CASE("spsc queue") {
+  p::spsc_queue_t<int, 4> q;
+  CHECK(!q.front());
+  CHECK(q.push(1));
+  CHECK(q.push(2));
+  CHECK(q.push(3));
+  CHECK(q.push(4));
+  CHECK(!q.push(5));
+  REQUIRE(q.front());
+  CHECK(*q.front() == 1);
+  q.pop();
+  CHECK(q.push(5));
+
+  for (int i = 2; i <= 5; ++i) {
+    REQUIRE(q.front());
+    CHECK(*q.front() == i);
+    q.pop();
+  }
+  CHECK(!q.front());
+}
+
+TEST_CASE("spsc queue preserves order across threads") {
+  p::spsc_queue_t<std::uint64_t, 64> q;
+  constexpr std::uint64_t count = 1 << 16;
+
+  std::jthread producer{[&]() {
+    for (std::uint64_t i = 0; i < count;) {
+      if (q.push(i))
+        ++i;
+    }
+  }};
+
+  for (std::uint64_t expected = 0; expected < count;) {
+    if (const auto *v = q.front()) {
+      REQUIRE(*v == expected);
+      q.pop();
+      ++expected;
+    }
+  }
+}
+
+TEST_CASE("pipe blocks rather than dropping values") {
+  p::pipe_t<std::uint64_t, 4> pipe;
+  constexpr std::uint64_t count = 1 << 14;
+
+  std::jthread producer{[&]() {
+    for (std::uint64_t i = 0; i < count; ++i)
+      pipe.push(i);
+  }};
+
+  for (std::uint64_t expected = 0; expected < count; ++expected)
+    REQUIRE(pipe.pop() == expected);
+}
+
+TEST_CASE("simulation thread publishes frames") {
+  p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}, 1ms};
+  s.start();
+
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (s.frame().current.tick < 10 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+
+  const auto f = s.frame();
+  CHECK(f.current.tick >= 10);
+  CHECK(f.previous.tick + 1 == f.current.tick);
+}
+
+TEST_CASE("the simulation thread keeps time while its reader is busy") {
+  // as when the browser's main thread janks, or a background tab's animation
+  // frames are throttled: nothing but the simulation's own thread (a Web
+  // Worker there) advances it
+  p::simulation_t s{make_starter(), c::rngSeed(), p::rules_t{}, 1ms};
+  s.start();
+
+  const auto before = s.frame().current.tick;
+  const auto busy = std::chrono::steady_clock::now() + 50ms;
+  while (std::chrono::steady_clock::now() < busy) {
+  }
+
+  // allowing for a slow start, and for the catch up limit under a loaded
+  // scheduler
+  CHECK(s.frame().current.tick >= before + 20);
+}
+
+TEST_CASE("a won simulation is idle until its controls change") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(),
+                    p::rules_t{.ai_skill = 95, .winning_score = 1}};
+  const p::simulation_t::clock_t::time_point start{1s};
+
+  int i = 0;
+  for (; i < 120 * 60 * 5 && !s.idle(); ++i) {
+    CHECK(s.frame().current.in_play);
+    s.advance_to(start + period * i);
+  }
+  REQUIRE(s.idle());
+  CHECK(!s.frame().current.in_play);
+
+  s.advance_to(start + period * ++i);
+  CHECK(s.idle());
+
+  // pending controls may change what's shown, so there's something to do
+  s.set_rules({.ai_skill = 95, .winning_score = 1});
+  CHECK(!s.idle());
+  s.advance_to(start + period * ++i);
+  CHECK(s.idle());
+
+  s.reset_scores();
+  CHECK(!s.idle());
+  s.advance_to(start + period * ++i);
+  CHECK(!s.idle());
+  CHECK(s.frame().current.in_play);
+}
+
+TEST_CASE("an idle simulation thread sleeps until woken") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(),
+                    p::rules_t{.ai_skill = 95, .winning_score = 1}};
+
+  // play the match out, quicker than real time
+  const p::simulation_t::clock_t::time_point start{1s};
+  for (int i = 0; i < 120 * 60 * 5 && !s.idle(); ++i)
+    s.advance_to(start + period * i);
+  REQUIRE(s.idle());
+
+  s.start();
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  const auto tick = s.frame().current.tick;
+  std::this_thread::sleep_for(20ms);
+  CHECK(s.frame().current.tick == tick);
+
+  s.reset_scores();
+  while (s.frame().current.tick < tick + 10 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  CHECK(s.frame().current.tick >= tick + 10);
+  CHECK(s.frame().current.in_play);
+}
+
+TEST_CASE("an idle simulation thread drains the inputs queued while asleep") {
+  const auto period = p::simulation_t::default_tick_period;
+  p::simulation_t s{make_starter(), c::rngSeed(),
+                    p::rules_t{.ai_skill = 95, .winning_score = 1}};
+
+  const p::simulation_t::clock_t::time_point start{1s};
+  for (int i = 0; i < 120 * 60 * 5 && !s.idle(); ++i)
+    s.advance_to(start + period * i);
+  REQUIRE(s.idle());
+  s.start();
+
+  // more presses and releases than the queue holds, a drain apart; the
+  // last release must not be lost, or the paddle would move on waking
+  for (int batch = 0; batch < 2; ++batch) {
+    for (int i = 0; i < 100; ++i) {
+      const auto now = p::simulation_t::clock_t::now();
+      CHECK(s.input({now, p::input_t::kind_t::up, 1}));
+      CHECK(s.input({now, p::input_t::kind_t::up, 0}));
+    }
+    std::this_thread::sleep_for(p::simulation_t::idle_drain_period * 2);
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  const auto tick = s.frame().current.tick;
+  s.reset_scores();
+  while (s.frame().current.tick < tick + 10 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  const auto frame = s.frame();
+  CHECK(frame.current.tick >= tick + 10);
+  CHECK(frame.current.rhs_paddle == frame.previous.rhs_paddle);
+}
+
+TEST_CASE("matches replay exactly from their seed") {
+  const p::rules_t rules{.ai_skill = 50, .winning_score = 3};
+  p::match_t a{c::rngSeed(), rules};
+  p::match_t b{c::rngSeed(), rules};
+
+  constexpr p::scalar_t dt = 1.f / 120;
+  for (int i = 0; i < 120 * 60 * 10 && a.in_play(); ++i) {
+    a.tick(dt);
+    b.tick(dt);
+    const auto sa = a.snapshot(i);
+    const auto sb = b.snapshot(i);
+    REQUIRE(sa.puck == sb.puck);
+    REQUIRE(sa.lhs_paddle == sb.lhs_paddle);
+    REQUIRE(sa.rhs_paddle == sb.rhs_paddle);
+    REQUIRE(sa.lhs_score == sb.lhs_score);
+    REQUIRE(sa.rhs_score == sb.rhs_score);
+  }
+
+  // a match stops once it has been won
+  CHECK(!a.in_play());
+  CHECK(std::max(a.arena().lhs_score(), a.arena().rhs_score()) == 3);
+  const auto before = a.snapshot(0);
+  CHECK(a.tick(dt) == 0);
+  CHECK(a.snapshot(0).puck == before.puck);
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch_all.hpp>
+
+#include "alloc.hpp"
+#include "headless_fixture.hpp"
+#include "spectator.hpp"
+
+#include "imgui.h"
+
+namespace {
+namespace p = pong;
+namespace a = p::alloc;
+namespace c = Catch;
+
+struct fixture_t : p::headless_fixture_t {
+  explicit fixture_t(int columns, int rows, const p::rules_t &rules = {})
+      : headless_fixture_t{{1920, 1080}},
+        spectator{columns, rows, c::rngSeed(), rules} {}
+
+  const ImDrawData &frame() {
+    return build([this](clock_t::time_point now) { spectator.frame(now); });
+  }
+
+  p::spectator_t spectator;
+};
+
+} // namespace
+
+TEST_CASE("spectators see every arena") {
+  fixture_t one{1, 1};
+  const auto single = one.frame().TotalVtxCount;
+
+  fixture_t wall{20, 20};
+  const auto &draw_data = wall.frame();
+
+  // every arena has its outline, centre line, puck and paddles; scores are
+  // text, so not counted
+  CHECK(draw_data.TotalVtxCount > 400 * 20);
+  CHECK(draw_data.TotalVtxCount > single);
+  CHECK(wall.frame().TotalVtxCount == draw_data.TotalVtxCount);
+}
+
+TEST_CASE("a wall is split into lists a renderer without offsets can index") {
+  int total = 0;
+  {
+    fixture_t f{40, 30};
+    total = f.frame().TotalVtxCount;
+  }
+  REQUIRE(total > 0x10000);
+
+  fixture_t f{40, 30};
+  f.headless.io().BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+  const auto &draw_data = f.frame();
+  CHECK(draw_data.TotalVtxCount == total);
+  CHECK(draw_data.CmdListsCount > 1);
+  for (int i = 0; i < draw_data.CmdListsCount; ++i) {
+    const auto &list = *draw_data.CmdLists[i];
+    INFO(i);
+    CHECK(list.VtxBuffer.Size <= 0x10000);
+    for (const auto &cmd : list.CmdBuffer)
+      CHECK(cmd.VtxOffset == 0);
+  }
+}
+
+TEST_CASE("spectator outlines are tessellated once per layout") {
+  fixture_t f{4, 3};
+
+  for (int i = 0; i < 10; ++i)
+    f.frame();
+  CHECK(f.spectator.layouts() == 1);
+
+  f.headless.io().DisplaySize = {1280, 720};
+  for (int i = 0; i < 10; ++i)
+    f.frame();
+  CHECK(f.spectator.layouts() == 2);
+}
+
+TEST_CASE("finished spectator matches are replaced") {
+  fixture_t f{2, 2, {.ai_skill = 5, .winning_score = 1}};
+
+  // a minute at 60 fps
+  for (int i = 0; i < 60 * 60 && f.spectator.restarts() == 0; ++i)
+    f.frame();
+  CHECK(f.spectator.restarts() > 0);
+}
+
+TEST_CASE("steady state spectator frames don't allocate") {
+  fixture_t f{20, 20};
+
+  // the first frames size ImGui's buffers
+  for (int i = 0; i < 120; ++i)
+    f.frame();
+
+  a::counts_t counts;
+  {
+    a::scope_t scope;
+    for (int i = 0; i < 120; ++i)
+      f.frame();
+    counts = scope.counts();
+  }
+
+  CHECK(counts.allocations == 0);
+}
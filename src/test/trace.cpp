@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+
+#include "model.hpp"
+#include "trace.hpp"
+
+#include <sstream>
+#include <thread>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+auto count(const std::string &s, const std::string &what) {
+  std::size_t n = 0;
+  for (auto i = s.find(what); i != std::string::npos; i = s.find(what, i + 1))
+    ++n;
+  return n;
+}
+
+} // namespace
+
+TEST_CASE("spans and counters are exported as chrome trace events") {
+  p::trace::clear();
+
+  {
+    PONG_TRACE_SCOPE("outer");
+    PONG_TRACE_SCOPE("inner");
+    PONG_TRACE_COUNTER("things", 42);
+  }
+
+  std::ostringstream os;
+  p::trace::write(os);
+  const auto json = os.str();
+
+  CHECK(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  CHECK(json.ends_with("]}\n"));
+  CHECK(count(json, R"("ph":"X")") == 2);
+  CHECK(count(json, R"("name":"outer")") == 1);
+  CHECK(count(json, R"("name":"inner")") == 1);
+  CHECK(count(json, R"("ph":"C","pid":1,)") == 1);
+  CHECK(count(json, R"("args":{"value":42})") == 1);
+}
+
+TEST_CASE("each thread has its own named buffer") {
+  p::trace::clear();
+
+  std::jthread{[] {
+    PONG_TRACE_THREAD_NAME("worker");
+    PONG_TRACE_SCOPE("work");
+  }}.join();
+
+  std::ostringstream os;
+  p::trace::write(os);
+  const auto json = os.str();
+
+  CHECK(count(json, R"("name":"thread_name","args":{"name":"worker"})") == 1);
+  CHECK(count(json, R"("name":"work")") == 1);
+}
+
+TEST_CASE("the model is traced") {
+  p::trace::clear();
+
+  p::arena_t a{p::make_starter(c::rngSeed())};
+  p::ai_t ai{c::rngSeed(), 0.f};
+  static_cast<void>(ai.paddle_speed(a, a.lhs_paddle()));
+  a.advance_time(1.f / 60.f);
+
+  std::ostringstream os;
+  p::trace::write(os);
+  const auto json = os.str();
+
+  CHECK(count(json, R"("name":"arena_t::advance_time")") == 1);
+  CHECK(count(json, R"("name":"ai_t::paddle_speed")") == 1);
+  CHECK(count(json, R"("name":"estimate_next_collision")") == 1);
+  CHECK(count(json, R"("name":"arena_t::next_action")") >= 1);
+  CHECK(count(json, R"("name":"paddle_t::next_action")") >= 2);
+}
@@ -0,0 +1,133 @@
+#include <catch2/catch_all.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "match.hpp"
+#include "trajectory.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+namespace m = c::Matchers;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+// within a small fraction of a pixel, allowing for the different rounding of
+// one long straight line and the server's many short ones
+bool close(const p::snapshot_t &a, const p::snapshot_t &b) {
+  constexpr p::scalar_t tolerance = 1e-2f;
+  auto near = [](auto &x, auto &y) {
+    for (std::size_t i = 0; i < x.size(); ++i)
+      if (!(std::abs(x[i] - y[i]) <= tolerance))
+        return false;
+    return true;
+  };
+  return a.tick == b.tick && near(a.puck, b.puck) &&
+         near(a.lhs_paddle, b.lhs_paddle) && near(a.rhs_paddle, b.rhs_paddle) &&
+         a.lhs_score == b.lhs_score && a.rhs_score == b.rhs_score &&
+         a.in_play == b.in_play;
+}
+
+// a player at the keyboard, who holds up or down until the paddle is level
+// with the puck and lets go until it's well away again
+class player_t {
+public:
+  p::scalar_t operator()(const p::snapshot_t &s) {
+    const auto paddle = (s.rhs_paddle[1] + s.rhs_paddle[3]) / 2;
+    const auto gap = s.puck[1] - paddle;
+    if (speed_ == 0 && std::abs(gap) > 20)
+      speed_ = gap > 0 ? p::simulation_t::key_paddle_speed
+                       : -p::simulation_t::key_paddle_speed;
+    else if (speed_ * gap <= 0)
+      speed_ = 0;
+    return speed_;
+  }
+
+private:
+  p::scalar_t speed_{};
+};
+
+} // namespace
+
+TEST_CASE("a match is reconstructed from its events alone") {
+  const p::rules_t rules{.ai_skill = 80, .winning_score = 3};
+  p::remote_match_t match{c::rngSeed(), rules};
+  p::trajectory_t trajectory{dt};
+
+  std::vector<p::event_t> events;
+  p::keyframe(match.arena(), 0, dt, match.in_play(), events);
+  for (const auto &e : events)
+    CHECK(trajectory.apply(e));
+  REQUIRE(trajectory.complete());
+  CHECK(close(trajectory.snapshot(0), match.snapshot()));
+
+  player_t player;
+  std::size_t changes = 0;
+  // until the match is won, some minutes at most
+  for (int t = 0; t < 60 * 60 * 10 && match.in_play(); ++t) {
+    match.command(player(match.snapshot()));
+    events.clear();
+    match.tick(dt, &events);
+    changes += events.size();
+    // as the server sends now and then, to stop rounding errors growing
+    if (match.ticks() % 60 == 0)
+      p::keyframe(match.arena(), match.ticks(), dt, match.in_play(), events);
+    for (const auto &e : events) {
+      CHECK(e.tick == match.ticks());
+      CHECK(e.offset >= 0);
+      CHECK(e.offset <= dt);
+      trajectory.apply(e);
+    }
+
+    const auto expected = match.snapshot();
+    const auto actual = trajectory.snapshot(match.ticks());
+    if (!close(actual, expected)) {
+      FAIL_CHECK("diverged at tick " << match.ticks());
+      break;
+    }
+  }
+  CHECK_FALSE(match.in_play());
+
+  // far fewer changes than ticks
+  CHECK(changes * 5 < match.ticks());
+}
+
+TEST_CASE("late and repeated events don't undo later ones") {
+  p::trajectory_t trajectory{dt};
+  CHECK_FALSE(trajectory.complete());
+
+  const p::event_t later{.tick = 10,
+                         .offset = dt / 2,
+                         .body = p::body_t::puck,
+                         .position = {100, 100},
+                         .velocity = {60, 0}};
+  p::event_t earlier = later;
+  earlier.tick = 9;
+  earlier.position = {0, 0};
+
+  CHECK(trajectory.apply(later));
+  CHECK_FALSE(trajectory.apply(earlier));
+  CHECK(trajectory.tick() == 10);
+
+  // half a tick on from the event, at 60 pixels a second
+  const auto s = trajectory.snapshot(10);
+  CHECK_THAT(s.puck[0], m::WithinAbs(100.5, 1e-3));
+  CHECK(s.puck[1] == 100);
+}
+
+TEST_CASE("a reconstructed paddle stops at the top and bottom") {
+  const p::rules_t rules{};
+  p::trajectory_t trajectory{dt};
+  CHECK(trajectory.apply({.tick = 1,
+                          .body = p::body_t::rhs_paddle,
+                          .position = {420, 420 + rules.paddle_size},
+                          .velocity = {0, 400}}));
+
+  p::arena_t arena{p::make_starter(c::rngSeed())};
+  const auto s = trajectory.snapshot(60);
+  CHECK(s.rhs_paddle[3] == arena.box().max()(1) - 1);
+  CHECK(s.rhs_paddle[1] == s.rhs_paddle[3] - rules.paddle_size);
+}
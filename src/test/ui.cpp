@@ -0,0 +1,93 @@
+#include <catch2/catch_all.hpp>
+
+#include "alloc.hpp"
+#include "headless_fixture.hpp"
+#include "simulation.hpp"
+#include "ui.hpp"
+
+#include "imgui.h"
+
+#include <memory>
+
+namespace {
+namespace p = pong;
+namespace a = p::alloc;
+namespace c = Catch;
+
+struct fixture_t : p::headless_fixture_t {
+  fixture_t()
+      : simulation{p::make_starter(c::rngSeed()), c::rngSeed(),
+                   p::rules(p::settings_t{})},
+        ui{simulation, profile.get()} {
+    simulation.profile(profile.get());
+  }
+
+  // advance the simulation and build the next frame
+  const ImDrawData &frame() {
+    return build([this](clock_t::time_point now) {
+      simulation.advance_to(now);
+      ui.frame(now);
+    });
+  }
+
+  const std::unique_ptr<p::profile_t> profile =
+      std::make_unique<p::profile_t>();
+  p::simulation_t simulation;
+  p::ui_t ui;
+};
+
+} // namespace
+
+TEST_CASE("ui frames build headless") {
+  fixture_t f;
+  const auto &draw_data = f.frame();
+  CHECK(draw_data.CmdListsCount > 0);
+  CHECK(draw_data.TotalVtxCount > 0);
+  CHECK(draw_data.TotalIdxCount > 0);
+}
+
+TEST_CASE("F1 toggles the profile window") {
+  fixture_t f;
+  auto &io = f.headless.io();
+
+  const auto without = f.frame().CmdListsCount;
+  CHECK(!f.ui.show_profile());
+
+  io.AddKeyEvent(ImGuiKey_F1, true);
+  CHECK(f.frame().CmdListsCount > without);
+  CHECK(f.ui.show_profile());
+
+  io.AddKeyEvent(ImGuiKey_F1, false);
+  f.frame();
+  io.AddKeyEvent(ImGuiKey_F1, true);
+  CHECK(f.frame().CmdListsCount == without);
+  CHECK(!f.ui.show_profile());
+}
+
+TEST_CASE("steady state ui frames don't allocate") {
+  fixture_t f;
+  auto &io = f.headless.io();
+
+  auto move = [&](int i) {
+    io.AddMousePosEvent(200.f + float(i % 60) * 4.f, 300.f);
+    io.AddMouseWheelEvent(0.f, i % 2 ? 1.f : -1.f);
+  };
+
+  // the first frames size ImGui's buffers
+  for (int i = 0; i < 120; ++i) {
+    move(i);
+    f.frame();
+  }
+
+  a::counts_t counts;
+  {
+    a::scope_t scope;
+    for (int i = 0; i < 120; ++i) {
+      move(i);
+      f.frame();
+    }
+    counts = scope.counts();
+  }
+
+  CHECK(counts.allocations == 0);
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch_all.hpp>
+
+#include "video.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+
+// bytes per 640 x 480 frame, after the stream or frame header
+constexpr std::size_t frame_bytes = 640 * 480 * 3;
+
+p::video_options_t options(double seconds) {
+  p::video_options_t options;
+  options.seed = c::rngSeed();
+  options.seconds = seconds;
+  options.threads = 2;
+  return options;
+}
+
+} // namespace
+
+TEST_CASE("y4m frames are 4:4:4 BT.601") {
+  p::framebuffer_t framebuffer{2, 1};
+  framebuffer.at(0, 0) = IM_COL32(0, 0, 0, 255);
+  framebuffer.at(1, 0) = IM_COL32(255, 255, 255, 255);
+
+  std::ostringstream os;
+  p::video_writer_t writer{os, p::video_format_t::y4m, 30};
+  writer.write(framebuffer);
+  writer.write(framebuffer);
+
+  const std::string header = "YUV4MPEG2 W2 H1 F30:1 Ip A1:1 C444\n";
+  const std::string frame = "FRAME\n"
+                            "\x10\xeb"  // Y: black, white
+                            "\x80\x80"  // U
+                            "\x80\x80"; // V
+  CHECK(os.str() == header + frame + frame);
+}
+
+TEST_CASE("ppm streams are concatenated images") {
+  p::framebuffer_t framebuffer{1, 1};
+  framebuffer.at(0, 0) = IM_COL32(1, 2, 3, 255);
+
+  std::ostringstream os;
+  p::video_writer_t writer{os, p::video_format_t::ppm, 60};
+  writer.write(framebuffer);
+  writer.write(framebuffer);
+
+  CHECK(os.str() == "P6\n1 1\n255\n\x01\x02\x03"
+                    "P6\n1 1\n255\n\x01\x02\x03");
+}
+
+TEST_CASE("matches export at a fixed frame rate") {
+  auto o = options(1.5);
+  o.fps = 30;
+
+  std::ostringstream os;
+  const auto stats = p::write_video(os, o);
+
+  CHECK(stats.frames == 45);
+  CHECK(stats.ticks == 176); // the last frame is at 44 / 30 s
+  const std::string header = "YUV4MPEG2 W640 H480 F30:1 Ip A1:1 C444\n";
+  REQUIRE(os.str().size() == header.size() + 45 * (6 + frame_bytes));
+  CHECK(os.str().starts_with(header));
+}
+
+TEST_CASE("exports are reproducible") {
+  const auto o = options(1);
+
+  std::ostringstream a;
+  std::ostringstream b;
+  p::write_video(a, o);
+  p::write_video(b, o);
+
+  REQUIRE(a.str().size() == b.str().size());
+  CHECK(a.str() == b.str());
+
+  // and the frames differ as the match moves
+  const auto header = a.str().find('\n') + 1;
+  const auto first = a.str().substr(header, 6 + frame_bytes);
+  const auto last = a.str().substr(a.str().size() - 6 - frame_bytes);
+  CHECK(first != last);
+}
+
+TEST_CASE("exports stop shortly after the match is won") {
+  auto o = options(600);
+  o.rules.ai_skill = 5;
+  o.rules.winning_score = 1;
+  o.hold = .5;
+  o.format = p::video_format_t::ppm;
+
+  std::ostringstream os;
+  const auto stats = p::write_video(os, o);
+
+  CHECK(!stats.last.in_play);
+  CHECK(std::max(stats.last.lhs_score, stats.last.rhs_score) == 1);
+  CHECK(stats.frames < 600 * 60);
+  CHECK(os.str().size() == stats.frames * (15 + frame_bytes));
+}
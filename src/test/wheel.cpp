@@ -0,0 +1,110 @@
+#include <catch2/catch_all.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "match.hpp"
+#include "wheel.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+namespace p = pong;
+namespace c = Catch;
+namespace m = c::Matchers;
+
+constexpr p::scalar_t dt = 1.f / 60.f;
+
+} // namespace
+
+TEST_CASE("timers are woken at their ticks, however far off") {
+  p::timer_wheel_t wheel;
+  std::mt19937_64 prng{c::rngSeed()};
+  // when each id is to be woken, as the wheel should have it
+  std::map<std::uint32_t, std::uint64_t> timers;
+
+  std::vector<std::uint32_t> woken;
+  for (int i = 0; i < 200'000; ++i) {
+    const auto id = std::uint32_t(prng() % 512);
+    switch (prng() % 4) {
+    case 0:
+      // from the next tick to past a level-3 slot
+      timers[id] = wheel.now() + 1 + prng() % (1u << (3 * 6 + 2));
+      wheel.schedule(id, timers[id]);
+      break;
+    case 1:
+      timers[id] = wheel.now() + 1 + prng() % 100;
+      wheel.schedule(id, timers[id]);
+      break;
+    case 2:
+      timers.erase(id);
+      wheel.cancel(id);
+      break;
+    default:
+      break;
+    }
+    REQUIRE(wheel.size() == timers.size());
+    REQUIRE(wheel.when(id) ==
+            (timers.contains(id) ? std::optional{timers[id]} : std::nullopt));
+
+    // on to the next due, now and then
+    if (prng() % 8 == 0 && !timers.empty()) {
+      const auto next = std::ranges::min_element(timers, {}, [](auto &t) {
+                          return t.second;
+                        })->second;
+      while (wheel.now() < next) {
+        woken.clear();
+        wheel.advance(woken);
+        std::vector<std::uint32_t> due;
+        for (const auto &[id, tick] : timers)
+          if (tick == wheel.now())
+            due.push_back(id);
+        std::ranges::sort(woken);
+        REQUIRE(woken == due);
+        for (const auto id : due)
+          timers.erase(id);
+      }
+    }
+  }
+}
+
+TEST_CASE("a timer beyond the wheel's span is woken at its end") {
+  p::timer_wheel_t wheel{p::timer_wheel_t::span * 3 - 10};
+  wheel.schedule(7, wheel.now() + p::timer_wheel_t::span * 2);
+  CHECK(wheel.when(7) == wheel.now() + p::timer_wheel_t::span - 1);
+
+  // a timer already due is woken next tick
+  wheel.schedule(8, 0);
+  std::vector<std::uint32_t> woken;
+  wheel.advance(woken);
+  CHECK(woken == std::vector<std::uint32_t>{8});
+}
+
+TEST_CASE("a match skipped until its next ticks misses nothing") {
+  p::remote_match_t match{c::rngSeed(), {.ai_skill = 80, .winning_score = 3}};
+  std::mt19937 prng{c::rngSeed()};
+
+  std::vector<p::event_t> events;
+  std::size_t ticked = 0;
+  while (match.in_play()) {
+    REQUIRE(match.ticks() < 60 * 60 * 10);
+    const auto next = match.next_tick(dt, 60);
+    REQUIRE(next > match.ticks());
+    REQUIRE(next <= match.ticks() + 60);
+
+    // nothing happens in the ticks skipped
+    match.skip(next - 1 - match.ticks(), dt, &events);
+    CHECK(events.empty());
+    match.tick(dt, &events);
+    ++ticked;
+    events.clear();
+
+    // a command now and then, for a tick a little ahead
+    if (prng() % 8 == 0)
+      match.command(std::uint32_t(ticked),
+                    p::scalar_t(int(prng() % 801) - 400),
+                    match.ticks() + prng() % 8);
+  }
+  CHECK(ticked * 4 < match.ticks());
+}